@@ -7,6 +7,50 @@
 #include <map>
 #include <memory>
 #include <set>
+#include <array>
+#include <cstdint>
+#include <stdexcept>
+#include <cstdio>
+#include <cstddef>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <atomic>
+#include <thread>
+#include <chrono>
+#include <string_view>
+#include <limits>
+#include <future>
+#include <unordered_map>
+#include <mutex>
+#include <charconv>
+#include <cmath>
+#include <type_traits>
+#include <deque>
+#include <queue>
+#include <coroutine>
+#include <utility>
+#include <sstream>
+#include <functional>
+#include <ctime>
+#include <numeric>
+#include <cstdlib>
+#include <new>
+#include <condition_variable>
+#include <cerrno>
+#include <csignal>
+#include <malloc.h>
+#include <poll.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
 
 
 namespace Game {
@@ -77,17 +121,102 @@ std::ostream& operator<<(std::ostream& os, const Card& card) {
     return os;
 }
 
+// Compact card encoding used by the fast code paths: rank_index * 4 + suit_index
+// rank_index 0..12 stands for "2".."A", suit_index 0..3 for "♥", "♦", "♣", "♠"
+const std::uint8_t no_card = 0xFF;
+const char* const rank_symbols[13] = { "2", "3", "4", "5", "6", "7", "8", "9", "10", "J", "Q", "K", "A" };
+const char* const suit_symbols[4] = { "♥", "♦", "♣", "♠" };
+
+// Converts a card to its compact index, or no_card for an empty placeholder card
+std::uint8_t card_index(const Card& card) {
+    for (int rank{0}; rank < 13; rank++) {
+        if (card.get_rank() != rank_symbols[rank]) {
+            continue;
+        }
+        for (int suit{0}; suit < 4; suit++) {
+            if (card.get_suit() == suit_symbols[suit]) {
+                return static_cast<std::uint8_t>(rank * 4 + suit);
+            }
+        }
+    }
+    return no_card;
+}
+
+// Converts a compact index back to a card
+Card card_from_index(std::uint8_t index) {
+    if (index == no_card) {
+        return Card("", "");
+    }
+    return Card(suit_symbols[index % 4], rank_symbols[index / 4]);
+}
+
+// Small and fast random generator (splitmix64) whose whole state is two 64 bit words,
+// so a session can save it, restore it and fork independent streams from it
+class Session_Rng {
+private:
+    std::uint64_t state;
+    std::uint64_t increment;
+
+public:
+    using result_type = std::uint64_t;
+
+    explicit Session_Rng(std::uint64_t seed = std::random_device{}(), std::uint64_t stream = 0)
+        : state(seed), increment(0x9E3779B97F4A7C15ull ^ (stream << 1)) {
+        increment |= 1;  // an odd increment visits every state
+    }
+
+    static constexpr result_type min() { return 0; }
+    static constexpr result_type max() { return ~result_type{0}; }
+
+    result_type operator()() {
+        state += increment;
+        std::uint64_t z = state;
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+        return z ^ (z >> 31);
+    }
+
+    std::uint64_t get_state() const { return state; }
+    std::uint64_t get_increment() const { return increment; }
+
+    void restore(std::uint64_t i_state, std::uint64_t i_increment) {
+        state = i_state;
+        increment = i_increment | 1;
+    }
+
+    // A generator for an independent continuation, used when forking simulations from one position
+    Session_Rng fork(std::uint64_t continuation) const {
+        Session_Rng copy(*this);
+        std::uint64_t mixed = copy();
+        return Session_Rng(mixed ^ (continuation * 0xD1B54A32D192ED03ull), continuation + 1);
+    }
+};
+
+// Standard 52 card deck, or the 36 card short deck (6+) that starts at the sixes
+enum class Deck_Type : std::uint8_t {
+    standard = 0,
+    short_deck = 1
+};
+
+// Lowest compact rank index in a deck of the type
+inline int lowest_rank(Deck_Type deck_type) { return deck_type == Deck_Type::short_deck ? 4 : 0; }
+
 class Card_Container {
 protected:
+    Session_Rng& rng;  // Shared random generator of the game
     std::vector<Card> cards;  // Collection of cards
     std::vector<std::string> suits = { "♥", "♦", "♣", "♠" };  // Available suits
     std::vector<std::string> ranks = { "2", "3", "4", "5", "6", "7", "8", "9", "10", "J", "Q", "K", "A" };  // Available ranks
+    Deck_Type deck_type;
 
 public:
-    Card_Container() {
+    Card_Container(Session_Rng& i_rng, Deck_Type i_deck_type = Deck_Type::standard) : rng(i_rng), deck_type(i_deck_type) {
+        ranks.erase(ranks.begin(), ranks.begin() + lowest_rank(deck_type));
         recreate();
     }
 
+    Deck_Type get_deck_type() const { return deck_type; }
+
     void print_cards() const {
         for (const auto& card : cards) {
             std::cout << card.get_rank() << card.get_suit() << " ";
@@ -104,9 +233,7 @@ public:
             }
         }
 
-        std::random_device rd;
-        std::mt19937 g(rd());
-        std::shuffle(cards.begin(), cards.end(), g);
+        std::shuffle(cards.begin(), cards.end(), rng);
     }
 
     virtual void reset() = 0;  // Virtual function to reset the card container
@@ -119,26 +246,50 @@ class Deck : public Card_Container {
 protected:
     std::vector<Card> game_cards;        // Cards used in the game
     std::vector<Card> community_cards;   // Community cards
+    std::vector<Card> fixed_board;       // Community cards of every deal when set
 
 public:
     int nr_of_community_cards{};         // Number of community cards
     int nr_of_players{};                 // Number of players
+    int nr_of_hole_cards{2};             // Cards dealt to each player, four in Omaha
 
-    Deck(int i_nr_of_players, int i_nr_of_community_cards)
-        : nr_of_players(i_nr_of_players),
-          nr_of_community_cards(i_nr_of_community_cards) {
+    Deck(int i_nr_of_players, int i_nr_of_community_cards, Session_Rng& i_rng, Deck_Type deck_type = Deck_Type::standard,
+         int i_nr_of_hole_cards = 2)
+        : Card_Container(i_rng, deck_type),
+          nr_of_players(i_nr_of_players),
+          nr_of_community_cards(i_nr_of_community_cards),
+          nr_of_hole_cards(i_nr_of_hole_cards) {
+        if (nr_of_community_cards + nr_of_players * nr_of_hole_cards > static_cast<int>(cards.size())) {
+            throw std::invalid_argument("The deck has too few cards for " + std::to_string(nr_of_players) + " players.");
+        }
         populate_game_cards();
     }
 
     void populate_game_cards() {
         // Populate the game cards by taking cards from the card container
-        for (int i{0}; i < nr_of_community_cards + nr_of_players * 2; i++) {
+        int dealt{0};
+        if (fixed_board.size() == static_cast<std::size_t>(nr_of_community_cards)) {
+            // the community cards are taken last, the flop from the back of what is left
+            for (auto it = fixed_board.rbegin(); it != fixed_board.rend(); ++it) {
+                cards.erase(std::remove_if(cards.begin(), cards.end(), [&it](const Card& card) {
+                    return card.get_rank() == it->get_rank() && card.get_suit() == it->get_suit();
+                }), cards.end());
+                game_cards.push_back(*it);
+            }
+            dealt = nr_of_community_cards;
+        }
+        for (int i{dealt}; i < nr_of_community_cards + nr_of_players * nr_of_hole_cards; i++) {
             Card selected_card = cards.back();
             cards.pop_back();
             game_cards.push_back(selected_card);
         }
     }
 
+    // Deals these community cards in every later deal, so stress runs can force equal hands
+    void fix_board(const std::vector<Card>& board) {
+        fixed_board = board;
+    }
+
     Card take_game_card() {
         // Take a card from the game cards
         Card taken_card = game_cards.back();
@@ -147,6 +298,15 @@ public:
         return taken_card;
     }
 
+    // Takes the hole cards of one player
+    std::vector<Card> take_hole_cards() {
+        std::vector<Card> hole_cards;
+        for (int i{0}; i < nr_of_hole_cards; i++) {
+            hole_cards.push_back(take_game_card());
+        }
+        return hole_cards;
+    }
+
     bool flop_is_taken = false;
     void take_flop() {
         // Take the flop cards from the game cards and add them to the community cards
@@ -213,1249 +373,10720 @@ public:
 
 } //namespace Cards end
 
-namespace Players {
+// Fast hand evaluation on compact card indices, used for equity and analytics.
+// Unlike Ranking::evaluate_hand it orders every hand completely, kickers included.
+namespace Eval {
 
-using Cards::Card;
-using Cards::Deck;
-using Game::Bet;
-using Game::Pot;
+// Strength layout: hand category (Poker_Ranks numbering) in bits 20-23, ranks and kickers below,
+// so a bigger strength is always a better hand
+using Strength = std::uint32_t;
 
-class Player {
-protected:
-    std::string name;
-    int chips;
-    Card card1;
-    Card card2;
+constexpr int high_card = 0;
+constexpr int pair = 1;
+constexpr int two_pair = 2;
+constexpr int three_of_a_kind = 3;
+constexpr int straight = 4;
+constexpr int flush = 5;
+constexpr int full_house = 6;
+constexpr int four_of_a_kind = 7;
+constexpr int straight_flush = 8;
 
-public:
-    Player(std::string i_name, int i_chips, Card i_card1, Card i_card2)
-        : name(i_name),
-          card1(i_card1),
-          card2(i_card2),
-          chips(i_chips) {}
+inline int category(Strength strength) { return static_cast<int>(strength >> 20); }
 
-    std::string get_name() const { return name; }
-    int get_chips() const { return chips; }
-    Card get_card1() const { return card1; }
-    Card get_card2() const { return card2; }
-    
-    // Static function to show player information
-    static void show_player_info(std::vector<Player> selected_players) {
-        for (auto &object : selected_players) {
-            std::cout << "Bot opponent: " << object.get_name() << ", chips: " << object.get_chips() << std::endl;
+constexpr int highest_rank(unsigned rank_mask) { return 31 - __builtin_clz(rank_mask); }
+
+// The evaluator tables are built by the compiler: they are read-only data of the binary, shared between
+// processes through the page cache, and the first evaluation does not pay for building them.
+
+// Lookups by 13 bit rank mask
+struct Rank_Tables {
+    std::array<std::uint8_t, 8192> straight_high{};  // top rank of the best straight plus one, 0 without a straight
+    std::array<std::uint32_t, 8192> top_five{};      // the five highest ranks packed in 4 bit groups
+};
+
+constexpr Rank_Tables build_rank_tables() {
+    Rank_Tables built;
+    for (unsigned mask{0}; mask < 8192; mask++) {
+        for (int high{12}; high >= 3; high--) {
+            unsigned run = high == 3 ? 0x100Fu : 0x1Fu << (high - 4);  // five to ace counts with the ace low
+            if ((mask & run) == run) {
+                built.straight_high[mask] = static_cast<std::uint8_t>(high + 1);
+                break;
+            }
         }
+        std::uint32_t packed{0};
+        int taken{0};
+        for (int rank{12}; rank >= 0 && taken < 5; rank--) {
+            if (mask & (1u << rank)) {
+                packed |= static_cast<std::uint32_t>(rank) << (16 - 4 * taken);
+                taken++;
+            }
+        }
+        built.top_five[mask] = packed;
     }
-    
-    bool operator==(const Player& other) const {
-        // Compare the attributes of the Player class, for example:
-        return name == other.name && chips == other.chips; // Add any other attributes you want to compare.
-    }
-    
-    // Player class
-    
-    // Make a bet and add it to the pot
-    std::shared_ptr<Bet> bet(int amount, Pot& pot) {
-        std::string betting_player_name{ get_name() };
-        std::shared_ptr<Bet> bet = std::make_shared<Bet>(amount, betting_player_name);
-        pot.add_to_pot(bet);
-        chips -= amount;
-        
-        return bet;
-    }
-    
-    // Receive a share of the pot
-    void receive_pot_share(int amount) {
-        chips += amount;
-    }
-    
-    // Set new cards for the player
-    void set_new_cards(Card input_card1, Card input_card2) {
-        card1 = input_card1;
-        card2 = input_card2;
-    }
-    
-    // Update the player's chips
-    void update_chips(int new_chips) {
-        chips = new_chips;
+    return built;
+}
+
+inline constexpr Rank_Tables rank_table_data = build_rank_tables();
+
+constexpr const Rank_Tables& rank_tables() { return rank_table_data; }
+
+constexpr Strength make_strength(int hand_category, std::uint32_t ranks) {
+    return (static_cast<Strength>(hand_category) << 20) | ranks;
+}
+
+// Evaluates the best hand out of per suit rank masks and 4 bit rank counts
+constexpr Strength evaluate_masks(const unsigned* suit_masks, std::uint64_t rank_counts) {
+    const Rank_Tables& tables = rank_tables();
+    unsigned ranks = suit_masks[0] | suit_masks[1] | suit_masks[2] | suit_masks[3];
+
+    Strength flush_strength{0};
+    for (int suit{0}; suit < 4; suit++) {
+        if (__builtin_popcount(suit_masks[suit]) >= 5) {
+            if (tables.straight_high[suit_masks[suit]]) {
+                return make_strength(straight_flush, static_cast<std::uint32_t>(tables.straight_high[suit_masks[suit]] - 1) << 16);
+            }
+            flush_strength = make_strength(flush, tables.top_five[suit_masks[suit]]);
+        }
     }
-};
 
-class Bot : public Player {
-public:
-    Bot() : Player("", 0, Card("", ""), Card("", "")) {}
+    unsigned quads{0};
+    unsigned trips{0};
+    unsigned pairs{0};
+    for (int rank{0}; rank < 13; rank++) {
+        unsigned count = (rank_counts >> (4 * rank)) & 0xF;
+        quads |= (count == 4 ? 1u : 0u) << rank;
+        trips |= (count == 3 ? 1u : 0u) << rank;
+        pairs |= (count == 2 ? 1u : 0u) << rank;
+    }
 
-    std::vector<Player> bots;
-    
-    std::vector<std::string> names = { "Alice", "Bence", "Carol", "David", "Eve", "Frank", "Grace", "Helen", "Ivan", "Judy", "Karl", "Laura", "Mike", "Nancy", "Oscar", "Paul", "Quincy", "Rita", "Steve", "Tina" };
-     
-    // Get a bot name from the list
-    std::string take_bot_name() {
-        std::string bot_name = names.back();
-        names.pop_back();
-        return bot_name;
+    if (quads) {
+        int quad = highest_rank(quads);
+        unsigned rest = ranks & ~(1u << quad);
+        return make_strength(four_of_a_kind, quad << 16 | (rest ? highest_rank(rest) << 12 : 0));
     }
-    
-    // Create bots with random cards
-    void create_bots(Deck& deck, int nr_bots, int start_chips) {
-        std::shuffle(names.begin(), names.end(), std::mt19937{std::random_device{}()});
-        for (int i{0}; i < nr_bots; i++) {
-            Card card1 = deck.take_game_card();
-            Card card2 = deck.take_game_card();
-            std::string bot_name = take_bot_name();
-            bots.emplace_back(bot_name, start_chips, card1, card2);
-        }
+    if (trips && (pairs || __builtin_popcount(trips) >= 2)) {
+        int trip = highest_rank(trips);
+        int paired = highest_rank((pairs | trips) & ~(1u << trip));
+        return make_strength(full_house, trip << 16 | paired << 12);
     }
-    
-    // Show information about the default bots
-    void show_default_bots() {
-        for (const auto& object : bots) {
-            std::cout << "This is a default bot player in this game: " << object.get_name()
-                      << ", cards: " << object.get_card1().get_rank() << object.get_card1().get_suit()
-                      << " " << object.get_card2().get_rank() << object.get_card2().get_suit()
-                      << ", chips: " << object.get_chips() << std::endl;
-        }
+    if (flush_strength) {
+        return flush_strength;
     }
-    
-    // Get the bots as a vector of players
-    std::vector<Player> get_bots() {
-        std::vector<Player> local_container;
-        for(auto& bot : bots) {
-            local_container.push_back(bot);
-        }
-        return local_container;
+    if (tables.straight_high[ranks]) {
+        return make_strength(straight, static_cast<std::uint32_t>(tables.straight_high[ranks] - 1) << 16);
     }
-    
-    // Get the number of bots
-    int get_bots_number() {
-        return bots.size();
+    if (trips) {
+        int trip = highest_rank(trips);
+        return make_strength(three_of_a_kind, trip << 16 | (tables.top_five[ranks & ~(1u << trip)] >> 12) << 8);
     }
-    
-    // Redistribute new cards to the bots from the deck
-    void redistribute_bot_cards(Deck& deck) {
-        for (auto& bot : bots) {
-            bot.set_new_cards(deck.take_game_card(), deck.take_game_card());
-        }
+    if (__builtin_popcount(pairs) >= 2) {
+        int high_pair = highest_rank(pairs);
+        int low_pair = highest_rank(pairs & ~(1u << high_pair));
+        unsigned rest = ranks & ~(1u << high_pair) & ~(1u << low_pair);
+        return make_strength(two_pair, high_pair << 16 | low_pair << 12 | (rest ? highest_rank(rest) << 8 : 0));
     }
-
-    // Convert bots to a vector of reference wrappers
-    std::vector<std::reference_wrapper<Player>> refer_updated_bots() {
-        std::vector<std::reference_wrapper<Player>> local_container;
-        for(auto& bot : bots) {
-            local_container.push_back(std::ref(bot));
-        }
-        return local_container;
+    if (pairs) {
+        int paired = highest_rank(pairs);
+        return make_strength(pair, paired << 16 | (tables.top_five[ranks & ~(1u << paired)] >> 8) << 4);
     }
-    
-    void update_bots() {
-        std::vector<std::reference_wrapper<Player>> botRefs = this->refer_updated_bots();
-        bots.clear();
-        for(auto& botRef : botRefs) {
-            Player updatedBot = botRef.get();
-            bots.push_back(updatedBot);
-        }
+    return make_strength(high_card, tables.top_five[ranks]);
+}
+
+// Evaluates the best five card hand among up to seven cards
+inline Strength evaluate(const std::uint8_t* cards, int nr_of_cards) {
+    unsigned suit_masks[4] = {0, 0, 0, 0};
+    std::uint64_t rank_counts{0};
+    for (int i{0}; i < nr_of_cards; i++) {
+        suit_masks[cards[i] & 3] |= 1u << (cards[i] >> 2);
+        rank_counts += 1ull << (4 * (cards[i] >> 2));
     }
+    return evaluate_masks(suit_masks, rank_counts);
+}
 
-    void update_bot_chips(std::string bot_name, int amount){
-        
-        for (auto &object : bots){
-            if (object.get_name() == bot_name){
-                object.update_chips(object.get_chips() - amount);
+// Short deck (6+): 36 cards, the ace also plays low in A-6-7-8-9 and a flush beats a full house.
+// Rank masks only need nine bits (six to ace), so the tables are 512 entries and stay in L1.
+// Short deck strengths swap the flush and full house category codes, so comparing two strengths
+// follows the short deck order; short_deck_category gives the Poker_Ranks numbering back.
+struct Short_Deck_Tables {
+    std::array<std::uint8_t, 512> straight_high{};  // top rank (compact index) of the best straight plus one
+    std::array<std::uint32_t, 512> top_five{};      // the five highest compact ranks packed in 4 bit groups
+};
+
+constexpr Short_Deck_Tables build_short_deck_tables() {
+    Short_Deck_Tables built;
+    for (unsigned mask{0}; mask < 512; mask++) {
+        for (int high{8}; high >= 3; high--) {
+            unsigned run = high == 3 ? 0x10Fu : 0x1Fu << (high - 4);  // nine to ace counts with the ace low
+            if ((mask & run) == run) {
+                built.straight_high[mask] = static_cast<std::uint8_t>(high + 4 + 1);
                 break;
             }
         }
-    }
-    
-    void update_chips_for_bot(const std::string& bot_name, int amount) {
-    for (auto& bot : bots){
-        if (bot.get_name() == bot_name){
-            bot.receive_pot_share(amount);
-            break;
+        std::uint32_t packed{0};
+        int taken{0};
+        for (int rank{8}; rank >= 0 && taken < 5; rank--) {
+            if (mask & (1u << rank)) {
+                packed |= static_cast<std::uint32_t>(rank + 4) << (16 - 4 * taken);
+                taken++;
+            }
         }
+        built.top_five[mask] = packed;
     }
+    return built;
 }
 
-    void delete_defeated_bots() {
-    for (auto it = bots.begin(); it != bots.end();) {
-        if (it->get_chips() == 0) {
-            it = bots.erase(it);  // Use the return value of erase to get a valid iterator
-        } else {
-            ++it;  // Only increment the iterator if we didn't erase an element
-        }
-    }
-}
+inline constexpr Short_Deck_Tables short_deck_table_data = build_short_deck_tables();
 
+constexpr const Short_Deck_Tables& short_deck_tables() { return short_deck_table_data; }
 
+inline int short_deck_category(Strength strength) {
+    int code = category(strength);
+    return code == flush ? full_house : code == full_house ? flush : code;
+}
 
-    
-};
+// Evaluates the best short deck hand out of per suit masks of the ranks from six up (bit 0 is the six).
+// Counts per rank come from the suit masks with bit operations instead of a loop over the ranks.
+inline Strength evaluate_short_deck_masks(const unsigned* m) {
+    const Short_Deck_Tables& tables = short_deck_tables();
+    unsigned ranks = m[0] | m[1] | m[2] | m[3];
 
-class Human : public Player {
-public:
-    
-    // Constructor for the Human player
-    Human(int start_chips, Deck& deck)
-        : Player("Human", start_chips, deck.take_game_card(), deck.take_game_card()) {}
+    Strength flush_strength{0};
+    for (int suit{0}; suit < 4; suit++) {
+        if (__builtin_popcount(m[suit]) >= 5) {
+            if (tables.straight_high[m[suit]]) {
+                return make_strength(straight_flush, static_cast<std::uint32_t>(tables.straight_high[m[suit]] - 1) << 16);
+            }
+            flush_strength = make_strength(full_house, tables.top_five[m[suit]]);
+        }
+    }
 
-    // Show the human player's cards
-    void show_human_cards() {
-        Card c1 = get_card1();
-        Card c2 = get_card2();
-        std::cout << "Your cards are: " << c1.get_rank() << c1.get_suit() << " " << c2.get_rank() << c2.get_suit() << std::endl;
+    unsigned quads = m[0] & m[1] & m[2] & m[3];
+    unsigned three_or_more = (m[0] & m[1] & m[2]) | (m[0] & m[1] & m[3]) | (m[0] & m[2] & m[3]) | (m[1] & m[2] & m[3]);
+    unsigned two_or_more = (m[0] & m[1]) | (m[0] & m[2]) | (m[0] & m[3]) | (m[1] & m[2]) | (m[1] & m[3]) | (m[2] & m[3]);
+    unsigned trips = three_or_more & ~quads;
+    unsigned pairs = two_or_more & ~three_or_more;
+
+    if (quads) {
+        int quad = highest_rank(quads);
+        unsigned rest = ranks & ~(1u << quad);
+        return make_strength(four_of_a_kind, (quad + 4) << 16 | (rest ? (highest_rank(rest) + 4) << 12 : 0));
     }
-    
-    // Redistribute new cards to the human player from the deck
-    void redistribute_human_cards(Deck& deck){
-        this->set_new_cards(deck.take_game_card(), deck.take_game_card());
+    if (flush_strength) {
+        return flush_strength;
     }
-};
+    if (trips && (pairs || __builtin_popcount(trips) >= 2)) {
+        int trip = highest_rank(trips);
+        int paired = highest_rank((pairs | trips) & ~(1u << trip));
+        return make_strength(flush, (trip + 4) << 16 | (paired + 4) << 12);
+    }
+    if (tables.straight_high[ranks]) {
+        return make_strength(straight, static_cast<std::uint32_t>(tables.straight_high[ranks] - 1) << 16);
+    }
+    if (trips) {
+        int trip = highest_rank(trips);
+        return make_strength(three_of_a_kind, (trip + 4) << 16 | (tables.top_five[ranks & ~(1u << trip)] >> 12) << 8);
+    }
+    if (__builtin_popcount(pairs) >= 2) {
+        int high_pair = highest_rank(pairs);
+        int low_pair = highest_rank(pairs & ~(1u << high_pair));
+        unsigned rest = ranks & ~(1u << high_pair) & ~(1u << low_pair);
+        return make_strength(two_pair, (high_pair + 4) << 16 | (low_pair + 4) << 12 | (rest ? (highest_rank(rest) + 4) << 8 : 0));
+    }
+    if (pairs) {
+        int paired = highest_rank(pairs);
+        return make_strength(pair, (paired + 4) << 16 | (tables.top_five[ranks & ~(1u << paired)] >> 8) << 4);
+    }
+    return make_strength(high_card, tables.top_five[ranks]);
+}
 
+// Evaluates the best five card hand among up to seven short deck cards
+inline Strength evaluate_short_deck(const std::uint8_t* cards, int nr_of_cards) {
+    unsigned m[4] = {0, 0, 0, 0};
+    for (int i{0}; i < nr_of_cards; i++) {
+        m[cards[i] & 3] |= 1u << ((cards[i] >> 2) - 4);
+    }
+    return evaluate_short_deck_masks(m);
+}
 
-} // namespace Players end
+// Evaluates with the rules of the deck
+inline Strength evaluate(const std::uint8_t* cards, int nr_of_cards, Cards::Deck_Type deck_type) {
+    return deck_type == Cards::Deck_Type::short_deck ? evaluate_short_deck(cards, nr_of_cards) : evaluate(cards, nr_of_cards);
+}
 
-namespace Game {
+// Poker_Ranks numbering of a strength from either deck
+inline int category(Strength strength, Cards::Deck_Type deck_type) {
+    return deck_type == Cards::Deck_Type::short_deck ? short_deck_category(strength) : category(strength);
+}
 
-using Cards::Deck;
-using Cards::Card;
-using namespace Players;
+// Omaha hands use exactly two of the four hole cards and three of the five board cards. Instead of
+// evaluating all 60 combinations, tables hold the answer per rank pattern: for every multiset of board
+// ranks and every pair of hole ranks the best hand without a flush over the ten board triples, and for
+// every set of three to five suited board ranks and suited hole pair the best flush. A river evaluation
+// is then six reads from one table row plus the suited pairs.
 
+// Binomial coefficients for numbering multisets of ranks
+constexpr std::array<std::array<std::uint16_t, 6>, 19> build_rank_binomials() {
+    std::array<std::array<std::uint16_t, 6>, 19> binomial{};
+    for (int n{0}; n < 19; n++) {
+        binomial[n][0] = 1;
+        for (int k{1}; k < 6 && k <= n; k++) {
+            binomial[n][k] = binomial[n - 1][k - 1] + (k < n ? binomial[n - 1][k] : 0);
+        }
+    }
+    return binomial;
+}
 
-enum class Poker_Ranks {
-    high_card = 0,
-    pair = 1,
-    two_pair = 2,
-    three_of_a_kind = 3,
-    straight = 4,
-    flush = 5,
-    full_house = 6,
-    four_of_a_kind = 7,
-    straight_flush = 8,
-    royal_flush = 9
-    
-    
-};
+inline constexpr std::array<std::array<std::uint16_t, 6>, 19> rank_binomials = build_rank_binomials();
 
+// Index of a multiset of ranks sorted from low to high among all multisets of the same size
+constexpr int multiset_index(const int* sorted_ranks, int size) {
+    int index{0};
+    for (int i{0}; i < size; i++) {
+        index += rank_binomials[sorted_ranks[i] + i][i + 1];
+    }
+    return index;
+}
 
+// Strength of five ranks that cannot make a flush
+constexpr Strength evaluate_ranks(const int* ranks) {
+    unsigned suit_masks[4] = {0, 0, 0, 0};
+    std::uint64_t rank_counts{0};
+    for (int i{0}; i < 5; i++) {
+        int seen = (rank_counts >> (4 * ranks[i])) & 0xF;
+        suit_masks[seen] |= 1u << ranks[i];
+        rank_counts += 1ull << (4 * ranks[i]);
+    }
+    if (__builtin_popcount(suit_masks[0]) == 5) {
+        int lowest = __builtin_ctz(suit_masks[0]);
+        suit_masks[0] &= ~(1u << lowest);
+        suit_masks[1] |= 1u << lowest;
+    }
+    return evaluate_masks(suit_masks, rank_counts);
+}
 
+// Strength of every multiset of five ranks without a flush, 0 for five cards of one rank
+constexpr std::array<Strength, 6188> build_five_rank_strengths() {
+    std::array<Strength, 6188> strengths{};
+    int ranks[5] = {};
+    for (ranks[0] = 0; ranks[0] < 13; ranks[0]++)
+    for (ranks[1] = ranks[0]; ranks[1] < 13; ranks[1]++)
+    for (ranks[2] = ranks[1]; ranks[2] < 13; ranks[2]++)
+    for (ranks[3] = ranks[2]; ranks[3] < 13; ranks[3]++)
+    for (ranks[4] = ranks[3]; ranks[4] < 13; ranks[4]++) {
+        if (ranks[0] != ranks[4]) {
+            strengths[multiset_index(ranks, 5)] = evaluate_ranks(ranks);
+        }
+    }
+    return strengths;
+}
 
+inline constexpr std::array<Strength, 6188> five_rank_strengths = build_five_rank_strengths();
 
+// Position of each suited board rank mask with three to five ranks in the flush table
+constexpr std::array<std::uint16_t, 8192> build_suited_board_index() {
+    std::array<std::uint16_t, 8192> index{};
+    int nr_of_suited_boards{0};
+    for (unsigned mask{0}; mask < 8192; mask++) {
+        int nr_of_ranks = __builtin_popcount(mask);
+        if (nr_of_ranks >= 3 && nr_of_ranks <= 5) {
+            index[mask] = static_cast<std::uint16_t>(nr_of_suited_boards++);
+        }
+    }
+    return index;
+}
 
+// The two big tables (3 MB) are too slow for the compiler to evaluate, so they are assembled from the
+// compile time tables on the first Omaha evaluation, which takes a few milliseconds
+struct Omaha_Tables {
+    static constexpr int nr_of_board_patterns = 6188;  // multisets of five ranks
+    static constexpr int nr_of_triples = 455;          // multisets of three ranks
+    static constexpr int nr_of_pairs = 91;             // pairs of ranks, equal ranks included
+    static constexpr int nr_of_suited_boards = 2288;   // sets of three to five ranks
+    static constexpr std::array<std::uint16_t, 8192> suited_board_index = build_suited_board_index();
 
-class Ranking {
+    std::vector<Strength> unsuited = std::vector<Strength>(nr_of_board_patterns * nr_of_pairs, 0);
+    std::vector<Strength> suited = std::vector<Strength>(nr_of_suited_boards * nr_of_pairs, 0);
 
-private:
-    static bool has_run;
+    static int pair_index(int rank1, int rank2) {
+        int low = std::min(rank1, rank2);
+        int high = std::max(rank1, rank2);
+        return low + high * (high + 1) / 2;
+    }
 
+    static int board_index(const int* sorted_ranks) { return multiset_index(sorted_ranks, 5); }
+};
 
-public:
-    
+inline const Omaha_Tables& omaha_tables() {
+    static const Omaha_Tables tables = []() {
+        Omaha_Tables built;
+        const int triples[10][3] = { {0,1,2}, {0,1,3}, {0,1,4}, {0,2,3}, {0,2,4}, {0,3,4}, {1,2,3}, {1,2,4}, {1,3,4}, {2,3,4} };
 
-    static bool compare_hand_ranks(const std::pair<std::string, std::pair<Poker_Ranks, int>>& a, const std::pair<std::string, std::pair<Poker_Ranks, int>>& b) {
-        if (a.second.first != b.second.first) {
-            return a.second.first > b.second.first;
+        // every multiset of three board ranks with every hole pair
+        std::vector<Strength> with_pair(Omaha_Tables::nr_of_triples * Omaha_Tables::nr_of_pairs);
+        int triple[3];
+        for (triple[0] = 0; triple[0] < 13; triple[0]++)
+        for (triple[1] = triple[0]; triple[1] < 13; triple[1]++)
+        for (triple[2] = triple[1]; triple[2] < 13; triple[2]++) {
+            Strength* row = &with_pair[multiset_index(triple, 3) * Omaha_Tables::nr_of_pairs];
+            for (int high{0}; high < 13; high++) {
+                for (int low{0}; low <= high; low++) {
+                    int ranks[5] = { low, high, triple[0], triple[1], triple[2] };
+                    std::sort(ranks, ranks + 5);
+                    row[Omaha_Tables::pair_index(high, low)] = five_rank_strengths[multiset_index(ranks, 5)];
+                }
+            }
+        }
+
+        // boards without a flush: the best of the ten triple rows, pair by pair
+        int board[5];
+        for (board[0] = 0; board[0] < 13; board[0]++)
+        for (board[1] = board[0]; board[1] < 13; board[1]++)
+        for (board[2] = board[1]; board[2] < 13; board[2]++)
+        for (board[3] = board[2]; board[3] < 13; board[3]++)
+        for (board[4] = board[3]; board[4] < 13; board[4]++) {
+            Strength* row = &built.unsuited[Omaha_Tables::board_index(board) * Omaha_Tables::nr_of_pairs];
+            for (const auto& picked : triples) {
+                int ranks[3] = { board[picked[0]], board[picked[1]], board[picked[2]] };
+                const Strength* triple_row = &with_pair[multiset_index(ranks, 3) * Omaha_Tables::nr_of_pairs];
+                for (int pair{0}; pair < Omaha_Tables::nr_of_pairs; pair++) {
+                    row[pair] = std::max(row[pair], triple_row[pair]);
+                }
+            }
+        }
+
+        // flushes: three to five board ranks of one suit with two hole cards of that suit
+        const Rank_Tables& rank_lookup = rank_tables();
+        for (unsigned mask{0}; mask < 8192; mask++) {
+            int count = __builtin_popcount(mask);
+            if (count < 3 || count > 5) {
+                continue;
+            }
+            Strength* row = &built.suited[Omaha_Tables::suited_board_index[mask] * Omaha_Tables::nr_of_pairs];
+            int ranks[5];
+            count = 0;
+            for (int rank{0}; rank < 13; rank++) {
+                if (mask >> rank & 1) {
+                    ranks[count++] = rank;
+                }
+            }
+            for (int high{0}; high < 13; high++) {
+                for (int low{0}; low < high; low++) {
+                    if ((mask >> high & 1) || (mask >> low & 1)) {
+                        continue;
+                    }
+                    Strength best{0};
+                    for (const auto& picked : triples) {
+                        if (picked[2] >= count) {
+                            continue;
+                        }
+                        unsigned flush_mask = 1u << high | 1u << low | 1u << ranks[picked[0]] | 1u << ranks[picked[1]] | 1u << ranks[picked[2]];
+                        best = std::max(best, rank_lookup.straight_high[flush_mask]
+                            ? make_strength(straight_flush, static_cast<std::uint32_t>(rank_lookup.straight_high[flush_mask] - 1) << 16)
+                            : make_strength(flush, rank_lookup.top_five[flush_mask]));
+                    }
+                    row[Omaha_Tables::pair_index(high, low)] = best;
+                }
+            }
+        }
+        return built;
+    }();
+    return tables;
+}
+
+// A full board prepared once for Omaha evaluation, so a showdown or an equity run only pays the table
+// rows per board and six reads per player
+class Omaha_Board {
+public:
+    explicit Omaha_Board(const std::uint8_t* board) {
+        const Omaha_Tables& tables = omaha_tables();
+        int ranks[5];
+        unsigned suit_masks[4] = {0, 0, 0, 0};
+        for (int i{0}; i < 5; i++) {
+            int rank = board[i] >> 2;
+            suit_masks[board[i] & 3] |= 1u << rank;
+            int j = i;
+            for (; j > 0 && ranks[j - 1] > rank; j--) {
+                ranks[j] = ranks[j - 1];
+            }
+            ranks[j] = rank;
+        }
+        row = &tables.unsuited[Omaha_Tables::board_index(ranks) * Omaha_Tables::nr_of_pairs];
+        for (int suit{0}; suit < 4; suit++) {
+            if (__builtin_popcount(suit_masks[suit]) >= 3) {  // five cards leave room for one such suit
+                flush_suit = suit;
+                flush_row = &tables.suited[tables.suited_board_index[suit_masks[suit]] * Omaha_Tables::nr_of_pairs];
+            }
         }
-        return a.second.second > b.second.second;
     }
-    
-    static void reset(){
-        has_run=false;
+
+    Strength evaluate(const std::uint8_t* hole) const {
+        static constexpr int hole_pairs[6][2] = { {0,1}, {0,2}, {0,3}, {1,2}, {1,3}, {2,3} };
+        int hole_ranks[4] = { hole[0] >> 2, hole[1] >> 2, hole[2] >> 2, hole[3] >> 2 };
+        Strength best{0};
+        for (const auto& pair : hole_pairs) {
+            best = std::max(best, row[Omaha_Tables::pair_index(hole_ranks[pair[0]], hole_ranks[pair[1]])]);
+        }
+        if (flush_row == nullptr) {
+            return best;
+        }
+        int suited{0};
+        for (int i{0}; i < 4; i++) {
+            suited += (hole[i] & 3) == flush_suit;
+        }
+        if (suited < 2) {
+            return best;
+        }
+        for (const auto& pair : hole_pairs) {
+            if ((hole[pair[0]] & 3) == flush_suit && (hole[pair[1]] & 3) == flush_suit) {
+                best = std::max(best, flush_row[Omaha_Tables::pair_index(hole_ranks[pair[0]], hole_ranks[pair[1]])]);
+            }
+        }
+        return best;
     }
-    
 
-    // Determine the winner function
-    std::vector<std::string> determine_winner(const std::vector<Player>& players, Deck& deck) {
-        const std::vector<Card> community_cards = deck.get_community_cards();
-        std::vector<std::pair<std::string, std::pair<Poker_Ranks, int>>> player_name_and_rank;
+private:
+    const Strength* row{nullptr};
+    const Strength* flush_row{nullptr};
+    int flush_suit{-1};
+};
 
-        for (const auto& player : players) {
-            Card card1 = player.get_card1();
-            Card card2 = player.get_card2();
+// Best Omaha hand of four hole cards on a board of three to five cards. Full boards use the tables,
+// shorter ones (only needed for bot decisions before the river) try every combination.
+inline Strength evaluate_omaha(const std::uint8_t* hole, const std::uint8_t* board, int nr_of_board_cards = 5) {
+    if (nr_of_board_cards == 5) {
+        return Omaha_Board(board).evaluate(hole);
+    }
+    const int hole_pairs[6][2] = { {0,1}, {0,2}, {0,3}, {1,2}, {1,3}, {2,3} };
+    Strength best{0};
+    for (const auto& pair : hole_pairs) {
+        for (int skipped{0}; skipped < (nr_of_board_cards == 4 ? 4 : 1); skipped++) {
+            std::uint8_t cards[5] = { hole[pair[0]], hole[pair[1]] };
+            int count{2};
+            for (int i{0}; i < nr_of_board_cards; i++) {
+                if (i != skipped || nr_of_board_cards == 3) {
+                    cards[count++] = board[i];
+                }
+            }
+            best = std::max(best, evaluate(cards, 5));
+        }
+    }
+    return best;
+}
 
-            std::pair<Poker_Ranks, int> player_hand = evaluate_hand(card1, card2, community_cards);
+struct Equity_Result {
+    double equity{0};  // share of the pot won on average, ties split
+    double win{0};
+    double tie{0};
+    int samples{0};
+    double error{0};   // half width of the 95% confidence interval on equity
+};
 
-            std::cout << "Final score:  player named: " << player.get_name() << " had these cards: "
-                      << card1.get_rank() << card1.get_suit() << " " << card2.get_rank() << card2.get_suit()
-                      << "  and the FINAL RANK: " << poker_rank_to_string(player_hand.first) << std::endl;
+// When sample_equity stops: once the confidence interval is narrow enough, at the deadline or at max_samples,
+// whichever comes first, but never before min_samples
+struct Sampling_Options {
+    double tolerance{0.005};
+    int min_samples{500};
+    int max_samples{200000};
+    std::chrono::steady_clock::time_point deadline{std::chrono::steady_clock::time_point::max()};
+    const std::atomic<bool>* stop{nullptr};  // stops after the current round once set, min_samples or not
+};
 
-            player_name_and_rank.push_back(std::make_pair(player.get_name(), player_hand));
+// Estimates the equity of two hole cards against random hands of the opponents, dealing the missing board
+// cards at random. The first dealt card is stratified: every round of samples deals each unseen card there
+// exactly once, in random order, which takes that card's share out of the variance. The confidence interval
+// comes from the spread of the round means, so it credits the stratification.
+inline Equity_Result sample_equity(const std::uint8_t* hole, const std::uint8_t* board, int nr_of_board_cards,
+                                   int nr_of_opponents, const Sampling_Options& options, std::uint64_t seed,
+                                   Cards::Deck_Type deck_type = Cards::Deck_Type::standard) {
+    Cards::Session_Rng rng(seed);
+    std::uint64_t dead{0};
+    dead |= 1ull << hole[0] | 1ull << hole[1];
+    for (int i{0}; i < nr_of_board_cards; i++) {
+        dead |= 1ull << board[i];
+    }
+    std::array<std::uint8_t, 52> deck{};
+    int deck_size{0};
+    for (int card{4 * Cards::lowest_rank(deck_type)}; card < 52; card++) {
+        if (!(dead >> card & 1)) {
+            deck[deck_size++] = static_cast<std::uint8_t>(card);
         }
+    }
+    std::array<std::uint8_t, 52> strata = deck;
 
-        std::sort(player_name_and_rank.begin(), player_name_and_rank.end(), compare_hand_ranks);
-
-        std::pair<Poker_Ranks, int> highest_rank = player_name_and_rank[0].second;
+    nr_of_opponents = std::max(1, std::min(nr_of_opponents, (deck_size - (5 - nr_of_board_cards)) / 2));
+    int needed = 5 - nr_of_board_cards + 2 * nr_of_opponents;
+    Equity_Result result;
+    double won{0};
+    double sum_of_round_means{0};
+    double sum_of_squared_round_means{0};
+    int nr_of_rounds{0};
+    int samples{0};
+    std::uint8_t cards[7];
+    while (samples < options.max_samples) {
+        // a round: a fresh order of the strata, cut short by max_samples
+        for (int i{deck_size - 1}; i > 0; i--) {
+            std::swap(strata[i], strata[rng() % static_cast<std::uint64_t>(i + 1)]);
+        }
+        int round_size = std::min(deck_size, options.max_samples - samples);
+        double round_won{0};
+        for (int stratum{0}; stratum < round_size; stratum++) {
+            // the stratum's card goes first, the rest is a partial shuffle
+            std::swap(deck[0], *std::find(deck.begin(), deck.begin() + deck_size, strata[stratum]));
+            for (int i{1}; i < needed; i++) {
+                int j = i + static_cast<int>(rng() % static_cast<std::uint64_t>(deck_size - i));
+                std::swap(deck[i], deck[j]);
+            }
+            for (int i{0}; i < nr_of_board_cards; i++) {
+                cards[i] = board[i];
+            }
+            for (int i{nr_of_board_cards}; i < 5; i++) {
+                cards[i] = deck[i - nr_of_board_cards];
+            }
+            cards[5] = hole[0];
+            cards[6] = hole[1];
+            Strength hero = evaluate(cards, 7, deck_type);
 
-        std::vector<std::string> winners;
-        for (const auto &player : player_name_and_rank) {
-            
-            if (player.second == highest_rank) {
-                winners.push_back(player.first);
-            } else {
+            int dealt = 5 - nr_of_board_cards;
+            int tied{0};
+            bool beaten{false};
+            for (int opponent{0}; opponent < nr_of_opponents && !beaten; opponent++) {
+                cards[5] = deck[dealt + 2 * opponent];
+                cards[6] = deck[dealt + 2 * opponent + 1];
+                Strength villain = evaluate(cards, 7, deck_type);
+                beaten = villain > hero;
+                tied += villain == hero ? 1 : 0;
+            }
+            if (!beaten) {
+                round_won += 1.0 / (tied + 1);
+                result.win += tied == 0 ? 1 : 0;
+                result.tie += tied > 0 ? 1 : 0;
+            }
+        }
+        won += round_won;
+        samples += round_size;
+        if (round_size == deck_size) {
+            double round_mean = round_won / round_size;
+            sum_of_round_means += round_mean;
+            sum_of_squared_round_means += round_mean * round_mean;
+            nr_of_rounds++;
+        }
+        if (nr_of_rounds >= 2) {
+            double mean = sum_of_round_means / nr_of_rounds;
+            double variance = std::max(0.0, (sum_of_squared_round_means - nr_of_rounds * mean * mean) / (nr_of_rounds - 1));
+            result.error = 1.96 * std::sqrt(variance / nr_of_rounds);
+        }
+        if (samples >= options.min_samples && nr_of_rounds >= 2
+            && (result.error <= options.tolerance || std::chrono::steady_clock::now() >= options.deadline)) {
+            break;
+        }
+        if (options.stop != nullptr && options.stop->load(std::memory_order_relaxed)) {
             break;
         }
+    }
+    result.samples = samples;
+    if (samples > 0) {
+        result.equity = won / samples;
+        result.win /= samples;
+        result.tie /= samples;
+    }
+    return result;
 }
 
-        if (has_run == false){
-            if (winners.size() == 1) {
-                std::cout << "The winner is " << winners[0] << " with a hand rank of " << poker_rank_to_string(highest_rank.first)<<" of highest card rank "<<highest_rank.second<< std::endl;
-            } else {
-                std::cout << "There are multiple winners with a hand rank of " << poker_rank_to_string(highest_rank.first)<<" of highest card rank "<< highest_rank.second << std::endl;
-                for (const auto &winner : winners) {
-                    std::cout << winner << std::endl;
-                }
-            }
-            has_run=true;
+// Equity from a fixed number of samples
+inline Equity_Result monte_carlo_equity(const std::uint8_t* hole, const std::uint8_t* board, int nr_of_board_cards,
+                                        int nr_of_opponents, int samples, std::uint64_t seed,
+                                        Cards::Deck_Type deck_type = Cards::Deck_Type::standard) {
+    Sampling_Options options;
+    options.tolerance = 0;
+    options.min_samples = samples;
+    options.max_samples = samples;
+    return sample_equity(hole, board, nr_of_board_cards, nr_of_opponents, options, seed, deck_type);
+}
+
+// Omaha version of monte_carlo_equity: four hole cards each, every sample prepares its board once
+inline Equity_Result monte_carlo_omaha_equity(const std::uint8_t* hole, const std::uint8_t* board, int nr_of_board_cards,
+                                              int nr_of_opponents, int samples, std::uint64_t seed) {
+    Cards::Session_Rng rng(seed);
+    std::uint64_t dead{0};
+    for (int i{0}; i < 4; i++) {
+        dead |= 1ull << hole[i];
+    }
+    for (int i{0}; i < nr_of_board_cards; i++) {
+        dead |= 1ull << board[i];
+    }
+    std::array<std::uint8_t, 52> deck{};
+    int deck_size{0};
+    for (int card{0}; card < 52; card++) {
+        if (!(dead >> card & 1)) {
+            deck[deck_size++] = static_cast<std::uint8_t>(card);
         }
-        return winners;
     }
 
-
-    
-    
-    
-    std::pair<Poker_Ranks, int> evaluate_hand (Card card1, Card card2, std::vector<Card> community_cards) {
-        std::map<std::string, int> rank_to_num = {{"2", 2}, {"3", 3}, {"4", 4}, {"5", 5}, {"6", 6}, {"7", 7}, {"8", 8}, {"9", 9}, {"10", 10}, {"J", 11}, {"Q", 12}, {"K", 13}, {"A", 14}};
-        std::vector<int> numeric_ranks;
-        std::vector<std::string> suits;
-        int highest_card{0};
-    
-    
-        numeric_ranks.push_back(rank_to_num[card1.get_rank()]);
-        numeric_ranks.push_back(rank_to_num[card2.get_rank()]);
-    
-        suits.push_back(card1.get_suit());
-        suits.push_back(card2.get_suit());
-    
-        for (auto object : community_cards) {
-            numeric_ranks.push_back(rank_to_num[object.get_rank()]);
-            suits.push_back(object.get_suit());
+    nr_of_opponents = std::max(1, std::min(nr_of_opponents, (deck_size - (5 - nr_of_board_cards)) / 4));
+    int needed = 5 - nr_of_board_cards + 4 * nr_of_opponents;
+    Equity_Result result;
+    double won{0};
+    std::uint8_t cards[5];
+    for (int sample{0}; sample < samples; sample++) {
+        for (int i{0}; i < needed; i++) {
+            int j = i + static_cast<int>(rng() % static_cast<std::uint64_t>(deck_size - i));
+            std::swap(deck[i], deck[j]);
         }
-    
-        std::sort(numeric_ranks.begin(), numeric_ranks.end());
+        for (int i{0}; i < nr_of_board_cards; i++) {
+            cards[i] = board[i];
+        }
+        for (int i{nr_of_board_cards}; i < 5; i++) {
+            cards[i] = deck[i - nr_of_board_cards];
+        }
+        Omaha_Board runout(cards);
+        Strength hero = runout.evaluate(hole);
 
-        //initialise map for rank counts and suit counts
-        std::map<int, int> rank_counts;
-                
-        for(auto object : numeric_ranks) {
-            ++rank_counts[object];
+        int dealt = 5 - nr_of_board_cards;
+        int tied{0};
+        bool beaten{false};
+        for (int opponent{0}; opponent < nr_of_opponents && !beaten; opponent++) {
+            Strength villain = runout.evaluate(&deck[dealt + 4 * opponent]);
+            beaten = villain > hero;
+            tied += villain == hero ? 1 : 0;
         }
-          //do the same for suits
-        std::map<std::string, int> suit_counts;
-        
-        for(auto object : suits) {
-            ++suit_counts[object];
+        if (!beaten) {
+            won += 1.0 / (tied + 1);
+            result.win += tied == 0 ? 1 : 0;
+            result.tie += tied > 0 ? 1 : 0;
         }
-        
-        int two_pair{0};
-        int three_of_a_kind{0};
-        int flush{0};
-        int straight{0};
+    }
+    result.samples = samples;
+    if (samples > 0) {
+        result.equity = won / samples;
+        result.win /= samples;
+        result.tie /= samples;
+    }
+    return result;
+}
 
-        std::vector<Poker_Ranks> hand_ranking;
-        
-        auto add_hand_ranking = [&hand_ranking] (Poker_Ranks rank) {hand_ranking.push_back(rank);};
-        
-        add_hand_ranking(Poker_Ranks::high_card);
+struct Outs_Result {
+    int current_category{high_card};
+    int nr_of_unseen{0};
+    std::uint64_t improving_cards{0};                 // bit per card that improves the hand on the next street
+    std::uint64_t beating_cards{0};                   // bit per card after which the hand is ahead of the opponent
+    std::array<std::uint8_t, 9> outs_per_category{};  // improving cards by the category they make
+    double improve_next{0};                           // chance to improve on the next street
+    double improve_by_river{0};
+    double ahead_next{0};                             // chance to be ahead of the opponent after the next street
+    double ahead_by_river{0};
+};
 
+// Suit masks and rank counts of a set of cards, so adding a card to a hand is two bit operations
+struct Card_Masks {
+    unsigned suit_masks[4]{0, 0, 0, 0};
+    std::uint64_t rank_counts{0};
+    std::uint32_t suit_counts{0};  // a byte per suit
 
-        for(auto entry : rank_counts) {
-            if(two_pair ==0){
-                highest_card = std::max(highest_card, entry.first);
+    void add(std::uint8_t card) {
+        suit_masks[card & 3] |= 1u << (card >> 2);
+        rank_counts += 1ull << (4 * (card >> 2));
+        suit_counts += 1u << (8 * (card & 3));
+    }
+
+    Card_Masks with(std::uint8_t card) const {
+        Card_Masks added = *this;
+        added.add(card);
+        return added;
+    }
+
+    Strength evaluate(Cards::Deck_Type deck_type) const {
+        if (deck_type == Cards::Deck_Type::short_deck) {
+            unsigned shifted[4] = { suit_masks[0] >> 4, suit_masks[1] >> 4, suit_masks[2] >> 4, suit_masks[3] >> 4 };
+            return evaluate_short_deck_masks(shifted);
+        }
+        return evaluate_masks(suit_masks, rank_counts);
+    }
+
+    // Category bits (strength >> 20) of evaluate without working out the ranks, ordered for either deck.
+    // Only bit operations: counting bits is a library call on builds without popcnt.
+    int ordered_category(Cards::Deck_Type deck_type) const {
+        const unsigned* m = suit_masks;
+        bool short_deck = deck_type == Cards::Deck_Type::short_deck;
+        auto straight_high = [short_deck](unsigned mask) {
+            return short_deck ? short_deck_tables().straight_high[mask >> 4] : rank_tables().straight_high[mask];
+        };
+        unsigned ranks = m[0] | m[1] | m[2] | m[3];
+        int flush_suit{-1};
+        std::uint32_t five_or_more = (suit_counts + 0x7B7B7B7Bu) & 0x80808080u;  // a byte of 5 or more reaches 128
+        if (five_or_more) {
+            flush_suit = __builtin_ctz(five_or_more) / 8;
+            if (straight_high(m[flush_suit])) {
+                return straight_flush;
             }
-            if(entry.second == 2) {
-                two_pair += 1;
-                add_hand_ranking(Poker_Ranks::pair);
-                highest_card = entry.first;
-            } 
         }
-        
-        if(two_pair >= 2) {
-            add_hand_ranking(Poker_Ranks::two_pair);
+        unsigned quads = m[0] & m[1] & m[2] & m[3];
+        unsigned three_or_more = (m[0] & m[1] & m[2]) | (m[0] & m[1] & m[3]) | (m[0] & m[2] & m[3]) | (m[1] & m[2] & m[3]);
+        unsigned two_or_more = (m[0] & m[1]) | (m[0] & m[2]) | (m[0] & m[3]) | (m[1] & m[2]) | (m[1] & m[3]) | (m[2] & m[3]);
+        unsigned trips = three_or_more & ~quads;
+        unsigned pairs = two_or_more & ~three_or_more;
+        if (quads) {
+            return four_of_a_kind;
         }
-            
-        for(auto entry : rank_counts) {
-            if (entry.second == 3) {
-                three_of_a_kind += 1;
-                add_hand_ranking(Poker_Ranks::three_of_a_kind);
-                highest_card = entry.first;
-            }
+        if (trips && (pairs || (trips & (trips - 1)))) {
+            return short_deck && flush_suit >= 0 ? full_house : short_deck ? flush : full_house;
         }
-        
-        for(int i = 0; i < numeric_ranks.size()-4; i++) {
-            if (numeric_ranks[i+1] == numeric_ranks[i]+1 && numeric_ranks[i+2] == numeric_ranks[i]+2 && numeric_ranks[i+3] == numeric_ranks[i]+3 && numeric_ranks[i+4] == numeric_ranks[i]+4) {
-                add_hand_ranking(Poker_Ranks::straight);
-                highest_card = numeric_ranks[i+4];
-                break;
-            }
+        if (flush_suit >= 0) {
+            return short_deck ? full_house : flush;
         }
-        
-        
-    
+        if (straight_high(ranks)) {
+            return straight;
+        }
+        if (trips) {
+            return three_of_a_kind;
+        }
+        return (pairs & (pairs - 1)) ? two_pair : pairs ? pair : high_card;
+    }
+};
 
-        for(auto entry : suit_counts) {
-            if(entry.second > 4) {
-                
-                add_hand_ranking(Poker_Ranks::flush);
+// Counts the unseen cards that improve two hole cards on a flop or turn. A card improves the hand when it
+// raises its category above the current one and above what the board alone makes, so a card that only
+// pairs the board is no out. With the opponent's hole cards it also counts the cards that put the hand
+// ahead. By the river includes runner-runner draws; the opponent's cards are the only known dead cards.
+inline Outs_Result count_outs(const std::uint8_t* hole, const std::uint8_t* board, int nr_of_board_cards,
+                              const std::uint8_t* opponent = nullptr,
+                              Cards::Deck_Type deck_type = Cards::Deck_Type::standard) {
+    Outs_Result result;
+    if (nr_of_board_cards < 3 || nr_of_board_cards > 4) {
+        throw std::invalid_argument("Outs are counted on the flop and the turn.");
+    }
+    Card_Masks board_masks;
+    for (int i{0}; i < nr_of_board_cards; i++) {
+        board_masks.add(board[i]);
+    }
+    Card_Masks hand = board_masks.with(hole[0]).with(hole[1]);
+    Card_Masks villain;
+    std::uint64_t dead = 1ull << hole[0] | 1ull << hole[1];
+    for (int i{0}; i < nr_of_board_cards; i++) {
+        dead |= 1ull << board[i];
+    }
+    if (opponent != nullptr) {
+        villain = board_masks.with(opponent[0]).with(opponent[1]);
+        dead |= 1ull << opponent[0] | 1ull << opponent[1];
+    }
+    std::array<std::uint8_t, 52> unseen{};
+    int nr_of_unseen{0};
+    for (int card{4 * Cards::lowest_rank(deck_type)}; card < 52; card++) {
+        if (!(dead >> card & 1)) {
+            unseen[nr_of_unseen++] = static_cast<std::uint8_t>(card);
+        }
+    }
+    result.nr_of_unseen = nr_of_unseen;
+
+    // categories are compared as the strength's top bits, which order them for either deck
+    Strength now = hand.evaluate(deck_type);
+    int now_category = static_cast<int>(now >> 20);
+    result.current_category = category(now, deck_type);
+    auto improves = [&](int after, const Card_Masks& board_after) {
+        return after > now_category && after > board_after.ordered_category(deck_type);
+    };
+    auto is_ahead = [&](const Card_Masks& hand_after, int after, const Card_Masks& villain_after) {
+        int villain_category = villain_after.ordered_category(deck_type);
+        if (after != villain_category) {
+            return after > villain_category;
+        }
+        return hand_after.evaluate(deck_type) > villain_after.evaluate(deck_type);
+    };
+
+    int improving{0};
+    int ahead_count{0};
+    for (int i{0}; i < nr_of_unseen; i++) {
+        std::uint8_t card = unseen[i];
+        Card_Masks hand_after = hand.with(card);
+        int after = hand_after.ordered_category(deck_type);
+        if (improves(after, board_masks.with(card))) {
+            improving++;
+            result.improving_cards |= 1ull << card;
+            result.outs_per_category[category(make_strength(after, 0), deck_type)]++;
+        }
+        if (opponent != nullptr && is_ahead(hand_after, after, villain.with(card))) {
+            ahead_count++;
+            result.beating_cards |= 1ull << card;
+        }
+    }
+    result.improve_next = static_cast<double>(improving) / nr_of_unseen;
+    result.ahead_next = static_cast<double>(ahead_count) / nr_of_unseen;
+    if (nr_of_board_cards == 4) {
+        result.improve_by_river = result.improve_next;
+        result.ahead_by_river = result.ahead_next;
+        return result;
+    }
+
+    // turn and river: every unordered pair of the unseen cards
+    int improving_runouts{0};
+    int ahead_runouts{0};
+    for (int i{0}; i < nr_of_unseen; i++) {
+        Card_Masks hand_turn = hand.with(unseen[i]);
+        Card_Masks board_turn = board_masks.with(unseen[i]);
+        Card_Masks villain_turn = villain.with(unseen[i]);
+        for (int j{i + 1}; j < nr_of_unseen; j++) {
+            Card_Masks hand_after = hand_turn.with(unseen[j]);
+            int after = hand_after.ordered_category(deck_type);
+            improving_runouts += improves(after, board_turn.with(unseen[j])) ? 1 : 0;
+            if (opponent != nullptr && is_ahead(hand_after, after, villain_turn.with(unseen[j]))) {
+                ahead_runouts++;
             }
         }
-        
-        if((two_pair > 0 && three_of_a_kind > 0) || (three_of_a_kind ==2 )) {
-           
-            add_hand_ranking(Poker_Ranks::full_house);
+    }
+    double nr_of_runouts = nr_of_unseen * (nr_of_unseen - 1) / 2.0;
+    result.improve_by_river = improving_runouts / nr_of_runouts;
+    result.ahead_by_river = ahead_runouts / nr_of_runouts;
+    return result;
+}
+} // namespace Eval end
+
+
+namespace Icm {
+
+constexpr int max_exact_players = 21;
+
+// Independent Chip Model: a player takes the next open place with probability stack / chips not yet placed.
+// Exact subset DP over the players who already finished in the paid places: dp[mask] is the probability
+// that the players in mask fill the top places, so the work is nr_of_players * (subsets up to the paid places).
+inline std::vector<double> exact_equity(const std::vector<double>& stacks, const std::vector<double>& payouts) {
+    int nr_of_players = stacks.size();
+    if (nr_of_players > max_exact_players) {
+        throw std::invalid_argument("Exact ICM handles at most 21 players.");
+    }
+    std::vector<double> equity(nr_of_players, 0.0);
+    int paid_places = std::min<int>(payouts.size(), nr_of_players);
+    double total{0};
+    for (double stack : stacks) {
+        total += stack;
+    }
+    if (paid_places == 0 || total <= 0) {
+        return equity;
+    }
+
+    static thread_local std::vector<double> dp;
+    dp.assign(std::size_t{1} << nr_of_players, 0.0);
+    dp[0] = 1.0;
+    for (std::uint32_t mask{0}; mask < dp.size(); mask++) {
+        double probability = dp[mask];
+        int place = __builtin_popcount(mask);
+        if (probability == 0 || place >= paid_places) {
+            continue;
         }
-        
-        
-        for (auto entry : rank_counts){
-            if(entry.second == 4){
-                add_hand_ranking(Poker_Ranks::four_of_a_kind);
-                highest_card = entry.first;
+        double left{total};
+        for (int i{0}; i < nr_of_players; i++) {
+            left -= (mask >> i & 1u) ? stacks[i] : 0;
+        }
+        if (left <= 0) {
+            continue;
+        }
+        for (int i{0}; i < nr_of_players; i++) {
+            if (!(mask >> i & 1u) && stacks[i] > 0) {
+                double next = probability * stacks[i] / left;
+                equity[i] += next * payouts[place];
+                dp[mask | 1u << i] += next;
             }
         }
-        
-        if (straight == 1 && flush == 1){
-            add_hand_ranking(Poker_Ranks::straight_flush);
-            
-            int royal_flush_elements{0};
-            for (auto entry : rank_counts){
-                if (entry.first == 10 || entry.first == 11 || entry.first == 12 || entry.first == 13 || entry.first == 14){
-                    royal_flush_elements +=1;
-                    
+    }
+    return equity;
+}
+
+// Estimates the ICM equity of large fields by sampling finishing orders of the paid places only.
+// A place is drawn in proportion to the stacks by a binary search over the prefix sums of the stacks,
+// drawing again when the player already finished, so a sample costs paid places * log(players).
+inline std::vector<double> sampled_equity(const std::vector<double>& stacks, const std::vector<double>& payouts,
+                                          int samples, std::uint64_t seed) {
+    int nr_of_players = stacks.size();
+    std::vector<double> equity(nr_of_players, 0.0);
+    int paid_places = std::min<int>(payouts.size(), nr_of_players);
+    std::vector<double> prefix(nr_of_players);
+    double total{0};
+    int players_with_chips{0};
+    for (int i{0}; i < nr_of_players; i++) {
+        total += std::max(stacks[i], 0.0);
+        prefix[i] = total;
+        players_with_chips += stacks[i] > 0 ? 1 : 0;
+    }
+    paid_places = std::min(paid_places, players_with_chips);
+    if (paid_places == 0 || samples <= 0) {
+        return equity;
+    }
+    Cards::Session_Rng rng(seed);
+    std::vector<int> placed;
+    for (int sample{0}; sample < samples; sample++) {
+        placed.clear();
+        double placed_chips{0};
+        for (int place{0}; place < paid_places; place++) {
+            int player{-1};
+            if (placed_chips < 0.75 * total) {
+                while (player < 0 || std::find(placed.begin(), placed.end(), player) != placed.end()) {
+                    double target = static_cast<double>(rng() >> 11) * 0x1.0p-53 * total;
+                    player = std::upper_bound(prefix.begin(), prefix.end(), target) - prefix.begin();
+                    player = std::min(player, nr_of_players - 1);
+                }
+            } else {
+                // most chips are placed already, so drawing again would rarely hit: walk the players left
+                double target = static_cast<double>(rng() >> 11) * 0x1.0p-53 * (total - placed_chips);
+                for (int i{0}; i < nr_of_players; i++) {
+                    if (stacks[i] > 0 && std::find(placed.begin(), placed.end(), i) == placed.end()) {
+                        player = i;
+                        target -= stacks[i];
+                        if (target < 0) {
+                            break;
+                        }
+                    }
                 }
             }
-            if (royal_flush_elements == 5){
-                add_hand_ranking(Poker_Ranks::royal_flush);
-                highest_card = 14;
+            placed.push_back(player);
+            placed_chips += stacks[player];
+            equity[player] += payouts[place];
+        }
+    }
+    for (double& value : equity) {
+        value /= samples;
+    }
+    return equity;
+}
+
+// Exact for tables up to 21 players, sampled beyond that
+inline std::vector<double> equity(const std::vector<double>& stacks, const std::vector<double>& payouts, int samples = 200000) {
+    if (static_cast<int>(stacks.size()) <= max_exact_players) {
+        return exact_equity(stacks, payouts);
+    }
+    return sampled_equity(stacks, payouts, samples, 0x1C3);
+}
+
+} // namespace Icm end
+
+
+namespace Push_Fold {
+
+constexpr int nr_of_classes = 169;
+constexpr int max_players = 6;
+constexpr int max_stack_bb = 20;
+constexpr std::uint32_t file_magic = 0x46504B50;  // "PKPF"
+constexpr std::uint32_t file_version = 1;
+
+// Starting hand class on a 13x13 grid: pairs on the diagonal, suited hands above it, offsuit hands below
+inline int hand_class(std::uint8_t card1, std::uint8_t card2) {
+    int high = std::max(card1 >> 2, card2 >> 2);
+    int low = std::min(card1 >> 2, card2 >> 2);
+    if (high == low) {
+        return high * 13 + high;
+    }
+    return (card1 & 3) == (card2 & 3) ? low * 13 + high : high * 13 + low;
+}
+
+inline int class_combos(int hand) {
+    int row = hand / 13;
+    int column = hand % 13;
+    return row == column ? 6 : (row < column ? 4 : 12);
+}
+
+inline std::string class_name(int hand) {
+    const char* ranks = "23456789TJQKA";
+    int row = hand / 13;
+    int column = hand % 13;
+    std::string name = { ranks[std::max(row, column)], ranks[std::min(row, column)] };
+    return row == column ? name : name + (row < column ? "s" : "o");
+}
+
+// A random concrete hand of the class, avoiding the cards in dead
+inline bool deal_class(int hand, std::uint64_t dead, Cards::Session_Rng& rng, std::uint8_t* out) {
+    int row = hand / 13;
+    int column = hand % 13;
+    int high = std::max(row, column);
+    int low = std::min(row, column);
+    for (int attempt{0}; attempt < 32; attempt++) {
+        int suit1 = rng() & 3;
+        int suit2 = rng() & 3;
+        if (row < column) {
+            suit2 = suit1;
+        } else if (suit1 == suit2) {
+            continue;
+        }
+        std::uint8_t card1 = static_cast<std::uint8_t>(high * 4 + suit1);
+        std::uint8_t card2 = static_cast<std::uint8_t>(low * 4 + suit2);
+        if (!(dead >> card1 & 1) && !(dead >> card2 & 1)) {
+            out[0] = card1;
+            out[1] = card2;
+            return true;
+        }
+    }
+    return false;
+}
+
+// All-in preflop equity of every class against every other class, estimated by sampling
+struct Equity_Table {
+    std::vector<float> equity = std::vector<float>(nr_of_classes * nr_of_classes, 0.5f);
+
+    float operator()(int hand, int against) const { return equity[hand * nr_of_classes + against]; }
+
+    static Equity_Table compute(int samples_per_pair, unsigned nr_of_threads, std::uint64_t seed) {
+        Equity_Table table;
+        std::atomic<int> next_row{0};
+        auto work = [&]() {
+            for (int row = next_row++; row < nr_of_classes; row = next_row++) {
+                Cards::Session_Rng rng(seed + row);
+                for (int column{row}; column < nr_of_classes; column++) {
+                    double won{0};
+                    int dealt{0};
+                    for (int sample{0}; sample < samples_per_pair; sample++) {
+                        std::uint8_t cards[9];
+                        if (!deal_class(row, 0, rng, cards)) {
+                            continue;
+                        }
+                        std::uint64_t dead = 1ull << cards[0] | 1ull << cards[1];
+                        if (!deal_class(column, dead, rng, cards + 2)) {
+                            continue;
+                        }
+                        dead |= 1ull << cards[2] | 1ull << cards[3];
+                        for (int i{4}; i < 9; i++) {
+                            std::uint8_t card;
+                            do {
+                                card = static_cast<std::uint8_t>(rng() % 52);
+                            } while (dead >> card & 1);
+                            dead |= 1ull << card;
+                            cards[i] = card;
+                        }
+                        std::uint8_t hero[7] = { cards[0], cards[1], cards[4], cards[5], cards[6], cards[7], cards[8] };
+                        std::uint8_t villain[7] = { cards[2], cards[3], cards[4], cards[5], cards[6], cards[7], cards[8] };
+                        Eval::Strength a = Eval::evaluate(hero, 7);
+                        Eval::Strength b = Eval::evaluate(villain, 7);
+                        won += a > b ? 1.0 : (a == b ? 0.5 : 0.0);
+                        dealt++;
+                    }
+                    float equity = dealt > 0 ? static_cast<float>(won / dealt) : 0.5f;
+                    table.equity[row * nr_of_classes + column] = equity;
+                    table.equity[column * nr_of_classes + row] = row == column ? 0.5f : 1.0f - equity;
+                }
             }
+        };
+        std::vector<std::thread> workers;
+        for (unsigned t{1}; t < nr_of_threads; t++) {
+            workers.emplace_back(work);
         }
-        
- 
-        Poker_Ranks highest_rank = hand_ranking.back();
-        
-        return {highest_rank, highest_card};
-    } // evaluate card function end
-    
-    
-    static std::string poker_rank_to_string(Poker_Ranks rank) {
-    switch (rank) {
-        case Poker_Ranks::high_card:       return "High Card";
-        case Poker_Ranks::pair:            return "Pair";
-        case Poker_Ranks::two_pair:        return "Two Pair";
-        case Poker_Ranks::three_of_a_kind: return "Three of a Kind";
-        case Poker_Ranks::straight:        return "Straight";
-        case Poker_Ranks::flush:           return "Flush";
-        case Poker_Ranks::full_house:      return "Full House";
-        case Poker_Ranks::four_of_a_kind:  return "Four of a Kind";
-        case Poker_Ranks::straight_flush:  return "Straight Flush";
-        case Poker_Ranks::royal_flush:     return "Royal Flush";
-        default:                           return "Unknown";
+        work();
+        for (auto& worker : workers) {
+            worker.join();
         }
+        return table;
     }
-    
 };
 
+// Push and call frequencies for one table size and stack depth. Position 0 acts first,
+// the last two positions are the small and the big blind.
+struct Chart {
+    int nr_of_players{2};
+    int stack_bb{10};
+    std::array<std::array<float, nr_of_classes>, max_players> push{};                            // [pusher]
+    std::array<std::array<std::array<float, nr_of_classes>, max_players>, max_players> call{};   // [pusher][caller]
 
-class Game {
-private:
-    int difficulty;
-    int nr_of_bots;
-    int starting_chips;
-    Deck deck;
-    Bot bot;
-    Human human;
-    Pot pot;
-   
+    bool should_push(int position, int hand) const { return push[position][hand] >= 0.5f; }
+    bool should_call(int pusher, int caller, int hand) const { return call[pusher][caller][hand] >= 0.5f; }
 
-public:
-    Game(int difficulty, int nr_bot, int start_chips)
-        : difficulty(difficulty), nr_of_bots(nr_bot), starting_chips(start_chips), deck(nr_of_bots + 1, 5), bot(), human(starting_chips, deck), pot() {}
-  
-          
-          
-    std::vector<Player> bots_in_the_game;
-    std::vector<Player> bot_initial_copy;
-    std::vector<Player> all_players_initial_copy;
-    
-    bool human_in_the_game{true};
-    bool it_is_the_first_game{true};
-    
-    
+    double push_percentage(int position) const {
+        double combos{0};
+        for (int hand{0}; hand < nr_of_classes; hand++) {
+            combos += push[position][hand] * class_combos(hand);
+        }
+        return 100 * combos / 1326;
+    }
+};
 
-    
-    void bot_turn() {
-        std::vector<Player>::iterator it = bots_in_the_game.begin();
-        bool did_bots_raise{false};
-        
-        while (it != bots_in_the_game.end()) {
-            
-    
-            // random code that generates bot action
-    
-            // Create a random number generator and a distribution
-            std::random_device rd;
-            std::mt19937 gen(rd());
-            std::uniform_int_distribution<> dist(1, 5);
-    
-            // Generate a random number between 1 and 4
-            int bot_decision_random_number = dist(gen);
-            //generate another random number used for "all in" bot raises
-            
-            
-            
-            // determine the bot action with if
-            if (bot_decision_random_number <= 4) {
-                // CHECK
-                std::cout << "bot " << it->get_name() << " made this action: check" << std::endl;
-                ++it;
-    
-            } else if (bot_decision_random_number == 5 && it->get_chips()>0) {
-                // RAISE
-                
-                std::uniform_int_distribution<> dist2(5, 20); 
-                int bot_raise_random_number = dist2(gen);
-                
-                
-                int bot_betting_amount{};
-                did_bots_raise = true;
-                
-                if (difficulty == 4){
-                    bot_betting_amount = (bot_raise_random_number + 0.005*starting_chips*bot_raise_random_number)*3;
-                } else {
-                    bot_betting_amount = bot_raise_random_number + 0.005*starting_chips*bot_raise_random_number;
-                }
-                
-                //introduces more bot raise decision options
-                if (bot_raise_random_number == 19){
-                    bot_betting_amount = bot_betting_amount*5;
-                } else if (bot_raise_random_number ==20){
-                    bot_betting_amount = bot_betting_amount*2;
+// Solves a push/fold chart by fictitious play: every iteration each player best responds to the average
+// strategies of the others, and the averages converge to the equilibrium. Only the first caller is
+// modelled, players behind a caller fold, and all stacks are stack_bb big blinds.
+inline Chart solve_chart(const Equity_Table& equities, int nr_of_players, int stack_bb, int iterations) {
+    if (nr_of_players < 2 || nr_of_players > max_players || stack_bb < 1 || stack_bb > max_stack_bb) {
+        throw std::invalid_argument("Push/fold charts cover 2 to 6 players and 1 to 20 big blinds.");
+    }
+    Chart chart;
+    chart.nr_of_players = nr_of_players;
+    chart.stack_bb = stack_bb;
+    const double stack = stack_bb;
+    auto blind = [nr_of_players](int position) {
+        return position == nr_of_players - 1 ? 1.0 : (position == nr_of_players - 2 ? 0.5 : 0.0);
+    };
+    std::array<float, nr_of_classes> weights{};
+    for (int hand{0}; hand < nr_of_classes; hand++) {
+        weights[hand] = class_combos(hand) / 1326.0f;
+    }
+    // everyone starts pushing and calling with everything
+    for (auto& range : chart.push) {
+        range.fill(1.0f);
+    }
+    for (auto& by_caller : chart.call) {
+        for (auto& range : by_caller) {
+            range.fill(1.0f);
+        }
+    }
+
+    // equity of a hand against a weighted range, written into out, returns the weight of the range
+    auto equity_against = [&](const std::array<float, nr_of_classes>& range, std::array<float, nr_of_classes>& out) {
+        float range_weight{0};
+        std::array<float, nr_of_classes> weighted{};
+        for (int hand{0}; hand < nr_of_classes; hand++) {
+            weighted[hand] = range[hand] * weights[hand];
+            range_weight += weighted[hand];
+        }
+        for (int hand{0}; hand < nr_of_classes; hand++) {
+            const float* row = &equities.equity[hand * nr_of_classes];
+            float sum{0};
+            for (int against{0}; against < nr_of_classes; against++) {
+                sum += row[against] * weighted[against];
+            }
+            out[hand] = range_weight > 0 ? sum / range_weight : 0.5f;
+        }
+        return range_weight;
+    };
+
+    std::array<float, nr_of_classes> equity{};
+    for (int iteration{1}; iteration <= iterations; iteration++) {
+        float step = 1.0f / (iteration + 1);
+        for (int pusher{0}; pusher < nr_of_players - 1; pusher++) {
+            // pusher's best response against the callers behind
+            std::array<double, nr_of_classes> push_ev{};
+            double nobody_called{1};
+            for (int caller{pusher + 1}; caller < nr_of_players; caller++) {
+                double call_frequency = equity_against(chart.call[pusher][caller], equity);
+                double pot = 2 * stack + 1.5 - blind(pusher) - blind(caller);
+                for (int hand{0}; hand < nr_of_classes; hand++) {
+                    push_ev[hand] += nobody_called * call_frequency * (equity[hand] * pot - stack);
                 }
-                
-                if (bot_betting_amount > it->get_chips()){
-                    bot_betting_amount = it->get_chips();
-                    std::cout<<"bot "<<it->get_name()<<"made this action: raise "<< bot_betting_amount<< "  and went ALL IN!!!"<<std::endl;
-                    it->bet(bot_betting_amount, pot);
-                    bot.update_bot_chips(it-> get_name(), bot_betting_amount);
-                } else{
-                std::cout << "the bot named " << it->get_name() << " made this action: raise " <<bot_betting_amount<< std::endl;
-                it->bet(bot_betting_amount, pot);
-                bot.update_bot_chips(it-> get_name(), bot_betting_amount);
+                nobody_called *= 1 - call_frequency;
+            }
+            for (int hand{0}; hand < nr_of_classes; hand++) {
+                push_ev[hand] += nobody_called * (1.5 - blind(pusher));
+                float best = push_ev[hand] > -blind(pusher) ? 1.0f : 0.0f;
+                chart.push[pusher][hand] += (best - chart.push[pusher][hand]) * step;
+            }
+
+            // each caller's best response against the push
+            float push_weight = equity_against(chart.push[pusher], equity);
+            for (int caller{pusher + 1}; caller < nr_of_players; caller++) {
+                double pot = 2 * stack + 1.5 - blind(pusher) - blind(caller);
+                for (int hand{0}; hand < nr_of_classes; hand++) {
+                    float best = push_weight > 0 && equity[hand] * pot - stack > -blind(caller) ? 1.0f : 0.0f;
+                    chart.call[pusher][caller][hand] += (best - chart.call[pusher][caller][hand]) * step;
                 }
-    
-             
-    
-                // Find the iterator pointing to the current bot in the other_bots_in_the_game vector
-                 auto current_bot_it = std::find(bots_in_the_game.begin(), bots_in_the_game.end(), *it);
+            }
+        }
+    }
+    return chart;
+}
 
-                bot_response(bot_betting_amount, it->get_name());
+// Charts for every table size and stack depth, solved on demand or in the background and cached in a file
+class Chart_Cache {
+private:
+    std::string path;
+    Equity_Table equities;
+    bool has_equities{false};
+    std::map<std::pair<int, int>, Chart> charts;  // by (players, big blinds), entries never move once added
+    std::mutex mutex;                             // guards charts
+    std::mutex solve_mutex;                       // one solve at a time, guards equities
+    std::atomic<bool> stopping{false};
+    std::thread background;
+    int iterations{300};
 
-            
+    static std::pair<int, int> key_of(int nr_of_players, int stack_bb) {
+        return { std::clamp(nr_of_players, 2, max_players), std::clamp(stack_bb, 1, max_stack_bb) };
+    }
 
-                if (human_in_the_game == true && human.get_chips()>0) {
-                    human_response(bot_betting_amount);
-                }
-    
-                break;
-    
-            } 
+    void ensure_equities() {
+        if (!has_equities) {
+            equities = Equity_Table::compute(600, std::max(1u, std::thread::hardware_concurrency()), 0x9F);
+            has_equities = true;
         }
-            
     }
 
+    // Frequencies are stored as bytes, which is far finer than the 0.5 cut the bots use
+    static void write_range(std::vector<std::uint8_t>& out, const std::array<float, nr_of_classes>& range) {
+        for (float frequency : range) {
+            out.push_back(static_cast<std::uint8_t>(std::lround(std::clamp(frequency, 0.0f, 1.0f) * 255)));
+        }
+    }
 
-    
-    void bot_response(int bet_amount, const std::string &raiser_bot_name) {
-        std::vector<int> indices_to_remove;
-        for (int i = 0; i < bots_in_the_game.size(); ++i) {
-            if (bots_in_the_game[i].get_name() == raiser_bot_name) {
-                continue;
+    static const std::uint8_t* read_range(const std::uint8_t* in, std::array<float, nr_of_classes>& range) {
+        for (float& frequency : range) {
+            frequency = *in++ / 255.0f;
+        }
+        return in;
+    }
+
+    void load() {
+        std::FILE* file = std::fopen(path.c_str(), "rb");
+        if (file == nullptr) {
+            return;
+        }
+        std::vector<std::uint8_t> bytes;
+        std::uint8_t buffer[65536];
+        for (std::size_t read; (read = std::fread(buffer, 1, sizeof(buffer), file)) > 0;) {
+            bytes.insert(bytes.end(), buffer, buffer + read);
+        }
+        std::fclose(file);
+
+        std::size_t chart_size = 2 + nr_of_classes * max_players * (1 + max_players);
+        std::size_t header_size = 12 + sizeof(float) * equities.equity.size();
+        std::uint32_t header[3] = {};
+        if (bytes.size() >= header_size) {
+            std::memcpy(header, bytes.data(), sizeof(header));
+        }
+        if (header[0] != file_magic || header[1] != file_version || bytes.size() != header_size + header[2] * chart_size) {
+            return;  // a stale or foreign file is simply solved again
+        }
+        std::memcpy(equities.equity.data(), bytes.data() + 12, sizeof(float) * equities.equity.size());
+        has_equities = true;
+        const std::uint8_t* in = bytes.data() + header_size;
+        for (std::uint32_t i{0}; i < header[2]; i++) {
+            Chart chart;
+            chart.nr_of_players = *in++;
+            chart.stack_bb = *in++;
+            for (auto& range : chart.push) {
+                in = read_range(in, range);
             }
-    
-            std::random_device rd;
-            std::mt19937 gen(rd());
-            std::uniform_int_distribution<> dist(1, 3);
-    
-            int random_number = dist(gen);
-    
-            if (random_number == 1 && bots_in_the_game[i].get_chips()>0 &&bots_in_the_game.size()>0) {
-                // FOLD
-                std::cout << "the bot named " << bots_in_the_game[i].get_name() << " responded with this action: fold" << std::endl;
-                indices_to_remove.push_back(i);
-            } else if (bots_in_the_game[i].get_chips()>0){
-                //CALL
-                std::cout << "the bot named " << bots_in_the_game[i].get_name() << " responded with this action: call" << std::endl;
-                if (bet_amount>=bots_in_the_game[i].get_chips()){
-                    std::cout<<"Bot "<<bots_in_the_game[i].get_name()<<" went ALL IN !!!"<<std::endl;
-                    int smaller_bet_amount = bots_in_the_game[i].get_chips();
-                    bots_in_the_game[i].bet(smaller_bet_amount, pot);
-                    bot.update_bot_chips(bots_in_the_game[i].get_name(), smaller_bet_amount);
-                } else{
-                    bots_in_the_game[i].bet(bet_amount, pot);
-                    bot.update_bot_chips(bots_in_the_game[i].get_name(), bet_amount);
+            for (auto& by_caller : chart.call) {
+                for (auto& range : by_caller) {
+                    in = read_range(in, range);
                 }
             }
+            charts[{chart.nr_of_players, chart.stack_bb}] = chart;
         }
-        std::sort(indices_to_remove.begin(), indices_to_remove.end(), std::greater<>()); // sort in descending order
-        for (int index : indices_to_remove) {
-            bots_in_the_game.erase(bots_in_the_game.begin() + index);
+    }
+
+    void save() const {
+        std::vector<std::uint8_t> bytes(12 + sizeof(float) * equities.equity.size());
+        std::uint32_t header[3] = { file_magic, file_version, static_cast<std::uint32_t>(charts.size()) };
+        std::memcpy(bytes.data(), header, sizeof(header));
+        std::memcpy(bytes.data() + 12, equities.equity.data(), sizeof(float) * equities.equity.size());
+        for (const auto& entry : charts) {
+            const Chart& chart = entry.second;
+            bytes.push_back(static_cast<std::uint8_t>(chart.nr_of_players));
+            bytes.push_back(static_cast<std::uint8_t>(chart.stack_bb));
+            for (const auto& range : chart.push) {
+                write_range(bytes, range);
+            }
+            for (const auto& by_caller : chart.call) {
+                for (const auto& range : by_caller) {
+                    write_range(bytes, range);
+                }
+            }
+        }
+        std::string temporary_path = path + ".tmp";
+        std::FILE* file = std::fopen(temporary_path.c_str(), "wb");
+        if (file == nullptr) {
+            throw std::runtime_error("Could not open " + temporary_path + " for writing.");
+        }
+        bool written = std::fwrite(bytes.data(), 1, bytes.size(), file) == bytes.size();
+        written = std::fclose(file) == 0 && written;
+        if (!written || std::rename(temporary_path.c_str(), path.c_str()) != 0) {
+            throw std::runtime_error("Could not save the push/fold charts to " + path);
         }
     }
 
+public:
+    explicit Chart_Cache(const std::string& i_path) : path(i_path) {
+        load();
+    }
 
+    Chart_Cache(const Chart_Cache&) = delete;
+    Chart_Cache& operator=(const Chart_Cache&) = delete;
 
-    
-    bool human_turn() {
-        bool validInput = false;
-        bool did_bots_respond = false;
-        
-        while (!validInput) {
-            try {
-                std::cout << "Choose one of the following actions: fold, check, raise" << std::endl;
-                std::string user_action;
-                std::cin >> user_action;
-        
-                if (user_action == "check") {
-                    std::cout << "Human player checked" << std::endl;
-                    validInput = true;
-                } else if (user_action == "raise"){
-                    int human_bet_amount;
-                    int max_chips;
-                    std::string max_chips_player_name;
-                    
-                    auto max_chips_player_it = std::max_element(bots_in_the_game.begin(), bots_in_the_game.end(), 
-                    [](const Player &a, const Player &b) {
-                        return a.get_chips() < b.get_chips();
-                    });
-                    max_chips = max_chips_player_it->get_chips();
-                    max_chips_player_name = max_chips_player_it->get_name();
-                    
-                    std::cout << "You have " << human.get_chips() << " chips" <<std::endl<< "max opponent chips are: "<<max_chips<< " held by "<<max_chips_player_name<<std::endl<<"How much are you betting?" << std::endl;
-                    std::cin >> human_bet_amount;
-                    if (human_bet_amount <= 0 || human_bet_amount > human.get_chips() || human_bet_amount>max_chips) {
-                        throw std::invalid_argument("Invalid bet amount!");
+    // A background solve stops after its current charts and keeps the ones it finished
+    ~Chart_Cache() {
+        stopping = true;
+        if (background.joinable()) {
+            background.join();
+        }
+    }
+
+    // The chart for a table size and stack depth, both clamped to the solved grid, solved now if missing
+    const Chart& chart(int nr_of_players, int stack_bb) {
+        std::pair<int, int> key = key_of(nr_of_players, stack_bb);
+        if (const Chart* found = find(key.first, key.second)) {
+            return *found;
+        }
+        std::lock_guard<std::mutex> solve_lock(solve_mutex);
+        ensure_equities();
+        Chart solved = solve_chart(equities, key.first, key.second, iterations);
+        std::lock_guard<std::mutex> lock(mutex);
+        const Chart& added = charts.emplace(key, solved).first->second;
+        save();
+        return added;
+    }
+
+    // The chart if it is already solved, nullptr otherwise; never waits for a solve
+    const Chart* find(int nr_of_players, int stack_bb) {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto found = charts.find(key_of(nr_of_players, stack_bb));
+        return found != charts.end() ? &found->second : nullptr;
+    }
+
+    bool is_complete() {
+        std::lock_guard<std::mutex> lock(mutex);
+        return charts.size() == static_cast<std::size_t>((max_players - 1) * max_stack_bb);
+    }
+
+    // Solves the whole grid, the charts in parallel, and saves it
+    void solve_all(unsigned nr_of_threads) {
+        std::lock_guard<std::mutex> solve_lock(solve_mutex);
+        ensure_equities();
+        std::vector<std::pair<int, int>> missing;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            for (int players{2}; players <= max_players; players++) {
+                for (int stack_bb{1}; stack_bb <= max_stack_bb; stack_bb++) {
+                    if (charts.find({players, stack_bb}) == charts.end()) {
+                        missing.push_back({players, stack_bb});
                     }
-    
-                    human.bet(human_bet_amount, pot);
-                    std::string bot_raiser_name = "none";
-                    bot_response(human_bet_amount, bot_raiser_name);
-                    did_bots_respond = true;
-                    validInput = true;
-                } else if (user_action == "fold") {
-                    std::cout << "Human player folded" << std::endl;
-                    human_in_the_game = false;
-                    validInput = true;
-                } else {
-                    throw std::invalid_argument("Invalid action. ");
                 }
-            } 
-            catch (const std::invalid_argument& e) {
-                std::cerr << e.what() << '\n';
             }
         }
+        // each chart is published as soon as it is solved, so lookups can use it while the rest are solved
+        std::atomic<std::size_t> next{0};
+        auto work = [&]() {
+            for (std::size_t i = next++; i < missing.size() && !stopping; i = next++) {
+                Chart solved = solve_chart(equities, missing[i].first, missing[i].second, iterations);
+                std::lock_guard<std::mutex> lock(mutex);
+                charts.emplace(missing[i], solved);
+            }
+        };
+        std::vector<std::thread> workers;
+        for (unsigned t{1}; t < nr_of_threads; t++) {
+            workers.emplace_back(work);
+        }
+        work();
+        for (auto& worker : workers) {
+            worker.join();
+        }
+        std::lock_guard<std::mutex> lock(mutex);
+        save();
+    }
 
-    return did_bots_respond;
-}
+    // Solves the missing charts on a background thread, so a game can start before they exist
+    void solve_in_background(unsigned nr_of_threads) {
+        if (background.joinable() || is_complete()) {
+            return;
+        }
+        background = std::thread([this, nr_of_threads]() {
+            try {
+                solve_all(nr_of_threads);
+            } catch (const std::exception& e) {
+                std::cerr << e.what() << '\n';
+            }
+        });
+    }
+};
+
+} // namespace Push_Fold end
+
+
+namespace Players {
+
+using Cards::Card;
+using Cards::Deck;
+using Game::Bet;
+using Game::Pot;
+
+class Player {
+protected:
+    std::string name;
+    int chips;
+    std::vector<Card> hole_cards;  // two, or four in Omaha
+
+public:
+    Player(std::string i_name, int i_chips, std::vector<Card> i_hole_cards)
+        : name(i_name),
+          chips(i_chips),
+          hole_cards(std::move(i_hole_cards)) {}
+
+    Player(std::string i_name, int i_chips, Card i_card1, Card i_card2)
+        : Player(i_name, i_chips, std::vector<Card>{ i_card1, i_card2 }) {}
 
+    std::string get_name() const { return name; }
+    int get_chips() const { return chips; }
+    Card get_card1() const { return hole_cards[0]; }
+    Card get_card2() const { return hole_cards[1]; }
+    const std::vector<Card>& get_hole_cards() const { return hole_cards; }
+
+    // The hole cards as they are printed, separated by spaces
+    std::string hole_cards_text() const {
+        std::ostringstream text;
+        for (std::size_t i{0}; i < hole_cards.size(); i++) {
+            text << (i > 0 ? " " : "") << hole_cards[i];
+        }
+        return text.str();
+    }
+    
+    // Static function to show player information
+    static void show_player_info(std::vector<Player> selected_players) {
+        for (auto &object : selected_players) {
+            std::cout << "Bot opponent: " << object.get_name() << ", chips: " << object.get_chips() << std::endl;
+        }
+    }
     
+    bool operator==(const Player& other) const {
+        // Compare the attributes of the Player class, for example:
+        return name == other.name && chips == other.chips; // Add any other attributes you want to compare.
+    }
     
+    // Player class
     
-    void human_response(int amount){
-        bool validInput = false;
+    // Make a bet and add it to the pot
+    std::shared_ptr<Bet> bet(int amount, Pot& pot) {
+        std::string betting_player_name{ get_name() };
+        std::shared_ptr<Bet> bet = std::make_shared<Bet>(amount, betting_player_name);
+        pot.add_to_pot(bet);
+        chips -= amount;
         
-        while (!validInput) {
-            try {
-                std::cout << "Other players are betting "<< amount << ", and you currently have: "<< human.get_chips() << ". What is your action?"<<std::endl<<"call, fold, raise"<<std::endl;
-                std::string human_action;
-                std::cin >> human_action;
+        return bet;
+    }
     
-                if (human_action == "fold") {
-                    std::cout << "Human player folded"<<std::endl;
-                    human_in_the_game = false;
-                    validInput = true;
-                } 
-                else if (human_action == "call") {
-                    int human_bet = amount;
-                    std::cout << "Human player called"<<std::endl;
-                    if (human.get_chips() < amount) {
-                        human_bet = human.get_chips();
-                        std::cout<<"human player went ALL IN!"<<std::endl;
-                    }
-                    
-                    human.bet(human_bet, pot);
-                    validInput = true;
-                } 
-                else if (human_action == "raise") {
-                    if (human.get_chips() <= amount) {
-                        throw std::invalid_argument("You don't have enough chips to raise!");
-                    }
-                    
-                    int max_chips;
-                    std::string max_chips_player_name;
-                    
-                    auto max_chips_player_it = std::max_element(bots_in_the_game.begin(), bots_in_the_game.end(), 
-                    [](const Player &a, const Player &b) {
-                        return a.get_chips() < b.get_chips();
-                    });
-                    max_chips = max_chips_player_it->get_chips();
-                    max_chips_player_name = max_chips_player_it->get_name();
-                    
-                    std::cout << "How many extra chips are you adding?\n"<< " You currently have "<<human.get_chips()-amount<< " chips. Max opponent chips: "<< max_chips<<" held by "<<max_chips_player_name<<std::endl;
-                    int extra_chips;
-                    std::cin >> extra_chips;
-                    if (extra_chips <= 0 || extra_chips > human.get_chips() - amount || extra_chips > max_chips) {
-                        throw std::invalid_argument("Invalid number of extra chips!");
-                    }
-                    human.bet(amount, pot);
-                    human.bet(extra_chips, pot);
-                    std::string bot_raiser_name = "na";
-                    bot_response(extra_chips, bot_raiser_name);
-                    validInput = true;
-                } 
-                else {
-                    throw std::invalid_argument("Invalid action. Please choose 'fold', 'call', or 'raise'.");
-                }
-            } 
-            catch (const std::invalid_argument& e) {
-                std::cerr << e.what() << '\n';
-            }
-        }
+    // Receive a share of the pot
+    void receive_pot_share(int amount) {
+        chips += amount;
     }
     
-        
-        void show_board(){
-            std::cout<<"the current community pot is: "<< pot.get_final_pot()<<std::endl;
-            
-                
-            std::cout<<"bots left in the game:  "<<bots_in_the_game.size()<<std::endl;
-            Player::show_player_info(bots_in_the_game);
-            deck.print_community_cards();
-            human.show_human_cards();
-            std::cout<<"Your current chips: "<<human.get_chips()<<std::endl;
-            
+    // Set new cards for the player
+    void set_new_cards(std::vector<Card> input_cards) {
+        hole_cards = std::move(input_cards);
     }
     
-    
-    void distribute_pot(std::vector<std::string> winning_player_names, std::vector<Player> all_final_players, int total_pot_amount) {
-        //if winners went all in and do not compete for all of the pot
-        int distributed_chips{0};
-        int distributed_chips_count{0};
-        int amount_to_distribute = total_pot_amount / winning_player_names.size();
-        std::string partial_pot_winner;
-        //checks all of the winners who do not receive the total shared pot
-        for (const auto& player_name : winning_player_names) {
-            for(auto &bot_initial : bot_initial_copy){
-                if (player_name == bot_initial.get_name()){
-                    if (amount_to_distribute > bot_initial.get_chips()*(std::max(bot_initial_copy.size()/2 , all_final_players.size()))){
-                        bot.update_chips_for_bot(player_name, bot_initial.get_chips()*(std::max(bot_initial_copy.size()/2 , all_final_players.size())));
-                        std::cout<<"Bot player "<< player_name << " receives a partial pot: "<< bot_initial.get_chips()*(std::max(bot_initial_copy.size()/2 , all_final_players.size())) <<" chips"<<std::endl;
-                        partial_pot_winner = player_name;
-                        distributed_chips += bot_initial.get_chips()*(std::max(bot_initial_copy.size()/2 , all_final_players.size()));
-                        distributed_chips_count +=1;
-                        break;
-                        }
-                    }
-                }
-        }
-        
-        if(distributed_chips_count>0 && (all_final_players.size()-distributed_chips_count)>0){
-            int remaining_chips = (total_pot_amount-distributed_chips)/(all_final_players.size()-distributed_chips_count);
-            for (const auto& player : all_final_players){
-                if (partial_pot_winner != player.get_name()){
-                    
-                    if (player.get_name() == human.get_name()) {
-                    human.receive_pot_share(remaining_chips);
-                    std::cout<<"Human player "<< human.get_name() << " gets back their chips "<< remaining_chips <<" chips"<<std::endl;
-                } else {
-                    bot.update_chips_for_bot(player.get_name(), remaining_chips);
-                    std::cout<<"Non-winner bot player "<< player.get_name() << " gets back their chips "<< remaining_chips <<" chips"<<std::endl;
-                    }
-                    
-                }
-            }
-        }
-        else if (distributed_chips_count == 0) {
-            
-            for (const auto& player_name : winning_player_names){
-            
-                if (player_name == human.get_name()) {
-                    human.receive_pot_share(amount_to_distribute);
-                    std::cout<<"Human player "<< human.get_name() << " receives "<< amount_to_distribute <<" chips"<<std::endl;
-                } else {
-                    bot.update_chips_for_bot(player_name, amount_to_distribute);
-                    std::cout<<"Bot player "<< player_name << " receives "<< amount_to_distribute <<" chips"<<std::endl;
-                }
-            }
-            
-        }
-    }   
+    // Update the player's chips
+    void update_chips(int new_chips) {
+        chips = new_chips;
+    }
+};
 
+class Bot : public Player {
+public:
+    Bot() : Player("", 0, Card("", ""), Card("", "")) {}
 
-    std::pair<Player, Player> get_two_random_players(std::vector<Player>& players) {
-        // Initialize a random number generator with a random device
-        std::random_device rd;
-        std::mt19937 rng(rd());
+    std::vector<Player> bots;
     
-        // Create a uniform distribution that covers the range of the vector's indices
-        std::uniform_int_distribution<int> dist(0, players.size() - 1);
+    std::vector<std::string> names = { "Alice", "Bence", "Carol", "David", "Eve", "Frank", "Grace", "Helen", "Ivan", "Judy", "Karl", "Laura", "Mike", "Nancy", "Oscar", "Paul", "Quincy", "Rita", "Steve", "Tina" };
+     
+    // Get a bot name from the list
+    std::string take_bot_name() {
+        std::string bot_name = names.back();
+        names.pop_back();
+        return bot_name;
+    }
     
-        // Get two random indices. Use a set to ensure they are unique
-        std::set<int> randomIndices;
-        while (randomIndices.size() < 2) {
-            randomIndices.insert(dist(rng));
+    // Create bots with random cards
+    void create_bots(Deck& deck, int nr_bots, int start_chips, Cards::Session_Rng& rng) {
+        std::shuffle(names.begin(), names.end(), rng);
+        for (int i{0}; i < nr_bots; i++) {
+            std::vector<Card> hole_cards = deck.take_hole_cards();
+            std::string bot_name = take_bot_name();
+            bots.emplace_back(bot_name, start_chips, hole_cards);
         }
-    
-        // Get iterators to the two random players
-        auto it = randomIndices.begin();
-        Player& player1 = players[*it];
-        ++it;
-        Player& player2 = players[*it];
-    
-        // Return the two players
-        return std::make_pair(player1, player2);
     }
     
+    // Show information about the default bots
+    void show_default_bots() {
+        for (const auto& object : bots) {
+            std::cout << "This is a default bot player in this game: " << object.get_name()
+                      << ", cards: " << object.hole_cards_text()
+                      << ", chips: " << object.get_chips() << std::endl;
+        }
+    }
     
-    
-    
-    
-    
-    
-    
-    
-    void game_analytics(std::vector<std::string> winner_names, std::vector<Player> remaining_players, Ranking&ranking){
-        
-        std::cout<<std::endl<<"Game analytics feedback to the user:"<<std::endl;
-        std::vector<std::pair<std::string, std::pair<Poker_Ranks, int>>> player_name_and_rank;
-    
-        for (const auto& player : remaining_players) {
-            Card card1 = player.get_card1();
-            Card card2 = player.get_card2();
-    
-            std::pair<Poker_Ranks, int> player_hand = ranking.evaluate_hand(card1, card2, deck.get_community_cards());
-    
-            player_name_and_rank.push_back(std::make_pair(player.get_name(), player_hand));
+    // Get the bots as a vector of players
+    std::vector<Player> get_bots() {
+        std::vector<Player> local_container;
+        for(auto& bot : bots) {
+            local_container.push_back(bot);
         }
-        
-        std::sort(player_name_and_rank.begin(), player_name_and_rank.end(), Ranking::compare_hand_ranks);
+        return local_container;
+    }
     
-        if(human_in_the_game == true){
-            bool human_is_among_the_winners = false;
-            
-            std::pair<Poker_Ranks, int> human_hand = ranking.evaluate_hand(human.get_card1(), human.get_card2(), deck.get_community_cards());
-                
-                std::pair<Poker_Ranks, int> highest_rank = player_name_and_rank[0].second;
-                
-            
-            for(auto &name : winner_names){
-                if (name == "Human"){
-                    //checks if human was the winner
-                    int rank_difference = static_cast<int>(human_hand.first) - static_cast<int>(player_name_and_rank[1].second.first);
-                    
-                    if (pot.get_final_pot() < 0.5*human.get_chips()){
-                        //checks if human could have raised more
-                        //based on rank difference it tells whether the user`s` moves were risky 
-                        if (rank_difference > 1){
-                            std::cout<<"Great job! \n Next time consider making bigger bets when you are in a similar situation, because you had way better hand rank"<<std::endl;
-                        } else {
-                            std::cout<<"Great job! \n It was a well balanced risk-reward betting ratio"<<std::endl;
-                        }
-                        
-                        
-                    } else{
-                        
-                        if (rank_difference >= 1 || player_name_and_rank.size() == 1){
-                            std::cout<<"Great job! Analytics show that you played a very good game!"<<std::endl;
-                        } else if (static_cast<int>(highest_rank.first) >= 3 && player_name_and_rank.size()>1 && rank_difference == 0){
-                            std::cout<<"It was a RISKY RAISE that you made \n Other players had the same poker hand rank, but the rank was a strong one \n Overall, such raising strategy is likely to be profitable in the long run !"<<std::endl;
-                        } else if (rank_difference == 0) {
-                            std::cout<<"It was a RISKY RAISE that you made \n Risk-reward ratio was not the best - you got a bit fortunate with the win \n There is a high chance that such strategy would not be profitable in the long run !"<<std::endl;
-                        }
-                        
-                        
-                        
-                    }
-                    human_is_among_the_winners = true;
-                }
-            }
+    // Get the number of bots
+    int get_bots_number() {
+        return bots.size();
+    }
     
-            if (!human_is_among_the_winners) {
-                // if human lost the game
-                int rank_difference = static_cast<int>(player_name_and_rank[0].second.first) - static_cast<int>(human_hand.first);
+    // Redistribute new cards to the bots from the deck
+    void redistribute_bot_cards(Deck& deck) {
+        for (auto& bot : bots) {
+            bot.set_new_cards(deck.take_hole_cards());
+        }
+    }
+
+    // Convert bots to a vector of reference wrappers
+    std::vector<std::reference_wrapper<Player>> refer_updated_bots() {
+        std::vector<std::reference_wrapper<Player>> local_container;
+        for(auto& bot : bots) {
+            local_container.push_back(std::ref(bot));
+        }
+        return local_container;
+    }
     
-                if (rank_difference > 1) {
-                    std::cout << "The difference between your hand rank and the winning hand rank was more than 1. \n It was a VERY BAD MOVE!\n In a similar situation consider FOLD as early as possible" << std::endl;
-                } else if (rank_difference == 1) {
-                    std::cout << "The difference between your hand rank and the winning hand rank was 1 . \n Try to be more aware of other players possible hands next time \n Also, try to Fold early on when your hands are not strong." << std::endl;
-                } else{
-                    std::cout<<"You were UNLUCKY this game. Opponents had identical hand rank, but with higher quality, so they won the game. \n It was a good game and with a bit more luck next time, you would probably win it!"<<std::endl;
-                    }    
-                }
-            }
+    void update_bots() {
+        std::vector<std::reference_wrapper<Player>> botRefs = this->refer_updated_bots();
+        // copied before bots is cleared, the references point into it
+        std::vector<Player> updatedBots;
+        for(auto& botRef : botRefs) {
+            updatedBots.push_back(botRef.get());
+        }
+        bots = std::move(updatedBots);
+    }
+
+    void update_bot_chips(std::string bot_name, int amount){
         
-    
-        if (human_in_the_game == false){
-            //if human folded in the game
-            std::pair<Poker_Ranks, int> human_hand = ranking.evaluate_hand(human.get_card1(), human.get_card2(), deck.get_community_cards());
-            player_name_and_rank.push_back(std::make_pair(human.get_name(), human_hand));
-            std::sort(player_name_and_rank.begin(), player_name_and_rank.end(), Ranking::compare_hand_ranks);
-    
-            std::pair<Poker_Ranks, int> highest_rank = player_name_and_rank[0].second;
-            std::vector<std::string> fictional_winners;
-            
-            for (auto &player : player_name_and_rank){
-                if(player.second == highest_rank){
-                    fictional_winners.push_back(player.first);
-                }
-            }
-            
-            bool human_would_have_been_the_winner = false;
-            for (auto &name : fictional_winners){
-                if (name == "Human"){
-                    // if human would have been the winner if he did not fold
-                    int rank_difference = static_cast<int>(human_hand.first) - static_cast<int>(player_name_and_rank[1].second.first);
-                    
-                    if (rank_difference >1){
-                        std::cout<<"You would have been the winner... \n It seems that you got scared and ran out of the game when YOU HAD THE BEST CARDS!\n A VERY BAD FOLD decision! "<<std::endl;
-                    } else if (rank_difference == 1){
-                        std::cout<<"You would have been the winner... \n It would have been a strong win! Other players did not have your hand rank \n Next time you can be more confident with similar cards"<<std::endl;
-                    } else {
-                        std::cout<<"You would have been the winner... but it would be a close one \n You and bots had the same rank type, but your rank quality would have been better!\n Next time you can try to play more aggressively in similar scenarios! "<<std::endl;
-                    }
-                    
-                    std::cout<<" Your rank would have been:\n Human FINAL RANK: "<< Ranking::poker_rank_to_string(human_hand.first)<<" of order "<<human_hand.second<<"\n the winner`s hand rank was: "<< Ranking::poker_rank_to_string(player_name_and_rank[1].second.first) << " of order "<< player_name_and_rank[1].second.second<<std::endl;
-                    human_would_have_been_the_winner = true;
-                    break;
-                }
+        for (auto &object : bots){
+            if (object.get_name() == bot_name){
+                object.update_chips(object.get_chips() - amount);
+                break;
             }
+        }
+    }
     
-            if (human_would_have_been_the_winner == false){
-                if (human_hand.first == highest_rank.first){
-                    std::cout<<" Your and winner hand ranks would have been the same, but the winner opponent had a better rank quality :) \n  GOOD FOLD decision ! And analytics admit that you were unlucky this game..."<<std::endl;
-                } else {
-                    std::cout<<" Winner`s hand ranks were better \n so it was GOOD DECISION to FOLD"<<std::endl;
-                    
-                }
-    
-                std::cout<<" Your rank would have been:\n Human FINAL RANK: "<< Ranking::poker_rank_to_string(human_hand.first)<< " of order "<< human_hand.second <<"\n the winner`s hand rank was: "<< Ranking::poker_rank_to_string(highest_rank.first) << " of order "<< highest_rank.second<<std::endl;
-                
-            }
+    void update_chips_for_bot(const std::string& bot_name, int amount) {
+    for (auto& bot : bots){
+        if (bot.get_name() == bot_name){
+            bot.receive_pot_share(amount);
+            break;
         }
-    } // game analytics function end
+    }
+}
 
+    void delete_defeated_bots() {
+    for (auto it = bots.begin(); it != bots.end();) {
+        if (it->get_chips() == 0) {
+            it = bots.erase(it);  // Use the return value of erase to get a valid iterator
+        } else {
+            ++it;  // Only increment the iterator if we didn't erase an element
+        }
+    }
+}
 
 
 
     
+};
+
+class Human : public Player {
+public:
     
+    // Constructor for the Human player
+    Human(int start_chips, Deck& deck)
+        : Player("Human", start_chips, deck.take_hole_cards()) {}
+
+    // Show the human player's cards
+    void show_human_cards() {
+        std::cout << "Your cards are: " << hole_cards_text() << std::endl;
+    }
     
-    
-    
-    
-    void run() {
-        
-        if (it_is_the_first_game == true){
-            //initialise the game when it is the first game
-            int bot_chips;
-            std::cout<<"new bots created"<<std::endl;
-            
-            if (difficulty ==1){
-                bot_chips = starting_chips/2;
-                bot.create_bots(deck, nr_of_bots, bot_chips);
-            } else if (difficulty == 2) {
-                bot_chips = starting_chips;
-                bot.create_bots(deck, nr_of_bots, bot_chips);
-            } else if (difficulty == 3) {
-                bot_chips = starting_chips*2;
-                bot.create_bots(deck, nr_of_bots, bot_chips);
-            } else if (difficulty == 4){
-                bot_chips = starting_chips*10;
-                bot.create_bots(deck, nr_of_bots, bot_chips);
+    // Redistribute new cards to the human player from the deck
+    void redistribute_human_cards(Deck& deck){
+        this->set_new_cards(deck.take_hole_cards());
+    }
+};
+
+
+} // namespace Players end
+
+namespace Game {
+
+using Cards::Deck;
+using Cards::Deck_Type;
+using Cards::Card;
+using Cards::Session_Rng;
+using namespace Players;
+
+
+enum class Poker_Ranks {
+    high_card = 0,
+    pair = 1,
+    two_pair = 2,
+    three_of_a_kind = 3,
+    straight = 4,
+    flush = 5,
+    full_house = 6,
+    four_of_a_kind = 7,
+    straight_flush = 8,
+    royal_flush = 9
+    
+    
+};
+
+
+
+
+
+
+
+class Ranking {
+
+private:
+    static bool has_run;
+
+
+public:
+    
+
+    static bool compare_hand_ranks(const std::pair<std::string, std::pair<Poker_Ranks, int>>& a, const std::pair<std::string, std::pair<Poker_Ranks, int>>& b) {
+        return is_better_hand(a.second, b.second, Deck_Type::standard);
+    }
+
+    // Position of a hand rank in the order of the deck: in a short deck a flush beats a full house
+    static int hand_order(Poker_Ranks rank, Deck_Type deck_type) {
+        if (deck_type == Deck_Type::short_deck && rank == Poker_Ranks::flush) {
+            return static_cast<int>(Poker_Ranks::full_house);
+        }
+        if (deck_type == Deck_Type::short_deck && rank == Poker_Ranks::full_house) {
+            return static_cast<int>(Poker_Ranks::flush);
+        }
+        return static_cast<int>(rank);
+    }
+
+    static bool is_better_hand(const std::pair<Poker_Ranks, int>& a, const std::pair<Poker_Ranks, int>& b, Deck_Type deck_type) {
+        if (a.first != b.first) {
+            return hand_order(a.first, deck_type) > hand_order(b.first, deck_type);
+        }
+        return a.second > b.second;
+    }
+    
+    static void reset(){
+        has_run=false;
+    }
+    
+
+    // Sorts the players by hand and returns the names sharing the best one
+    static std::vector<std::string> top_ranked_names(std::vector<std::pair<std::string, std::pair<Poker_Ranks, int>>>& player_name_and_rank,
+                                                     Deck_Type deck_type = Deck_Type::standard) {
+        std::sort(player_name_and_rank.begin(), player_name_and_rank.end(), [deck_type](const auto& a, const auto& b) {
+            return is_better_hand(a.second, b.second, deck_type);
+        });
+
+        std::vector<std::string> winners;
+        for (const auto &player : player_name_and_rank) {
+            if (player.second != player_name_and_rank[0].second) {
+                break;
             }
-            
-            
-        } else {
-            // for later games only deck and player cards are updated
-            deck.recreate();
-            deck.populate_game_cards();
-            
-            bot.update_bots();
-            bot.redistribute_bot_cards(deck);
-            human.redistribute_human_cards(deck);
+            winners.push_back(player.first);
+        }
+        return winners;
+    }
+    
+    // Same result as determine_winner without printing, used when replaying logged hands
+    static std::vector<std::string> find_winners(const std::vector<Player>& players, const std::vector<Card>& community_cards,
+                                                 Deck_Type deck_type = Deck_Type::standard) {
+        std::vector<std::pair<std::string, std::pair<Poker_Ranks, int>>> player_name_and_rank;
+        for (const auto& player : players) {
+            player_name_and_rank.push_back(std::make_pair(player.get_name(), evaluate_player_hand(player, community_cards, deck_type)));
+        }
+        return top_ranked_names(player_name_and_rank, deck_type);
+    }
+
+    // Determine the winner function
+    std::vector<std::string> determine_winner(const std::vector<Player>& players, Deck& deck) {
+        const std::vector<Card> community_cards = deck.get_community_cards();
+        std::vector<std::pair<std::string, std::pair<Poker_Ranks, int>>> player_name_and_rank;
+
+        for (const auto& player : players) {
+            std::pair<Poker_Ranks, int> player_hand = evaluate_player_hand(player, community_cards, deck.get_deck_type());
+
+            std::cout << "Final score:  player named: " << player.get_name() << " had these cards: "
+                      << player.hole_cards_text()
+                      << "  and the FINAL RANK: " << poker_rank_to_string(player_hand.first) << std::endl;
+
+            player_name_and_rank.push_back(std::make_pair(player.get_name(), player_hand));
+        }
+
+        std::vector<std::string> winners = top_ranked_names(player_name_and_rank, deck.get_deck_type());
+        std::pair<Poker_Ranks, int> highest_rank = player_name_and_rank[0].second;
+
+        if (has_run == false){
+            if (winners.size() == 1) {
+                std::cout << "The winner is " << winners[0] << " with a hand rank of " << poker_rank_to_string(highest_rank.first)<<" of highest card rank "<<highest_rank.second<< std::endl;
+            } else {
+                std::cout << "There are multiple winners with a hand rank of " << poker_rank_to_string(highest_rank.first)<<" of highest card rank "<< highest_rank.second << std::endl;
+                for (const auto &winner : winners) {
+                    std::cout << winner << std::endl;
+                }
+            }
+            has_run=true;
+        }
+        return winners;
+    }
+
+
+    
+    
+    
+    // Numeric rank of a card, 2 to 14 (ace), 0 for an empty card
+    static int numeric_rank(const Card& card) {
+        const std::string& rank = card.get_rank();
+        if (rank.empty()) {
+            return 0;
+        }
+        switch (rank[0]) {
+            case '1': return 10;
+            case 'J': return 11;
+            case 'Q': return 12;
+            case 'K': return 13;
+            case 'A': return 14;
+            default:  return rank[0] >= '2' && rank[0] <= '9' ? rank[0] - '0' : 0;
+        }
+    }
+    
+    // Suit of a card as 0 to 3, 4 for an empty card
+    static int suit_number(const Card& card) {
+        // the suit symbols are three byte UTF-8 sequences that only differ in the last byte
+        const std::string& suit = card.get_suit();
+        if (suit.size() != 3 || suit[0] != '\xE2' || suit[1] != '\x99') {
+            return 4;
+        }
+        switch (static_cast<unsigned char>(suit[2])) {
+            case 0xA5: return 0;
+            case 0xA6: return 1;
+            case 0xA3: return 2;
+            case 0xA0: return 3;
+            default:   return 4;
+        }
+    }
+    
+    // Counts live in small arrays instead of maps, so evaluating a hand does not allocate.
+    // With a short deck the ace also plays low in A-6-7-8-9 and a flush is kept over a full house.
+    static std::pair<Poker_Ranks, int> evaluate_hand (const Card& card1, const Card& card2, const std::vector<Card>& community_cards,
+                                                      Deck_Type deck_type = Deck_Type::standard) {
+        int numeric_ranks[7];
+        int nr_of_cards{0};
+        std::array<int, 15> rank_counts{};
+        std::array<int, 5> suit_counts{};
+        int highest_card{0};
+    
+        auto add_card = [&](const Card& card) {
+            int rank = numeric_rank(card);
+            if (nr_of_cards < 7) {
+                numeric_ranks[nr_of_cards++] = rank;
+            }
+            ++rank_counts[rank];
+            ++suit_counts[suit_number(card)];
+        };
+        add_card(card1);
+        add_card(card2);
+        for (const auto& object : community_cards) {
+            add_card(object);
+        }
+    
+        // insertion sort: at most seven ranks, and std::sort on the raw array trips -Warray-bounds at -O2
+        for (int i{1}; i < nr_of_cards; i++) {
+            int rank = numeric_ranks[i];
+            int j = i;
+            for (; j > 0 && numeric_ranks[j - 1] > rank; j--) {
+                numeric_ranks[j] = numeric_ranks[j - 1];
+            }
+            numeric_ranks[j] = rank;
         }
         
+        int two_pair{0};
+        int three_of_a_kind{0};
+        int flush{0};
+        int straight{0};
+
+        // categories are found in increasing order, so the last one found is the hand rank
+        Poker_Ranks highest_rank = Poker_Ranks::high_card;
         
-        //initialise the primary game conditions
-        //containers help to keep track of the game 
-        human_in_the_game = true;
+        auto add_hand_ranking = [&highest_rank] (Poker_Ranks rank) {highest_rank = rank;};
+
+
+        for(int rank{0}; rank < 15; rank++) {
+            if (rank_counts[rank] == 0) {
+                continue;
+            }
+            if(two_pair ==0){
+                highest_card = std::max(highest_card, rank);
+            }
+            if(rank_counts[rank] == 2) {
+                two_pair += 1;
+                add_hand_ranking(Poker_Ranks::pair);
+                highest_card = rank;
+            } 
+        }
         
-        bots_in_the_game = bot.get_bots();
-        bot_initial_copy = bot.get_bots();
-        all_players_initial_copy = bot.get_bots();
-        all_players_initial_copy.push_back(human);
-        //main game loop
-        for (int round = 1; round <= 4; ++round) {
-            std::cout<<std::endl<<std::endl << "Round " << round << " begins" << std::endl;
-            bool bots_responded = false;
+        if(two_pair >= 2) {
+            add_hand_ranking(Poker_Ranks::two_pair);
+        }
             
+        for(int rank{0}; rank < 15; rank++) {
+            if (rank_counts[rank] == 3) {
+                three_of_a_kind += 1;
+                add_hand_ranking(Poker_Ranks::three_of_a_kind);
+                highest_card = rank;
+            }
+        }
+        
+        for(int i = 0; i + 4 < nr_of_cards; i++) {
+            if (numeric_ranks[i+1] == numeric_ranks[i]+1 && numeric_ranks[i+2] == numeric_ranks[i]+2 && numeric_ranks[i+3] == numeric_ranks[i]+3 && numeric_ranks[i+4] == numeric_ranks[i]+4) {
+                add_hand_ranking(Poker_Ranks::straight);
+                highest_card = numeric_ranks[i+4];
+                break;
+            }
+        }
+        if (deck_type == Deck_Type::short_deck && highest_rank < Poker_Ranks::straight
+            && rank_counts[14] && rank_counts[6] && rank_counts[7] && rank_counts[8] && rank_counts[9]) {
+            add_hand_ranking(Poker_Ranks::straight);
+            highest_card = 9;
+        }
+        
+        
+    
+
+        for(int suit{0}; suit < 5; suit++) {
+            if(suit_counts[suit] > 4) {
+                
+                add_hand_ranking(Poker_Ranks::flush);
+            }
+        }
+        
+        if(((two_pair > 0 && three_of_a_kind > 0) || (three_of_a_kind ==2 ))
+           && !(deck_type == Deck_Type::short_deck && highest_rank == Poker_Ranks::flush)) {
            
-            if (round == 1){
-                // big and small blinds
-                int big_blind{starting_chips/10};
-                int small_blind{big_blind/2};
-                if (difficulty == 4){
-                    big_blind = big_blind*3;
-                    small_blind=small_blind*3;
+            add_hand_ranking(Poker_Ranks::full_house);
+        }
+        
+        
+        for(int rank{0}; rank < 15; rank++) {
+            if(rank_counts[rank] == 4){
+                add_hand_ranking(Poker_Ranks::four_of_a_kind);
+                highest_card = rank;
+            }
+        }
+        
+        if (straight == 1 && flush == 1){
+            add_hand_ranking(Poker_Ranks::straight_flush);
+            
+            int royal_flush_elements{0};
+            for (int rank{10}; rank <= 14; rank++){
+                if (rank_counts[rank] > 0){
+                    royal_flush_elements +=1;
+                    
                 }
-                std::pair<Player, Player> two_players = get_two_random_players(all_players_initial_copy);
-                Player &player1 = two_players.first;
-                Player &player2 = two_players.second;
-                
-                Player::show_player_info(bots_in_the_game);
-         
-                    if (player1.get_name() == "Human"){
-                        std::cout<<"BIG BLIND: Human" <<std::endl;
-                    } else {
-                        std::cout<<"BIG BLIND: Bot"<< std::endl;
-                        for (auto &object : bots_in_the_game){
-                            if (object.get_name() == player1.get_name()){
-                                object.bet(big_blind, pot);
-                                bot.update_bot_chips(player1.get_name(), big_blind);
+            }
+            if (royal_flush_elements == 5){
+                add_hand_ranking(Poker_Ranks::royal_flush);
+                highest_card = 14;
+            }
+        }
+        
+        return {highest_rank, highest_card};
+    } // evaluate card function end
+    
+    // Hand of a player at showdown. Hold'em hands use any five of the seven cards, Omaha hands exactly two
+    // of the four hole cards with three of the board, so the best of those combinations counts.
+    static std::pair<Poker_Ranks, int> evaluate_player_hand(const Player& player, const std::vector<Card>& community_cards,
+                                                            Deck_Type deck_type = Deck_Type::standard) {
+        const std::vector<Card>& hole_cards = player.get_hole_cards();
+        if (hole_cards.size() != 4) {
+            return evaluate_hand(hole_cards[0], hole_cards[1], community_cards, deck_type);
+        }
+        int nr_of_board_cards = std::min<int>(community_cards.size(), 5);
+        std::pair<Poker_Ranks, int> best{Poker_Ranks::high_card, 0};
+        std::vector<Card> three_cards;
+        for (int first{0}; first < 4; first++) {
+            for (int second{first + 1}; second < 4; second++) {
+                // boards of three cards or fewer are used whole
+                for (int i{0}; i < std::max(nr_of_board_cards - 2, 1); i++) {
+                    for (int j{i + 1}; j < std::max(nr_of_board_cards - 1, 2); j++) {
+                        for (int k{j + 1}; k < std::max(nr_of_board_cards, 3); k++) {
+                            three_cards.clear();
+                            for (int index : { i, j, k }) {
+                                if (index < nr_of_board_cards) {
+                                    three_cards.push_back(community_cards[index]);
+                                }
+                            }
+                            std::pair<Poker_Ranks, int> hand = evaluate_hand(hole_cards[first], hole_cards[second], three_cards, deck_type);
+                            if (is_better_hand(hand, best, deck_type)) {
+                                best = hand;
                             }
                         }
                     }
-                    
-                    if (player2.get_name() == "Human"){
-                        std::cout<<"SMALL BLIND: Human" <<std::endl;
-                    } else {
-                        std::cout<<"SMALL BLIND: Bot"<< std::endl;
-                    }
-                    
-                human.show_human_cards();
-                std::cout<<"your private pot is: "<<human.get_chips()<<std::endl;
-                
-                bot_response(big_blind, player1.get_name());
-                if (bots_in_the_game.size()>0){
-                    if (human.get_chips()>big_blind){
-                        if (player1.get_name() != "Human" && player2.get_name() != "Human"){
-                            human_response(big_blind);
-                        } else if (player2.get_name() == "Human"){
-                            human.bet(small_blind, pot);
-                            human_response(big_blind-small_blind);
-                        }
-                    } else {
-                        human_response (human.get_chips());
-                    }
                 }
             }
-            //shows the board and populates community cards
-            else if (round == 2) {
-                deck.take_flop();
-                show_board();
-            } else if (round == 3) {
-                deck.take_turn();
-                show_board();
-            } else if (round == 4) {
-                deck.take_river();
-                show_board();
+        }
+        return best;
+    }
+    
+    
+    static std::string poker_rank_to_string(Poker_Ranks rank) {
+    switch (rank) {
+        case Poker_Ranks::high_card:       return "High Card";
+        case Poker_Ranks::pair:            return "Pair";
+        case Poker_Ranks::two_pair:        return "Two Pair";
+        case Poker_Ranks::three_of_a_kind: return "Three of a Kind";
+        case Poker_Ranks::straight:        return "Straight";
+        case Poker_Ranks::flush:           return "Flush";
+        case Poker_Ranks::full_house:      return "Full House";
+        case Poker_Ranks::four_of_a_kind:  return "Four of a Kind";
+        case Poker_Ranks::straight_flush:  return "Straight Flush";
+        case Poker_Ranks::royal_flush:     return "Royal Flush";
+        default:                           return "Unknown";
+        }
+    }
+    
+};
+
+
+enum class Action_Type : std::uint8_t {
+    fold = 0,
+    check = 1,
+    call = 2,
+    raise = 3,
+    blind = 4,    // only appears in hand records
+    uncalled = 5  // only appears in hand records: an uncalled bet handed back, as a negative amount
+};
+
+struct Action {
+    Action_Type type;
+    std::int32_t amount{0};  // for raise: the street bet the player raises to
+};
+
+// Game variants: no-limit Hold'em, pot-limit Omaha with four hole cards,
+// or no-limit Hold'em with the 36 card short deck
+enum class Variant : std::uint8_t {
+    holdem = 0,
+    omaha = 1,
+    short_deck = 2
+};
+
+
+// Compact game state for search and what-if analysis.
+// A node is a handful of fixed arrays, apply() pushes a small undo record and undo() pops it,
+// so exploring the tree never copies the Game object and never allocates.
+class Game_State {
+public:
+    static constexpr int max_seats = 21;
+    static constexpr int max_undo = 512;
+    static constexpr int max_actions = 6;
+
+    // Streets, showdown means the hand is over
+    static constexpr std::uint8_t preflop = 0;
+    static constexpr std::uint8_t flop = 1;
+    static constexpr std::uint8_t turn = 2;
+    static constexpr std::uint8_t river = 3;
+    static constexpr std::uint8_t showdown = 4;
+
+private:
+    // Everything apply() can change, so undo() can restore it (28 bytes)
+    struct Undo_Record {
+        std::int32_t committed;
+        std::int32_t level;
+        std::int32_t street_start_level;
+        std::int32_t last_raise;
+        std::uint32_t folded_mask;
+        std::uint32_t acted_mask;
+        std::uint8_t seat;
+        std::uint8_t to_act;
+        std::uint8_t street;
+    };
+
+    std::array<Undo_Record, max_undo> undo_log;
+    int undo_size{0};
+
+public:
+    std::array<std::int32_t, max_seats> chips{};      // chips behind
+    std::array<std::int32_t, max_seats> committed{};  // chips put in during this hand
+    std::array<std::uint8_t, max_seats * 4> hole_cards{};  // hole_cards_per_player() cards per seat
+    std::array<std::uint8_t, 5> board{};              // Cards::no_card for cards that are not known
+    std::uint32_t folded_mask{0};
+    std::uint32_t acted_mask{0};                      // seats that acted since the last raise
+    std::int32_t pot{0};
+    std::int32_t level{0};                            // committed amount every player has to match
+    std::int32_t street_start_level{0};
+    std::int32_t last_raise{0};
+    std::int32_t big_blind{0};
+    std::uint8_t nr_of_seats{0};
+    std::uint8_t button{0};
+    std::uint8_t to_act{0};
+    std::uint8_t street{preflop};
+    Variant variant{Variant::holdem};                 // set before start_hand, hole gives the cards per seat in that order
+
+    // Starts a new hand: sets the stacks and cards and posts the blinds
+    void start_hand(int seats, const std::int32_t* stacks, const std::uint8_t* hole, const std::uint8_t* board_cards,
+                    int dealer, int small_blind, int i_big_blind) {
+        set_table(seats, stacks, hole, board_cards, dealer, i_big_blind);
+
+        // heads up the dealer posts the small blind
+        int small_blind_seat = seats == 2 ? dealer : (dealer + 1) % seats;
+        int big_blind_seat = (small_blind_seat + 1) % seats;
+        post(small_blind_seat, small_blind);
+        post(big_blind_seat, i_big_blind);
+        level = std::max(committed[small_blind_seat], committed[big_blind_seat]);
+
+        to_act = static_cast<std::uint8_t>(big_blind_seat);
+        if (!move_to_next_seat(big_blind_seat)) {
+            close_street();
+        }
+    }
+
+    // Starts at the beginning of a later street, with the chips of the earlier streets already in the pot
+    void start_street(int seats, const std::int32_t* stacks, const std::uint8_t* hole, const std::uint8_t* board_cards,
+                      int dealer, int i_street, int i_pot, int i_big_blind, std::uint32_t i_folded_mask) {
+        set_table(seats, stacks, hole, board_cards, dealer, i_big_blind);
+        street = static_cast<std::uint8_t>(i_street);
+        pot = i_pot;
+        folded_mask = i_folded_mask;
+        if (nr_of_players_in_hand() <= 1 || !move_to_next_seat(button)) {
+            street = showdown;
+        }
+    }
+
+    bool is_folded(int seat) const { return (folded_mask >> seat) & 1u; }
+    bool hand_is_over() const { return street == showdown; }
+    int street_bet(int seat) const { return committed[seat] - street_start_level; }
+    int amount_to_call(int seat) const { return std::min(std::max(level - committed[seat], 0), chips[seat]); }
+    int depth() const { return undo_size; }
+    // Drops the undo records, for owners that swap whole states in and never take actions back
+    void forget_undo_log() { undo_size = 0; }
+    int hole_cards_per_player() const { return variant == Variant::omaha ? 4 : 2; }
+    Cards::Deck_Type deck_type() const { return variant == Variant::short_deck ? Cards::Deck_Type::short_deck : Cards::Deck_Type::standard; }
+    const std::uint8_t* hole(int seat) const { return &hole_cards[hole_cards_per_player() * seat]; }
+
+    int nr_of_players_in_hand() const {
+        int count{0};
+        for (int i{0}; i < nr_of_seats; i++) {
+            count += is_folded(i) ? 0 : 1;
+        }
+        return count;
+    }
+
+    // Smallest street bet the player to act may raise to
+    int min_raise_to() const {
+        return std::min(level + last_raise, committed[to_act] + chips[to_act]) - street_start_level;
+    }
+
+    // Largest street bet the player to act may raise to: all in, or in pot limit a call plus the pot after the call
+    int max_raise_to() const {
+        int all_in_to = committed[to_act] + chips[to_act] - street_start_level;
+        if (variant != Variant::omaha) {
+            return all_in_to;
+        }
+        int pot_to = level - street_start_level + pot + (level - committed[to_act]);
+        return std::max(min_raise_to(), std::min(all_in_to, pot_to));
+    }
+
+    bool is_legal(const Action& action) const {
+        if (hand_is_over()) {
+            return false;
+        }
+        bool facing_bet = committed[to_act] < level;
+        switch (action.type) {
+            case Action_Type::fold:  return facing_bet;
+            case Action_Type::check: return !facing_bet;
+            case Action_Type::call:  return facing_bet;
+            case Action_Type::raise:
+                return chips[to_act] > level - committed[to_act]
+                    && action.amount >= min_raise_to() && action.amount <= max_raise_to();
+            case Action_Type::blind: return false;  // posted by start_hand, never a decision
+            case Action_Type::uncalled: return false;
+        }
+        return false;
+    }
+
+    // Writes the actions worth exploring into out and returns their count:
+    // fold/check/call plus a min raise, a pot sized raise and all in
+    int legal_actions(Action* out) const {
+        if (hand_is_over()) {
+            return 0;
+        }
+        int count{0};
+        bool facing_bet = committed[to_act] < level;
+        if (facing_bet) {
+            out[count++] = {Action_Type::fold, 0};
+            out[count++] = {Action_Type::call, 0};
+        } else {
+            out[count++] = {Action_Type::check, 0};
+        }
+        if (chips[to_act] > level - committed[to_act]) {
+            int min_to = min_raise_to();
+            int max_to = max_raise_to();
+            int pot_to = level - street_start_level + pot + (level - committed[to_act]);
+            out[count++] = {Action_Type::raise, min_to};
+            if (pot_to > min_to && pot_to < max_to) {
+                out[count++] = {Action_Type::raise, pot_to};
+            }
+            if (max_to > min_to) {
+                out[count++] = {Action_Type::raise, max_to};
+            }
+        }
+        return count;
+    }
+
+    // Applies a legal action of the player to act and records how to take it back
+    void apply(const Action& action) {
+        if (undo_size == max_undo) {
+            throw std::length_error("Game_State undo log is full.");
+        }
+        int seat = to_act;
+        undo_log[undo_size++] = { committed[seat], level, street_start_level, last_raise, folded_mask, acted_mask,
+                                  static_cast<std::uint8_t>(seat), to_act, street };
+
+        if (action.type == Action_Type::fold) {
+            folded_mask |= 1u << seat;
+        } else if (action.type == Action_Type::call) {
+            put_in(seat, amount_to_call(seat));
+        } else if (action.type == Action_Type::raise) {
+            int target = std::min(street_start_level + action.amount, committed[seat] + chips[seat]);
+            put_in(seat, target - committed[seat]);
+            if (target - level >= last_raise) {
+                last_raise = target - level;
+            }
+            if (target > level) {
+                level = target;
+                acted_mask = 0;  // everyone has to respond to the raise
+            }
+        }
+        acted_mask |= 1u << seat;
+
+        if (nr_of_players_in_hand() == 1) {
+            street = showdown;
+        } else if (!move_to_next_seat(seat)) {
+            close_street();
+        }
+    }
+
+    // Takes back the last applied action
+    void undo() {
+        if (undo_size == 0) {
+            throw std::out_of_range("Game_State has no action to undo.");
+        }
+        const Undo_Record& record = undo_log[--undo_size];
+        int paid = committed[record.seat] - record.committed;
+        chips[record.seat] += paid;
+        pot -= paid;
+        committed[record.seat] = record.committed;
+        level = record.level;
+        street_start_level = record.street_start_level;
+        last_raise = record.last_raise;
+        folded_mask = record.folded_mask;
+        acted_mask = record.acted_mask;
+        to_act = record.to_act;
+        street = record.street;
+    }
+
+    // Showdown strength of a seat with the full board, by the rules of the variant
+    Eval::Strength showdown_strength(int seat) const {
+        if (variant == Variant::omaha) {
+            return Eval::evaluate_omaha(hole(seat), board.data());
+        }
+        std::uint8_t cards[7] = { hole_cards[2 * seat], hole_cards[2 * seat + 1], board[0], board[1], board[2], board[3], board[4] };
+        return Eval::evaluate(cards, 7, deck_type());
+    }
+
+    // Splits the pot, including side pots, once the hand is over.
+    // strength(seat) must return a value where bigger means a better showdown hand.
+    template <typename Strength_Function>
+    void settle(Strength_Function strength, std::array<std::int32_t, max_seats>& won) const {
+        won.fill(0);
+        if (nr_of_players_in_hand() == 1) {
+            for (int i{0}; i < nr_of_seats; i++) {
+                if (!is_folded(i)) {
+                    won[i] = pot;
+                }
+            }
+            return;
+        }
+
+        std::array<std::uint32_t, max_seats> strengths{};
+        for (int i{0}; i < nr_of_seats; i++) {
+            strengths[i] = is_folded(i) ? 0 : strength(i);
+        }
+
+        // every distinct committed level of a live player closes one side pot
+        int previous_level{0};
+        int distributed{0};
+        while (true) {
+            int next_level{0};
+            for (int i{0}; i < nr_of_seats; i++) {
+                if (!is_folded(i) && committed[i] > previous_level && (next_level == 0 || committed[i] < next_level)) {
+                    next_level = committed[i];
+                }
+            }
+            if (next_level == 0) {
+                break;
+            }
+            int side_pot{0};
+            std::uint32_t best{0};
+            int nr_of_winners{0};
+            for (int i{0}; i < nr_of_seats; i++) {
+                side_pot += std::max(0, std::min(committed[i], next_level) - previous_level);
+                if (!is_folded(i) && committed[i] >= next_level) {
+                    if (strengths[i] > best) {
+                        best = strengths[i];
+                        nr_of_winners = 1;
+                    } else if (strengths[i] == best) {
+                        nr_of_winners += 1;
+                    }
+                }
+            }
+            int share = side_pot / nr_of_winners;
+            int odd_chips = side_pot - share * nr_of_winners;
+            for (int i{0}; i < nr_of_seats; i++) {
+                if (!is_folded(i) && committed[i] >= next_level && strengths[i] == best) {
+                    won[i] += share + (odd_chips-- > 0 ? 1 : 0);
+                }
+            }
+            distributed += side_pot;
+            previous_level = next_level;
+        }
+        // chips from before the state was captured have no owner in committed, the best live hand takes them
+        if (pot > distributed) {
+            int best_seat{-1};
+            for (int i{0}; i < nr_of_seats; i++) {
+                if (!is_folded(i) && (best_seat < 0 || strengths[i] > strengths[best_seat])) {
+                    best_seat = i;
+                }
+            }
+            won[best_seat] += pot - distributed;
+        }
+    }
+
+private:
+    void set_table(int seats, const std::int32_t* stacks, const std::uint8_t* hole, const std::uint8_t* board_cards,
+                   int dealer, int i_big_blind) {
+        if (seats < 2 || seats > max_seats) {
+            throw std::invalid_argument("Game_State supports 2 to 21 seats.");
+        }
+        nr_of_seats = static_cast<std::uint8_t>(seats);
+        for (int i{0}; i < seats; i++) {
+            chips[i] = stacks[i];
+            committed[i] = 0;
+        }
+        std::copy(hole, hole + hole_cards_per_player() * seats, hole_cards.begin());
+        for (int i{0}; i < 5; i++) {
+            board[i] = board_cards[i];
+        }
+        folded_mask = 0;
+        acted_mask = 0;
+        pot = 0;
+        level = 0;
+        street = preflop;
+        street_start_level = 0;
+        big_blind = i_big_blind;
+        last_raise = i_big_blind;
+        button = static_cast<std::uint8_t>(dealer);
+        undo_size = 0;
+    }
+
+    void post(int seat, int amount) {
+        put_in(seat, std::min(amount, chips[seat]));
+    }
+
+    void put_in(int seat, int amount) {
+        chips[seat] -= amount;
+        committed[seat] += amount;
+        pot += amount;
+    }
+
+    bool needs_to_act(int seat) const {
+        return !is_folded(seat) && chips[seat] > 0
+            && (!((acted_mask >> seat) & 1u) || committed[seat] < level);
+    }
+
+    // Moves to_act to the next seat after from that still has to act, false if the street is closed
+    bool move_to_next_seat(int from) {
+        for (int step{1}; step <= nr_of_seats; step++) {
+            int seat = (from + step) % nr_of_seats;
+            if (needs_to_act(seat)) {
+                to_act = static_cast<std::uint8_t>(seat);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Deals the next street, or runs out the board when at most one player can still bet
+    void close_street() {
+        int players_with_chips{0};
+        for (int i{0}; i < nr_of_seats; i++) {
+            if (!is_folded(i) && chips[i] > 0) {
+                players_with_chips += 1;
+            }
+        }
+        if (players_with_chips <= 1 || street == river) {
+            street = showdown;
+            return;
+        }
+        street += 1;
+        acted_mask = 0;
+        last_raise = big_blind;
+        street_start_level = level;
+        if (!move_to_next_seat(button)) {
+            street = showdown;
+        }
+    }
+};
+
+
+// Versioned fixed layout snapshot of a play_multiple_games session, written between games.
+// The struct is saved byte for byte, so saving and loading is a single write or read.
+struct Session_Snapshot {
+    static constexpr std::uint32_t file_magic = 0x53534B50;  // "PKSS"
+    static constexpr std::uint32_t current_version = 2;
+    static constexpr int max_bots = 20;
+
+    std::uint32_t magic{file_magic};
+    std::uint32_t version{current_version};
+    std::int32_t difficulty{0};
+    std::int32_t starting_chips{0};
+    std::int32_t nr_of_bots{0};        // bots at the start of the session
+    std::int32_t nr_of_games{0};       // games the user asked for
+    std::int32_t games_played{0};
+    std::int32_t human_chips{0};
+    std::int32_t nr_of_bots_left{0};
+    std::int32_t deck_type{0};         // Cards::Deck_Type, 0 (standard) in snapshots from before short decks
+    std::uint64_t rng_state{0};
+    std::uint64_t rng_increment{0};
+    std::int32_t bot_chips[max_bots]{};
+    char bot_names[max_bots][8]{};
+    std::int32_t variant{0};           // Game::Variant, from version 2 on
+    std::uint32_t checksum{0};
+
+    // FNV-1a over every byte before the checksum field
+    std::uint32_t compute_checksum(std::size_t size = offsetof(Session_Snapshot, checksum)) const {
+        const unsigned char* bytes = reinterpret_cast<const unsigned char*>(this);
+        std::uint32_t hash = 2166136261u;
+        for (std::size_t i{0}; i < size; i++) {
+            hash = (hash ^ bytes[i]) * 16777619u;
+        }
+        return hash;
+    }
+
+    // A copy with an independent random stream, so many continuations can start from one position
+    Session_Snapshot fork(std::uint64_t continuation) const {
+        Session_Snapshot copy(*this);
+        Session_Rng rng;
+        rng.restore(rng_state, rng_increment);
+        Session_Rng forked = rng.fork(continuation);
+        copy.rng_state = forked.get_state();
+        copy.rng_increment = forked.get_increment();
+        copy.checksum = copy.compute_checksum();
+        return copy;
+    }
+
+    // Writes to a temporary file first and renames it, so a crash never leaves half a snapshot behind
+    void save(const std::string& path) const {
+        std::string temporary_path = path + ".tmp";
+        std::FILE* file = std::fopen(temporary_path.c_str(), "wb");
+        if (file == nullptr) {
+            throw std::runtime_error("Could not open " + temporary_path + " for writing.");
+        }
+        bool written = std::fwrite(this, sizeof(Session_Snapshot), 1, file) == 1;
+        written = std::fclose(file) == 0 && written;
+        if (!written || std::rename(temporary_path.c_str(), path.c_str()) != 0) {
+            throw std::runtime_error("Could not save the session snapshot to " + path);
+        }
+    }
+
+    static Session_Snapshot load(const std::string& path) {
+        Session_Snapshot snapshot;
+        std::FILE* file = std::fopen(path.c_str(), "rb");
+        if (file == nullptr) {
+            throw std::runtime_error("Could not open " + path);
+        }
+        bool read = std::fread(&snapshot, sizeof(Session_Snapshot), 1, file) == 1;
+        std::fclose(file);
+        if (!read || snapshot.magic != file_magic) {
+            throw std::runtime_error(path + " is not a poker session snapshot.");
+        }
+        if (snapshot.version == 1) {
+            // version 1 kept its checksum where the variant is now and only had Hold'em and short deck games
+            if (static_cast<std::uint32_t>(snapshot.variant) != snapshot.compute_checksum(offsetof(Session_Snapshot, variant))) {
+                throw std::runtime_error(path + " is corrupted.");
+            }
+            bool short_deck = snapshot.deck_type == static_cast<std::int32_t>(Cards::Deck_Type::short_deck);
+            snapshot.variant = static_cast<std::int32_t>(short_deck ? Variant::short_deck : Variant::holdem);
+            snapshot.version = current_version;
+            snapshot.checksum = snapshot.compute_checksum();
+        }
+        if (snapshot.version != current_version) {
+            throw std::runtime_error(path + " has an unsupported snapshot version.");
+        }
+        if (snapshot.checksum != snapshot.compute_checksum()) {
+            throw std::runtime_error(path + " is corrupted.");
+        }
+        return snapshot;
+    }
+};
+
+static_assert(std::is_trivially_copyable<Session_Snapshot>::value, "Session_Snapshot is saved byte for byte");
+static_assert(offsetof(Session_Snapshot, variant) == 296 && sizeof(Session_Snapshot) == 304,
+              "version 1 snapshots are read in place, with their checksum in the variant field");
+
+
+// Binary hand history.
+// The file is a header followed by records that each start with their size and type:
+// hand records, an index block after every few thousand hands and a trailer when the writer closes.
+// All parts are multiples of 8 bytes, so a reader can use the records in place from a memory map.
+namespace History {
+
+constexpr std::uint32_t file_magic = 0x48484B50;  // "PKHH"
+constexpr std::uint32_t file_version = 2;         // 2 added short deck hands, version 1 files are read as they are
+constexpr std::uint32_t hand_record = 1;
+constexpr std::uint32_t index_record = 2;
+constexpr std::uint32_t trailer_record = 3;
+constexpr std::uint32_t short_deck_hand_record = 4;  // laid out like hand_record, played with the 36 card deck
+constexpr int max_seats = 21;
+constexpr int max_actions = 1024;
+
+struct File_Header {
+    std::uint32_t magic;
+    std::uint32_t version;
+    std::uint64_t reserved;
+};
+
+struct Hand_Header {
+    std::uint32_t size;            // whole record in bytes
+    std::uint32_t type;
+    std::uint64_t hand_id;
+    std::uint16_t nr_of_actions;
+    std::uint8_t nr_of_seats;
+    std::uint8_t board[5];         // Cards::no_card for streets that were not dealt
+};
+
+// Seat flags
+constexpr std::uint8_t seat_is_human = 1;
+constexpr std::uint8_t seat_folded = 2;
+constexpr std::uint8_t seat_at_showdown = 4;
+
+struct Seat_Entry {
+    char name[12];
+    std::int32_t starting_chips;
+    std::int32_t won;              // chips received from the pot
+    std::uint8_t hole[2];
+    std::uint8_t flags;
+    std::uint8_t reserved;
+};
+
+struct Action_Entry {
+    std::int32_t amount;
+    std::uint8_t seat;
+    std::uint8_t street;           // 0 preflop, 1 flop, 2 turn, 3 river
+    std::uint8_t type;             // Game::Action_Type
+    std::uint8_t reserved;
+};
+
+struct Index_Header {
+    std::uint32_t size;
+    std::uint32_t type;
+    std::uint64_t previous_index_offset;  // 0 for the first index block
+    std::uint64_t nr_of_entries;
+};
+
+struct Index_Entry {
+    std::uint64_t hand_id;
+    std::uint64_t offset;
+};
+
+struct Trailer {
+    std::uint32_t size;
+    std::uint32_t type;
+    std::uint64_t last_index_offset;
+    std::uint64_t magic;
+};
+
+inline bool is_hand(std::uint32_t record_type) {
+    return record_type == hand_record || record_type == short_deck_hand_record;
+}
+
+inline bool is_supported_version(std::uint32_t version) {
+    return version >= 1 && version <= file_version;
+}
+
+// The deck whose rules score the hand
+inline Cards::Deck_Type deck_type_of(const Hand_Header& header) {
+    return header.type == short_deck_hand_record ? Cards::Deck_Type::short_deck : Cards::Deck_Type::standard;
+}
+
+static_assert(sizeof(File_Header) == 16 && sizeof(Hand_Header) == 24 && sizeof(Seat_Entry) == 24
+              && sizeof(Action_Entry) == 8 && sizeof(Index_Header) == 24 && sizeof(Trailer) == 24,
+              "history records are read in place and must keep their layout");
+
+
+// One hand being recorded, kept in fixed arrays so recording never allocates
+class Hand_Record {
+public:
+    Hand_Header header{};
+    std::array<Seat_Entry, max_seats> seats{};
+    std::array<Action_Entry, max_actions> actions{};
+
+    void begin(std::uint64_t hand_id, Cards::Deck_Type deck_type = Cards::Deck_Type::standard) {
+        header = Hand_Header{};
+        header.type = deck_type == Cards::Deck_Type::short_deck ? short_deck_hand_record : hand_record;
+        header.hand_id = hand_id;
+        std::fill(std::begin(header.board), std::end(header.board), Cards::no_card);
+    }
+
+    int add_seat(const std::string& name, int starting_chips, std::uint8_t card1, std::uint8_t card2, bool is_human) {
+        if (header.nr_of_seats == max_seats) {
+            throw std::length_error("A hand record holds at most 21 seats.");
+        }
+        Seat_Entry& seat = seats[header.nr_of_seats];
+        seat = Seat_Entry{};
+        name.copy(seat.name, sizeof(seat.name) - 1);
+        seat.starting_chips = starting_chips;
+        seat.hole[0] = card1;
+        seat.hole[1] = card2;
+        seat.flags = is_human ? seat_is_human : 0;
+        return header.nr_of_seats++;
+    }
+
+    // Seat number of a player, -1 if the player is not seated in this hand
+    int seat_of(const std::string& name) const {
+        for (int i{0}; i < header.nr_of_seats; i++) {
+            if (std::strncmp(seats[i].name, name.c_str(), sizeof(seats[i].name)) == 0) {
+                return i;
+            }
+        }
+        return -1;
+    }
+
+    void add_action(int seat, int street, std::uint8_t type, int amount) {
+        if (seat < 0 || header.nr_of_actions == max_actions) {
+            return;
+        }
+        actions[header.nr_of_actions++] = { amount, static_cast<std::uint8_t>(seat), static_cast<std::uint8_t>(street), type, 0 };
+    }
+
+    void set_board(const std::uint8_t* board_cards, int nr_of_cards) {
+        for (int i{0}; i < nr_of_cards && i < 5; i++) {
+            header.board[i] = board_cards[i];
+        }
+    }
+
+    std::uint32_t serialized_size() const {
+        return sizeof(Hand_Header) + header.nr_of_seats * sizeof(Seat_Entry) + header.nr_of_actions * sizeof(Action_Entry);
+    }
+};
+
+
+// A hand record read in place from a mapped file
+class Hand_View {
+private:
+    const Hand_Header* hand;
+
+public:
+    explicit Hand_View(const Hand_Header* i_hand) : hand(i_hand) {}
+
+    const Hand_Header& header() const { return *hand; }
+    std::uint64_t hand_id() const { return hand->hand_id; }
+    int nr_of_seats() const { return hand->nr_of_seats; }
+    int nr_of_actions() const { return hand->nr_of_actions; }
+    const std::uint8_t* board() const { return hand->board; }
+    Cards::Deck_Type deck_type() const { return deck_type_of(*hand); }
+
+    int nr_of_board_cards() const {
+        int count{0};
+        while (count < 5 && hand->board[count] != Cards::no_card) {
+            count++;
+        }
+        return count;
+    }
+
+    const Seat_Entry* seats() const {
+        return reinterpret_cast<const Seat_Entry*>(hand + 1);
+    }
+    const Action_Entry* actions() const {
+        return reinterpret_cast<const Action_Entry*>(seats() + hand->nr_of_seats);
+    }
+};
+
+
+// Appends hands to a history file, buffering writes and adding an index block every index_interval hands
+class Hand_History_Writer {
+private:
+    std::FILE* file{nullptr};
+    std::vector<char> buffer;
+    std::vector<Index_Entry> pending_index;
+    std::uint64_t file_size{0};            // bytes in the file plus bytes in the buffer
+    std::uint64_t last_index_offset{0};
+    std::uint64_t last_hand_id{0};
+    std::size_t index_interval;
+
+    void write_bytes(const void* data, std::size_t size) {
+        if (buffer.size() + size > buffer.capacity()) {
+            flush();
+        }
+        const char* bytes = static_cast<const char*>(data);
+        buffer.insert(buffer.end(), bytes, bytes + size);
+        file_size += size;
+    }
+
+    void write_index_block() {
+        if (pending_index.empty()) {
+            return;
+        }
+        Index_Header index{};
+        index.type = index_record;
+        index.size = sizeof(Index_Header) + pending_index.size() * sizeof(Index_Entry);
+        index.previous_index_offset = last_index_offset;
+        index.nr_of_entries = pending_index.size();
+        last_index_offset = file_size;
+        write_bytes(&index, sizeof(index));
+        write_bytes(pending_index.data(), pending_index.size() * sizeof(Index_Entry));
+        pending_index.clear();
+    }
+
+    // Finds where the previous writer stopped: drops its trailer, or any half written record after a crash
+    void recover_tail() {
+        std::fseek(file, 0, SEEK_END);
+        std::uint64_t end = std::ftell(file);
+
+        Trailer trailer{};
+        if (end >= sizeof(File_Header) + sizeof(Trailer)) {
+            std::fseek(file, end - sizeof(Trailer), SEEK_SET);
+            if (std::fread(&trailer, sizeof(trailer), 1, file) == 1 && trailer.type == trailer_record && trailer.magic == file_magic) {
+                Index_Header index{};
+                std::fseek(file, trailer.last_index_offset, SEEK_SET);
+                if (trailer.last_index_offset != 0 && std::fread(&index, sizeof(index), 1, file) == 1 && index.nr_of_entries > 0) {
+                    Index_Entry entry{};
+                    std::fseek(file, trailer.last_index_offset + index.size - sizeof(Index_Entry), SEEK_SET);
+                    if (std::fread(&entry, sizeof(entry), 1, file) == 1) {
+                        last_hand_id = entry.hand_id;
+                    }
+                }
+                last_index_offset = trailer.last_index_offset;
+                file_size = end - sizeof(Trailer);
+                if (ftruncate(fileno(file), file_size) != 0) {
+                    throw std::runtime_error("Could not reopen the hand history file.");
+                }
+                std::fseek(file, file_size, SEEK_SET);
+                return;
+            }
+        }
+
+        std::uint64_t offset = sizeof(File_Header);
+        std::uint64_t valid_end = offset;
+        std::uint32_t record[2];
+        std::vector<Index_Entry> unindexed;
+        while (offset + sizeof(record) <= end) {
+            std::fseek(file, offset, SEEK_SET);
+            if (std::fread(record, sizeof(record), 1, file) != 1 || record[0] < sizeof(record) || offset + record[0] > end) {
+                break;
+            }
+            if (is_hand(record[1])) {
+                std::uint64_t hand_id;
+                if (std::fread(&hand_id, sizeof(hand_id), 1, file) != 1) {
+                    break;
+                }
+                unindexed.push_back({hand_id, offset});
+                last_hand_id = std::max(last_hand_id, hand_id);
+            } else if (record[1] == index_record) {
+                last_index_offset = offset;
+                unindexed.clear();
+            } else if (record[1] != trailer_record) {
+                break;
+            }
+            offset += record[0];
+            if (record[1] != trailer_record) {
+                valid_end = offset;
+            }
+        }
+        if (ftruncate(fileno(file), valid_end) != 0) {
+            throw std::runtime_error("Could not repair the hand history file.");
+        }
+        std::fseek(file, valid_end, SEEK_SET);
+        file_size = valid_end;
+        pending_index = unindexed;
+    }
+
+public:
+    Hand_History_Writer(const std::string& path, std::size_t i_index_interval = 4096, std::size_t buffer_size = 1 << 20)
+        : index_interval(i_index_interval) {
+        file = std::fopen(path.c_str(), "r+b");
+        if (file == nullptr) {
+            file = std::fopen(path.c_str(), "w+b");
+        }
+        if (file == nullptr) {
+            throw std::runtime_error("Could not open the hand history file " + path);
+        }
+        buffer.reserve(buffer_size);
+
+        File_Header header{};
+        if (std::fread(&header, sizeof(header), 1, file) != 1) {
+            header = { file_magic, file_version, 0 };
+            std::fseek(file, 0, SEEK_SET);
+            std::fwrite(&header, sizeof(header), 1, file);
+            file_size = sizeof(header);
+        } else if (header.magic != file_magic || !is_supported_version(header.version)) {
+            std::fclose(file);
+            throw std::runtime_error(path + " is not a hand history file of this version.");
+        } else {
+            recover_tail();
+            if (header.version != file_version) {
+                // mark the file as the newer version, so older programs refuse it instead of cutting off hands they do not know
+                header.version = file_version;
+                std::fseek(file, 0, SEEK_SET);
+                std::fwrite(&header, sizeof(header), 1, file);
+                std::fseek(file, file_size, SEEK_SET);
+            }
+        }
+    }
+
+    Hand_History_Writer(const Hand_History_Writer&) = delete;
+    Hand_History_Writer& operator=(const Hand_History_Writer&) = delete;
+
+    ~Hand_History_Writer() {
+        try {
+            close();
+        } catch (const std::exception& e) {
+            std::cerr << e.what() << '\n';
+        }
+    }
+
+    // Hand ids keep increasing across sessions that append to the same file
+    std::uint64_t next_hand_id() const { return last_hand_id + 1; }
+
+    void append(const Hand_Record& record) {
+        Hand_Header header = record.header;
+        last_hand_id = std::max(last_hand_id, header.hand_id);
+        header.size = record.serialized_size();
+        pending_index.push_back({header.hand_id, file_size});
+        write_bytes(&header, sizeof(header));
+        write_bytes(record.seats.data(), header.nr_of_seats * sizeof(Seat_Entry));
+        write_bytes(record.actions.data(), header.nr_of_actions * sizeof(Action_Entry));
+        if (pending_index.size() >= index_interval) {
+            write_index_block();
+        }
+    }
+
+    void flush() {
+        if (!buffer.empty()) {
+            if (std::fwrite(buffer.data(), 1, buffer.size(), file) != buffer.size()) {
+                throw std::runtime_error("Could not write the hand history.");
+            }
+            buffer.clear();
+        }
+        std::fflush(file);
+    }
+
+    // Indexes the remaining hands and writes the trailer, so readers find the index without a scan
+    void close() {
+        if (file == nullptr) {
+            return;
+        }
+        write_index_block();
+        Trailer trailer{ sizeof(Trailer), trailer_record, last_index_offset, file_magic };
+        write_bytes(&trailer, sizeof(trailer));
+        flush();
+        std::fclose(file);
+        file = nullptr;
+    }
+};
+
+
+// Maps a history file read only and walks its hand records in place
+class Hand_History_Reader {
+private:
+    const char* data{nullptr};
+    std::size_t size{0};
+    std::vector<Index_Entry> index;
+
+    const std::uint32_t* record_at(std::size_t offset) const {
+        if (offset + 8 > size) {
+            return nullptr;
+        }
+        const std::uint32_t* record = reinterpret_cast<const std::uint32_t*>(data + offset);
+        if (record[0] < 8 || offset + record[0] > size) {
+            return nullptr;  // half written record at the end of the file
+        }
+        return record;
+    }
+
+    void load_index() {
+        const Trailer* trailer = size >= sizeof(File_Header) + sizeof(Trailer)
+            ? reinterpret_cast<const Trailer*>(data + size - sizeof(Trailer)) : nullptr;
+        if (trailer != nullptr && trailer->type == trailer_record && trailer->magic == file_magic) {
+            std::uint64_t offset = trailer->last_index_offset;
+            while (offset != 0 && record_at(offset) != nullptr) {
+                const Index_Header* block = reinterpret_cast<const Index_Header*>(data + offset);
+                const Index_Entry* entries = reinterpret_cast<const Index_Entry*>(block + 1);
+                index.insert(index.end(), entries, entries + block->nr_of_entries);
+                offset = block->previous_index_offset;
+            }
+        } else {
+            // the writer did not close the file, so index it with one pass over the records
+            for_each_hand([this](const Hand_View& hand) {
+                index.push_back({hand.hand_id(), static_cast<std::uint64_t>(reinterpret_cast<const char*>(&hand.header()) - data)});
+            });
+        }
+        std::sort(index.begin(), index.end(), [](const Index_Entry& a, const Index_Entry& b) {
+            return a.hand_id < b.hand_id;
+        });
+    }
+
+public:
+    explicit Hand_History_Reader(const std::string& path) {
+        int descriptor = ::open(path.c_str(), O_RDONLY);
+        if (descriptor < 0) {
+            throw std::runtime_error("Could not open the hand history file " + path);
+        }
+        struct stat file_info;
+        if (fstat(descriptor, &file_info) != 0 || file_info.st_size < static_cast<off_t>(sizeof(File_Header))) {
+            ::close(descriptor);
+            throw std::runtime_error(path + " is not a hand history file.");
+        }
+        size = file_info.st_size;
+        void* mapped = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, descriptor, 0);
+        ::close(descriptor);
+        if (mapped == MAP_FAILED) {
+            throw std::runtime_error("Could not map the hand history file " + path);
+        }
+        madvise(mapped, size, MADV_SEQUENTIAL);
+        data = static_cast<const char*>(mapped);
+
+        const File_Header* header = reinterpret_cast<const File_Header*>(data);
+        if (header->magic != file_magic || !is_supported_version(header->version)) {
+            munmap(mapped, size);
+            throw std::runtime_error(path + " is not a hand history file of this version.");
+        }
+        load_index();
+    }
+
+    Hand_History_Reader(const Hand_History_Reader&) = delete;
+    Hand_History_Reader& operator=(const Hand_History_Reader&) = delete;
+
+    ~Hand_History_Reader() {
+        munmap(const_cast<char*>(data), size);
+    }
+
+    std::size_t file_size() const { return size; }
+    std::size_t nr_of_hands() const { return index.size(); }
+
+    // Calls function with every hand in file order, without copying the records
+    template <typename Function>
+    void for_each_hand(Function function) const {
+        std::size_t offset = sizeof(File_Header);
+        while (const std::uint32_t* record = record_at(offset)) {
+            if (is_hand(record[1])) {
+                function(Hand_View(reinterpret_cast<const Hand_Header*>(record)));
+            }
+            offset += record[0];
+        }
+    }
+
+    // Looks a hand up through the index blocks
+    bool find(std::uint64_t hand_id, const Hand_Header*& found) const {
+        auto it = std::lower_bound(index.begin(), index.end(), hand_id, [](const Index_Entry& entry, std::uint64_t id) {
+            return entry.hand_id < id;
+        });
+        if (it == index.end() || it->hand_id != hand_id) {
+            return false;
+        }
+        found = reinterpret_cast<const Hand_Header*>(data + it->offset);
+        return true;
+    }
+};
+
+} // namespace History end
+
+
+// One decision of the human with the numbers that were true at that moment
+struct Decision_Record {
+    std::uint8_t street{0};            // 0 preflop, 1 flop, 2 turn, 3 river
+    Action_Type action{Action_Type::check};
+    bool facing_bet{false};
+    int amount_to_call{0};
+    int invested{0};                   // chips the action put in
+    int pot{0};                        // pot before the action
+    int stack{0};                      // chips before the action
+    int nr_of_opponents{0};
+    double equity{0};
+    int equity_samples{0};             // runouts the equity estimate used
+    double pot_odds{0};                // share of the final pot the call costs
+    double stack_to_pot{0};
+    double ev_loss{0};                 // chips lost against the best simple alternative
+};
+
+// Scores a decision with a simple one-street model: a call or bet is assumed to be called once,
+// a check realizes the equity of the current pot, and folding is worth nothing
+inline Decision_Record score_decision(Decision_Record decision) {
+    double pot = decision.pot;
+    double equity = decision.equity;
+    decision.pot_odds = decision.facing_bet ? decision.amount_to_call / (pot + decision.amount_to_call) : 0;
+    decision.stack_to_pot = pot > 0 ? decision.stack / pot : 0;
+
+    auto bet_ev = [&](double invested) {
+        double extra = std::max(0.0, invested - decision.amount_to_call);
+        return equity * (pot + invested + extra) - invested;
+    };
+    double raise_size = decision.action == Action_Type::raise ? decision.invested
+                                                              : std::min<double>(decision.stack, decision.amount_to_call + std::max(pot, 1.0));
+    double fold_ev = 0;
+    double passive_ev = decision.facing_bet ? equity * (pot + decision.amount_to_call) - decision.amount_to_call : equity * pot;
+    double raise_ev = decision.stack > decision.amount_to_call ? bet_ev(raise_size) : passive_ev;
+
+    double chosen_ev = passive_ev;
+    if (decision.action == Action_Type::fold) {
+        chosen_ev = fold_ev;
+    } else if (decision.action == Action_Type::raise) {
+        chosen_ev = raise_ev;
+    }
+    decision.ev_loss = std::max({fold_ev, passive_ev, raise_ev}) - chosen_ev;
+    return decision;
+}
+
+// Running EV loss per street and decision type over any number of hands
+class Leak_Aggregator {
+private:
+    struct Cell {
+        std::uint64_t decisions{0};
+        std::uint64_t mistakes{0};
+        double ev_loss{0};
+        double equity{0};
+        double pot_odds{0};
+    };
+    std::array<std::array<Cell, 4>, 4> cells{};  // [street][fold, check, call, raise]
+    std::uint64_t equity_samples{0};
+
+public:
+    void add(const Decision_Record& decision) {
+        Cell& cell = cells[std::min<int>(decision.street, 3)][std::min<int>(static_cast<int>(decision.action), 3)];
+        cell.decisions += 1;
+        cell.ev_loss += decision.ev_loss;
+        cell.equity += decision.equity;
+        cell.pot_odds += decision.pot_odds;
+        equity_samples += decision.equity_samples;
+        // a mistake costs more than a twentieth of the pot
+        cell.mistakes += decision.ev_loss > 0.05 * std::max(decision.pot, 1) ? 1 : 0;
+    }
+
+    std::uint64_t nr_of_decisions() const {
+        std::uint64_t total{0};
+        for (const auto& street : cells) {
+            for (const auto& cell : street) {
+                total += cell.decisions;
+            }
+        }
+        return total;
+    }
+
+    void print() const {
+        const char* street_names[4] = { "preflop", "flop", "turn", "river" };
+        const char* action_names[4] = { "fold", "check", "call", "raise" };
+        std::cout << "\nDecision analysis (EV lost against the best simple alternative):" << std::endl;
+        for (int street{0}; street < 4; street++) {
+            for (int action{0}; action < 4; action++) {
+                const Cell& cell = cells[street][action];
+                if (cell.decisions == 0) {
+                    continue;
+                }
+                std::cout << " " << street_names[street] << " " << action_names[action] << ": " << cell.decisions << " decisions"
+                          << ", average equity " << static_cast<int>(100 * cell.equity / cell.decisions) << "%"
+                          << ", average pot odds " << static_cast<int>(100 * cell.pot_odds / cell.decisions) << "%"
+                          << ", EV lost " << static_cast<int>(cell.ev_loss) << " chips (" << cell.ev_loss / cell.decisions << " per decision)"
+                          << ", mistakes " << cell.mistakes << std::endl;
+            }
+        }
+        if (nr_of_decisions() > 0) {
+            std::cout << " equity estimates used " << equity_samples / nr_of_decisions() << " runouts per decision on average" << std::endl;
+        }
+    }
+};
+
+
+namespace Stats {
+
+enum Counter : int { hands, vpip, pfr, bets_and_raises, calls, faced_raise, folded_to_raise, showdowns, showdowns_won, nr_of_counters };
+
+// Merged counters of one player or bot policy, the rates are derived when reported
+struct Player_Stats {
+    std::string name;
+    std::array<std::uint64_t, nr_of_counters> counters{};
+
+    double rate(Counter part, Counter whole) const {
+        return counters[whole] > 0 ? static_cast<double>(counters[part]) / counters[whole] : 0;
+    }
+    double aggression_factor() const {
+        return counters[calls] > 0 ? static_cast<double>(counters[bets_and_raises]) / counters[calls] : counters[bets_and_raises];
+    }
+};
+
+// Counters written by a single thread. The owner updates them with relaxed loads and stores instead of
+// read-modify-write, so counting stays a plain add, and a report can read a running block without locks.
+class alignas(64) Counter_Block {
+public:
+    static constexpr int max_slots = 4096;  // the last slot collects every player beyond that
+
+private:
+    struct Slot {
+        std::string name;
+        std::array<std::atomic<std::uint64_t>, nr_of_counters> counters{};
+    };
+    std::unique_ptr<Slot[]> slots;
+    std::atomic<int> nr_of_slots{0};
+    std::unordered_map<std::string_view, int> index;  // only used by the owner
+    std::deque<std::string> overflow_names;           // keys of index for players in the last slot
+
+public:
+    Counter_Block() : slots(new Slot[max_slots]) {}
+
+    // Slot of a player or policy, creating it on first use. Owner thread only.
+    int slot_of(std::string_view name) {
+        auto found = index.find(name);
+        if (found != index.end()) {
+            return found->second;
+        }
+        int slot = nr_of_slots.load(std::memory_order_relaxed);
+        if (slot >= max_slots - 1) {
+            slot = max_slots - 1;
+            if (slots[slot].name.empty()) {
+                slots[slot].name = "(other players)";
+                nr_of_slots.store(max_slots, std::memory_order_release);
+            }
+            overflow_names.emplace_back(name);
+            index.emplace(overflow_names.back(), slot);
+            return slot;
+        }
+        slots[slot].name = std::string(name);
+        index.emplace(slots[slot].name, slot);
+        nr_of_slots.store(slot + 1, std::memory_order_release);
+        return slot;
+    }
+
+    void add(int slot, Counter counter, std::uint64_t amount = 1) {
+        std::atomic<std::uint64_t>& cell = slots[slot].counters[counter];
+        cell.store(cell.load(std::memory_order_relaxed) + amount, std::memory_order_relaxed);
+    }
+
+    // Adds the published slots to the totals, safe while the owner keeps counting
+    void merge_into(std::unordered_map<std::string, Player_Stats>& totals) const {
+        int published = nr_of_slots.load(std::memory_order_acquire);
+        for (int i{0}; i < published; i++) {
+            Player_Stats& stats = totals[slots[i].name];
+            stats.name = slots[i].name;
+            for (int c{0}; c < nr_of_counters; c++) {
+                stats.counters[c] += slots[i].counters[c].load(std::memory_order_relaxed);
+            }
+        }
+    }
+};
+
+// Hands out one counter block per thread and merges all of them at report time
+class Stats_Registry {
+private:
+    static constexpr int max_blocks = 256;
+    std::array<std::atomic<Counter_Block*>, max_blocks> blocks{};
+    std::atomic<int> nr_of_blocks{0};
+
+public:
+    Stats_Registry() = default;
+    Stats_Registry(const Stats_Registry&) = delete;
+    Stats_Registry& operator=(const Stats_Registry&) = delete;
+    ~Stats_Registry() {
+        for (auto& block : blocks) {
+            delete block.load();
+        }
+    }
+
+    Counter_Block& new_block() {
+        int i = nr_of_blocks.fetch_add(1);
+        if (i >= max_blocks) {
+            throw std::length_error("Too many statistics blocks.");
+        }
+        Counter_Block* block = new Counter_Block();
+        blocks[i].store(block, std::memory_order_release);
+        return *block;
+    }
+
+    // Merged statistics, the players with the most hands first
+    std::vector<Player_Stats> merge() const {
+        std::unordered_map<std::string, Player_Stats> totals;
+        for (const auto& block : blocks) {
+            if (const Counter_Block* current = block.load(std::memory_order_acquire)) {
+                current->merge_into(totals);
+            }
+        }
+        std::vector<Player_Stats> merged;
+        for (auto& entry : totals) {
+            merged.push_back(std::move(entry.second));
+        }
+        std::sort(merged.begin(), merged.end(), [](const Player_Stats& a, const Player_Stats& b) {
+            return a.counters[hands] != b.counters[hands] ? a.counters[hands] > b.counters[hands] : a.name < b.name;
+        });
+        return merged;
+    }
+};
+
+// Turns the actions of one hand into counter updates. VPIP and PFR count once per hand,
+// an action faces a raise when another seat raised earlier on the same street.
+class Hand_Tracker {
+private:
+    Counter_Block* block{nullptr};
+    std::array<int, History::max_seats> player_slots{};
+    std::array<int, History::max_seats> policy_slots{};
+    int nr_of_seats{0};
+    std::uint32_t voluntary_mask{0};
+    std::uint32_t preflop_raise_mask{0};
+    int street{0};
+    int street_raiser{-1};
+
+    void count(int seat, Counter counter) {
+        block->add(player_slots[seat], counter);
+        if (policy_slots[seat] >= 0) {
+            block->add(policy_slots[seat], counter);
+        }
+    }
+
+public:
+    void begin(Counter_Block& i_block) {
+        block = &i_block;
+        nr_of_seats = 0;
+        voluntary_mask = 0;
+        preflop_raise_mask = 0;
+        street = 0;
+        street_raiser = -1;
+    }
+
+    // Seats have to be added in seat order, policy is empty when the player is only tracked by name
+    void add_seat(std::string_view player, std::string_view policy) {
+        if (nr_of_seats == History::max_seats) {
+            return;
+        }
+        player_slots[nr_of_seats] = block->slot_of(player);
+        policy_slots[nr_of_seats] = policy.empty() ? -1 : block->slot_of(policy);
+        nr_of_seats++;
+    }
+
+    void action(int seat, int action_street, Action_Type type) {
+        if (block == nullptr || seat < 0 || seat >= nr_of_seats) {
+            return;
+        }
+        if (action_street != street) {
+            street = action_street;
+            street_raiser = -1;
+        }
+        bool facing_raise = street_raiser >= 0 && street_raiser != seat;
+        if (facing_raise) {
+            count(seat, faced_raise);
+        }
+        switch (type) {
+            case Action_Type::fold:
+                if (facing_raise) {
+                    count(seat, folded_to_raise);
+                }
+                break;
+            case Action_Type::call:
+                count(seat, calls);
+                voluntary_mask |= street == 0 ? 1u << seat : 0;
+                break;
+            case Action_Type::raise:
+                count(seat, bets_and_raises);
+                voluntary_mask |= street == 0 ? 1u << seat : 0;
+                preflop_raise_mask |= street == 0 ? 1u << seat : 0;
+                street_raiser = seat;
+                break;
+            default:
+                break;
+        }
+    }
+
+    void finish_seat(int seat, bool at_showdown, bool won) {
+        if (block == nullptr || seat < 0 || seat >= nr_of_seats) {
+            return;
+        }
+        count(seat, hands);
+        if (voluntary_mask & (1u << seat)) {
+            count(seat, vpip);
+        }
+        if (preflop_raise_mask & (1u << seat)) {
+            count(seat, pfr);
+        }
+        if (at_showdown) {
+            count(seat, showdowns);
+            if (won) {
+                count(seat, showdowns_won);
+            }
+        }
+    }
+
+    // Tracks a logged hand in one go, players are keyed by their seat name
+    void track_hand(Counter_Block& i_block, const History::Hand_View& hand) {
+        begin(i_block);
+        for (int i{0}; i < hand.nr_of_seats(); i++) {
+            const History::Seat_Entry& seat = hand.seats()[i];
+            add_seat(std::string_view(seat.name, strnlen(seat.name, sizeof(seat.name))), "");
+        }
+        for (int i{0}; i < hand.nr_of_actions(); i++) {
+            const History::Action_Entry& entry = hand.actions()[i];
+            action(entry.seat, entry.street, static_cast<Action_Type>(entry.type));
+        }
+        for (int i{0}; i < hand.nr_of_seats(); i++) {
+            const History::Seat_Entry& seat = hand.seats()[i];
+            finish_seat(i, seat.flags & History::seat_at_showdown, seat.won > 0);
+        }
+    }
+};
+
+inline void print_player_stats(const std::vector<Player_Stats>& stats, std::size_t max_rows) {
+    std::cout << "\nPlayer statistics (VPIP, PFR, aggression factor, fold to raise, showdown win rate):" << std::endl;
+    for (std::size_t i{0}; i < stats.size() && i < max_rows; i++) {
+        const Player_Stats& player = stats[i];
+        std::cout << " " << player.name << ": " << player.counters[hands] << " hands"
+                  << ", VPIP " << static_cast<int>(100 * player.rate(vpip, hands)) << "%"
+                  << ", PFR " << static_cast<int>(100 * player.rate(pfr, hands)) << "%"
+                  << ", AF " << player.aggression_factor()
+                  << ", fold to raise " << static_cast<int>(100 * player.rate(folded_to_raise, faced_raise)) << "%"
+                  << ", won at showdown " << static_cast<int>(100 * player.rate(showdowns_won, showdowns)) << "%" << std::endl;
+    }
+    if (stats.size() > max_rows) {
+        std::cout << " ... and " << stats.size() - max_rows << " more" << std::endl;
+    }
+}
+
+} // namespace Stats end
+
+
+namespace Export {
+
+enum class Format { columnar, csv };
+
+enum class Column_Type : std::uint8_t { u8 = 1, i32 = 2, u32 = 3, u64 = 4 };
+
+inline int column_width(Column_Type type) {
+    switch (type) {
+        case Column_Type::u8: return 1;
+        case Column_Type::i32: return 4;
+        case Column_Type::u32: return 4;
+        case Column_Type::u64: return 8;
+    }
+    return 0;
+}
+
+struct Column_Spec {
+    const char* name;
+    Column_Type type;
+};
+
+// Columnar file layout, all little endian:
+//   "PKCOLUMN", u32 nr_of_columns, per column { u8 type, u8 name_length, name }
+//   then blocks of { u32 nr_of_rows, every column's values back to back }
+constexpr char columnar_magic[8] = { 'P', 'K', 'C', 'O', 'L', 'U', 'M', 'N' };
+constexpr std::size_t rows_per_block = 65536;
+
+// Rows of one table collected column by column by a single thread
+class Column_Batch {
+private:
+    const std::vector<Column_Spec>* specs;
+    std::vector<std::vector<char>> columns;
+    std::size_t nr_of_rows{0};
+
+public:
+    explicit Column_Batch(const std::vector<Column_Spec>& i_specs) : specs(&i_specs), columns(i_specs.size()) {
+        for (std::size_t i{0}; i < columns.size(); i++) {
+            columns[i].reserve(rows_per_block * column_width(i_specs[i].type));
+        }
+    }
+
+    template <typename T>
+    void put(int column, T value) {
+        static_assert(std::is_trivially_copyable<T>::value, "columns hold plain values");
+        const char* bytes = reinterpret_cast<const char*>(&value);
+        columns[column].insert(columns[column].end(), bytes, bytes + sizeof(T));
+    }
+
+    // Returns true when the batch is large enough to be flushed
+    bool end_row() {
+        return ++nr_of_rows >= rows_per_block;
+    }
+
+    std::size_t size() const { return nr_of_rows; }
+    const std::vector<Column_Spec>& column_specs() const { return *specs; }
+    const std::vector<char>& column(int i) const { return columns[i]; }
+
+    void clear() {
+        for (auto& column : columns) {
+            column.clear();
+        }
+        nr_of_rows = 0;
+    }
+};
+
+// One output table shared by all threads. Batches are encoded by the thread that filled them
+// and only the final write of a whole block is serialized.
+class Table_Writer {
+private:
+    std::vector<Column_Spec> specs;
+    Format format;
+    std::FILE* file{nullptr};
+    std::mutex write_mutex;
+    std::uint64_t nr_of_rows{0};
+
+    std::string encode_csv(const Column_Batch& batch) const {
+        std::string text;
+        text.reserve(batch.size() * specs.size() * 6);
+        char number[24];
+        for (std::size_t row{0}; row < batch.size(); row++) {
+            for (std::size_t c{0}; c < specs.size(); c++) {
+                const char* value = batch.column(c).data() + row * column_width(specs[c].type);
+                char* end = number;
+                switch (specs[c].type) {
+                    case Column_Type::u8: end = std::to_chars(number, number + sizeof(number), static_cast<std::uint8_t>(*value)).ptr; break;
+                    case Column_Type::i32: { std::int32_t v; std::memcpy(&v, value, 4); end = std::to_chars(number, number + sizeof(number), v).ptr; break; }
+                    case Column_Type::u32: { std::uint32_t v; std::memcpy(&v, value, 4); end = std::to_chars(number, number + sizeof(number), v).ptr; break; }
+                    case Column_Type::u64: { std::uint64_t v; std::memcpy(&v, value, 8); end = std::to_chars(number, number + sizeof(number), v).ptr; break; }
+                }
+                text.append(number, end);
+                text.push_back(c + 1 < specs.size() ? ',' : '\n');
+            }
+        }
+        return text;
+    }
+
+    void write_bytes(const void* data, std::size_t size) {
+        if (size > 0 && std::fwrite(data, 1, size, file) != size) {
+            throw std::runtime_error("Could not write the export file.");
+        }
+    }
+
+public:
+    Table_Writer(const std::string& path, std::vector<Column_Spec> i_specs, Format i_format)
+        : specs(std::move(i_specs)), format(i_format) {
+        file = std::fopen(path.c_str(), "wb");
+        if (file == nullptr) {
+            throw std::runtime_error("Could not open " + path + " for the export.");
+        }
+        std::setvbuf(file, nullptr, _IOFBF, 1 << 20);
+        if (format == Format::csv) {
+            std::string header;
+            for (std::size_t c{0}; c < specs.size(); c++) {
+                header += specs[c].name;
+                header.push_back(c + 1 < specs.size() ? ',' : '\n');
+            }
+            write_bytes(header.data(), header.size());
+        } else {
+            std::uint32_t nr_of_columns = specs.size();
+            write_bytes(columnar_magic, sizeof(columnar_magic));
+            write_bytes(&nr_of_columns, sizeof(nr_of_columns));
+            for (const auto& spec : specs) {
+                std::uint8_t type = static_cast<std::uint8_t>(spec.type);
+                std::uint8_t name_length = std::strlen(spec.name);
+                write_bytes(&type, 1);
+                write_bytes(&name_length, 1);
+                write_bytes(spec.name, name_length);
+            }
+        }
+    }
+
+    Table_Writer(const Table_Writer&) = delete;
+    Table_Writer& operator=(const Table_Writer&) = delete;
+
+    ~Table_Writer() {
+        if (file != nullptr) {
+            std::fclose(file);
+        }
+    }
+
+    const std::vector<Column_Spec>& column_specs() const { return specs; }
+    std::uint64_t rows_written() const { return nr_of_rows; }
+
+    // Writes the batch as one block and empties it
+    void flush(Column_Batch& batch) {
+        if (batch.size() == 0) {
+            return;
+        }
+        std::string text = format == Format::csv ? encode_csv(batch) : std::string();
+        std::uint32_t block_rows = batch.size();
+        {
+            std::lock_guard<std::mutex> lock(write_mutex);
+            if (format == Format::csv) {
+                write_bytes(text.data(), text.size());
+            } else {
+                write_bytes(&block_rows, sizeof(block_rows));
+                for (std::size_t c{0}; c < specs.size(); c++) {
+                    write_bytes(batch.column(c).data(), batch.column(c).size());
+                }
+            }
+            nr_of_rows += block_rows;
+        }
+        batch.clear();
+    }
+
+    void close() {
+        std::lock_guard<std::mutex> lock(write_mutex);
+        if (file != nullptr && std::fclose(file) != 0) {
+            file = nullptr;
+            throw std::runtime_error("Could not finish the export file.");
+        }
+        file = nullptr;
+    }
+};
+
+// Per-hand rows: one per seat
+enum Hand_Column : int { hand_id_column, seat_column, hole1_column, hole2_column, strength_column, won_column, net_column, flags_column };
+// Per-decision rows: one per logged action
+enum Decision_Column : int { decision_hand_id_column, decision_seat_column, street_column, action_column, amount_column };
+
+inline std::vector<Column_Spec> hand_columns() {
+    return { { "hand_id", Column_Type::u64 }, { "seat", Column_Type::u8 }, { "hole1", Column_Type::u8 }, { "hole2", Column_Type::u8 },
+             { "strength", Column_Type::u32 }, { "won", Column_Type::i32 }, { "net", Column_Type::i32 }, { "flags", Column_Type::u8 } };
+}
+
+inline std::vector<Column_Spec> decision_columns() {
+    return { { "hand_id", Column_Type::u64 }, { "seat", Column_Type::u8 }, { "street", Column_Type::u8 },
+             { "action", Column_Type::u8 }, { "amount", Column_Type::i32 } };
+}
+
+// The hands and decisions tables of one export, written to <prefix>_hands and <prefix>_decisions
+class Exporter {
+public:
+    Table_Writer hands;
+    Table_Writer decisions;
+
+    Exporter(const std::string& prefix, Format format)
+        : hands(prefix + (format == Format::csv ? "_hands.csv" : "_hands.col"), hand_columns(), format),
+          decisions(prefix + (format == Format::csv ? "_decisions.csv" : "_decisions.col"), decision_columns(), format) {}
+
+    void close() {
+        hands.close();
+        decisions.close();
+    }
+};
+
+// Rows collected by one thread, flushed to the shared exporter a block at a time
+class Export_Batch {
+private:
+    Exporter* exporter;
+    Column_Batch hand_rows;
+    Column_Batch decision_rows;
+
+public:
+    explicit Export_Batch(Exporter& i_exporter)
+        : exporter(&i_exporter), hand_rows(i_exporter.hands.column_specs()), decision_rows(i_exporter.decisions.column_specs()) {}
+
+    Export_Batch(const Export_Batch&) = delete;
+    Export_Batch& operator=(const Export_Batch&) = delete;
+
+    ~Export_Batch() {
+        try {
+            flush();
+        } catch (const std::exception&) {
+        }
+    }
+
+    // Adds a hand given as its header, seats and actions, so records and mapped views export the same way
+    void add_hand(const History::Hand_Header& header, const History::Seat_Entry* seats, const History::Action_Entry* actions) {
+        std::array<std::int32_t, History::max_seats> committed{};
+        for (int i{0}; i < header.nr_of_actions; i++) {
+            const History::Action_Entry& action = actions[i];
+            committed[action.seat] += action.amount;
+            decision_rows.put(decision_hand_id_column, header.hand_id);
+            decision_rows.put(decision_seat_column, action.seat);
+            decision_rows.put(street_column, action.street);
+            decision_rows.put(action_column, action.type);
+            decision_rows.put(amount_column, action.amount);
+            if (decision_rows.end_row()) {
+                exporter->decisions.flush(decision_rows);
+            }
+        }
+
+        std::uint8_t cards[7];
+        int nr_of_board_cards{0};
+        while (nr_of_board_cards < 5 && header.board[nr_of_board_cards] != Cards::no_card) {
+            cards[2 + nr_of_board_cards] = header.board[nr_of_board_cards];
+            nr_of_board_cards++;
+        }
+        for (int i{0}; i < header.nr_of_seats; i++) {
+            const History::Seat_Entry& seat = seats[i];
+            cards[0] = seat.hole[0];
+            cards[1] = seat.hole[1];
+            bool cards_known = seat.hole[0] != Cards::no_card && seat.hole[1] != Cards::no_card;
+            Eval::Strength strength = cards_known && nr_of_board_cards >= 3
+                ? Eval::evaluate(cards, 2 + nr_of_board_cards, History::deck_type_of(header)) : 0;
+            hand_rows.put(hand_id_column, header.hand_id);
+            hand_rows.put(seat_column, static_cast<std::uint8_t>(i));
+            hand_rows.put(hole1_column, seat.hole[0]);
+            hand_rows.put(hole2_column, seat.hole[1]);
+            hand_rows.put(strength_column, strength);
+            hand_rows.put(won_column, seat.won);
+            hand_rows.put(net_column, seat.won - committed[i]);
+            hand_rows.put(flags_column, seat.flags);
+            if (hand_rows.end_row()) {
+                exporter->hands.flush(hand_rows);
+            }
+        }
+    }
+
+    void flush() {
+        exporter->hands.flush(hand_rows);
+        exporter->decisions.flush(decision_rows);
+    }
+};
+
+// Exports history files in parallel, one file (shard) at a time per thread
+inline std::uint64_t export_shards(const std::vector<std::string>& paths, Exporter& exporter, unsigned nr_of_threads) {
+    nr_of_threads = std::max(1u, std::min<unsigned>(nr_of_threads, paths.size()));
+    std::vector<std::uint64_t> hands(nr_of_threads);
+    std::vector<std::string> errors(nr_of_threads);
+    std::atomic<std::size_t> next_shard{0};
+
+    std::vector<std::thread> workers;
+    for (unsigned t{0}; t < nr_of_threads; t++) {
+        workers.emplace_back([&, t]() {
+            try {
+                Export_Batch batch(exporter);
+                for (std::size_t shard = next_shard++; shard < paths.size(); shard = next_shard++) {
+                    History::Hand_History_Reader reader(paths[shard]);
+                    reader.for_each_hand([&](const History::Hand_View& hand) {
+                        batch.add_hand(hand.header(), hand.seats(), hand.actions());
+                        hands[t] += 1;
+                    });
+                }
+                batch.flush();
+            } catch (const std::exception& e) {
+                errors[t] = e.what();
+            }
+        });
+    }
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    for (const auto& error : errors) {
+        if (!error.empty()) {
+            throw std::runtime_error(error);
+        }
+    }
+    std::uint64_t total{0};
+    for (auto count : hands) {
+        total += count;
+    }
+    return total;
+}
+
+} // namespace Export end
+
+
+// Hand ranges as weights over all 1326 two card combos
+namespace Ranges {
+
+constexpr int nr_of_combos = 1326;
+using Range = std::array<float, nr_of_combos>;
+
+struct Combo_Tables {
+    std::array<std::array<std::uint8_t, 2>, nr_of_combos> cards{};  // lower card index first
+    std::array<std::array<std::int16_t, 52>, 52> index{};           // -1 on the diagonal
+};
+
+constexpr Combo_Tables build_combo_tables() {
+    Combo_Tables built;
+    int combo{0};
+    for (int first{0}; first < 52; first++) {
+        built.index[first][first] = -1;
+        for (int second{first + 1}; second < 52; second++) {
+            built.cards[combo] = { static_cast<std::uint8_t>(first), static_cast<std::uint8_t>(second) };
+            built.index[first][second] = built.index[second][first] = static_cast<std::int16_t>(combo);
+            combo++;
+        }
+    }
+    return built;
+}
+
+inline constexpr Combo_Tables combo_table_data = build_combo_tables();  // built by the compiler, like the evaluator tables
+
+constexpr const Combo_Tables& combo_tables() { return combo_table_data; }
+
+inline int combo_index(std::uint8_t card1, std::uint8_t card2) {
+    return combo_tables().index[card1][card2];
+}
+
+inline std::uint64_t combo_mask(int combo) {
+    const auto& cards = combo_tables().cards[combo];
+    return 1ull << cards[0] | 1ull << cards[1];
+}
+
+// Every combo that does not use one of the dead cards, with weight 1
+inline Range uniform_range(std::uint64_t dead) {
+    Range range{};
+    for (int combo{0}; combo < nr_of_combos; combo++) {
+        range[combo] = (combo_mask(combo) & dead) ? 0.0f : 1.0f;
+    }
+    return range;
+}
+
+// Strength of every combo on a complete board and the combos the board leaves possible, weakest first.
+// The sorted order is stored with the cards of each combo and the end of its group of equal strength,
+// so the sweeps below read memory in sequence.
+struct Board_Strengths {
+    struct Entry {
+        std::int16_t combo;
+        std::uint8_t card1;
+        std::uint8_t card2;
+        std::int16_t group_end;  // first position past the combos of equal strength
+    };
+
+    std::uint64_t board_mask{0};
+    std::array<Eval::Strength, nr_of_combos> strength{};
+    std::array<Entry, nr_of_combos> sorted{};
+    int nr_of_valid{0};
+
+    // With used given, combos of weight 0 in it are not evaluated and count as blocked
+    explicit Board_Strengths(const std::uint8_t* board, const float* used = nullptr) {
+        for (int i{0}; i < 5; i++) {
+            board_mask |= 1ull << board[i];
+        }
+        std::uint8_t cards[7] = { 0, 0, board[0], board[1], board[2], board[3], board[4] };
+        const Combo_Tables& tables = combo_tables();
+        for (int combo{0}; combo < nr_of_combos; combo++) {
+            if ((combo_mask(combo) & board_mask) || (used && used[combo] <= 0)) {
+                continue;
+            }
+            cards[0] = tables.cards[combo][0];
+            cards[1] = tables.cards[combo][1];
+            strength[combo] = Eval::evaluate(cards, 7);
+            sorted[nr_of_valid++] = { static_cast<std::int16_t>(combo), cards[0], cards[1], 0 };
+        }
+        std::sort(sorted.begin(), sorted.begin() + nr_of_valid, [this](const Entry& a, const Entry& b) {
+            return strength[a.combo] < strength[b.combo];
+        });
+        for (int last{nr_of_valid - 1}, end{nr_of_valid}; last >= 0; last--) {
+            if (last + 1 < nr_of_valid && strength[sorted[last].combo] != strength[sorted[last + 1].combo]) {
+                end = last + 1;
+            }
+            sorted[last].group_end = static_cast<std::int16_t>(end);
+        }
+    }
+
+    // For every combo: opponent weight it beats minus opponent weight it loses to, without the combos that
+    // share a card with it. One sweep from weak to strong with running totals per card replaces the
+    // 1326 x 1326 comparison. Combos the board blocks get 0.
+    void showdown_balance(const float* opponent, float* out) const {
+        std::fill(out, out + nr_of_combos, 0.0f);
+        float total{0};
+        std::array<float, 52> total_by_card{};
+        for (int i{0}; i < nr_of_valid; i++) {
+            const Entry& entry = sorted[i];
+            float weight = opponent[entry.combo];
+            total += weight;
+            total_by_card[entry.card1] += weight;
+            total_by_card[entry.card2] += weight;
+        }
+        float weaker{0};
+        std::array<float, 52> weaker_by_card{};
+        std::array<float, 52> equal_by_card{};
+        for (int first{0}; first < nr_of_valid;) {
+            int end = sorted[first].group_end;
+            float equal{0};
+            for (int i{first}; i < end; i++) {
+                const Entry& entry = sorted[i];
+                float weight = opponent[entry.combo];
+                equal += weight;
+                equal_by_card[entry.card1] += weight;
+                equal_by_card[entry.card2] += weight;
+            }
+            for (int i{first}; i < end; i++) {
+                const Entry& entry = sorted[i];
+                float weight = opponent[entry.combo];
+                float beats = weaker - weaker_by_card[entry.card1] - weaker_by_card[entry.card2];
+                float ties = equal - equal_by_card[entry.card1] - equal_by_card[entry.card2] + weight;
+                float possible = total - total_by_card[entry.card1] - total_by_card[entry.card2] + weight;
+                out[entry.combo] = 2 * beats + ties - possible;
+            }
+            weaker += equal;
+            for (int i{first}; i < end; i++) {
+                const Entry& entry = sorted[i];
+                weaker_by_card[entry.card1] += equal_by_card[entry.card1];
+                weaker_by_card[entry.card2] += equal_by_card[entry.card2];
+                equal_by_card[entry.card1] = 0;
+                equal_by_card[entry.card2] = 0;
+            }
+            first = end;
+        }
+    }
+
+    // For every combo: opponent weight that does not share a card with it
+    void possible_weight(const float* opponent, float* out) const {
+        std::fill(out, out + nr_of_combos, 0.0f);
+        float total{0};
+        std::array<float, 52> total_by_card{};
+        for (int i{0}; i < nr_of_valid; i++) {
+            const Entry& entry = sorted[i];
+            float weight = opponent[entry.combo];
+            total += weight;
+            total_by_card[entry.card1] += weight;
+            total_by_card[entry.card2] += weight;
+        }
+        for (int i{0}; i < nr_of_valid; i++) {
+            const Entry& entry = sorted[i];
+            out[entry.combo] = total - total_by_card[entry.card1] - total_by_card[entry.card2] + opponent[entry.combo];
+        }
+    }
+};
+
+
+// "Ah" to a card index
+inline bool parse_card(std::string_view token, std::uint8_t& card) {
+    static const std::string_view rank_letters = "23456789TJQKA";
+    static const std::string_view suit_letters = "hdcs";  // same order as Cards::suit_symbols
+    if (token.size() != 2) {
+        return false;
+    }
+    std::size_t rank = rank_letters.find(token[0]);
+    std::size_t suit = suit_letters.find(token[1]);
+    if (rank == std::string_view::npos || suit == std::string_view::npos) {
+        return false;
+    }
+    card = static_cast<std::uint8_t>(rank * 4 + suit);
+    return true;
+}
+
+// "AsKd7c" to card indices, returns the number of cards
+inline int parse_cards(std::string_view text, std::uint8_t* cards, int max_cards) {
+    if (text.size() % 2 != 0 || static_cast<int>(text.size() / 2) > max_cards) {
+        throw std::invalid_argument("Invalid cards: " + std::string(text));
+    }
+    std::uint64_t seen{0};
+    for (std::size_t i{0}; i < text.size(); i += 2) {
+        if (!parse_card(text.substr(i, 2), cards[i / 2]) || (seen >> cards[i / 2] & 1)) {
+            throw std::invalid_argument("Invalid cards: " + std::string(text));
+        }
+        seen |= 1ull << cards[i / 2];
+    }
+    return text.size() / 2;
+}
+
+enum class Suitedness { any, suited, offsuit };
+
+// Sets the weight of every combo of a starting hand like "AKs", "AKo", "AK" or "QQ"
+inline void set_hand(Range& range, int high, int low, Suitedness suitedness, float weight) {
+    for (int suit1{0}; suit1 < 4; suit1++) {
+        for (int suit2{0}; suit2 < 4; suit2++) {
+            if ((high == low && suit2 <= suit1) || (suitedness == Suitedness::suited && suit1 != suit2)
+                || (suitedness == Suitedness::offsuit && suit1 == suit2)) {
+                continue;
+            }
+            range[combo_index(high * 4 + suit1, low * 4 + suit2)] = weight;
+        }
+    }
+}
+
+// Parses the usual range notation: comma separated hands with an optional ":weight", where a hand is
+// a pair ("QQ", "22+", "TT-77"), a suited or offsuit hand ("AKs", "KTo+", "A5s-A2s", "AT" for both)
+// or one exact combo ("AhKd"). Later entries overwrite the weight of earlier ones.
+inline Range parse_range(std::string_view text) {
+    static const std::string_view rank_letters = "23456789TJQKA";
+    Range range{};
+    while (!text.empty()) {
+        std::size_t comma = text.find(',');
+        std::string_view entry = text.substr(0, comma);
+        text = comma == std::string_view::npos ? std::string_view{} : text.substr(comma + 1);
+        while (!entry.empty() && entry.front() == ' ') {
+            entry.remove_prefix(1);
+        }
+        while (!entry.empty() && entry.back() == ' ') {
+            entry.remove_suffix(1);
+        }
+        if (entry.empty()) {
+            continue;
+        }
+        const std::string invalid = "Invalid range entry: " + std::string(entry);
+        float weight{1.0f};
+        if (std::size_t colon = entry.find(':'); colon != std::string_view::npos) {
+            std::string_view number = entry.substr(colon + 1);
+            auto [end, error] = std::from_chars(number.data(), number.data() + number.size(), weight);
+            if (error != std::errc() || end != number.data() + number.size() || weight < 0) {
+                throw std::invalid_argument(invalid);
+            }
+            entry = entry.substr(0, colon);
+        }
+        std::uint8_t cards[2];
+        if (entry.size() == 4 && parse_card(entry.substr(0, 2), cards[0]) && parse_card(entry.substr(2, 2), cards[1])) {
+            if (cards[0] == cards[1]) {
+                throw std::invalid_argument(invalid);
+            }
+            range[combo_index(cards[0], cards[1])] = weight;
+            continue;
+        }
+
+        // one hand: two ranks and an optional 's' or 'o'
+        auto parse_hand = [&](std::string_view hand, int& high, int& low, Suitedness& suitedness) {
+            if (hand.size() < 2 || hand.size() > 3) {
+                throw std::invalid_argument(invalid);
+            }
+            std::size_t first = rank_letters.find(hand[0]);
+            std::size_t second = rank_letters.find(hand[1]);
+            if (first == std::string_view::npos || second == std::string_view::npos) {
+                throw std::invalid_argument(invalid);
+            }
+            high = std::max(first, second);
+            low = std::min(first, second);
+            suitedness = Suitedness::any;
+            if (hand.size() == 3) {
+                if (hand[2] != 's' && hand[2] != 'o') {
+                    throw std::invalid_argument(invalid);
+                }
+                suitedness = hand[2] == 's' ? Suitedness::suited : Suitedness::offsuit;
+            }
+            if (high == low && suitedness != Suitedness::any) {
+                throw std::invalid_argument(invalid);
+            }
+        };
+
+        int high, low;
+        Suitedness suitedness;
+        if (std::size_t dash = entry.find('-'); dash != std::string_view::npos) {
+            int high2, low2;
+            Suitedness suitedness2;
+            parse_hand(entry.substr(0, dash), high, low, suitedness);
+            parse_hand(entry.substr(dash + 1), high2, low2, suitedness2);
+            bool pairs = high == low && high2 == low2;
+            if (suitedness != suitedness2 || (!pairs && (high != high2 || high == low || high2 == low2))) {
+                throw std::invalid_argument(invalid);
+            }
+            int from = pairs ? std::min(high, high2) : std::min(low, low2);
+            int to = pairs ? std::max(high, high2) : std::max(low, low2);
+            for (int rank{from}; rank <= to; rank++) {
+                set_hand(range, pairs ? rank : high, rank, suitedness, weight);
+            }
+        } else if (entry.back() == '+') {
+            parse_hand(entry.substr(0, entry.size() - 1), high, low, suitedness);
+            // pairs go up to aces, other hands raise the kicker up to one below the top card
+            for (int rank{low}; rank < (high == low ? 13 : high); rank++) {
+                set_hand(range, high == low ? rank : high, rank, suitedness, weight);
+            }
+        } else {
+            parse_hand(entry, high, low, suitedness);
+            set_hand(range, high, low, suitedness, weight);
+        }
+    }
+    return range;
+}
+
+struct Range_Equity {
+    std::vector<double> equity;  // share of the pot each range wins on average
+    int nr_of_boards{0};
+    bool exact{false};           // false when runouts or multiway showdowns were sampled
+};
+
+// Equity of every range against the others on a board of 0, 3, 4 or 5 cards, with every combination of
+// combos weighted by the product of their weights and the ones that share a card left out.
+// Runouts are enumerated up to max_boards and sampled beyond that. Heads-up, each runout is solved for
+// all 1326 combos at once with the sorted strength sweep; with more players each runout is sampled
+// samples_per_board times from the strength table, rejecting samples whose cards collide.
+inline Range_Equity range_equity(const std::vector<Range>& ranges, const std::uint8_t* board, int nr_of_board_cards,
+                                 int max_boards = 5000, int samples_per_board = 200, std::uint64_t seed = 1,
+                                 unsigned nr_of_threads = 1) {
+    int nr_of_players = ranges.size();
+    if (nr_of_players < 2 || nr_of_players > 10 || nr_of_board_cards < 0 || nr_of_board_cards > 5 || nr_of_board_cards == 1 || nr_of_board_cards == 2) {
+        throw std::invalid_argument("Range equity needs 2 to 10 ranges and a board of 0, 3, 4 or 5 cards.");
+    }
+    std::uint64_t board_mask{0};
+    for (int i{0}; i < nr_of_board_cards; i++) {
+        board_mask |= 1ull << board[i];
+    }
+
+    // the runouts, all of them when there are few enough
+    std::vector<std::uint8_t> deck;
+    for (std::uint8_t card{0}; card < 52; card++) {
+        if (!(board_mask >> card & 1)) {
+            deck.push_back(card);
+        }
+    }
+    int missing = 5 - nr_of_board_cards;
+    double nr_of_runouts{1};
+    for (int i{0}; i < missing; i++) {
+        nr_of_runouts = nr_of_runouts * (deck.size() - i) / (i + 1);
+    }
+    Range_Equity result;
+    result.exact = nr_of_runouts <= max_boards && nr_of_players == 2;
+    std::vector<std::array<std::uint8_t, 5>> runouts;
+    std::array<std::uint8_t, 5> runout{};
+    std::copy(board, board + nr_of_board_cards, runout.begin());
+    if (nr_of_runouts <= max_boards) {
+        std::array<int, 5> position{};
+        for (int i{0}; i < missing; i++) {
+            position[i] = i;
+        }
+        while (true) {
+            for (int i{0}; i < missing; i++) {
+                runout[nr_of_board_cards + i] = deck[position[i]];
+            }
+            runouts.push_back(runout);
+            int i = missing - 1;
+            while (i >= 0 && position[i] == static_cast<int>(deck.size()) - missing + i) {
+                i--;
+            }
+            if (i < 0) {
+                break;
+            }
+            position[i]++;
+            for (int j{i + 1}; j < missing; j++) {
+                position[j] = position[j - 1] + 1;
+            }
+        }
+    } else {
+        Cards::Session_Rng rng(seed);
+        for (int b{0}; b < max_boards; b++) {
+            std::uint64_t dead = board_mask;
+            for (int i{0}; i < missing; i++) {
+                std::uint8_t card;
+                do {
+                    card = deck[rng() % deck.size()];
+                } while (dead >> card & 1);
+                dead |= 1ull << card;
+                runout[nr_of_board_cards + i] = card;
+            }
+            runouts.push_back(runout);
+        }
+    }
+    result.nr_of_boards = runouts.size();
+
+    // prefix sums of the weights for sampling multiway showdowns, and the combos any range holds
+    std::vector<std::array<float, nr_of_combos>> prefix(nr_of_players);
+    Range used{};
+    for (int player{0}; player < nr_of_players; player++) {
+        float sum{0};
+        for (int combo{0}; combo < nr_of_combos; combo++) {
+            sum += ranges[player][combo];
+            prefix[player][combo] = sum;
+            used[combo] += ranges[player][combo];
+        }
+        if (sum <= 0) {
+            throw std::invalid_argument("Every range needs at least one combo.");
+        }
+    }
+
+    std::vector<double> won(nr_of_players, 0.0);
+    double total{0};
+    std::mutex merge;
+    std::atomic<int> next_board{0};
+    auto work = [&](unsigned thread) {
+        std::vector<double> local_won(nr_of_players, 0.0);
+        double local_total{0};
+        std::array<float, nr_of_combos> balance{};
+        std::array<float, nr_of_combos> possible{};
+        Cards::Session_Rng rng(seed ^ (0x9E3779B97F4A7C15ull * (thread + 1)));
+        for (int b = next_board++; b < static_cast<int>(runouts.size()); b = next_board++) {
+            Board_Strengths strengths(runouts[b].data(), used.data());
+            if (nr_of_players == 2) {
+                strengths.showdown_balance(ranges[1].data(), balance.data());
+                strengths.possible_weight(ranges[1].data(), possible.data());
+                for (int combo{0}; combo < nr_of_combos; combo++) {
+                    local_won[0] += 0.5 * ranges[0][combo] * (balance[combo] + possible[combo]);
+                    local_total += ranges[0][combo] * possible[combo];
+                }
+                continue;
+            }
+            std::uniform_real_distribution<float> uniform(0.0f, 1.0f);
+            for (int sample{0}; sample < samples_per_board; sample++) {
+                std::uint64_t dead = strengths.board_mask;
+                Eval::Strength best{0};
+                int nr_of_winners{0};
+                std::array<int, 10> combos{};
+                bool collided{false};
+                for (int player{0}; player < nr_of_players && !collided; player++) {
+                    float draw = uniform(rng) * prefix[player].back();
+                    int combo = std::upper_bound(prefix[player].begin(), prefix[player].end(), draw) - prefix[player].begin();
+                    combo = std::min(combo, nr_of_combos - 1);
+                    collided = (combo_mask(combo) & dead) != 0;
+                    dead |= combo_mask(combo);
+                    combos[player] = combo;
+                }
+                if (collided) {
+                    continue;
+                }
+                for (int player{0}; player < nr_of_players; player++) {
+                    Eval::Strength strength = strengths.strength[combos[player]];
+                    if (strength > best) {
+                        best = strength;
+                        nr_of_winners = 0;
+                    }
+                    nr_of_winners += strength == best;
+                }
+                for (int player{0}; player < nr_of_players; player++) {
+                    if (strengths.strength[combos[player]] == best) {
+                        local_won[player] += 1.0 / nr_of_winners;
+                    }
+                }
+                local_total += 1;
+            }
+        }
+        std::lock_guard<std::mutex> lock(merge);
+        for (int player{0}; player < nr_of_players; player++) {
+            won[player] += local_won[player];
+        }
+        total += local_total;
+    };
+    std::vector<std::thread> workers;
+    for (unsigned t{1}; t < nr_of_threads; t++) {
+        workers.emplace_back(work, t);
+    }
+    work(0);
+    for (auto& worker : workers) {
+        worker.join();
+    }
+
+    if (total <= 0) {
+        throw std::invalid_argument("The ranges cannot be dealt together on this board.");
+    }
+    if (nr_of_players == 2) {
+        won[1] = total - won[0];
+    }
+    for (int player{0}; player < nr_of_players; player++) {
+        result.equity.push_back(won[player] / total);
+    }
+    return result;
+}
+
+} // namespace Ranges end
+
+
+// Card abstraction from expected hand strength. Every combo on every canonical board of a street gets
+// its strength against a random hand averaged over the runouts (EHS) and the mean of its square (EHS²),
+// the pairs are clustered into k buckets with k-means, and the bucket of each combo on each canonical
+// board goes into a table that the bots map from disk.
+namespace Buckets {
+
+constexpr std::uint32_t file_magic = 0x544B4250;  // "PBKT"
+constexpr std::uint32_t file_version = 1;
+constexpr int nr_of_streets = 3;                  // flop, turn, river
+constexpr int grid = 128;                         // EHS and EHS² are quantized to 128 levels each
+constexpr std::uint16_t no_cell = 0xFFFF;
+constexpr std::uint8_t no_bucket = 0xFF;
+constexpr int max_buckets = 255;
+constexpr int chunk_boards = 64;                  // boards per unit of work, the unit a restarted build skips
+
+struct Street_Header {
+    std::uint32_t nr_of_buckets;
+    std::uint32_t nr_of_boards;
+    std::uint32_t hash_bits;
+    std::uint32_t reserved;
+    std::uint64_t hash_offset;
+    std::uint64_t buckets_offset;     // nr_of_boards rows of one bucket per combo
+};
+
+struct File_Header {
+    std::uint32_t magic;
+    std::uint32_t version;
+    std::uint32_t id;                 // checksum of the buckets, tells tables apart
+    std::uint32_t reserved;
+    Street_Header streets[nr_of_streets];
+};
+
+struct Hash_Entry {
+    std::uint64_t board_mask;         // 0 for an empty slot
+    std::uint32_t board;
+    std::uint32_t reserved;
+};
+
+inline std::size_t hash_slot(std::uint64_t board_mask, std::uint32_t hash_bits) {
+    return (board_mask * 0x9E3779B97F4A7C15ull) >> (64 - hash_bits);
+}
+
+// A board with its suits renamed in order of the ranks they hold, so boards that differ only by a suit
+// permutation become the same board. Suits with the same ranks may be renamed either way, which gives
+// the same board too.
+struct Canonical_Board {
+    std::uint64_t mask{0};
+    std::array<std::uint8_t, 4> suit_map{};
+    std::array<std::uint16_t, 4> suit_ranks{};  // board ranks of each new suit, equal ones are interchangeable
+
+    std::uint8_t map(std::uint8_t card) const {
+        return static_cast<std::uint8_t>((card & ~3) | suit_map[card & 3]);
+    }
+
+    // Maps hole cards like map() but hands the interchangeable suits to the hole cards from the higher
+    // card down, so isomorphic hands land on the same combo
+    std::array<std::uint8_t, 2> map_hole(const std::uint8_t* hole) const {
+        std::array<std::uint8_t, 2> cards = { std::max(hole[0], hole[1]), std::min(hole[0], hole[1]) };
+        std::array<int, 4> assigned = { -1, -1, -1, -1 };
+        std::array<bool, 4> taken{};
+        for (std::uint8_t& card : cards) {
+            int suit = card & 3;
+            if (assigned[suit] < 0) {
+                int first = suit_map[suit];
+                while (first > 0 && suit_ranks[first - 1] == suit_ranks[suit_map[suit]]) {
+                    first--;
+                }
+                while (taken[first]) {
+                    first++;
+                }
+                assigned[suit] = first;
+                taken[first] = true;
+            }
+            card = static_cast<std::uint8_t>((card & ~3) | assigned[suit]);
+        }
+        return cards;
+    }
+};
+
+inline Canonical_Board canonical_board(const std::uint8_t* board, int nr_of_board_cards) {
+    std::array<std::uint16_t, 4> ranks{};
+    for (int i{0}; i < nr_of_board_cards; i++) {
+        ranks[board[i] & 3] |= 1 << (board[i] >> 2);
+    }
+    std::array<int, 4> order = { 0, 1, 2, 3 };
+    std::stable_sort(order.begin(), order.end(), [&ranks](int a, int b) {
+        return ranks[a] > ranks[b];
+    });
+    Canonical_Board canonical;
+    for (int i{0}; i < 4; i++) {
+        canonical.suit_map[order[i]] = static_cast<std::uint8_t>(i);
+        canonical.suit_ranks[i] = ranks[order[i]];
+    }
+    for (int i{0}; i < nr_of_board_cards; i++) {
+        canonical.mask |= 1ull << canonical.map(board[i]);
+    }
+    return canonical;
+}
+
+struct Board_Class {
+    std::uint64_t mask;
+    std::uint32_t weight;             // boards that map to this one
+};
+
+// Every canonical board of 3, 4 or 5 cards, in mask order
+inline std::vector<Board_Class> canonical_boards(int nr_of_board_cards) {
+    std::unordered_map<std::uint64_t, std::uint32_t> classes;
+    std::array<std::uint8_t, 5> board{};
+    std::array<int, 5> position{};
+    for (int i{0}; i < nr_of_board_cards; i++) {
+        position[i] = i;
+    }
+    while (true) {
+        for (int i{0}; i < nr_of_board_cards; i++) {
+            board[i] = static_cast<std::uint8_t>(position[i]);
+        }
+        classes[canonical_board(board.data(), nr_of_board_cards).mask]++;
+        int i = nr_of_board_cards - 1;
+        while (i >= 0 && position[i] == 52 - nr_of_board_cards + i) {
+            i--;
+        }
+        if (i < 0) {
+            break;
+        }
+        position[i]++;
+        for (int j{i + 1}; j < nr_of_board_cards; j++) {
+            position[j] = position[j - 1] + 1;
+        }
+    }
+    std::vector<Board_Class> boards;
+    for (const auto& entry : classes) {
+        boards.push_back({ entry.first, entry.second });
+    }
+    std::sort(boards.begin(), boards.end(), [](const Board_Class& a, const Board_Class& b) {
+        return a.mask < b.mask;
+    });
+    return boards;
+}
+
+inline int board_cards(std::uint64_t mask, std::uint8_t* cards) {
+    int count{0};
+    for (; mask != 0; mask &= mask - 1) {
+        cards[count++] = static_cast<std::uint8_t>(__builtin_ctzll(mask));
+    }
+    return count;
+}
+
+// The quantized (EHS, EHS²) cell of every combo on the board, no_cell for combos the board blocks.
+// Each river completion is one Board_Strengths sweep that scores all combos at once.
+inline void board_cells(std::uint64_t board_mask, std::uint16_t* cells) {
+    static const Ranges::Range everyone = Ranges::uniform_range(0);
+    std::uint8_t board[5];
+    int nr_of_board_cards = board_cards(board_mask, board);
+    std::vector<double> sums(Ranges::nr_of_combos, 0.0);
+    std::vector<double> square_sums(Ranges::nr_of_combos, 0.0);
+    std::vector<int> counts(Ranges::nr_of_combos, 0);
+    std::array<float, Ranges::nr_of_combos> balance{};
+    std::array<float, Ranges::nr_of_combos> possible{};
+
+    auto score = [&](const std::uint8_t* river_board) {
+        Ranges::Board_Strengths strengths(river_board);
+        strengths.showdown_balance(everyone.data(), balance.data());
+        strengths.possible_weight(everyone.data(), possible.data());
+        for (int i{0}; i < strengths.nr_of_valid; i++) {
+            int combo = strengths.sorted[i].combo;
+            double strength = 0.5 * (balance[combo] + possible[combo]) / possible[combo];
+            sums[combo] += strength;
+            square_sums[combo] += strength * strength;
+            counts[combo]++;
+        }
+    };
+    if (nr_of_board_cards == 5) {
+        score(board);
+    } else if (nr_of_board_cards == 4) {
+        for (std::uint8_t river{0}; river < 52; river++) {
+            if (!(board_mask >> river & 1)) {
+                board[4] = river;
+                score(board);
+            }
+        }
+    } else {
+        for (std::uint8_t turn{0}; turn < 52; turn++) {
+            for (std::uint8_t river{static_cast<std::uint8_t>(turn + 1)}; river < 52; river++) {
+                if (!(board_mask >> turn & 1) && !(board_mask >> river & 1)) {
+                    board[3] = turn;
+                    board[4] = river;
+                    score(board);
+                }
+            }
+        }
+    }
+    for (int combo{0}; combo < Ranges::nr_of_combos; combo++) {
+        if (counts[combo] == 0) {
+            cells[combo] = no_cell;
+            continue;
+        }
+        int ehs = std::min(grid - 1, static_cast<int>(sums[combo] / counts[combo] * grid));
+        int ehs_squared = std::min(grid - 1, static_cast<int>(square_sums[combo] / counts[combo] * grid));
+        cells[combo] = static_cast<std::uint16_t>(ehs * grid + ehs_squared);
+    }
+}
+
+// Weighted k-means over the occupied grid cells, with the assignment step split across threads.
+// Returns the bucket of every cell, buckets numbered from the weakest centroid to the strongest.
+inline std::vector<std::uint8_t> cluster_cells(const std::vector<double>& cell_weights, int nr_of_buckets,
+                                               unsigned nr_of_threads, std::uint64_t seed) {
+    struct Point { float x, y; double weight; int cell; };
+    std::vector<Point> points;
+    for (int cell{0}; cell < grid * grid; cell++) {
+        if (cell_weights[cell] > 0) {
+            points.push_back({ (cell / grid + 0.5f) / grid, (cell % grid + 0.5f) / grid, cell_weights[cell], cell });
+        }
+    }
+    std::vector<std::uint8_t> buckets(grid * grid, no_bucket);
+    if (points.empty()) {
+        return buckets;
+    }
+    int k = std::min<int>(nr_of_buckets, points.size());
+    auto distance = [](const Point& point, const std::array<float, 2>& centroid) {
+        float dx = point.x - centroid[0];
+        float dy = point.y - centroid[1];
+        return dx * dx + dy * dy;
+    };
+
+    // k-means++ seeding
+    Cards::Session_Rng rng(seed);
+    std::uniform_real_distribution<double> uniform(0.0, 1.0);
+    std::vector<std::array<float, 2>> centroids;
+    std::vector<double> nearest(points.size(), std::numeric_limits<double>::max());
+    double total_weight{0};
+    for (const Point& point : points) {
+        total_weight += point.weight;
+    }
+    double draw = uniform(rng) * total_weight;
+    std::size_t chosen{0};
+    for (; chosen + 1 < points.size() && (draw -= points[chosen].weight) > 0; chosen++) {}
+    centroids.push_back({ points[chosen].x, points[chosen].y });
+    while (static_cast<int>(centroids.size()) < k) {
+        double total{0};
+        for (std::size_t i{0}; i < points.size(); i++) {
+            nearest[i] = std::min<double>(nearest[i], distance(points[i], centroids.back()));
+            total += points[i].weight * nearest[i];
+        }
+        if (total <= 0) {
+            break;
+        }
+        draw = uniform(rng) * total;
+        for (chosen = 0; chosen + 1 < points.size() && (draw -= points[chosen].weight * nearest[chosen]) > 0; chosen++) {}
+        centroids.push_back({ points[chosen].x, points[chosen].y });
+    }
+    k = centroids.size();
+
+    // Lloyd iterations: threads assign slices of the points and keep their own sums
+    std::vector<int> assignment(points.size(), -1);
+    for (int iteration{0}; iteration < 100; iteration++) {
+        std::vector<std::array<double, 3>> sums(k, { 0.0, 0.0, 0.0 });
+        std::atomic<std::size_t> changed{0};
+        std::mutex merge;
+        auto work = [&](unsigned thread) {
+            std::vector<std::array<double, 3>> local(k, { 0.0, 0.0, 0.0 });
+            std::size_t local_changed{0};
+            std::size_t first = points.size() * thread / nr_of_threads;
+            std::size_t last = points.size() * (thread + 1) / nr_of_threads;
+            for (std::size_t i{first}; i < last; i++) {
+                int best{0};
+                float best_distance = distance(points[i], centroids[0]);
+                for (int c{1}; c < k; c++) {
+                    float d = distance(points[i], centroids[c]);
+                    if (d < best_distance) {
+                        best_distance = d;
+                        best = c;
+                    }
+                }
+                local_changed += assignment[i] != best;
+                assignment[i] = best;
+                local[best][0] += points[i].weight * points[i].x;
+                local[best][1] += points[i].weight * points[i].y;
+                local[best][2] += points[i].weight;
+            }
+            changed += local_changed;
+            std::lock_guard<std::mutex> lock(merge);
+            for (int c{0}; c < k; c++) {
+                for (int j{0}; j < 3; j++) {
+                    sums[c][j] += local[c][j];
+                }
+            }
+        };
+        std::vector<std::thread> workers;
+        for (unsigned t{1}; t < nr_of_threads; t++) {
+            workers.emplace_back(work, t);
+        }
+        work(0);
+        for (auto& worker : workers) {
+            worker.join();
+        }
+        for (int c{0}; c < k; c++) {
+            if (sums[c][2] > 0) {
+                centroids[c] = { static_cast<float>(sums[c][0] / sums[c][2]), static_cast<float>(sums[c][1] / sums[c][2]) };
+            }
+        }
+        if (changed == 0) {
+            break;
+        }
+    }
+
+    std::vector<int> order(k);
+    for (int c{0}; c < k; c++) {
+        order[c] = c;
+    }
+    std::sort(order.begin(), order.end(), [&centroids](int a, int b) {
+        return centroids[a] < centroids[b];
+    });
+    std::vector<std::uint8_t> rank_of(k);
+    for (int r{0}; r < k; r++) {
+        rank_of[order[r]] = static_cast<std::uint8_t>(r);
+    }
+    for (std::size_t i{0}; i < points.size(); i++) {
+        buckets[points[i].cell] = rank_of[assignment[i]];
+    }
+    return buckets;
+}
+
+// Builds the bucket table. The cells of each street are computed in chunks of boards that are written
+// to a work file next to the table as they finish; a second file marks the finished chunks, so an
+// interrupted build continues where it stopped. The work files are removed once the table is written.
+class Builder {
+private:
+    std::string path;
+    int nr_of_buckets;
+    unsigned nr_of_threads;
+
+    std::string work_path(int street) const {
+        return path + ".street" + std::to_string(street + 1) + ".cells";
+    }
+
+    std::string progress_path(int street) const {
+        return work_path(street) + ".done";
+    }
+
+    // Computes the cells of the boards of a street that no earlier run finished
+    void compute_cells(int street, const std::vector<Board_Class>& boards) const {
+        std::size_t nr_of_chunks = (boards.size() + chunk_boards - 1) / chunk_boards;
+        int cells_file = ::open(work_path(street).c_str(), O_RDWR | O_CREAT, 0644);
+        int progress_file = ::open(progress_path(street).c_str(), O_RDWR | O_CREAT, 0644);
+        if (cells_file < 0 || progress_file < 0
+            || ftruncate(cells_file, boards.size() * Ranges::nr_of_combos * sizeof(std::uint16_t)) != 0
+            || ftruncate(progress_file, nr_of_chunks) != 0) {
+            if (cells_file >= 0) {
+                ::close(cells_file);
+            }
+            if (progress_file >= 0) {
+                ::close(progress_file);
+            }
+            throw std::runtime_error("Could not create the work files of " + path);
+        }
+        std::vector<std::uint8_t> done(nr_of_chunks, 0);
+        bool read = pread(progress_file, done.data(), nr_of_chunks, 0) == static_cast<ssize_t>(nr_of_chunks);
+
+        std::atomic<std::size_t> next_chunk{0};
+        std::atomic<bool> failed{!read};
+        auto work = [&]() {
+            std::vector<std::uint16_t> cells(chunk_boards * Ranges::nr_of_combos);
+            for (std::size_t chunk = next_chunk++; chunk < nr_of_chunks && !failed; chunk = next_chunk++) {
+                if (done[chunk]) {
+                    continue;
+                }
+                std::size_t first = chunk * chunk_boards;
+                std::size_t last = std::min(boards.size(), first + chunk_boards);
+                for (std::size_t board{first}; board < last; board++) {
+                    board_cells(boards[board].mask, &cells[(board - first) * Ranges::nr_of_combos]);
+                }
+                std::size_t bytes = (last - first) * Ranges::nr_of_combos * sizeof(std::uint16_t);
+                std::uint8_t finished{1};
+                if (pwrite(cells_file, cells.data(), bytes, first * Ranges::nr_of_combos * sizeof(std::uint16_t)) != static_cast<ssize_t>(bytes)
+                    || pwrite(progress_file, &finished, 1, chunk) != 1) {
+                    failed = true;
+                }
+            }
+        };
+        std::vector<std::thread> workers;
+        for (unsigned t{1}; t < nr_of_threads; t++) {
+            workers.emplace_back(work);
+        }
+        work();
+        for (auto& worker : workers) {
+            worker.join();
+        }
+        ::close(progress_file);
+        if (::close(cells_file) != 0 || failed) {
+            throw std::runtime_error("Could not write the work files of " + path);
+        }
+    }
+
+public:
+    Builder(const std::string& i_path, int i_nr_of_buckets, unsigned i_nr_of_threads)
+        : path(i_path), nr_of_buckets(i_nr_of_buckets), nr_of_threads(std::max(1u, i_nr_of_threads)) {
+        if (nr_of_buckets < 2 || nr_of_buckets > max_buckets) {
+            throw std::invalid_argument("The number of buckets must be between 2 and 255.");
+        }
+    }
+
+    void build() {
+        std::string temporary_path = path + ".tmp";
+        std::FILE* file = std::fopen(temporary_path.c_str(), "wb");
+        if (file == nullptr) {
+            throw std::runtime_error("Could not open " + temporary_path + " for writing.");
+        }
+        std::setvbuf(file, nullptr, _IOFBF, 1 << 20);
+        File_Header header{};
+        header.magic = file_magic;
+        header.version = file_version;
+        bool written = std::fwrite(&header, sizeof(header), 1, file) == 1;
+        std::uint32_t checksum = 2166136261u;
+
+        for (int street{0}; street < nr_of_streets && written; street++) {
+            auto start = std::chrono::steady_clock::now();
+            std::vector<Board_Class> boards = canonical_boards(street + 3);
+            compute_cells(street, boards);
+
+            std::vector<std::uint16_t> cells(Ranges::nr_of_combos);
+            std::vector<double> cell_weights(grid * grid, 0.0);
+            std::FILE* work_file = std::fopen(work_path(street).c_str(), "rb");
+            if (work_file == nullptr) {
+                std::fclose(file);
+                throw std::runtime_error("Could not read the work file " + work_path(street));
+            }
+            for (const Board_Class& board : boards) {
+                written = written && std::fread(cells.data(), sizeof(std::uint16_t), cells.size(), work_file) == cells.size();
+                for (std::uint16_t cell : cells) {
+                    if (cell != no_cell) {
+                        cell_weights[cell] += board.weight;
+                    }
+                }
+            }
+            std::vector<std::uint8_t> cell_buckets = cluster_cells(cell_weights, nr_of_buckets, nr_of_threads, 0xB0C + street);
+
+            Street_Header& section = header.streets[street];
+            section.nr_of_buckets = nr_of_buckets;
+            section.nr_of_boards = boards.size();
+            section.hash_bits = 1;
+            while ((std::size_t{1} << section.hash_bits) < 2 * boards.size()) {
+                section.hash_bits++;
+            }
+            std::vector<Hash_Entry> hash(std::size_t{1} << section.hash_bits, Hash_Entry{ 0, 0, 0 });
+            for (std::size_t board{0}; board < boards.size(); board++) {
+                std::size_t slot = hash_slot(boards[board].mask, section.hash_bits);
+                while (hash[slot].board_mask != 0) {
+                    slot = (slot + 1) & (hash.size() - 1);
+                }
+                hash[slot] = { boards[board].mask, static_cast<std::uint32_t>(board), 0 };
+            }
+            section.hash_offset = std::ftell(file);
+            written = written && std::fwrite(hash.data(), sizeof(Hash_Entry), hash.size(), file) == hash.size();
+            section.buckets_offset = std::ftell(file);
+            std::rewind(work_file);
+            std::vector<std::uint8_t> row(Ranges::nr_of_combos);
+            for (std::size_t board{0}; board < boards.size() && written; board++) {
+                written = std::fread(cells.data(), sizeof(std::uint16_t), cells.size(), work_file) == cells.size();
+                for (int combo{0}; combo < Ranges::nr_of_combos; combo++) {
+                    row[combo] = cells[combo] == no_cell ? no_bucket : cell_buckets[cells[combo]];
+                    checksum = (checksum ^ row[combo]) * 16777619u;
+                }
+                written = written && std::fwrite(row.data(), 1, row.size(), file) == row.size();
+            }
+            std::fclose(work_file);
+            double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            std::cout << (street == 0 ? "flop" : (street == 1 ? "turn" : "river")) << ": " << boards.size()
+                      << " canonical boards in " << nr_of_buckets << " buckets, " << seconds << " s" << std::endl;
+        }
+
+        header.id = checksum == 0 ? 1 : checksum;
+        written = written && std::fseek(file, 0, SEEK_SET) == 0 && std::fwrite(&header, sizeof(header), 1, file) == 1;
+        written = std::fclose(file) == 0 && written;
+        if (!written || std::rename(temporary_path.c_str(), path.c_str()) != 0) {
+            throw std::runtime_error("Could not save the bucket table to " + path);
+        }
+        for (int street{0}; street < nr_of_streets; street++) {
+            std::remove(work_path(street).c_str());
+            std::remove(progress_path(street).c_str());
+        }
+    }
+};
+
+// A bucket table mapped read only. Looking a bucket up is one hash probe for the canonical board and
+// one byte read for the combo.
+class Bucket_Table {
+private:
+    const char* data{nullptr};
+    std::size_t size{0};
+    const File_Header* header{nullptr};
+
+public:
+    explicit Bucket_Table(const std::string& path) {
+        int descriptor = ::open(path.c_str(), O_RDONLY);
+        if (descriptor < 0) {
+            throw std::runtime_error("Could not open the bucket table " + path);
+        }
+        struct stat file_info;
+        if (fstat(descriptor, &file_info) != 0 || file_info.st_size < static_cast<off_t>(sizeof(File_Header))) {
+            ::close(descriptor);
+            throw std::runtime_error(path + " is not a bucket table.");
+        }
+        size = file_info.st_size;
+        void* mapped = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, descriptor, 0);
+        ::close(descriptor);
+        if (mapped == MAP_FAILED) {
+            throw std::runtime_error("Could not map the bucket table " + path);
+        }
+        madvise(mapped, size, MADV_RANDOM);
+        data = static_cast<const char*>(mapped);
+        header = reinterpret_cast<const File_Header*>(data);
+        bool valid = header->magic == file_magic && header->version == file_version;
+        for (int street{0}; street < nr_of_streets && valid; street++) {
+            const Street_Header& section = header->streets[street];
+            valid = section.hash_bits > 0 && section.hash_bits < 32
+                 && section.hash_offset + (sizeof(Hash_Entry) << section.hash_bits) <= size
+                 && section.buckets_offset + std::uint64_t{section.nr_of_boards} * Ranges::nr_of_combos <= size;
+        }
+        if (!valid) {
+            munmap(mapped, size);
+            throw std::runtime_error(path + " is not a bucket table of this version.");
+        }
+    }
+
+    Bucket_Table(const Bucket_Table&) = delete;
+    Bucket_Table& operator=(const Bucket_Table&) = delete;
+
+    ~Bucket_Table() {
+        munmap(const_cast<char*>(data), size);
+    }
+
+    std::uint32_t id() const { return header->id; }
+    int nr_of_buckets(int street) const { return header->streets[street - 1].nr_of_buckets; }
+
+    // Bucket of the hole cards on a flop (street 1), turn (2) or river (3) board, -1 if there is none
+    int bucket(int street, const std::uint8_t* hole, const std::uint8_t* board) const {
+        if (street < 1 || street > nr_of_streets) {
+            return -1;
+        }
+        const Street_Header& section = header->streets[street - 1];
+        Canonical_Board canonical = canonical_board(board, street + 2);
+        const Hash_Entry* hash = reinterpret_cast<const Hash_Entry*>(data + section.hash_offset);
+        std::size_t mask = (std::size_t{1} << section.hash_bits) - 1;
+        for (std::size_t slot = hash_slot(canonical.mask, section.hash_bits); hash[slot].board_mask != 0; slot = (slot + 1) & mask) {
+            if (hash[slot].board_mask == canonical.mask) {
+                std::array<std::uint8_t, 2> cards = canonical.map_hole(hole);
+                int combo = Ranges::combo_index(cards[0], cards[1]);
+                std::uint8_t value = static_cast<std::uint8_t>(data[section.buckets_offset + std::uint64_t{hash[slot].board} * Ranges::nr_of_combos + combo]);
+                return value == no_bucket ? -1 : value;
+            }
+        }
+        return -1;
+    }
+};
+
+} // namespace Buckets end
+
+
+// Heads-up counterfactual regret minimization on an abstracted game, used to train the impossible bots.
+// Cards are bucketed (169 starting hand classes before the flop, made hand category and top rank or the
+// buckets of a bucket table after)
+// and raises are limited to a few pot fractions plus all in.
+namespace Cfr {
+
+constexpr int max_actions = 6;
+constexpr int max_bet_fractions = 3;
+constexpr int chips_per_bb = 100;
+constexpr int nr_of_buckets = 169;
+constexpr float response_regret_threshold = 5.0f;  // big blinds
+constexpr std::uint32_t checkpoint_magic = 0x52464350;  // "PCFR"
+constexpr std::uint32_t blueprint_magic = 0x50424650;   // "PFBP"
+constexpr std::uint32_t file_version = 1;
+
+struct Abstraction {
+    std::array<float, max_bet_fractions> bet_fractions{ 0.5f, 1.0f, 0.0f };  // raise sizes as pot fractions, 0 = unused
+    int nr_of_bet_fractions{2};
+    int max_raises_per_street{2};
+    int stack_bb{50};
+    const Buckets::Bucket_Table* card_buckets{nullptr};  // EHS buckets after the flop instead of hand categories
+};
+
+// Card bucket of a player from the cards visible on the street
+inline int bucket(int street, const std::uint8_t* hole, const std::uint8_t* board, const Buckets::Bucket_Table* card_buckets = nullptr) {
+    if (street == Game_State::preflop) {
+        return Push_Fold::hand_class(hole[0], hole[1]);
+    }
+    if (card_buckets != nullptr) {
+        return std::max(0, card_buckets->bucket(std::min(street, 3), hole, board));
+    }
+    int nr_of_board_cards = std::min(street + 2, 5);
+    std::uint8_t cards[7] = { hole[0], hole[1] };
+    for (int i{0}; i < nr_of_board_cards; i++) {
+        cards[2 + i] = board[i];
+    }
+    Eval::Strength strength = Eval::evaluate(cards, 2 + nr_of_board_cards);
+    int top_rank = (strength >> 16) & 15;
+    return Eval::category(strength) * 3 + (top_rank < 5 ? 0 : (top_rank < 10 ? 1 : 2));
+}
+
+// Info set key: bucket in bits 0-7, street in 8-10, position in 11, facing a bet in 12,
+// a hash of the betting history above and bit 63 always set so no key is 0
+inline std::uint64_t info_set_key(std::uint64_t history, int bucket, int street, int position, bool facing_bet) {
+    return (history & ~0x1FFFull) | 1ull << 63 | static_cast<std::uint64_t>(facing_bet) << 12
+         | static_cast<std::uint64_t>(position) << 11 | static_cast<std::uint64_t>(street) << 8 | static_cast<std::uint64_t>(bucket);
+}
+
+inline std::uint64_t extend_history(std::uint64_t history, int action, int street) {
+    history ^= static_cast<std::uint64_t>(action + 1 + 8 * street);
+    history *= 0x9E3779B97F4A7C15ull;
+    return history ^ (history >> 29);
+}
+
+// The abstract actions of the player to act: fold/check/call, the pot fractions and all in
+inline int abstract_actions(const Game_State& state, const Abstraction& abstraction, int raises_this_street, Action* out) {
+    int count{0};
+    int seat = state.to_act;
+    int to_call = state.amount_to_call(seat);
+    if (state.committed[seat] < state.level) {
+        out[count++] = { Action_Type::fold, 0 };
+        out[count++] = { Action_Type::call, 0 };
+    } else {
+        out[count++] = { Action_Type::check, 0 };
+    }
+    if (raises_this_street >= abstraction.max_raises_per_street || state.chips[seat] <= to_call) {
+        return count;
+    }
+    int min_to = state.min_raise_to();
+    int max_to = state.max_raise_to();
+    int last_to{0};
+    for (int i{0}; i < abstraction.nr_of_bet_fractions; i++) {
+        int to = state.level - state.street_start_level + static_cast<int>(abstraction.bet_fractions[i] * (state.pot + to_call));
+        to = std::clamp(to, min_to, max_to);
+        if (to > last_to && to < max_to) {
+            out[count++] = { Action_Type::raise, to };
+            last_to = to;
+        }
+    }
+    out[count++] = { Action_Type::raise, max_to };
+    return count;
+}
+
+// Open addressing table of info sets shared by all training threads without locks. Slots are claimed with
+// a compare and swap on the key; regrets and strategy sums are updated with relaxed loads and stores,
+// so concurrent updates of the same info set may occasionally lose one, which sampling CFR tolerates.
+// The action count of a slot is published by its winning thread after the claim, 0 until then.
+class Strategy_Table {
+private:
+    std::size_t mask;
+    std::unique_ptr<std::atomic<std::uint64_t>[]> keys;
+    std::unique_ptr<std::atomic<std::uint8_t>[]> action_counts;
+    std::unique_ptr<std::atomic<float>[]> regrets;
+    std::unique_ptr<std::atomic<float>[]> strategy_sums;
+    std::atomic<std::size_t> used{0};
+
+    static std::size_t slot_hash(std::uint64_t key) {
+        key ^= key >> 31;
+        key *= 0xBF58476D1CE4E5B9ull;
+        return static_cast<std::size_t>(key ^ (key >> 29));
+    }
+
+public:
+    explicit Strategy_Table(int table_bits)
+        : mask((std::size_t{1} << table_bits) - 1),
+          keys(new std::atomic<std::uint64_t>[mask + 1]),
+          action_counts(new std::atomic<std::uint8_t>[mask + 1]),
+          regrets(new std::atomic<float>[(mask + 1) * max_actions]),
+          strategy_sums(new std::atomic<float>[(mask + 1) * max_actions]) {
+        for (std::size_t i{0}; i <= mask; i++) {
+            keys[i].store(0, std::memory_order_relaxed);
+            action_counts[i].store(0, std::memory_order_relaxed);
+        }
+        for (std::size_t i{0}; i < (mask + 1) * max_actions; i++) {
+            regrets[i].store(0, std::memory_order_relaxed);
+            strategy_sums[i].store(0, std::memory_order_relaxed);
+        }
+    }
+
+    std::size_t capacity() const { return mask + 1; }
+    std::size_t size() const { return used.load(std::memory_order_relaxed); }
+
+    // Slot of the info set, -1 when it was never visited
+    std::int64_t find(std::uint64_t key) const {
+        for (std::size_t probe{0}, slot = slot_hash(key) & mask; probe <= mask; probe++, slot = (slot + 1) & mask) {
+            std::uint64_t found = keys[slot].load(std::memory_order_acquire);
+            if (found == key) {
+                return static_cast<std::int64_t>(slot);
+            }
+            if (found == 0) {
+                return -1;
+            }
+        }
+        return -1;
+    }
+
+    std::size_t find_or_insert(std::uint64_t key, int nr_of_actions) {
+        for (std::size_t probe{0}, slot = slot_hash(key) & mask; probe <= mask; probe++, slot = (slot + 1) & mask) {
+            std::uint64_t found = keys[slot].load(std::memory_order_acquire);
+            if (found == key) {
+                return slot;
+            }
+            if (found == 0) {
+                if (keys[slot].compare_exchange_strong(found, key, std::memory_order_acq_rel)) {
+                    action_counts[slot].store(static_cast<std::uint8_t>(nr_of_actions), std::memory_order_release);
+                    used.fetch_add(1, std::memory_order_relaxed);
+                    return slot;
+                }
+                if (found == key) {
+                    return slot;
+                }
+            }
+        }
+        throw std::length_error("The CFR strategy table is full, train with more table bits.");
+    }
+
+    std::uint64_t key_at(std::size_t slot) const { return keys[slot].load(std::memory_order_acquire); }
+    // Waits out the moment between another thread claiming the slot and publishing its action count
+    int actions_at(std::size_t slot) const {
+        std::uint8_t count;
+        while ((count = action_counts[slot].load(std::memory_order_acquire)) == 0) {
+            std::this_thread::yield();
+        }
+        return count;
+    }
+    std::atomic<float>* regrets_at(std::size_t slot) { return &regrets[slot * max_actions]; }
+    std::atomic<float>* strategy_sums_at(std::size_t slot) { return &strategy_sums[slot * max_actions]; }
+    const std::atomic<float>* strategy_sums_at(std::size_t slot) const { return &strategy_sums[slot * max_actions]; }
+
+    // Regret matching: play in proportion to the positive regrets, uniformly when there are none
+    void current_strategy(std::size_t slot, int nr_of_actions, float* out) const {
+        float total{0};
+        for (int a{0}; a < nr_of_actions; a++) {
+            out[a] = std::max(0.0f, regrets[slot * max_actions + a].load(std::memory_order_relaxed));
+            total += out[a];
+        }
+        for (int a{0}; a < nr_of_actions; a++) {
+            out[a] = total > 0 ? out[a] / total : 1.0f / nr_of_actions;
+        }
+    }
+
+    // The average strategy, which is what converges to the equilibrium
+    void average_strategy(std::uint64_t key, int nr_of_actions, float* out) const {
+        std::int64_t slot = find(key);
+        float total{0};
+        for (int a{0}; a < nr_of_actions; a++) {
+            out[a] = slot < 0 ? 0 : strategy_sums[slot * max_actions + a].load(std::memory_order_relaxed);
+            total += out[a];
+        }
+        for (int a{0}; a < nr_of_actions; a++) {
+            out[a] = total > 0 ? out[a] / total : 1.0f / nr_of_actions;
+        }
+    }
+};
+
+inline int sample_action(const float* strategy, int nr_of_actions, Cards::Session_Rng& rng) {
+    float target = static_cast<float>(rng() >> 40) * 0x1.0p-24f;
+    for (int a{0}; a < nr_of_actions - 1; a++) {
+        target -= strategy[a];
+        if (target < 0) {
+            return a;
+        }
+    }
+    return nr_of_actions - 1;
+}
+
+// What the bots use: the average strategy of every info set folded into fold / passive / aggressive
+// probabilities per street, bucket and whether the bot faces a bet
+struct Blueprint {
+    std::vector<float> probabilities = std::vector<float>(4 * nr_of_buckets * 2 * 3, 0.0f);
+    std::vector<float> weights = std::vector<float>(4 * nr_of_buckets * 2, 0.0f);
+    std::uint32_t card_buckets{0};  // id of the bucket table it was trained with, 0 for hand categories
+
+    static constexpr int fold = 0;
+    static constexpr int passive = 1;
+    static constexpr int aggressive = 2;
+
+    float probability(int street, int bucket, bool facing_bet, int kind) const {
+        int cell = (std::clamp(street, 0, 3) * nr_of_buckets + bucket) * 2 + (facing_bet ? 1 : 0);
+        if (weights[cell] <= 0) {
+            // never reached in training: check or call most of the time
+            const float fallback[2][3] = { { 0.0f, 0.75f, 0.25f }, { 0.3f, 0.55f, 0.15f } };
+            return fallback[facing_bet ? 1 : 0][kind];
+        }
+        return probabilities[cell * 3 + kind];
+    }
+
+    static Blueprint from_table(const Strategy_Table& table) {
+        Blueprint blueprint;
+        for (std::size_t slot{0}; slot < table.capacity(); slot++) {
+            std::uint64_t key = table.key_at(slot);
+            if (key == 0) {
+                continue;
+            }
+            int bucket = key & 0xFF;
+            int street = (key >> 8) & 7;
+            bool facing_bet = (key >> 12) & 1;
+            int cell = (street * nr_of_buckets + bucket) * 2 + (facing_bet ? 1 : 0);
+            const std::atomic<float>* sums = table.strategy_sums_at(slot);
+            for (int a{0}; a < table.actions_at(slot); a++) {
+                float sum = sums[a].load(std::memory_order_relaxed);
+                int kind = facing_bet ? std::min(a, 2) : (a == 0 ? passive : aggressive);
+                blueprint.probabilities[cell * 3 + kind] += sum;
+                blueprint.weights[cell] += sum;
+            }
+        }
+        for (std::size_t cell{0}; cell < blueprint.weights.size(); cell++) {
+            for (int kind{0}; kind < 3 && blueprint.weights[cell] > 0; kind++) {
+                blueprint.probabilities[cell * 3 + kind] /= blueprint.weights[cell];
+            }
+        }
+        return blueprint;
+    }
+
+    void save(const std::string& path) const {
+        std::string temporary_path = path + ".tmp";
+        std::FILE* file = std::fopen(temporary_path.c_str(), "wb");
+        if (file == nullptr) {
+            throw std::runtime_error("Could not open " + temporary_path + " for writing.");
+        }
+        std::uint32_t header[2] = { blueprint_magic, file_version };
+        bool written = std::fwrite(header, sizeof(header), 1, file) == 1
+                    && std::fwrite(probabilities.data(), sizeof(float), probabilities.size(), file) == probabilities.size()
+                    && std::fwrite(weights.data(), sizeof(float), weights.size(), file) == weights.size()
+                    && std::fwrite(&card_buckets, sizeof(card_buckets), 1, file) == 1;
+        written = std::fclose(file) == 0 && written;
+        if (!written || std::rename(temporary_path.c_str(), path.c_str()) != 0) {
+            throw std::runtime_error("Could not save the blueprint to " + path);
+        }
+    }
+
+    static Blueprint load(const std::string& path) {
+        Blueprint blueprint;
+        std::FILE* file = std::fopen(path.c_str(), "rb");
+        if (file == nullptr) {
+            throw std::runtime_error("Could not open " + path);
+        }
+        std::uint32_t header[2] = {};
+        bool read = std::fread(header, sizeof(header), 1, file) == 1
+                 && std::fread(blueprint.probabilities.data(), sizeof(float), blueprint.probabilities.size(), file) == blueprint.probabilities.size()
+                 && std::fread(blueprint.weights.data(), sizeof(float), blueprint.weights.size(), file) == blueprint.weights.size();
+        // blueprints written before bucket tables existed end here
+        if (std::fread(&blueprint.card_buckets, sizeof(blueprint.card_buckets), 1, file) != 1) {
+            blueprint.card_buckets = 0;
+        }
+        std::fclose(file);
+        if (!read || header[0] != blueprint_magic || header[1] != file_version) {
+            throw std::runtime_error(path + " is not a poker blueprint.");
+        }
+        return blueprint;
+    }
+};
+
+struct Training_Report {
+    std::uint64_t iterations{0};
+    double iterations_per_second{0};
+    double exploitability_mbb{0};  // milli big blinds per hand a trained best response wins, a lower bound
+    std::size_t info_sets{0};
+};
+
+// External sampling MCCFR with regret matching+ (negative regrets are floored at zero) and linearly
+// weighted strategy sums. Each thread deals its own hands and traverses with its own Game_State.
+class Trainer {
+private:
+    Abstraction abstraction;
+    Strategy_Table table;
+    std::atomic<std::uint64_t> iterations_done{0};
+    std::uint64_t seed;
+
+    struct Deal {
+        std::array<std::uint8_t, 4> hole;
+        std::array<std::uint8_t, 5> board;
+        int dealer;
+    };
+
+    static Deal deal(Cards::Session_Rng& rng, int dealer) {
+        std::array<std::uint8_t, 52> deck;
+        for (int i{0}; i < 52; i++) {
+            deck[i] = static_cast<std::uint8_t>(i);
+        }
+        for (int i{0}; i < 9; i++) {
+            int j = i + static_cast<int>(rng() % static_cast<std::uint64_t>(52 - i));
+            std::swap(deck[i], deck[j]);
+        }
+        Deal dealt;
+        std::copy(deck.begin(), deck.begin() + 4, dealt.hole.begin());
+        std::copy(deck.begin() + 4, deck.begin() + 9, dealt.board.begin());
+        dealt.dealer = dealer;
+        return dealt;
+    }
+
+    void start(Game_State& state, const Deal& dealt) const {
+        std::int32_t stacks[2] = { abstraction.stack_bb * chips_per_bb, abstraction.stack_bb * chips_per_bb };
+        state.start_hand(2, stacks, dealt.hole.data(), dealt.board.data(), dealt.dealer, chips_per_bb / 2, chips_per_bb);
+    }
+
+    // Chips won by the seat in big blinds once the hand is over
+    static double utility(const Game_State& state, int seat) {
+        std::array<std::int32_t, Game_State::max_seats> won{};
+        state.settle([&state](int player) {
+            std::uint8_t cards[7] = { state.hole_cards[2 * player], state.hole_cards[2 * player + 1],
+                                      state.board[0], state.board[1], state.board[2], state.board[3], state.board[4] };
+            return Eval::evaluate(cards, 7);
+        }, won);
+        return static_cast<double>(won[seat] - state.committed[seat]) / chips_per_bb;
+    }
+
+    std::uint64_t key_for(const Game_State& state, std::uint64_t history) const {
+        int seat = state.to_act;
+        int street = std::min<int>(state.street, Game_State::river);
+        return info_set_key(history, bucket(street, &state.hole_cards[2 * seat], state.board.data(), abstraction.card_buckets), street,
+                            seat == state.button ? 0 : 1, state.committed[seat] < state.level);
+    }
+
+    // One external sampling traversal for the traverser. With a frozen table the opponent plays its
+    // average strategy instead of learning, which trains a best response against it.
+    double traverse(Game_State& state, Strategy_Table& learner, const Strategy_Table* frozen, int traverser,
+                    std::uint64_t history, int raises, float weight, Cards::Session_Rng& rng) {
+        if (state.hand_is_over()) {
+            return utility(state, traverser);
+        }
+        Action actions[max_actions];
+        int nr_of_actions = abstract_actions(state, abstraction, raises, actions);
+        std::uint64_t key = key_for(state, history);
+        int street = state.street;
+        float strategy[max_actions];
+
+        if (state.to_act != traverser) {
+            if (frozen != nullptr) {
+                frozen->average_strategy(key, nr_of_actions, strategy);
+            } else {
+                std::size_t slot = learner.find_or_insert(key, nr_of_actions);
+                learner.current_strategy(slot, nr_of_actions, strategy);
+                std::atomic<float>* sums = learner.strategy_sums_at(slot);
+                for (int a{0}; a < nr_of_actions; a++) {
+                    sums[a].store(sums[a].load(std::memory_order_relaxed) + weight * strategy[a], std::memory_order_relaxed);
+                }
+            }
+            int a = sample_action(strategy, nr_of_actions, rng);
+            state.apply(actions[a]);
+            int next_raises = state.street != street ? 0 : raises + (actions[a].type == Action_Type::raise ? 1 : 0);
+            double value = traverse(state, learner, frozen, traverser, extend_history(history, a, street), next_raises, weight, rng);
+            state.undo();
+            return value;
+        }
+
+        std::size_t slot = learner.find_or_insert(key, nr_of_actions);
+        learner.current_strategy(slot, nr_of_actions, strategy);
+        double values[max_actions];
+        double node_value{0};
+        for (int a{0}; a < nr_of_actions; a++) {
+            state.apply(actions[a]);
+            int next_raises = state.street != street ? 0 : raises + (actions[a].type == Action_Type::raise ? 1 : 0);
+            values[a] = traverse(state, learner, frozen, traverser, extend_history(history, a, street), next_raises, weight, rng);
+            state.undo();
+            node_value += strategy[a] * values[a];
+        }
+        std::atomic<float>* regrets = learner.regrets_at(slot);
+        for (int a{0}; a < nr_of_actions; a++) {
+            float regret = regrets[a].load(std::memory_order_relaxed) + static_cast<float>(values[a] - node_value);
+            regrets[a].store(std::max(0.0f, regret), std::memory_order_relaxed);
+        }
+        return node_value;
+    }
+
+    // Plays one hand of the response in seat against the average strategy. The response takes the action with
+    // the highest regret where it learned one and plays like the average strategy elsewhere; without a
+    // response both seats play the average strategy.
+    double play_out(Game_State& state, Strategy_Table* response, int seat, std::uint64_t history, int raises, Cards::Session_Rng& rng) const {
+        if (state.hand_is_over()) {
+            return utility(state, seat);
+        }
+        Action actions[max_actions];
+        int nr_of_actions = abstract_actions(state, abstraction, raises, actions);
+        std::uint64_t key = key_for(state, history);
+        float strategy[max_actions];
+        table.average_strategy(key, nr_of_actions, strategy);
+        int a = sample_action(strategy, nr_of_actions, rng);
+        std::int64_t slot = response != nullptr && state.to_act == seat ? response->find(key) : -1;
+        if (slot >= 0) {
+            std::atomic<float>* regrets = response->regrets_at(slot);
+            int best{0};
+            for (int i{1}; i < nr_of_actions; i++) {
+                best = regrets[i].load(std::memory_order_relaxed) > regrets[best].load(std::memory_order_relaxed) ? i : best;
+            }
+            // a deviation needs a clear regret, single noisy samples would make the response weaker
+            a = regrets[best].load(std::memory_order_relaxed) > response_regret_threshold ? best : a;
+        }
+        int street = state.street;
+        state.apply(actions[a]);
+        int next_raises = state.street != street ? 0 : raises + (actions[a].type == Action_Type::raise ? 1 : 0);
+        double value = play_out(state, response, seat, extend_history(history, a, street), next_raises, rng);
+        state.undo();
+        return value;
+    }
+
+    template <typename Work>
+    static void run_threads(unsigned nr_of_threads, Work work) {
+        std::vector<std::thread> workers;
+        for (unsigned t{1}; t < nr_of_threads; t++) {
+            workers.emplace_back(work, t);
+        }
+        work(0);
+        for (auto& worker : workers) {
+            worker.join();
+        }
+    }
+
+public:
+    Trainer(const Abstraction& i_abstraction, int table_bits, std::uint64_t i_seed)
+        : abstraction(i_abstraction), table(table_bits), seed(i_seed) {
+        if (abstraction.nr_of_bet_fractions < 0 || abstraction.nr_of_bet_fractions > max_bet_fractions) {
+            throw std::invalid_argument("The abstraction allows at most 3 bet fractions.");
+        }
+        for (int street{1}; street <= 3 && abstraction.card_buckets; street++) {
+            if (abstraction.card_buckets->nr_of_buckets(street) > nr_of_buckets) {
+                throw std::invalid_argument("The abstraction allows at most 169 buckets per street.");
+            }
+        }
+    }
+
+    std::uint64_t iterations() const { return iterations_done.load(); }
+    const Strategy_Table& strategy_table() const { return table; }
+
+    // Every iteration deals one hand and traverses it once for each player
+    void train(std::uint64_t nr_of_iterations, unsigned nr_of_threads) {
+        std::uint64_t first = iterations_done.load();
+        std::atomic<std::uint64_t> next{first};
+        std::uint64_t last = first + nr_of_iterations;
+        run_threads(nr_of_threads, [&](unsigned thread) {
+            Cards::Session_Rng rng(seed ^ (first * 0x9E3779B97F4A7C15ull) ^ (thread + 1) * 0xD1B54A32D192ED03ull);
+            Game_State state;
+            for (std::uint64_t iteration = next++; iteration < last; iteration = next++) {
+                Deal dealt = deal(rng, iteration & 1);
+                float weight = static_cast<float>(iteration + 1);
+                for (int traverser{0}; traverser < 2; traverser++) {
+                    start(state, dealt);
+                    traverse(state, table, nullptr, traverser, 0, 0, weight, rng);
+                }
+                iterations_done.fetch_add(1, std::memory_order_relaxed);
+            }
+        });
+    }
+
+    // Trains a best response for each seat against the frozen average strategy and measures what it wins.
+    // The response only sees the abstraction and has a limited budget, so this is a lower bound.
+    double estimate_exploitability(int response_iterations, int evaluation_hands, int table_bits, unsigned nr_of_threads) {
+        double total{0};
+        for (int seat{0}; seat < 2; seat++) {
+            Strategy_Table response(table_bits);
+            std::atomic<int> next{0};
+            run_threads(nr_of_threads, [&](unsigned thread) {
+                Cards::Session_Rng rng(seed + 77 * (seat + 1) + thread);
+                Game_State state;
+                for (int iteration = next++; iteration < response_iterations; iteration = next++) {
+                    start(state, deal(rng, iteration & 1));
+                    traverse(state, response, &table, seat, 0, 0, static_cast<float>(iteration + 1), rng);
+                }
+            });
+            // the response and the average strategy itself play the same deals and draws, and only the
+            // difference is counted, which removes most of the card luck from the estimate
+            Cards::Session_Rng rng(seed + 991 * (seat + 1));
+            Game_State state;
+            double won{0};
+            for (int hand{0}; hand < evaluation_hands; hand++) {
+                Deal dealt = deal(rng, hand & 1);
+                std::uint64_t draws = rng();
+                Cards::Session_Rng response_rng(draws);
+                Cards::Session_Rng baseline_rng(draws);
+                start(state, dealt);
+                won += play_out(state, &response, seat, 0, 0, response_rng);
+                start(state, dealt);
+                won -= play_out(state, nullptr, seat, 0, 0, baseline_rng);
+            }
+            total += won / std::max(evaluation_hands, 1);
+        }
+        return 1000 * total / 2;
+    }
+
+    // Checkpoint: header, then every visited info set with its regrets and strategy sums
+    void save_checkpoint(const std::string& path) const {
+        std::string temporary_path = path + ".tmp";
+        std::FILE* file = std::fopen(temporary_path.c_str(), "wb");
+        if (file == nullptr) {
+            throw std::runtime_error("Could not open " + temporary_path + " for writing.");
+        }
+        std::setvbuf(file, nullptr, _IOFBF, 1 << 20);
+        std::uint32_t header[4] = { checkpoint_magic, file_version, static_cast<std::uint32_t>(abstraction.stack_bb),
+                                    static_cast<std::uint32_t>(abstraction.max_raises_per_street) };
+        std::uint64_t counts[2] = { iterations_done.load(), table.size() };
+        bool written = std::fwrite(header, sizeof(header), 1, file) == 1 && std::fwrite(counts, sizeof(counts), 1, file) == 1
+                    && std::fwrite(abstraction.bet_fractions.data(), sizeof(float), max_bet_fractions, file) == max_bet_fractions;
+        Strategy_Table& entries = const_cast<Strategy_Table&>(table);
+        for (std::size_t slot{0}; slot < table.capacity() && written; slot++) {
+            std::uint64_t key = table.key_at(slot);
+            if (key == 0) {
+                continue;
+            }
+            std::uint8_t nr_of_actions = static_cast<std::uint8_t>(table.actions_at(slot));
+            float values[2 * max_actions];
+            for (int a{0}; a < nr_of_actions; a++) {
+                values[a] = entries.regrets_at(slot)[a].load(std::memory_order_relaxed);
+                values[nr_of_actions + a] = entries.strategy_sums_at(slot)[a].load(std::memory_order_relaxed);
+            }
+            written = std::fwrite(&key, sizeof(key), 1, file) == 1 && std::fwrite(&nr_of_actions, 1, 1, file) == 1
+                   && std::fwrite(values, sizeof(float), 2 * nr_of_actions, file) == 2u * nr_of_actions;
+        }
+        std::uint32_t card_buckets = abstraction.card_buckets ? abstraction.card_buckets->id() : 0;
+        written = written && std::fwrite(&card_buckets, sizeof(card_buckets), 1, file) == 1;
+        written = std::fclose(file) == 0 && written;
+        if (!written || std::rename(temporary_path.c_str(), path.c_str()) != 0) {
+            throw std::runtime_error("Could not save the CFR checkpoint to " + path);
+        }
+    }
+
+    // Continues from a checkpoint of the same abstraction, false when there is no checkpoint yet
+    bool load_checkpoint(const std::string& path) {
+        std::FILE* file = std::fopen(path.c_str(), "rb");
+        if (file == nullptr) {
+            return false;
+        }
+        std::uint32_t header[4] = {};
+        std::uint64_t counts[2] = {};
+        std::array<float, max_bet_fractions> fractions{};
+        bool read = std::fread(header, sizeof(header), 1, file) == 1 && std::fread(counts, sizeof(counts), 1, file) == 1
+                 && std::fread(fractions.data(), sizeof(float), max_bet_fractions, file) == max_bet_fractions;
+        if (!read || header[0] != checkpoint_magic || header[1] != file_version) {
+            std::fclose(file);
+            throw std::runtime_error(path + " is not a CFR checkpoint.");
+        }
+        if (header[2] != static_cast<std::uint32_t>(abstraction.stack_bb) || header[3] != static_cast<std::uint32_t>(abstraction.max_raises_per_street)
+            || fractions != abstraction.bet_fractions) {
+            std::fclose(file);
+            throw std::runtime_error(path + " was trained with a different abstraction.");
+        }
+        // the id of the bucket table follows the entries, checkpoints from before bucket tables have none
+        long entries_offset = std::ftell(file);
+        std::uint32_t card_buckets{0};
+        for (std::uint64_t i{0}; i < counts[1] && read; i++) {
+            std::uint64_t key;
+            std::uint8_t nr_of_actions;
+            read = std::fread(&key, sizeof(key), 1, file) == 1 && std::fread(&nr_of_actions, 1, 1, file) == 1
+                && nr_of_actions <= max_actions && std::fseek(file, 2 * nr_of_actions * sizeof(float), SEEK_CUR) == 0;
+        }
+        if (read && std::fread(&card_buckets, sizeof(card_buckets), 1, file) != 1) {
+            card_buckets = 0;
+        }
+        if (card_buckets != (abstraction.card_buckets ? abstraction.card_buckets->id() : 0)) {
+            std::fclose(file);
+            throw std::runtime_error(path + " was trained with a different bucket table.");
+        }
+        std::fseek(file, entries_offset, SEEK_SET);
+        for (std::uint64_t i{0}; i < counts[1] && read; i++) {
+            std::uint64_t key;
+            std::uint8_t nr_of_actions;
+            float values[2 * max_actions];
+            read = std::fread(&key, sizeof(key), 1, file) == 1 && std::fread(&nr_of_actions, 1, 1, file) == 1
+                && nr_of_actions <= max_actions && std::fread(values, sizeof(float), 2 * nr_of_actions, file) == 2u * nr_of_actions;
+            if (read) {
+                std::size_t slot = table.find_or_insert(key, nr_of_actions);
+                for (int a{0}; a < nr_of_actions; a++) {
+                    table.regrets_at(slot)[a].store(values[a], std::memory_order_relaxed);
+                    table.strategy_sums_at(slot)[a].store(values[nr_of_actions + a], std::memory_order_relaxed);
+                }
+            }
+        }
+        std::fclose(file);
+        if (!read) {
+            throw std::runtime_error(path + " is truncated.");
+        }
+        iterations_done.store(counts[0]);
+        return true;
+    }
+
+    Blueprint blueprint() const {
+        Blueprint blueprint = Blueprint::from_table(table);
+        blueprint.card_buckets = abstraction.card_buckets ? abstraction.card_buckets->id() : 0;
+        return blueprint;
+    }
+};
+
+} // namespace Cfr end
+
+
+// Real time river subgame solving: vector CFR+ over a small betting tree, every node works on whole
+// 1326 combo ranges at once, and iterations stop at a deadline
+namespace River {
+
+using Ranges::nr_of_combos;
+using Ranges::Range;
+
+struct River_Spot {
+    std::array<std::uint8_t, 5> board{};
+    int pot{0};                    // chips in the middle before the river betting, facing_bet not included
+    int stack{0};                  // effective chips behind
+    int facing_bet{0};             // the opponent's bet the hero faces, 0 when the hero acts first
+    Range hero_range{};
+    Range villain_range{};         // with three players, the two opponent ranges added together
+    std::array<float, 3> bet_fractions{ 0.75f, 0.0f, 0.0f };  // bet and raise sizes besides all in, 0 = unused
+    int max_raises{2};
+};
+
+struct River_Choice {
+    Action_Type type;
+    int amount;                    // chips the hero puts in with the action
+    float probability;
+};
+
+struct River_Result {
+    std::vector<River_Choice> choices;
+    int iterations{0};
+    double milliseconds{0};
+};
+
+enum class Node_Kind : std::uint8_t { action, fold, showdown };
+
+struct Node {
+    Node_Kind kind{Node_Kind::action};
+    int player{0};                 // to act, or who folded
+    std::array<std::int32_t, 2> contributed{};
+    std::vector<int> children;
+    std::vector<River_Choice> actions;
+    std::vector<float> regrets;        // [action * nr_of_combos + combo]
+    std::vector<float> strategy_sums;
+};
+
+class Subgame {
+private:
+    River_Spot spot;
+    Ranges::Board_Strengths strengths;
+    std::vector<Node> nodes;
+    int max_depth{0};
+    int max_actions{0};
+
+    // Scratch vectors for one tree depth, allocated once so iterations do not allocate
+    struct Scratch {
+        std::vector<float> strategy;       // [action * nr_of_combos + combo]
+        std::vector<float> action_values;
+        std::array<float, nr_of_combos> reach{};
+        std::array<float, nr_of_combos> child_values{};
+        std::array<float, nr_of_combos> totals{};
+    };
+    std::vector<Scratch> scratch;
+
+    int add_terminal(Node_Kind kind, int player, std::int32_t hero, std::int32_t villain) {
+        Node node;
+        node.kind = kind;
+        node.player = player;
+        node.contributed = { hero, villain };
+        nodes.push_back(std::move(node));
+        return nodes.size() - 1;
+    }
+
+    // Builds the tree below a decision of player; checked is set after a check that did not end the betting
+    int build(int player, std::int32_t hero, std::int32_t villain, int raises, bool checked, int depth) {
+        max_depth = std::max(max_depth, depth);
+        int index = nodes.size();
+        nodes.emplace_back();
+        nodes[index].player = player;
+        nodes[index].contributed = { hero, villain };
+        std::array<std::int32_t, 2> contributed = { hero, villain };
+        int opponent = 1 - player;
+        int to_call = contributed[opponent] - contributed[player];
+        std::vector<std::pair<River_Choice, std::array<std::int32_t, 2>>> options;
+
+        if (to_call > 0) {
+            options.push_back({ { Action_Type::fold, 0, 0 }, contributed });
+            std::array<std::int32_t, 2> called = contributed;
+            called[player] = contributed[opponent];
+            options.push_back({ { Action_Type::call, to_call, 0 }, called });
+        } else {
+            options.push_back({ { Action_Type::check, 0, 0 }, contributed });
+        }
+        if (raises < spot.max_raises && contributed[opponent] < spot.stack) {
+            int pot_after_call = spot.pot + 2 * contributed[opponent];
+            int last_to = contributed[opponent];
+            for (float fraction : spot.bet_fractions) {
+                int to = std::min(contributed[opponent] + static_cast<int>(fraction * pot_after_call), spot.stack);
+                if (fraction > 0 && to > last_to && to < spot.stack) {
+                    std::array<std::int32_t, 2> raised = contributed;
+                    raised[player] = to;
+                    options.push_back({ { Action_Type::raise, to - contributed[player], 0 }, raised });
+                    last_to = to;
+                }
+            }
+            std::array<std::int32_t, 2> all_in = contributed;
+            all_in[player] = spot.stack;
+            options.push_back({ { Action_Type::raise, spot.stack - contributed[player], 0 }, all_in });
+        }
+
+        std::vector<int> children;
+        for (const auto& option : options) {
+            const auto& after = option.second;
+            int child{0};
+            if (option.first.type == Action_Type::fold) {
+                child = add_terminal(Node_Kind::fold, player, after[0], after[1]);
+            } else if (option.first.type == Action_Type::call || (option.first.type == Action_Type::check && checked)) {
+                child = add_terminal(Node_Kind::showdown, player, after[0], after[1]);
+            } else if (option.first.type == Action_Type::check) {
+                child = build(opponent, after[0], after[1], raises, true, depth + 1);
+            } else {
+                child = build(opponent, after[0], after[1], raises + 1, false, depth + 1);
+            }
+            children.push_back(child);
+        }
+        max_actions = std::max<int>(max_actions, options.size());
+        Node& node = nodes[index];
+        node.children = children;
+        for (const auto& option : options) {
+            node.actions.push_back(option.first);
+        }
+        node.regrets.assign(options.size() * nr_of_combos, 0.0f);
+        node.strategy_sums.assign(options.size() * nr_of_combos, 0.0f);
+        return index;
+    }
+
+    // Loops run over the combos innermost so the compiler can vectorize them
+    void current_strategy(const Node& node, float* out, float* totals) const {
+        int nr_of_actions = node.actions.size();
+        const float* regrets = node.regrets.data();
+        std::fill(totals, totals + nr_of_combos, 0.0f);
+        for (int a{0}; a < nr_of_actions; a++) {
+            for (int combo{0}; combo < nr_of_combos; combo++) {
+                totals[combo] += regrets[a * nr_of_combos + combo];
+            }
+        }
+        float uniform = 1.0f / nr_of_actions;
+        for (int combo{0}; combo < nr_of_combos; combo++) {
+            totals[combo] = totals[combo] > 0 ? 1.0f / totals[combo] : 0.0f;
+        }
+        for (int a{0}; a < nr_of_actions; a++) {
+            for (int combo{0}; combo < nr_of_combos; combo++) {
+                out[a * nr_of_combos + combo] = totals[combo] > 0 ? regrets[a * nr_of_combos + combo] * totals[combo] : uniform;
+            }
+        }
+    }
+
+    // Counterfactual values of the traverser's combos below the node, written into values
+    void cfr(int index, int traverser, const float* own_reach, const float* opponent_reach, float weight, int depth, float* values) {
+        Node& node = nodes[index];
+        if (node.kind != Node_Kind::action) {
+            float half_pot = spot.pot / 2.0f;
+            if (node.kind == Node_Kind::fold) {
+                strengths.possible_weight(opponent_reach, values);
+                float amount = half_pot + node.contributed[node.player];
+                float sign = node.player == traverser ? -1.0f : 1.0f;
+                for (int combo{0}; combo < nr_of_combos; combo++) {
+                    values[combo] *= sign * amount;
+                }
+            } else {
+                strengths.showdown_balance(opponent_reach, values);
+                float amount = half_pot + node.contributed[0];
+                for (int combo{0}; combo < nr_of_combos; combo++) {
+                    values[combo] *= amount;
+                }
+            }
+            return;
+        }
+
+        int nr_of_actions = node.actions.size();
+        Scratch& local = scratch[depth];
+        float* strategy = local.strategy.data();
+        float* child_values = local.child_values.data();
+        float* reach = local.reach.data();
+        current_strategy(node, strategy, local.totals.data());
+        std::fill(values, values + nr_of_combos, 0.0f);
+
+        if (node.player != traverser) {
+            for (int a{0}; a < nr_of_actions; a++) {
+                for (int combo{0}; combo < nr_of_combos; combo++) {
+                    reach[combo] = opponent_reach[combo] * strategy[a * nr_of_combos + combo];
+                }
+                cfr(node.children[a], traverser, own_reach, reach, weight, depth + 1, child_values);
+                for (int combo{0}; combo < nr_of_combos; combo++) {
+                    values[combo] += child_values[combo];
+                }
+            }
+            return;
+        }
+
+        float* action_values = local.action_values.data();
+        for (int a{0}; a < nr_of_actions; a++) {
+            for (int combo{0}; combo < nr_of_combos; combo++) {
+                reach[combo] = own_reach[combo] * strategy[a * nr_of_combos + combo];
+            }
+            cfr(node.children[a], traverser, reach, opponent_reach, weight, depth + 1, &action_values[a * nr_of_combos]);
+            for (int combo{0}; combo < nr_of_combos; combo++) {
+                values[combo] += strategy[a * nr_of_combos + combo] * action_values[a * nr_of_combos + combo];
+            }
+        }
+        for (int a{0}; a < nr_of_actions; a++) {
+            float* regrets = &node.regrets[a * nr_of_combos];
+            float* sums = &node.strategy_sums[a * nr_of_combos];
+            const float* action_value = &action_values[a * nr_of_combos];
+            const float* probability = &strategy[a * nr_of_combos];
+            for (int combo{0}; combo < nr_of_combos; combo++) {
+                regrets[combo] = std::max(0.0f, regrets[combo] + action_value[combo] - values[combo]);
+                sums[combo] += weight * own_reach[combo] * probability[combo];
+            }
+        }
+    }
+
+public:
+    explicit Subgame(const River_Spot& i_spot) : spot(i_spot), strengths(i_spot.board.data()) {
+        for (int combo{0}; combo < nr_of_combos; combo++) {
+            if (Ranges::combo_mask(combo) & strengths.board_mask) {
+                spot.hero_range[combo] = 0;
+                spot.villain_range[combo] = 0;
+            }
+        }
+        spot.stack = std::max(spot.stack, spot.facing_bet);
+        if (spot.facing_bet > 0) {
+            build(0, 0, spot.facing_bet, 1, false, 0);
+        } else {
+            build(0, 0, 0, 0, false, 0);
+        }
+        scratch.resize(max_depth + 1);
+        for (Scratch& local : scratch) {
+            local.strategy.resize(max_actions * nr_of_combos);
+            local.action_values.resize(max_actions * nr_of_combos);
+        }
+    }
+
+    std::size_t nr_of_nodes() const { return nodes.size(); }
+
+    // Runs CFR+ iterations, alternating the updating player, until the deadline passes
+    River_Result solve(int hero_combo, double deadline_milliseconds, int max_iterations) {
+        auto start = std::chrono::steady_clock::now();
+        auto deadline = start + std::chrono::duration<double, std::milli>(deadline_milliseconds);
+        std::array<float, nr_of_combos> values{};
+        River_Result result;
+        while (result.iterations < max_iterations) {
+            float weight = static_cast<float>(result.iterations + 1);
+            cfr(0, 0, spot.hero_range.data(), spot.villain_range.data(), weight, 0, values.data());
+            cfr(0, 1, spot.villain_range.data(), spot.hero_range.data(), weight, 0, values.data());
+            result.iterations++;
+            if (std::chrono::steady_clock::now() >= deadline) {
+                break;
+            }
+        }
+        const Node& root = nodes[0];
+        float total{0};
+        for (std::size_t a{0}; a < root.actions.size(); a++) {
+            total += root.strategy_sums[a * nr_of_combos + hero_combo];
+        }
+        for (std::size_t a{0}; a < root.actions.size(); a++) {
+            River_Choice choice = root.actions[a];
+            choice.probability = total > 0 ? root.strategy_sums[a * nr_of_combos + hero_combo] / total : 1.0f / root.actions.size();
+            result.choices.push_back(choice);
+        }
+        result.milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        return result;
+    }
+};
+
+} // namespace River end
+
+} // namespace Game end
+
+
+// The coroutine pieces of the table driver further down that the interactive Game needs as well: where a
+// seat's actions come from, the task types a table runs and the table a suspended coroutine waits at
+namespace Driver {
+
+using Game::Action;
+using Game::Action_Type;
+using Game::Game_State;
+
+class Table_Scheduler;
+
+// Where a seat's actions come from. request may deliver at once or later from poll.
+class Input_Source {
+public:
+    virtual ~Input_Source() = default;
+    // Asks for the action of the seat to act at the table, given back with one of Table_Scheduler::deliver
+    virtual void request(Table_Scheduler& scheduler, int table, const Game_State& state) = 0;
+    // Called when no table can run; delivers the answers that arrived, waiting at most timeout_ms for one
+    virtual void poll(Table_Scheduler& scheduler, int timeout_ms) { (void)scheduler; (void)timeout_ms; }
+};
+
+// Coroutine that plays the hands of one table; it starts suspended and the scheduler resumes it
+class Table_Task {
+public:
+    struct promise_type {
+        std::exception_ptr exception;
+
+        Table_Task get_return_object() { return Table_Task(std::coroutine_handle<promise_type>::from_promise(*this)); }
+        std::suspend_always initial_suspend() noexcept { return {}; }
+        std::suspend_always final_suspend() noexcept { return {}; }
+        void return_void() {}
+        void unhandled_exception() { exception = std::current_exception(); }
+    };
+
+private:
+    std::coroutine_handle<promise_type> handle;
+
+public:
+    Table_Task() = default;
+    explicit Table_Task(std::coroutine_handle<promise_type> i_handle) : handle(i_handle) {}
+    Table_Task(Table_Task&& other) noexcept : handle(std::exchange(other.handle, {})) {}
+    Table_Task& operator=(Table_Task&& other) noexcept {
+        if (this != &other) {
+            if (handle) {
+                handle.destroy();
+            }
+            handle = std::exchange(other.handle, {});
+        }
+        return *this;
+    }
+    Table_Task(const Table_Task&) = delete;
+    Table_Task& operator=(const Table_Task&) = delete;
+    ~Table_Task() {
+        if (handle) {
+            handle.destroy();
+        }
+    }
+
+    std::coroutine_handle<> get_handle() const { return handle; }
+    bool is_done() const { return !handle || handle.done(); }
+    // Rethrows what the table's coroutine threw
+    void check() const {
+        if (handle && handle.promise().exception) {
+            std::rethrow_exception(handle.promise().exception);
+        }
+    }
+};
+
+// Value a Task gives back to its caller
+template <typename T>
+struct Task_Value {
+    T value{};
+    void return_value(T result) { value = std::move(result); }
+    T take() { return std::move(value); }
+};
+
+template <>
+struct Task_Value<void> {
+    void return_void() {}
+    void take() {}
+};
+
+// Coroutine that a table's coroutine awaits, for code that waits for input a few calls deep. It starts
+// when awaited and resumes its caller when it finishes, so the nested calls never grow the stack.
+template <typename T = void>
+class Task {
+public:
+    struct promise_type : Task_Value<T> {
+        std::coroutine_handle<> caller;
+        std::exception_ptr exception;
+
+        struct Resume_Caller {
+            bool await_ready() const noexcept { return false; }
+            std::coroutine_handle<> await_suspend(std::coroutine_handle<promise_type> handle) noexcept {
+                return handle.promise().caller ? handle.promise().caller : std::noop_coroutine();
+            }
+            void await_resume() const noexcept {}
+        };
+
+        Task get_return_object() { return Task(std::coroutine_handle<promise_type>::from_promise(*this)); }
+        std::suspend_always initial_suspend() noexcept { return {}; }
+        Resume_Caller final_suspend() noexcept { return {}; }
+        void unhandled_exception() { exception = std::current_exception(); }
+    };
+
+private:
+    std::coroutine_handle<promise_type> handle;
+
+public:
+    explicit Task(std::coroutine_handle<promise_type> i_handle) : handle(i_handle) {}
+    Task(Task&& other) noexcept : handle(std::exchange(other.handle, {})) {}
+    Task(const Task&) = delete;
+    Task& operator=(const Task&) = delete;
+    Task& operator=(Task&&) = delete;
+    ~Task() {
+        if (handle) {
+            handle.destroy();
+        }
+    }
+
+    bool await_ready() const noexcept { return false; }
+    std::coroutine_handle<> await_suspend(std::coroutine_handle<> i_caller) noexcept {
+        handle.promise().caller = i_caller;
+        return handle;
+    }
+    // Gives the result, or rethrows what the coroutine threw
+    T await_resume() {
+        if (handle.promise().exception) {
+            std::rethrow_exception(handle.promise().exception);
+        }
+        return handle.promise().take();
+    }
+};
+
+struct Table {
+    Game_State state;                                            // what the seat to act decides on
+    Cards::Session_Rng rng;
+    std::array<Input_Source*, Game_State::max_seats> sources{};  // nullptr seats are bots
+    std::array<std::int32_t, Game_State::max_seats> stacks{};
+    std::array<std::int64_t, Game_State::max_seats> results{};   // net chips per seat over all hands
+    std::uint32_t hand_id{0};
+    Action answer{};
+    bool has_answer{false};
+    std::coroutine_handle<> waiting;                             // set while the table waits for input
+    Table_Task task;
+};
+
+// Parks the coroutine until the input source of the seat to act in table.state delivers. The scheduler
+// asks the source once the coroutine is parked, and the coroutine gets the delivered action back.
+struct Input_Awaiter {
+    Table& table;
+
+    bool await_ready() const noexcept { return false; }
+    void await_suspend(std::coroutine_handle<> handle) noexcept {
+        table.waiting = handle;
+        table.has_answer = false;
+    }
+    Action await_resume() const { return table.answer; }
+};
+
+} // namespace Driver end
+
+namespace Game {
+
+
+class Game {
+private:
+    int difficulty;
+    int nr_of_bots;
+    int starting_chips;
+    Variant variant;
+    Deck_Type deck_type;
+    Session_Rng rng;
+    Deck deck;
+    Bot bot;
+    Human human;
+    Pot pot;
+   
+
+public:
+    // A short deck game uses the 36 card deck and its rankings, an Omaha game deals four hole cards and
+    // limits every raise to the pot. Push/fold charts, the blueprint, the card buckets and the river solver
+    // are built for full deck Hold'em, so bots play without them in the other variants.
+    Game(int difficulty, int nr_bot, int start_chips, Variant i_variant = Variant::holdem)
+        : difficulty(difficulty), nr_of_bots(nr_bot), starting_chips(start_chips), variant(i_variant),
+          deck_type(i_variant == Variant::short_deck ? Deck_Type::short_deck : Deck_Type::standard), rng(),
+          deck(nr_of_bots + 1, 5, rng, deck_type, i_variant == Variant::omaha ? 4 : 2), bot(), human(starting_chips, deck), pot() {}
+    
+    // Most bots a game of the variant has cards for: the board and every player's hole cards come from one deck
+    static int max_bots(Variant variant) {
+        int deck_size = variant == Variant::short_deck ? 36 : 52;
+        return std::min(20, (deck_size - 5) / (variant == Variant::omaha ? 4 : 2) - 1);
+    }
+  
+          
+          
+    std::vector<Player> bots_in_the_game;
+    std::vector<Player> bot_initial_copy;
+    std::vector<Player> all_players_initial_copy;
+    
+    bool human_in_the_game{true};
+    bool it_is_the_first_game{true};
+    
+    int games_played{0};
+    int nr_of_games_requested{0};
+    std::string snapshot_path;  // autosave target, empty when autosave is off
+    
+    int current_round{0};
+    History::Hand_Record hand_record;  // actions of the current hand
+    std::unique_ptr<History::Hand_History_Writer> history_writer;
+    
+    std::unique_ptr<Push_Fold::Chart_Cache> push_fold_charts;
+    std::string big_blind_name;    // blinds of the current hand, for the push/fold positions
+    std::string small_blind_name;
+    std::unique_ptr<Cfr::Blueprint> blueprint;
+    std::unique_ptr<Buckets::Bucket_Table> card_buckets;
+    double river_deadline_ms{20.0};  // time a bot may spend re-solving the river, 0 turns the solver off
+    std::unique_ptr<Export::Exporter> exporter;
+    std::unique_ptr<Export::Export_Batch> export_batch;  // declared after the exporter so it is flushed first
+    Driver::Table* input_table{nullptr};  // the driver table the human's decisions are asked at
+    
+    // Seat of the human in the Game_State an input source is shown, the bots still in the hand follow
+    static constexpr int human_seat = 0;
+    
+    // The human's decisions are asked at the table until its scheduler is gone; Table_Scheduler::add_game calls this
+    void attach_input(Driver::Table& table) {
+        input_table = &table;
+    }
+    
+    // Appends every finished hand to a binary hand history file. A hand record keeps two hole cards per
+    // seat, so Omaha hands are not written.
+    void enable_hand_history(const std::string& path) {
+        if (variant == Variant::omaha) {
+            return;
+        }
+        history_writer = std::make_unique<History::Hand_History_Writer>(path);
+    }
+    
+    // Lets short stacked bots at the higher difficulties play solved push/fold charts before the flop
+    void enable_push_fold_charts(const std::string& path) {
+        if (variant != Variant::holdem) {
+            return;
+        }
+        push_fold_charts = std::make_unique<Push_Fold::Chart_Cache>(path);
+        // missing charts are solved off the game's thread; until they exist the bots play as before
+        if (difficulty >= 3) {
+            push_fold_charts->solve_in_background(std::max(1u, std::thread::hardware_concurrency()));
+        }
+    }
+    
+    // Players before the flop in the chart's order: those without a blind in the order they act, then the
+    // small and the big blind
+    std::vector<std::string> preflop_order() const {
+        std::vector<std::string> order;
+        auto has_blind = [this](const std::string& name) { return name == small_blind_name || name == big_blind_name; };
+        for (const auto& object : bots_in_the_game) {
+            if (!has_blind(object.get_name())) {
+                order.push_back(object.get_name());
+            }
+        }
+        if (human_in_the_game && !has_blind(human.get_name())) {
+            order.push_back(human.get_name());
+        }
+        order.push_back(small_blind_name);
+        order.push_back(big_blind_name);
+        return order;
+    }
+    
+    // 1 when the chart plays the hand, 0 when it folds it, -1 when no chart applies or it is not solved yet.
+    // raiser_name is the player whose bet the bot faces, "na" for the human.
+    int push_fold_decision(const Player& player, int bet_amount, const std::string& raiser_name) {
+        if (!push_fold_charts || difficulty < 3 || current_round != 1) {
+            return -1;
+        }
+        int big_blind = std::max(1, difficulty == 4 ? (starting_chips / 10) * 3 : starting_chips / 10);
+        int stack_bb = player.get_chips() / big_blind;
+        std::vector<std::string> order = preflop_order();
+        int nr_of_players = std::min<int>(order.size(), Push_Fold::max_players);
+        if (stack_bb > 15 || nr_of_players < 2) {
+            return -1;
+        }
+        const Push_Fold::Chart* chart = push_fold_charts->find(nr_of_players, std::max(stack_bb, 1));
+        if (chart == nullptr) {
+            return -1;
+        }
+        // tables bigger than the chart put their early seats on its first position
+        auto position = [&](const std::string& name) {
+            int index = std::find(order.begin(), order.end(), name) - order.begin();
+            return std::max(0, index - static_cast<int>(order.size()) + nr_of_players);
+        };
+        int seat = position(player.get_name());
+        int hand = Push_Fold::hand_class(Cards::card_index(player.get_card1()), Cards::card_index(player.get_card2()));
+        // against the blind alone the bot enters with the first-in push range of its position
+        if (raiser_name == big_blind_name && bet_amount <= big_blind) {
+            return chart->should_push(std::min(seat, nr_of_players - 2), hand) ? 1 : 0;
+        }
+        // against a push it calls with its own range behind the pusher, and with the big blind's range
+        // when it acted before the pusher
+        int pusher = std::min(position(raiser_name == "na" ? human.get_name() : raiser_name), nr_of_players - 2);
+        int caller = seat > pusher ? seat : nr_of_players - 1;
+        return chart->should_call(pusher, caller, hand) ? 1 : 0;
+    }
+    
+    // The impossible bots follow the blueprint trained with --train-cfr when there is one
+    void enable_blueprint(const std::string& path) {
+        if (difficulty != 4 || variant != Variant::holdem) {
+            return;
+        }
+        try {
+            blueprint = std::make_unique<Cfr::Blueprint>(Cfr::Blueprint::load(path));
+        } catch (const std::runtime_error&) {
+            blueprint.reset();
+        }
+        // a blueprint trained on a bucket table is only usable with that table
+        if (blueprint && blueprint->card_buckets != (card_buckets ? card_buckets->id() : 0)) {
+            blueprint.reset();
+        }
+    }
+    
+    // Maps the bucket table built with --build-buckets for the impossible bots, call before enable_blueprint
+    void enable_card_buckets(const std::string& path) {
+        if (difficulty != 4 || variant != Variant::holdem) {
+            return;
+        }
+        try {
+            card_buckets = std::make_unique<Buckets::Bucket_Table>(path);
+        } catch (const std::runtime_error&) {
+            card_buckets.reset();
+        }
+    }
+    
+    // Blueprint probability of a fold, passive or aggressive choice for the bot's cards on this street
+    float blueprint_probability(const Player& player, bool facing_bet, int kind) {
+        std::uint8_t hole[2] = { Cards::card_index(player.get_card1()), Cards::card_index(player.get_card2()) };
+        std::uint8_t board_cards[5] = {};
+        std::vector<Card> community_cards = deck.get_community_cards();
+        int nr_of_board_cards = std::min<int>(community_cards.size(), 5);
+        for (int i{0}; i < nr_of_board_cards; i++) {
+            board_cards[i] = Cards::card_index(community_cards[i]);
+        }
+        int street = nr_of_board_cards >= 3 ? nr_of_board_cards - 2 : 0;
+        const Buckets::Bucket_Table* table = blueprint->card_buckets ? card_buckets.get() : nullptr;
+        return blueprint->probability(street, Cfr::bucket(street, hole, board_cards, table), facing_bet, kind);
+    }
+    
+    // Re-solves the river for a bot at the higher difficulties when it plays against one or two players.
+    // Both sides start from every combo the board allows; with two opponents their ranges are added into
+    // one. The result has no choices when the solver does not apply.
+    River::River_Result solve_river(const Player& player, int pot_before, int facing_bet) {
+        std::vector<Card> community_cards = deck.get_community_cards();
+        std::vector<int> opponent_chips;
+        for (const auto& object : bots_in_the_game) {
+            if (object.get_name() != player.get_name()) {
+                opponent_chips.push_back(object.get_chips());
+            }
+        }
+        if (human_in_the_game) {
+            opponent_chips.push_back(human.get_chips());
+        }
+        if (difficulty < 3 || variant != Variant::holdem || current_round != 4 || community_cards.size() < 5 || river_deadline_ms <= 0
+            || opponent_chips.empty() || opponent_chips.size() > 2) {
+            return {};
+        }
+        River::River_Spot spot;
+        for (int i{0}; i < 5; i++) {
+            spot.board[i] = Cards::card_index(community_cards[i]);
+        }
+        spot.pot = std::max(pot_before, 1);
+        spot.facing_bet = facing_bet;
+        spot.stack = std::min(player.get_chips(), *std::max_element(opponent_chips.begin(), opponent_chips.end()) + facing_bet);
+        std::uint64_t board_mask{0};
+        for (std::uint8_t card : spot.board) {
+            board_mask |= 1ull << card;
+        }
+        spot.hero_range = Ranges::uniform_range(board_mask);
+        spot.villain_range = spot.hero_range;
+        int hero_combo = Ranges::combo_index(Cards::card_index(player.get_card1()), Cards::card_index(player.get_card2()));
+        River::Subgame subgame(spot);
+        return subgame.solve(hero_combo, river_deadline_ms, 10000);
+    }
+    
+    // Samples one of the solver's choices
+    const River::River_Choice* sample_river_choice(const River::River_Result& result) {
+        std::uniform_real_distribution<float> uniform(0.0f, 1.0f);
+        float draw = uniform(rng);
+        for (const auto& choice : result.choices) {
+            draw -= choice.probability;
+            if (draw < 0) {
+                return &choice;
+            }
+        }
+        return result.choices.empty() ? nullptr : &result.choices.back();
+    }
+    
+    // Writes per-hand and per-decision rows of every finished hand as tables for analysis.
+    // The rows are built from hand records, so Omaha hands are not exported either.
+    void enable_export(const std::string& prefix, Export::Format format) {
+        if (variant == Variant::omaha) {
+            return;
+        }
+        exporter = std::make_unique<Export::Exporter>(prefix, format);
+        export_batch = std::make_unique<Export::Export_Batch>(*exporter);
+    }
+    
+    // Starts recording a hand, seat 0 is the human and the bots follow in Bot::bots order
+    void begin_hand_record() {
+        hand_record.begin(history_writer ? history_writer->next_hand_id() : games_played + 1, deck_type);
+        hand_decisions.clear();
+        hand_record.add_seat(human.get_name(), human.get_chips(), Cards::card_index(human.get_card1()), Cards::card_index(human.get_card2()), true);
+        for (const auto& object : bot.bots) {
+            hand_record.add_seat(object.get_name(), object.get_chips(), Cards::card_index(object.get_card1()), Cards::card_index(object.get_card2()), false);
+        }
+        // bots are tracked by name and by the policy they share
+        std::string bot_policy = "bots at difficulty " + std::to_string(difficulty);
+        stats_tracker.begin(stats_block);
+        stats_tracker.add_seat(human.get_name(), "");
+        for (const auto& object : bot.bots) {
+            stats_tracker.add_seat(object.get_name(), bot_policy);
+        }
+    }
+    
+    Stats::Stats_Registry stats_registry;
+    Stats::Counter_Block& stats_block{stats_registry.new_block()};  // counters of the thread running this table
+    Stats::Hand_Tracker stats_tracker;
+    
+    std::vector<Decision_Record> hand_decisions;  // human decisions of the current hand
+    Leak_Aggregator leak_aggregator;
+    int decision_equity_samples{20000};     // most samples for a decision's equity
+    double decision_equity_tolerance{0.005};  // a clear spot stops sampling once its equity is this precise
+    
+    // Compact indices of a player's two or four hole cards
+    static std::array<std::uint8_t, 4> hole_indices(const Player& player) {
+        std::array<std::uint8_t, 4> hole;
+        hole.fill(Cards::no_card);
+        const std::vector<Card>& hole_cards = player.get_hole_cards();
+        for (std::size_t i{0}; i < hole_cards.size() && i < hole.size(); i++) {
+            hole[i] = Cards::card_index(hole_cards[i]);
+        }
+        return hole;
+    }
+    
+    // Equity of hole cards against random hands by the rules of the variant. The Omaha sampler takes a
+    // fixed count, so it draws the most samples options allows.
+    static Eval::Equity_Result variant_equity(Variant variant, const std::uint8_t* hole, const std::uint8_t* board_cards, int nr_of_board_cards,
+                                              int nr_of_opponents, const Eval::Sampling_Options& options, std::uint64_t seed) {
+        if (variant == Variant::omaha) {
+            return Eval::monte_carlo_omaha_equity(hole, board_cards, nr_of_board_cards, nr_of_opponents, options.max_samples, seed);
+        }
+        Deck_Type deck_type = variant == Variant::short_deck ? Deck_Type::short_deck : Deck_Type::standard;
+        return Eval::sample_equity(hole, board_cards, nr_of_board_cards, nr_of_opponents, options, seed, deck_type);
+    }
+    
+    // Starts the equity calculation for a human decision in the background, so it runs while the user thinks
+    std::future<Eval::Equity_Result> start_decision_equity() {
+        std::array<std::uint8_t, 4> hole = hole_indices(human);
+        std::array<std::uint8_t, 5> board_cards{};
+        std::vector<Card> community_cards = deck.get_community_cards();
+        int nr_of_board_cards = std::min<int>(community_cards.size(), 5);
+        for (int i{0}; i < nr_of_board_cards; i++) {
+            board_cards[i] = Cards::card_index(community_cards[i]);
+        }
+        int nr_of_opponents = std::max<int>(1, bots_in_the_game.size());
+        Eval::Sampling_Options options;
+        options.tolerance = decision_equity_tolerance;
+        options.max_samples = decision_equity_samples;
+        std::uint64_t seed = rng();
+        Variant game_variant = variant;
+        return std::async(std::launch::async, [=]() {
+            return variant_equity(game_variant, hole.data(), board_cards.data(), nr_of_board_cards, nr_of_opponents, options, seed);
+        });
+    }
+    
+    // Scores a human decision once its equity is known and adds it to the leak statistics
+    void record_human_decision(std::future<Eval::Equity_Result>& equity, Action_Type action, int amount_to_call, int invested, int pot_before, int stack_before) {
+        Decision_Record decision;
+        decision.street = static_cast<std::uint8_t>(std::max(current_round - 1, 0));
+        decision.action = action;
+        decision.facing_bet = amount_to_call > 0;
+        decision.amount_to_call = std::min(amount_to_call, stack_before);
+        decision.invested = invested;
+        decision.pot = pot_before;
+        decision.stack = stack_before;
+        decision.nr_of_opponents = bots_in_the_game.size();
+        if (equity.valid()) {
+            Eval::Equity_Result result = equity.get();
+            decision.equity = result.equity;
+            decision.equity_samples = result.samples;
+        }
+        hand_decisions.push_back(score_decision(decision));
+        leak_aggregator.add(hand_decisions.back());
+    }
+    
+    void record_action(const std::string& player_name, Action_Type type, int amount) {
+        int seat = hand_record.seat_of(player_name);
+        hand_record.add_action(seat, std::max(current_round - 1, 0), static_cast<std::uint8_t>(type), amount);
+        stats_tracker.action(seat, std::max(current_round - 1, 0), type);
+    }
+    
+    // Completes the record with the board and what every seat won, then writes it
+    void finish_hand_record(const std::vector<Player>& remaining_players) {
+        std::vector<Card> community_cards = deck.get_community_cards();
+        std::uint8_t board_cards[5];
+        for (int i{0}; i < static_cast<int>(community_cards.size()) && i < 5; i++) {
+            board_cards[i] = Cards::card_index(community_cards[i]);
+        }
+        hand_record.set_board(board_cards, std::min<int>(community_cards.size(), 5));
+        
+        std::array<std::int32_t, History::max_seats> committed{};
+        for (int i{0}; i < hand_record.header.nr_of_actions; i++) {
+            committed[hand_record.actions[i].seat] += hand_record.actions[i].amount;
+        }
+        for (int i{0}; i < hand_record.header.nr_of_seats; i++) {
+            History::Seat_Entry& seat = hand_record.seats[i];
+            std::string name(seat.name);
+            int chips_now = seat.starting_chips - committed[i];
+            if (name == human.get_name()) {
+                chips_now = human.get_chips();
+            }
+            for (const auto& object : bot.bots) {
+                if (object.get_name() == name) {
+                    chips_now = object.get_chips();
+                }
+            }
+            seat.won = chips_now - seat.starting_chips + committed[i];
+            bool remained = std::any_of(remaining_players.begin(), remaining_players.end(), [&name](const Player& player) {
+                return player.get_name() == name;
+            });
+            seat.flags |= remained ? (remaining_players.size() > 1 ? History::seat_at_showdown : 0) : History::seat_folded;
+            stats_tracker.finish_seat(i, seat.flags & History::seat_at_showdown, seat.won > 0);
+        }
+        if (history_writer) {
+            history_writer->append(hand_record);
+        }
+        if (export_batch) {
+            export_batch->add_hand(hand_record.header, hand_record.seats.data(), hand_record.actions.data());
+        }
+    }
+    
+    
+
+    
+    Driver::Task<> bot_turn() {
+        std::vector<Player>::iterator it = bots_in_the_game.begin();
+        bool did_bots_raise{false};
+        
+        while (it != bots_in_the_game.end()) {
+            
+    
+            // random code that generates bot action
+    
+            // Create a distribution over the game random generator
+            std::uniform_int_distribution<> dist(1, 5);
+    
+            // Generate a random number between 1 and 4
+            int bot_decision_random_number = dist(rng);
+            int solver_bet{0};
+            River::River_Result river = solve_river(*it, pot.get_final_pot(), 0);
+            if (const River::River_Choice* choice = sample_river_choice(river)) {
+                solver_bet = choice->type == Action_Type::raise ? choice->amount : 0;
+                bot_decision_random_number = solver_bet > 0 ? 5 : 1;
+            } else if (blueprint) {
+                std::uniform_real_distribution<float> uniform(0.0f, 1.0f);
+                bot_decision_random_number = uniform(rng) < blueprint_probability(*it, false, Cfr::Blueprint::aggressive) ? 5 : 1;
+            }
+            //generate another random number used for "all in" bot raises
+            
+            
+            
+            // determine the bot action with if
+            if (bot_decision_random_number <= 4) {
+                // CHECK
+                std::cout << "bot " << it->get_name() << " made this action: check" << std::endl;
+                record_action(it->get_name(), Action_Type::check, 0);
+                ++it;
+    
+            } else if (bot_decision_random_number == 5 && it->get_chips()>0) {
+                // RAISE
+                
+                std::uniform_int_distribution<> dist2(5, 20); 
+                int bot_raise_random_number = dist2(rng);
+                
+                
+                int bot_betting_amount{};
+                did_bots_raise = true;
+                
+                if (difficulty == 4){
+                    bot_betting_amount = (bot_raise_random_number + 0.005*starting_chips*bot_raise_random_number)*3;
+                } else {
+                    bot_betting_amount = bot_raise_random_number + 0.005*starting_chips*bot_raise_random_number;
+                }
+                
+                //introduces more bot raise decision options
+                if (bot_raise_random_number == 19){
+                    bot_betting_amount = bot_betting_amount*5;
+                } else if (bot_raise_random_number ==20){
+                    bot_betting_amount = bot_betting_amount*2;
+                }
+                if (solver_bet > 0) {
+                    bot_betting_amount = solver_bet;
+                }
+                bot_betting_amount = std::min(bot_betting_amount, raise_limit(0));
+                
+                if (bot_betting_amount > it->get_chips()){
+                    bot_betting_amount = it->get_chips();
+                    std::cout<<"bot "<<it->get_name()<<"made this action: raise "<< bot_betting_amount<< "  and went ALL IN!!!"<<std::endl;
+                    it->bet(bot_betting_amount, pot);
+                    bot.update_bot_chips(it-> get_name(), bot_betting_amount);
+                    record_action(it->get_name(), Action_Type::raise, bot_betting_amount);
+                } else{
+                std::cout << "the bot named " << it->get_name() << " made this action: raise " <<bot_betting_amount<< std::endl;
+                it->bet(bot_betting_amount, pot);
+                bot.update_bot_chips(it-> get_name(), bot_betting_amount);
+                record_action(it->get_name(), Action_Type::raise, bot_betting_amount);
+                }
+    
+             
+    
+                // Find the iterator pointing to the current bot in the other_bots_in_the_game vector
+                 auto current_bot_it = std::find(bots_in_the_game.begin(), bots_in_the_game.end(), *it);
+
+                bot_response(bot_betting_amount, it->get_name());
+
+            
+
+                if (human_in_the_game == true && human.get_chips()>0) {
+                    co_await human_response(bot_betting_amount);
+                }
+    
+                break;
+    
+            } 
+        }
+            
+    }
+
+
+    
+    void bot_response(int bet_amount, const std::string &raiser_bot_name) {
+        std::vector<int> indices_to_remove;
+        int pot_before_bet = pot.get_final_pot() - bet_amount;
+        for (int i = 0; i < bots_in_the_game.size(); ++i) {
+            if (bots_in_the_game[i].get_name() == raiser_bot_name) {
+                continue;
+            }
+    
+            std::uniform_int_distribution<> dist(1, 3);
+    
+            int random_number = dist(rng);
+            int chart_decision = push_fold_decision(bots_in_the_game[i], bet_amount, raiser_bot_name);
+            River::River_Result river = solve_river(bots_in_the_game[i], pot_before_bet, bet_amount);
+            if (chart_decision >= 0) {
+                random_number = chart_decision == 1 ? 2 : 1;
+            } else if (const River::River_Choice* choice = sample_river_choice(river)) {
+                // the game has no re-raises, so a raise from the solver is played as a call
+                random_number = choice->type == Action_Type::fold ? 1 : 2;
+            } else if (blueprint) {
+                std::uniform_real_distribution<float> uniform(0.0f, 1.0f);
+                random_number = uniform(rng) < blueprint_probability(bots_in_the_game[i], true, Cfr::Blueprint::fold) ? 1 : 2;
+            }
+            // the harder bots weigh a call that risks their whole stack by its prize equity in the session
+            if (difficulty >= 3 && random_number != 1 && bots_in_the_game[i].get_chips() > 0 && bet_amount >= bots_in_the_game[i].get_chips()
+                && !icm_allows_all_in_call(bots_in_the_game[i], bet_amount, raiser_bot_name)) {
+                random_number = 1;
+            }
+    
+            if (random_number == 1 && bots_in_the_game[i].get_chips()>0 &&bots_in_the_game.size()>0) {
+                // FOLD
+                std::cout << "the bot named " << bots_in_the_game[i].get_name() << " responded with this action: fold" << std::endl;
+                record_action(bots_in_the_game[i].get_name(), Action_Type::fold, 0);
+                indices_to_remove.push_back(i);
+            } else if (bots_in_the_game[i].get_chips()>0){
+                //CALL
+                std::cout << "the bot named " << bots_in_the_game[i].get_name() << " responded with this action: call" << std::endl;
+                if (bet_amount>=bots_in_the_game[i].get_chips()){
+                    std::cout<<"Bot "<<bots_in_the_game[i].get_name()<<" went ALL IN !!!"<<std::endl;
+                    int smaller_bet_amount = bots_in_the_game[i].get_chips();
+                    bots_in_the_game[i].bet(smaller_bet_amount, pot);
+                    bot.update_bot_chips(bots_in_the_game[i].get_name(), smaller_bet_amount);
+                    record_action(bots_in_the_game[i].get_name(), Action_Type::call, smaller_bet_amount);
+                } else{
+                    bots_in_the_game[i].bet(bet_amount, pot);
+                    bot.update_bot_chips(bots_in_the_game[i].get_name(), bet_amount);
+                    record_action(bots_in_the_game[i].get_name(), Action_Type::call, bet_amount);
+                }
+            }
+        }
+        std::sort(indices_to_remove.begin(), indices_to_remove.end(), std::greater<>()); // sort in descending order
+        for (int index : indices_to_remove) {
+            bots_in_the_game.erase(bots_in_the_game.begin() + index);
+        }
+    }
+
+
+
+    
+    int big_blind_size() const {
+        return difficulty == 4 ? (starting_chips / 10) * 3 : starting_chips / 10;
+    }
+    
+    // Most chips a raise may add on top of amount_to_call: in pot-limit Omaha the pot after the call,
+    // but at least a big blind, as in Game_State::max_raise_to
+    int raise_limit(int amount_to_call) {
+        if (variant != Variant::omaha) {
+            return std::numeric_limits<int>::max();
+        }
+        return std::max(pot.get_final_pot() + amount_to_call, big_blind_size());
+    }
+    
+    // Shows the table's input source the hand as a Game_State, the human facing a bet of amount_to_call,
+    // and waits for its answer. The bots' cards stay hidden.
+    Driver::Input_Awaiter human_decision(int amount_to_call) {
+        if (input_table == nullptr) {
+            throw std::logic_error("The game has no input source for the human.");
+        }
+        int seats = std::clamp<int>(bots_in_the_game.size() + 1, 2, Game_State::max_seats);
+        std::array<std::int32_t, Game_State::max_seats> stacks{};
+        std::array<std::uint8_t, Game_State::max_seats * 4> hole;
+        hole.fill(Cards::no_card);
+        std::array<std::uint8_t, 5> board_cards;
+        board_cards.fill(Cards::no_card);
+        stacks[human_seat] = human.get_chips();
+        std::array<std::uint8_t, 4> human_hole = hole_indices(human);
+        int nr_of_hole_cards = variant == Variant::omaha ? 4 : 2;
+        std::copy_n(human_hole.begin(), nr_of_hole_cards, hole.begin() + nr_of_hole_cards * human_seat);
+        std::uint32_t folded{0};
+        for (int i{1}; i < seats; i++) {
+            if (i - 1 < static_cast<int>(bots_in_the_game.size())) {
+                stacks[i] = bots_in_the_game[i - 1].get_chips();
+            } else {
+                folded |= 1u << i;  // an empty seat, so a human alone still sees a table of two
+            }
+        }
+        std::vector<Card> community_cards = deck.get_community_cards();
+        for (int i{0}; i < static_cast<int>(community_cards.size()) && i < 5; i++) {
+            board_cards[i] = Cards::card_index(community_cards[i]);
+        }
+        int street = std::clamp(current_round - 1, 0, 3);
+        int big_blind = big_blind_size();
+
+        Game_State& state = input_table->state;
+        state.variant = variant;
+        state.start_street(seats, stacks.data(), hole.data(), board_cards.data(), seats - 1, street, pot.get_final_pot(), big_blind, folded);
+        state.street = static_cast<std::uint8_t>(street);
+        state.to_act = human_seat;
+        state.level = amount_to_call;
+        state.last_raise = std::max(amount_to_call, big_blind);
+        return Driver::Input_Awaiter{ *input_table };
+    }
+    
+    Driver::Task<bool> human_turn() {
+        bool validInput = false;
+        bool did_bots_respond = false;
+        int pot_before = pot.get_final_pot();
+        int stack_before = human.get_chips();
+        std::future<Eval::Equity_Result> equity = start_decision_equity();
+        
+        while (!validInput) {
+            try {
+                std::cout << "Choose one of the following actions: fold, check, raise" << std::endl;
+                Action user_action = co_await human_decision(0);
+        
+                if (user_action.type == Action_Type::check) {
+                    std::cout << "Human player checked" << std::endl;
+                    record_action(human.get_name(), Action_Type::check, 0);
+                    record_human_decision(equity, Action_Type::check, 0, 0, pot_before, stack_before);
+                    validInput = true;
+                } else if (user_action.type == Action_Type::raise){
+                    int human_bet_amount = user_action.amount;
+                    int max_chips{0};
+                    for (const auto& object : bots_in_the_game) {
+                        max_chips = std::max(max_chips, object.get_chips());
+                    }
+                    
+                    if (human_bet_amount <= 0 || human_bet_amount > human.get_chips() || human_bet_amount>max_chips) {
+                        throw std::invalid_argument("Invalid bet amount!");
+                    }
+                    if (human_bet_amount > raise_limit(0)) {
+                        throw std::invalid_argument("The bet is over the pot limit of " + std::to_string(raise_limit(0)) + " chips!");
+                    }
+    
+                    human.bet(human_bet_amount, pot);
+                    record_action(human.get_name(), Action_Type::raise, human_bet_amount);
+                    record_human_decision(equity, Action_Type::raise, 0, human_bet_amount, pot_before, stack_before);
+                    std::string bot_raiser_name = "none";
+                    bot_response(human_bet_amount, bot_raiser_name);
+                    did_bots_respond = true;
+                    validInput = true;
+                } else if (user_action.type == Action_Type::fold) {
+                    std::cout << "Human player folded" << std::endl;
+                    record_action(human.get_name(), Action_Type::fold, 0);
+                    record_human_decision(equity, Action_Type::fold, 0, 0, pot_before, stack_before);
+                    human_in_the_game = false;
+                    validInput = true;
+                } else {
+                    throw std::invalid_argument("Invalid action. ");
+                }
+            } 
+            catch (const std::invalid_argument& e) {
+                std::cerr << e.what() << '\n';
+            }
+        }
+
+    co_return did_bots_respond;
+}
+
+    
+    
+    
+    Driver::Task<> human_response(int amount){
+        bool validInput = false;
+        int pot_before = pot.get_final_pot();
+        int stack_before = human.get_chips();
+        std::future<Eval::Equity_Result> equity = start_decision_equity();
+        
+        while (!validInput) {
+            try {
+                std::cout << "Other players are betting "<< amount << ", and you currently have: "<< human.get_chips() << ". What is your action?"<<std::endl<<"call, fold, raise"<<std::endl;
+                Action human_action = co_await human_decision(amount);
+    
+                if (human_action.type == Action_Type::fold) {
+                    std::cout << "Human player folded"<<std::endl;
+                    record_action(human.get_name(), Action_Type::fold, 0);
+                    record_human_decision(equity, Action_Type::fold, amount, 0, pot_before, stack_before);
+                    human_in_the_game = false;
+                    validInput = true;
+                } 
+                else if (human_action.type == Action_Type::call) {
+                    int human_bet = amount;
+                    std::cout << "Human player called"<<std::endl;
+                    if (human.get_chips() < amount) {
+                        human_bet = human.get_chips();
+                        std::cout<<"human player went ALL IN!"<<std::endl;
+                    }
+                    
+                    human.bet(human_bet, pot);
+                    record_action(human.get_name(), Action_Type::call, human_bet);
+                    record_human_decision(equity, Action_Type::call, amount, human_bet, pot_before, stack_before);
+                    validInput = true;
+                } 
+                else if (human_action.type == Action_Type::raise) {
+                    if (human.get_chips() <= amount) {
+                        throw std::invalid_argument("You don't have enough chips to raise!");
+                    }
+                    
+                    int max_chips{0};
+                    for (const auto& object : bots_in_the_game) {
+                        max_chips = std::max(max_chips, object.get_chips());
+                    }
+                    
+                    // the raise is a street bet: what the bet asks for plus the extra chips
+                    int extra_chips = human_action.amount - amount;
+                    if (extra_chips <= 0 || extra_chips > human.get_chips() - amount || extra_chips > max_chips) {
+                        throw std::invalid_argument("Invalid number of extra chips!");
+                    }
+                    if (extra_chips > raise_limit(amount)) {
+                        throw std::invalid_argument("The raise is over the pot limit of " + std::to_string(raise_limit(amount)) + " extra chips!");
+                    }
+                    human.bet(amount, pot);
+                    human.bet(extra_chips, pot);
+                    record_action(human.get_name(), Action_Type::raise, amount + extra_chips);
+                    record_human_decision(equity, Action_Type::raise, amount, amount + extra_chips, pot_before, stack_before);
+                    std::string bot_raiser_name = "na";
+                    bot_response(extra_chips, bot_raiser_name);
+                    validInput = true;
+                } 
+                else {
+                    throw std::invalid_argument("Invalid action. Please choose 'fold', 'call', or 'raise'.");
+                }
+            } 
+            catch (const std::invalid_argument& e) {
+                std::cerr << e.what() << '\n';
+            }
+        }
+    }
+
+
+    // Prize shares the session's ICM figures assume: the usual top three payout of a small tournament
+    static const std::vector<double>& session_payouts() {
+        static const std::vector<double> payouts = { 0.5, 0.3, 0.2 };
+        return payouts;
+    }
+
+    // Chips behind of the human (first) and every bot in Bot::bots order
+    std::vector<double> current_stacks() const {
+        std::vector<double> stacks = { static_cast<double>(human.get_chips()) };
+        for (const auto& object : bot.bots) {
+            stacks.push_back(object.get_chips());
+        }
+        return stacks;
+    }
+
+    // Prize equity of the human (first) and every bot in Bot::bots order for the given payouts
+    std::vector<double> icm_equity(const std::vector<double>& payouts) {
+        return Icm::equity(current_stacks(), payouts);
+    }
+
+    // Whether a bot's call that puts it all in is worth it in prize equity rather than in chips.
+    // The pot is treated as heads up against the raiser ("na" for the human): folding hands the raiser
+    // the pot, winning pays the bot the pot without the raiser's unmatched chips, losing busts the bot.
+    bool icm_allows_all_in_call(const Player& caller, int bet_amount, const std::string& raiser_name) {
+        std::vector<double> stacks = current_stacks();
+        auto seat_of = [this](const std::string& name) {
+            for (std::size_t i{0}; i < bot.bots.size(); i++) {
+                if (bot.bots[i].get_name() == name) {
+                    return static_cast<int>(i) + 1;
+                }
+            }
+            return 0;
+        };
+        int seat = seat_of(caller.get_name());
+        int raiser = raiser_name == "na" ? 0 : seat_of(raiser_name);
+        if (seat == 0 || seat == raiser) {
+            return true;
+        }
+        double risked = std::min(caller.get_chips(), bet_amount);
+        double in_pot = pot.get_final_pot();
+        std::vector<double> fold = stacks;
+        fold[raiser] += in_pot;
+        std::vector<double> win = stacks;
+        win[seat] += in_pot - bet_amount + risked;
+        win[raiser] += bet_amount - risked;
+        std::vector<double> lose = stacks;
+        lose[seat] -= risked;
+        lose[raiser] += in_pot + risked;
+        const std::vector<double>& payouts = session_payouts();
+        double if_folded = Icm::equity(fold, payouts)[seat];
+        double if_won = Icm::equity(win, payouts)[seat];
+        double if_lost = Icm::equity(lose, payouts)[seat];
+
+        std::array<std::uint8_t, 4> hole = hole_indices(caller);
+        std::array<std::uint8_t, 5> board_cards{};
+        std::vector<Card> community_cards = deck.get_community_cards();
+        int nr_of_board_cards = std::min<int>(community_cards.size(), 5);
+        for (int i{0}; i < nr_of_board_cards; i++) {
+            board_cards[i] = Cards::card_index(community_cards[i]);
+        }
+        Eval::Sampling_Options options;
+        options.tolerance = 0.02;
+        options.max_samples = 4000;
+        double winning = variant_equity(variant, hole.data(), board_cards.data(), nr_of_board_cards, 1, options, rng()).equity;
+        return winning * if_won + (1 - winning) * if_lost >= if_folded;
+    }
+
+
+        void show_board(){
+            std::cout<<"the current community pot is: "<< pot.get_final_pot()<<std::endl;
+            
+                
+            std::cout<<"bots left in the game:  "<<bots_in_the_game.size()<<std::endl;
+            Player::show_player_info(bots_in_the_game);
+            deck.print_community_cards();
+            human.show_human_cards();
+            show_outs();
+            std::cout<<"Your current chips: "<<human.get_chips()<<std::endl;
+            
+    }
+    
+    // Lists the cards that improve the human's hand on the flop and the turn with the chances to hit one.
+    // Outs are counted for two hole cards, so Omaha hands get none.
+    void show_outs() {
+        std::vector<Card> community_cards = deck.get_community_cards();
+        if (!human_in_the_game || variant == Variant::omaha || community_cards.size() < 3 || community_cards.size() > 4) {
+            return;
+        }
+        std::array<std::uint8_t, 2> hole = { Cards::card_index(human.get_card1()), Cards::card_index(human.get_card2()) };
+        std::array<std::uint8_t, 4> board_cards{};
+        for (std::size_t i{0}; i < community_cards.size(); i++) {
+            board_cards[i] = Cards::card_index(community_cards[i]);
+        }
+        Eval::Outs_Result outs = Eval::count_outs(hole.data(), board_cards.data(), community_cards.size(), nullptr, deck_type);
+        std::cout << "You have " << Ranking::poker_rank_to_string(static_cast<Poker_Ranks>(outs.current_category)) << ", "
+                  << __builtin_popcountll(outs.improving_cards) << " outs";
+        for (int hand_category{Eval::straight_flush}; hand_category > Eval::high_card; hand_category--) {
+            if (outs.outs_per_category[hand_category] > 0) {
+                std::cout << ", " << static_cast<int>(outs.outs_per_category[hand_category]) << " to "
+                          << Ranking::poker_rank_to_string(static_cast<Poker_Ranks>(hand_category));
+            }
+        }
+        std::cout << std::endl;
+        if (outs.improving_cards != 0) {
+            for (int card{0}; card < 52; card++) {
+                if (outs.improving_cards >> card & 1) {
+                    std::cout << Cards::card_from_index(card) << ' ';
+                }
+            }
+            std::cout << std::endl;
+        }
+        std::cout << "Chance to improve: " << std::round(outs.improve_next * 1000) / 10 << "% on the next card";
+        if (community_cards.size() == 3) {
+            std::cout << ", " << std::round(outs.improve_by_river * 1000) / 10 << "% by the river";
+        }
+        std::cout << std::endl;
+    }
+    
+    
+    enum class Share_Kind {
+        partial_pot,     // an all in winner only takes what they could cover
+        returned_chips,  // the others get back the rest of a partially won pot
+        pot_share        // regular (split) pot
+    };
+    
+    struct Pot_Share {
+        std::string player_name;
+        int amount;
+        Share_Kind kind;
+    };
+    
+    // Works out who receives which part of the pot without touching any chips, so replays can reuse it.
+    // initial_bots are the bots with their chips at the start of the hand.
+    static std::vector<Pot_Share> compute_pot_shares(const std::vector<std::string>& winning_player_names, const std::vector<Player>& all_final_players, int total_pot_amount, const std::vector<Player>& initial_bots) {
+        std::vector<Pot_Share> shares;
+        if (winning_player_names.empty()) {
+            return shares;
+        }
+        //if winners went all in and do not compete for all of the pot
+        int distributed_chips{0};
+        int distributed_chips_count{0};
+        int amount_to_distribute = total_pot_amount / static_cast<int>(winning_player_names.size());
+        int players_covered = static_cast<int>(std::max(initial_bots.size()/2 , all_final_players.size()));
+        std::string partial_pot_winner;
+        //checks all of the winners who do not receive the total shared pot
+        for (const auto& player_name : winning_player_names) {
+            for(auto &bot_initial : initial_bots){
+                if (player_name == bot_initial.get_name()){
+                    int partial_pot = bot_initial.get_chips()*players_covered;
+                    if (amount_to_distribute > partial_pot){
+                        shares.push_back({player_name, partial_pot, Share_Kind::partial_pot});
+                        partial_pot_winner = player_name;
+                        distributed_chips += partial_pot;
+                        distributed_chips_count +=1;
+                        break;
+                        }
+                    }
+                }
+        }
+        
+        int other_players = static_cast<int>(all_final_players.size()) - distributed_chips_count;
+        if(distributed_chips_count>0 && other_players>0){
+            int remaining_chips = (total_pot_amount-distributed_chips)/other_players;
+            for (const auto& player : all_final_players){
+                if (partial_pot_winner != player.get_name()){
+                    shares.push_back({player.get_name(), remaining_chips, Share_Kind::returned_chips});
+                }
+            }
+        }
+        else if (distributed_chips_count == 0) {
+            for (const auto& player_name : winning_player_names){
+                shares.push_back({player_name, amount_to_distribute, Share_Kind::pot_share});
+            }
+        }
+        return shares;
+    }
+    
+    void distribute_pot(std::vector<std::string> winning_player_names, std::vector<Player> all_final_players, int total_pot_amount) {
+        for (const auto& share : compute_pot_shares(winning_player_names, all_final_players, total_pot_amount, bot_initial_copy)) {
+            if (share.player_name == human.get_name()) {
+                human.receive_pot_share(share.amount);
+                if (share.kind == Share_Kind::returned_chips) {
+                    std::cout<<"Human player "<< human.get_name() << " gets back their chips "<< share.amount <<" chips"<<std::endl;
+                } else {
+                    std::cout<<"Human player "<< human.get_name() << " receives "<< share.amount <<" chips"<<std::endl;
+                }
+            } else {
+                bot.update_chips_for_bot(share.player_name, share.amount);
+                if (share.kind == Share_Kind::partial_pot) {
+                    std::cout<<"Bot player "<< share.player_name << " receives a partial pot: "<< share.amount <<" chips"<<std::endl;
+                } else if (share.kind == Share_Kind::returned_chips) {
+                    std::cout<<"Non-winner bot player "<< share.player_name << " gets back their chips "<< share.amount <<" chips"<<std::endl;
+                } else {
+                    std::cout<<"Bot player "<< share.player_name << " receives "<< share.amount <<" chips"<<std::endl;
+                }
+            }
+        }
+    }   
+
+
+    std::pair<Player, Player> get_two_random_players(std::vector<Player>& players) {
+        // Create a uniform distribution that covers the range of the vector's indices
+        std::uniform_int_distribution<int> dist(0, players.size() - 1);
+    
+        // Get two random indices. Use a set to ensure they are unique
+        std::set<int> randomIndices;
+        while (randomIndices.size() < 2) {
+            randomIndices.insert(dist(rng));
+        }
+    
+        // Get iterators to the two random players
+        auto it = randomIndices.begin();
+        Player& player1 = players[*it];
+        ++it;
+        Player& player2 = players[*it];
+    
+        // Return the two players
+        return std::make_pair(player1, player2);
+    }
+    
+    
+    
+    
+    
+    
+    
+    
+    
+    enum class Analytics_Verdict {
+        none = 0,
+        bigger_bets_advised,
+        balanced_risk,
+        very_good_game,
+        risky_raise_strong_rank,
+        risky_raise_fortunate,
+        very_bad_move,
+        lost_by_one_rank,
+        unlucky_loss,
+        bad_fold,
+        strong_win_folded,
+        close_win_folded,
+        good_fold_unlucky,
+        good_fold,
+        count
+    };
+    
+    struct Analytics_Result {
+        Analytics_Verdict verdict{Analytics_Verdict::none};
+        std::pair<Poker_Ranks, int> human_hand{};
+        std::pair<Poker_Ranks, int> winner_hand{};  // hand the human is compared with after a fold
+    };
+    
+    static std::string analytics_verdict_to_string(Analytics_Verdict verdict) {
+        switch (verdict) {
+            case Analytics_Verdict::bigger_bets_advised:     return "won, could have bet bigger";
+            case Analytics_Verdict::balanced_risk:           return "won, balanced risk";
+            case Analytics_Verdict::very_good_game:          return "won, very good game";
+            case Analytics_Verdict::risky_raise_strong_rank: return "won, risky raise with a strong rank";
+            case Analytics_Verdict::risky_raise_fortunate:   return "won, risky raise and fortunate";
+            case Analytics_Verdict::very_bad_move:           return "lost, very bad move";
+            case Analytics_Verdict::lost_by_one_rank:        return "lost by one rank";
+            case Analytics_Verdict::unlucky_loss:            return "lost, unlucky";
+            case Analytics_Verdict::bad_fold:                return "folded the best cards";
+            case Analytics_Verdict::strong_win_folded:       return "folded a strong win";
+            case Analytics_Verdict::close_win_folded:        return "folded a close win";
+            case Analytics_Verdict::good_fold_unlucky:       return "good fold, unlucky";
+            case Analytics_Verdict::good_fold:               return "good fold";
+            default:                                         return "no verdict";
+        }
+    }
+    
+    // Judges the human's game without printing anything, so replays can re-score logged hands.
+    // human_player holds the chips after the pot was distributed.
+    static Analytics_Result analyse_game(const std::vector<std::string>& winner_names, const std::vector<Player>& remaining_players, const Player& human_player, bool human_played_to_the_end, int final_pot, const std::vector<Card>& community_cards,
+                                        Deck_Type deck_type = Deck_Type::standard) {
+        Analytics_Result result;
+        std::vector<std::pair<std::string, std::pair<Poker_Ranks, int>>> player_name_and_rank;
+    
+        for (const auto& player : remaining_players) {
+            std::pair<Poker_Ranks, int> player_hand = Ranking::evaluate_player_hand(player, community_cards, deck_type);
+            player_name_and_rank.push_back(std::make_pair(player.get_name(), player_hand));
+        }
+        
+        std::sort(player_name_and_rank.begin(), player_name_and_rank.end(), [deck_type](const auto& a, const auto& b) {
+            return Ranking::is_better_hand(a.second, b.second, deck_type);
+        });
+        result.human_hand = Ranking::evaluate_player_hand(human_player, community_cards, deck_type);
+        std::pair<Poker_Ranks, int> human_hand = result.human_hand;
+    
+        if(human_played_to_the_end == true){
+            if (player_name_and_rank.empty()) {
+                return result;
+            }
+            std::pair<Poker_Ranks, int> highest_rank = player_name_and_rank[0].second;
+            // the best hand after the human's, or the human's own hand when nobody else was left
+            std::pair<Poker_Ranks, int> runner_up = player_name_and_rank[player_name_and_rank.size() > 1 ? 1 : 0].second;
+            
+            bool human_is_among_the_winners = std::find(winner_names.begin(), winner_names.end(), human_player.get_name()) != winner_names.end();
+            if (human_is_among_the_winners) {
+                //checks if human was the winner
+                int rank_difference = Ranking::hand_order(human_hand.first, deck_type) - Ranking::hand_order(runner_up.first, deck_type);
+                
+                if (final_pot < 0.5*human_player.get_chips()){
+                    //checks if human could have raised more
+                    //based on rank difference it tells whether the user`s` moves were risky 
+                    result.verdict = rank_difference > 1 ? Analytics_Verdict::bigger_bets_advised : Analytics_Verdict::balanced_risk;
+                } else if (rank_difference >= 1 || player_name_and_rank.size() == 1){
+                    result.verdict = Analytics_Verdict::very_good_game;
+                } else if (Ranking::hand_order(highest_rank.first, deck_type) >= 3 && player_name_and_rank.size()>1 && rank_difference == 0){
+                    result.verdict = Analytics_Verdict::risky_raise_strong_rank;
+                } else if (rank_difference == 0) {
+                    result.verdict = Analytics_Verdict::risky_raise_fortunate;
+                }
+            } else {
+                // if human lost the game
+                int rank_difference = Ranking::hand_order(highest_rank.first, deck_type) - Ranking::hand_order(human_hand.first, deck_type);
+                if (rank_difference > 1) {
+                    result.verdict = Analytics_Verdict::very_bad_move;
+                } else if (rank_difference == 1) {
+                    result.verdict = Analytics_Verdict::lost_by_one_rank;
+                } else {
+                    result.verdict = Analytics_Verdict::unlucky_loss;
+                }
+            }
+            return result;
+        }
+        
+        //if human folded in the game
+        player_name_and_rank.push_back(std::make_pair(human_player.get_name(), human_hand));
+        std::sort(player_name_and_rank.begin(), player_name_and_rank.end(), [deck_type](const auto& a, const auto& b) {
+            return Ranking::is_better_hand(a.second, b.second, deck_type);
+        });
+    
+        std::pair<Poker_Ranks, int> highest_rank = player_name_and_rank[0].second;
+        std::pair<Poker_Ranks, int> runner_up = player_name_and_rank[player_name_and_rank.size() > 1 ? 1 : 0].second;
+        
+        for (auto &player : player_name_and_rank){
+            if(player.second == highest_rank && player.first == human_player.get_name()){
+                // if human would have been the winner if he did not fold
+                int rank_difference = Ranking::hand_order(human_hand.first, deck_type) - Ranking::hand_order(runner_up.first, deck_type);
+                if (rank_difference >1){
+                    result.verdict = Analytics_Verdict::bad_fold;
+                } else if (rank_difference == 1){
+                    result.verdict = Analytics_Verdict::strong_win_folded;
+                } else {
+                    result.verdict = Analytics_Verdict::close_win_folded;
+                }
+                result.winner_hand = runner_up;
+                return result;
+            }
+        }
+        
+        result.verdict = human_hand.first == highest_rank.first ? Analytics_Verdict::good_fold_unlucky : Analytics_Verdict::good_fold;
+        result.winner_hand = highest_rank;
+        return result;
+    }
+    
+    
+    void game_analytics(std::vector<std::string> winner_names, std::vector<Player> remaining_players){
+        
+        std::cout<<std::endl<<"Game analytics feedback to the user:"<<std::endl;
+        Analytics_Result result = analyse_game(winner_names, remaining_players, human, human_in_the_game, pot.get_final_pot(), deck.get_community_cards(), deck_type);
+        
+        switch (result.verdict) {
+            case Analytics_Verdict::bigger_bets_advised:
+                std::cout<<"Great job! \n Next time consider making bigger bets when you are in a similar situation, because you had way better hand rank"<<std::endl;
+                break;
+            case Analytics_Verdict::balanced_risk:
+                std::cout<<"Great job! \n It was a well balanced risk-reward betting ratio"<<std::endl;
+                break;
+            case Analytics_Verdict::very_good_game:
+                std::cout<<"Great job! Analytics show that you played a very good game!"<<std::endl;
+                break;
+            case Analytics_Verdict::risky_raise_strong_rank:
+                std::cout<<"It was a RISKY RAISE that you made \n Other players had the same poker hand rank, but the rank was a strong one \n Overall, such raising strategy is likely to be profitable in the long run !"<<std::endl;
+                break;
+            case Analytics_Verdict::risky_raise_fortunate:
+                std::cout<<"It was a RISKY RAISE that you made \n Risk-reward ratio was not the best - you got a bit fortunate with the win \n There is a high chance that such strategy would not be profitable in the long run !"<<std::endl;
+                break;
+            case Analytics_Verdict::very_bad_move:
+                std::cout << "The difference between your hand rank and the winning hand rank was more than 1. \n It was a VERY BAD MOVE!\n In a similar situation consider FOLD as early as possible" << std::endl;
+                break;
+            case Analytics_Verdict::lost_by_one_rank:
+                std::cout << "The difference between your hand rank and the winning hand rank was 1 . \n Try to be more aware of other players possible hands next time \n Also, try to Fold early on when your hands are not strong." << std::endl;
+                break;
+            case Analytics_Verdict::unlucky_loss:
+                std::cout<<"You were UNLUCKY this game. Opponents had identical hand rank, but with higher quality, so they won the game. \n It was a good game and with a bit more luck next time, you would probably win it!"<<std::endl;
+                break;
+            case Analytics_Verdict::bad_fold:
+                std::cout<<"You would have been the winner... \n It seems that you got scared and ran out of the game when YOU HAD THE BEST CARDS!\n A VERY BAD FOLD decision! "<<std::endl;
+                break;
+            case Analytics_Verdict::strong_win_folded:
+                std::cout<<"You would have been the winner... \n It would have been a strong win! Other players did not have your hand rank \n Next time you can be more confident with similar cards"<<std::endl;
+                break;
+            case Analytics_Verdict::close_win_folded:
+                std::cout<<"You would have been the winner... but it would be a close one \n You and bots had the same rank type, but your rank quality would have been better!\n Next time you can try to play more aggressively in similar scenarios! "<<std::endl;
+                break;
+            case Analytics_Verdict::good_fold_unlucky:
+                std::cout<<" Your and winner hand ranks would have been the same, but the winner opponent had a better rank quality :) \n  GOOD FOLD decision ! And analytics admit that you were unlucky this game..."<<std::endl;
+                break;
+            case Analytics_Verdict::good_fold:
+                std::cout<<" Winner`s hand ranks were better \n so it was GOOD DECISION to FOLD"<<std::endl;
+                break;
+            default:
+                break;
+        }
+        
+        if (human_in_the_game == false){
+            std::cout<<" Your rank would have been:\n Human FINAL RANK: "<< Ranking::poker_rank_to_string(result.human_hand.first)<<" of order "<<result.human_hand.second<<"\n the winner`s hand rank was: "<< Ranking::poker_rank_to_string(result.winner_hand.first) << " of order "<< result.winner_hand.second<<std::endl;
+        }
+        
+        // chips are not prizes: the human's share of a 50/30/20 prize pool by ICM, before and after the hand
+        std::vector<double> stacks_before = { static_cast<double>(all_players_initial_copy.back().get_chips()) };
+        for (const auto& object : bot_initial_copy) {
+            stacks_before.push_back(object.get_chips());
+        }
+        double share_before = Icm::equity(stacks_before, session_payouts())[0];
+        double share_after = icm_equity(session_payouts())[0];
+        std::cout<<" Your share of the prize pool (ICM, 50/30/20 payouts) went from "<< 100 * share_before <<"% to "<< 100 * share_after <<"%"<<std::endl;
+    } // game analytics function end
+
+
+
+
+    
+    
+    
+    
+    
+    
+    // Plays one hand; the human's decisions are awaited from the attached input table
+    Driver::Task<> run() {
+        
+        if (it_is_the_first_game == true){
+            //initialise the game when it is the first game
+            int bot_chips;
+            std::cout<<"new bots created"<<std::endl;
+            
+            if (difficulty ==1){
+                bot_chips = starting_chips/2;
+                bot.create_bots(deck, nr_of_bots, bot_chips, rng);
+            } else if (difficulty == 2) {
+                bot_chips = starting_chips;
+                bot.create_bots(deck, nr_of_bots, bot_chips, rng);
+            } else if (difficulty == 3) {
+                bot_chips = starting_chips*2;
+                bot.create_bots(deck, nr_of_bots, bot_chips, rng);
+            } else if (difficulty == 4){
+                bot_chips = starting_chips*10;
+                bot.create_bots(deck, nr_of_bots, bot_chips, rng);
+            }
+            
+            
+        } else {
+            // for later games only deck and player cards are updated
+            deck.recreate();
+            deck.populate_game_cards();
+            
+            bot.update_bots();
+            bot.redistribute_bot_cards(deck);
+            human.redistribute_human_cards(deck);
+        }
+        
+        
+        //initialise the primary game conditions
+        //containers help to keep track of the game 
+        human_in_the_game = true;
+        
+        bots_in_the_game = bot.get_bots();
+        bot_initial_copy = bot.get_bots();
+        all_players_initial_copy = bot.get_bots();
+        all_players_initial_copy.push_back(human);
+        begin_hand_record();
+        //main game loop
+        for (int round = 1; round <= 4; ++round) {
+            current_round = round;
+            std::cout<<std::endl<<std::endl << "Round " << round << " begins" << std::endl;
+            bool bots_responded = false;
+            
+           
+            if (round == 1){
+                // big and small blinds
+                int big_blind{starting_chips/10};
+                int small_blind{big_blind/2};
+                if (difficulty == 4){
+                    big_blind = big_blind*3;
+                    small_blind=small_blind*3;
+                }
+                std::pair<Player, Player> two_players = get_two_random_players(all_players_initial_copy);
+                Player &player1 = two_players.first;
+                Player &player2 = two_players.second;
+                big_blind_name = player1.get_name();
+                small_blind_name = player2.get_name();
+                
+                Player::show_player_info(bots_in_the_game);
+         
+                    if (player1.get_name() == "Human"){
+                        std::cout<<"BIG BLIND: Human" <<std::endl;
+                    } else {
+                        std::cout<<"BIG BLIND: Bot"<< std::endl;
+                        for (auto &object : bots_in_the_game){
+                            if (object.get_name() == player1.get_name()){
+                                object.bet(big_blind, pot);
+                                record_action(object.get_name(), Action_Type::blind, big_blind);
+                                bot.update_bot_chips(player1.get_name(), big_blind);
+                            }
+                        }
+                    }
+                    
+                    if (player2.get_name() == "Human"){
+                        std::cout<<"SMALL BLIND: Human" <<std::endl;
+                    } else {
+                        std::cout<<"SMALL BLIND: Bot"<< std::endl;
+                    }
+                    
+                human.show_human_cards();
+                std::cout<<"your private pot is: "<<human.get_chips()<<std::endl;
+                
+                bot_response(big_blind, player1.get_name());
+                if (bots_in_the_game.size()>0){
+                    if (human.get_chips()>big_blind){
+                        if (player1.get_name() != "Human" && player2.get_name() != "Human"){
+                            co_await human_response(big_blind);
+                        } else if (player2.get_name() == "Human"){
+                            human.bet(small_blind, pot);
+                            record_action(human.get_name(), Action_Type::blind, small_blind);
+                            co_await human_response(big_blind-small_blind);
+                        }
+                    } else {
+                        co_await human_response (human.get_chips());
+                    }
+                }
+            }
+            //shows the board and populates community cards
+            else if (round == 2) {
+                deck.take_flop();
+                show_board();
+            } else if (round == 3) {
+                deck.take_turn();
+                show_board();
+            } else if (round == 4) {
+                deck.take_river();
+                show_board();
+            }
+
+            
+            
+            
+            int highest_chips{0};
+            for (auto &object : bots_in_the_game ){
+                highest_chips = std::max(highest_chips, object.get_chips());
+            }
+            if (highest_chips == 0){
+                deck.take_flop();
+                deck.take_turn();
+                deck.take_river();
+                break;
+            }
+            
+            if (human_in_the_game == true && human.get_chips()>0 && round !=1){
+                bots_responded = co_await human_turn();
+            } if (bots_in_the_game.size()>0 && bots_responded == false && round !=1){
+                co_await bot_turn();
+            } else if ((bots_in_the_game.size() == 0 && human_in_the_game == true) || (bots_in_the_game.size()==1 && human_in_the_game == false)){
+                //ends the main game round loop if there is only a single player remaining in the game
+                deck.take_flop();
+                deck.take_turn();
+                deck.take_river();
+                break;
+            }
+            
+        
+        }//game round loop ends
+        
+        
+        std::vector<Player> remaining_players;
+        std::cout<<"the number of bots left was: "<< bots_in_the_game.size()<<std::endl;
+        if (human_in_the_game == true){
+            remaining_players.push_back(human);
+        }
+        
+        std::cout<<"final community pot: "<<pot.get_final_pot()<<std::endl;
+        std::cout<<"final community cards: ";
+        deck.print_community_cards();
+
+        
+        if (bots_in_the_game.size()>0){
+            for (const auto& bot : bots_in_the_game) {
+            remaining_players.push_back(bot);
+            }
+        }
+    
+        
+        // Determine the winner
+        std::vector<std::string> winner_names;
+        Ranking ranking;
+        
+        winner_names = ranking.determine_winner(remaining_players, deck);
+        
+       
+        // distribute the pot among winners
+        distribute_pot(winner_names, remaining_players, pot.get_final_pot());
+        
+        //the hand goes to the hand history before defeated bots are removed
+        finish_hand_record(remaining_players);
+        
+        
+        //introduce game analytics for human player
+        
+        game_analytics(winner_names, remaining_players);
+        
+        
+        
+        //delete bots that are out of the game
+        bot.delete_defeated_bots();
+        
+       
+        //reset pot
+        pot.reset();
+        
+        //reset game cards
+        
+        deck.reset();
+        
+        Ranking::reset();   
+        
+        
+        it_is_the_first_game = false;
+        
+        
+   
+    }//run function ending
+    
+   
+    
+    // Saves the session after every finished game, so it can be resumed if the process dies
+    void enable_autosave(const std::string& path) {
+        snapshot_path = path;
+    }
+    
+    Session_Snapshot take_snapshot() const {
+        Session_Snapshot snapshot;
+        snapshot.difficulty = difficulty;
+        snapshot.starting_chips = starting_chips;
+        snapshot.deck_type = static_cast<std::int32_t>(deck_type);
+        snapshot.variant = static_cast<std::int32_t>(variant);
+        snapshot.nr_of_bots = nr_of_bots;
+        snapshot.nr_of_games = nr_of_games_requested;
+        snapshot.games_played = games_played;
+        snapshot.human_chips = human.get_chips();
+        snapshot.nr_of_bots_left = std::min<int>(bot.bots.size(), Session_Snapshot::max_bots);
+        snapshot.rng_state = rng.get_state();
+        snapshot.rng_increment = rng.get_increment();
+        for (int i{0}; i < snapshot.nr_of_bots_left; i++) {
+            snapshot.bot_chips[i] = bot.bots[i].get_chips();
+            bot.bots[i].get_name().copy(snapshot.bot_names[i], sizeof(snapshot.bot_names[i]) - 1);
+        }
+        snapshot.checksum = snapshot.compute_checksum();
+        return snapshot;
+    }
+    
+    // Continues a session from a snapshot taken between games.
+    // The Game has to be constructed with the difficulty, bots, chips and variant stored in the snapshot.
+    void restore(const Session_Snapshot& snapshot) {
+        if (snapshot.difficulty != difficulty || snapshot.nr_of_bots != nr_of_bots || snapshot.starting_chips != starting_chips
+            || snapshot.variant != static_cast<std::int32_t>(variant)) {
+            throw std::invalid_argument("The snapshot belongs to a game with different settings.");
+        }
+        games_played = snapshot.games_played;
+        nr_of_games_requested = snapshot.nr_of_games;
+        human.update_chips(snapshot.human_chips);
+        rng.restore(snapshot.rng_state, snapshot.rng_increment);
+        
+        bot.bots.clear();
+        for (int i{0}; i < snapshot.nr_of_bots_left; i++) {
+            std::string name(snapshot.bot_names[i], strnlen(snapshot.bot_names[i], sizeof(snapshot.bot_names[i])));
+            bot.bots.emplace_back(name, snapshot.bot_chips[i], Card("", ""), Card("", ""));
+        }
+        it_is_the_first_game = snapshot.games_played == 0;
+    }
+    
+    // Plays one game without the console loop around it, for headless runs with scripted input: a busted
+    // human buys back in. Returns false once every bot is out.
+    Driver::Task<bool> play_unattended_game() {
+        if (bot.get_bots_number() == 0 && !it_is_the_first_game) {
+            co_return false;
+        }
+        if (human.get_chips() == 0) {
+            human.receive_pot_share(starting_chips);
+        }
+        co_await run();
+        games_played += 1;
+        co_return true;
+    }
+    
+    void reseed(std::uint64_t seed) {
+        rng = Session_Rng(seed);
+    }
+    
+    void fix_board(const std::vector<Card>& board) {
+        deck.fix_board(board);
+    }
+    
+    std::size_t get_bet_history_size() const {
+        return pot.get_bets().size();
+    }
+    
+    Driver::Task<> play_multiple_games(int nr_of_games) {
+        nr_of_games_requested = nr_of_games;
+        for (int game = games_played + 1; game <= nr_of_games; ++game) {
+            
+            if(human.get_chips() > 0) {
+                if(bot.get_bots_number() > 0 || it_is_the_first_game == true){
+                    //if all conditions are met, the game continues
+                    std::cout << "\n \n \n The Poker Game number " << game << " begins!\n";
+                    co_await run();
+                    games_played = game;
+                    if (history_writer) {
+                        history_writer->flush();
+                    }
+                    if (!snapshot_path.empty()) {
+                        take_snapshot().save(snapshot_path);
+                    }
+                }
+                if (bot.get_bots_number() == 0 && it_is_the_first_game == false) {
+                    std::cout << "\nCONGRATULATIONS! You have successfully defeated all of the bot players! Throughout these poker games you increased your chips up to: " << human.get_chips() << std::endl;
+                    break;
+                }
+            } else if (human.get_chips() == 0) {
+                // when the user lost the game
+                while (true) {
+                    try {
+                        std::cout << "\nYou have lost the game... It appears that you do not have any chips left. Now you can choose one out of two options:\n"
+                                  << "buyback - get free chips and continue playing\n"
+                                  << "quit - quits the program\n";
+                        std::string human_input;
+                        std::getline(std::cin, human_input); // Use getline to handle spaces in the input
+                        if (human_input == "buyback"){
+                            human.receive_pot_share(starting_chips);
+                            game -= 1;
+                            break;
+                        } else if (human_input == "quit"){
+                            while (true) {
+                                try {
+                                    std::cout << "Before you quit, would you like to see the previous games betting history [yes/no]? ";
+                                    std::string user_response;
+                                    if (!std::getline(std::cin, user_response)) {
+                                        co_return; // closed input counts as no
+                                    }
+                                    if (user_response == "yes"){
+                                        const std::vector<std::shared_ptr<Bet>>& bet_history = pot.get_bets();
+                                        for (const auto& bet : bet_history) {
+                                            std::cout << "Player " << bet->get_player_name() << " bet "
+                                                      << bet->get_amount() << " chips." << std::endl;
+                                        }
+                                        co_return;
+                                    } else if (user_response == "no"){
+                                        co_return;
+                                    } else {
+                                        throw std::invalid_argument("Invalid response. Please answer 'yes' or 'no'.");
+                                    }
+                                } catch (const std::exception& e) {
+                                    std::cout << e.what() << '\n';
+                                    throw; // Re-throw the exception to be caught by the outer loop
+                                }
+                            }
+                        } else {
+                            throw std::invalid_argument("Invalid response. Please choose 'buyback' or 'quit'.");
+                            }
+                    } catch (const std::exception& e) {
+                        std::cout << e.what() << '\n';
+                        continue;
+                        }
+                }
+    
+            }   
+        }
+            // after the games have passed
+            if (export_batch) {
+                export_batch->flush();
+            }
+            Stats::print_player_stats(stats_registry.merge(), 25);
+            if (leak_aggregator.nr_of_decisions() > 0) {
+                leak_aggregator.print();
+            }
+            std::string user_response;
+            while (true) {
+                try {
+                    std::cout<<  "The game has finished. Restart the program if you would like to play again \n Would you like to see betting history? [yes/no] \n";
+                    if (!(std::cin >> user_response)) {
+                        break; // closed input: nothing left to answer
+                    }
+            
+                    if (user_response == "yes") {
+                        const std::vector<std::shared_ptr<Bet>>& bet_history = pot.get_bets();
+                        for (const auto& bet : bet_history) {
+                            std::cout << "Player " << bet->get_player_name() << " bet "
+                                    << bet->get_amount() << " chips." << std::endl;
+                        }
+                        break;
+                    } else if (user_response != "no") {
+                        throw std::invalid_argument("Invalid response. Please answer 'yes' or 'no'.");
+                    } else {
+                        break;
+                    }
+                } catch (const std::invalid_argument& e) {
+                    std::cout << e.what() << '\n';
+                }
+            }
+     
+    }
+
+};
+
+} //namespace Game end
+
+namespace Replay {
+
+using Cards::Card;
+using Players::Player;
+using Game::Poker_Ranks;
+using Game::Ranking;
+using Table = Game::Game;
+
+// Aggregate results of re-running logged hands through the current ranking, pot and analytics logic
+struct alignas(64) Replay_Report {
+    std::uint64_t hands{0};
+    std::uint64_t showdowns{0};
+    std::uint64_t split_pots{0};
+    std::uint64_t partial_pots{0};
+    std::uint64_t changed_results{0};  // hands where today's pot distribution differs from the logged one
+    std::uint64_t human_hands{0};
+    std::int64_t human_net_chips{0};
+    std::array<std::uint64_t, 10> winning_ranks{};
+    std::array<std::uint64_t, static_cast<int>(Table::Analytics_Verdict::count)> verdicts{};
+    double seconds{0};
+    std::vector<Game::Stats::Player_Stats> player_stats;  // filled in the merged report only
+
+    void merge(const Replay_Report& other) {
+        hands += other.hands;
+        showdowns += other.showdowns;
+        split_pots += other.split_pots;
+        partial_pots += other.partial_pots;
+        changed_results += other.changed_results;
+        human_hands += other.human_hands;
+        human_net_chips += other.human_net_chips;
+        for (std::size_t i{0}; i < winning_ranks.size(); i++) {
+            winning_ranks[i] += other.winning_ranks[i];
+        }
+        for (std::size_t i{0}; i < verdicts.size(); i++) {
+            verdicts[i] += other.verdicts[i];
+        }
+    }
+
+    void print() const {
+        double hands_per_minute = seconds > 0 ? hands / seconds * 60 : 0;
+        std::cout << "Replayed " << hands << " hands in " << seconds << " s (" << static_cast<std::uint64_t>(hands_per_minute) << " hands/min)" << std::endl;
+        std::cout << "showdowns: " << showdowns << ", split pots: " << split_pots << ", partial pots: " << partial_pots
+                  << ", hands whose result changed: " << changed_results << std::endl;
+        std::cout << "Winning hand ranks:" << std::endl;
+        for (std::size_t i{0}; i < winning_ranks.size(); i++) {
+            if (winning_ranks[i] > 0) {
+                std::cout << "  " << Ranking::poker_rank_to_string(static_cast<Poker_Ranks>(i)) << ": " << winning_ranks[i] << std::endl;
+            }
+        }
+        std::cout << "Human hands: " << human_hands << ", net chips: " << human_net_chips << std::endl;
+        std::cout << "Analytics verdicts:" << std::endl;
+        for (std::size_t i{1}; i < verdicts.size(); i++) {
+            if (verdicts[i] > 0) {
+                std::cout << "  " << Table::analytics_verdict_to_string(static_cast<Table::Analytics_Verdict>(i)) << ": " << verdicts[i] << std::endl;
+            }
+        }
+        if (!player_stats.empty()) {
+            Game::Stats::print_player_stats(player_stats, 20);
+        }
+    }
+};
+
+// Re-runs one logged hand through Ranking, the pot distribution and the analytics.
+// Everything comes from the record, so no random numbers are drawn and no input is read.
+void replay_hand(const Game::History::Hand_View& hand, Replay_Report& report) {
+    Cards::Deck_Type deck_type = hand.deck_type();
+    std::vector<Card> community_cards;
+    for (int i{0}; i < hand.nr_of_board_cards(); i++) {
+        community_cards.push_back(Cards::card_from_index(hand.board()[i]));
+    }
+
+    std::array<std::int32_t, Game::History::max_seats> committed{};
+    int total_pot{0};
+    for (int i{0}; i < hand.nr_of_actions(); i++) {
+        const Game::History::Action_Entry& action = hand.actions()[i];
+        committed[action.seat] += action.amount;
+        total_pot += action.amount;
+    }
+
+    std::vector<Player> remaining_players;
+    std::vector<Player> initial_bots;
+    int human_seat{-1};
+    for (int i{0}; i < hand.nr_of_seats(); i++) {
+        const Game::History::Seat_Entry& seat = hand.seats()[i];
+        Player player(std::string(seat.name, strnlen(seat.name, sizeof(seat.name))), seat.starting_chips,
+                      Cards::card_from_index(seat.hole[0]), Cards::card_from_index(seat.hole[1]));
+        if (seat.flags & Game::History::seat_is_human) {
+            human_seat = i;
+        } else {
+            initial_bots.push_back(player);
+        }
+        if (!(seat.flags & Game::History::seat_folded)) {
+            remaining_players.push_back(player);
+        }
+    }
+
+    report.hands += 1;
+    if (remaining_players.empty()) {
+        return;
+    }
+    if (remaining_players.size() > 1) {
+        report.showdowns += 1;
+    }
+
+    std::vector<std::string> winner_names = Ranking::find_winners(remaining_players, community_cards, deck_type);
+    for (const auto& player : remaining_players) {
+        if (player.get_name() == winner_names[0]) {
+            std::pair<Poker_Ranks, int> winning_hand = Ranking::evaluate_player_hand(player, community_cards, deck_type);
+            report.winning_ranks[static_cast<int>(winning_hand.first)] += 1;
+            break;
+        }
+    }
+    if (winner_names.size() > 1) {
+        report.split_pots += 1;
+    }
+
+    std::array<std::int32_t, Game::History::max_seats> won{};
+    bool partial_pot{false};
+    for (const auto& share : Table::compute_pot_shares(winner_names, remaining_players, total_pot, initial_bots)) {
+        for (int i{0}; i < hand.nr_of_seats(); i++) {
+            if (std::strncmp(hand.seats()[i].name, share.player_name.c_str(), sizeof(hand.seats()[i].name)) == 0) {
+                won[i] += share.amount;
+            }
+        }
+        partial_pot = partial_pot || share.kind == Table::Share_Kind::partial_pot;
+    }
+    report.partial_pots += partial_pot ? 1 : 0;
+    for (int i{0}; i < hand.nr_of_seats(); i++) {
+        if (won[i] != hand.seats()[i].won) {
+            report.changed_results += 1;
+            break;
+        }
+    }
+
+    if (human_seat >= 0) {
+        const Game::History::Seat_Entry& seat = hand.seats()[human_seat];
+        int net_chips = won[human_seat] - committed[human_seat];
+        Player human(std::string(seat.name, strnlen(seat.name, sizeof(seat.name))), seat.starting_chips + net_chips,
+                     Cards::card_from_index(seat.hole[0]), Cards::card_from_index(seat.hole[1]));
+        bool human_played_to_the_end = !(seat.flags & Game::History::seat_folded);
+        Table::Analytics_Result result = Table::analyse_game(winner_names, remaining_players, human, human_played_to_the_end, total_pot, community_cards,
+                                                                   deck_type);
+        report.verdicts[static_cast<int>(result.verdict)] += 1;
+        report.human_hands += 1;
+        report.human_net_chips += net_chips;
+    }
+}
+
+// Replays history files in parallel, one file (shard) at a time per thread, and merges the reports
+Replay_Report replay_shards(const std::vector<std::string>& paths, unsigned nr_of_threads) {
+    nr_of_threads = std::max(1u, std::min<unsigned>(nr_of_threads, paths.size()));
+    std::vector<Replay_Report> reports(nr_of_threads);
+    std::vector<std::string> errors(nr_of_threads);
+    std::atomic<std::size_t> next_shard{0};
+    Game::Stats::Stats_Registry stats_registry;
+    auto start = std::chrono::steady_clock::now();
+
+    std::vector<std::thread> workers;
+    for (unsigned t{0}; t < nr_of_threads; t++) {
+        workers.emplace_back([&, t]() {
+            try {
+                Game::Stats::Counter_Block& stats_block = stats_registry.new_block();
+                Game::Stats::Hand_Tracker stats_tracker;
+                for (std::size_t shard = next_shard++; shard < paths.size(); shard = next_shard++) {
+                    Game::History::Hand_History_Reader reader(paths[shard]);
+                    reader.for_each_hand([&](const Game::History::Hand_View& hand) {
+                        replay_hand(hand, reports[t]);
+                        stats_tracker.track_hand(stats_block, hand);
+                    });
+                }
+            } catch (const std::exception& e) {
+                errors[t] = e.what();
+            }
+        });
+    }
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    for (const auto& error : errors) {
+        if (!error.empty()) {
+            throw std::runtime_error(error);
+        }
+    }
+
+    Replay_Report total;
+    for (const auto& report : reports) {
+        total.merge(report);
+    }
+    total.player_stats = stats_registry.merge();
+    total.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return total;
+}
+
+} // namespace Replay end
+
+namespace Import {
+
+using Game::History::Hand_Record;
+
+// Totals of one import run
+struct Import_Report {
+    std::uint64_t hands{0};
+    std::uint64_t malformed{0};
+    std::uint64_t bytes{0};
+    double seconds{0};
+
+    void print() const {
+        double megabytes = bytes / 1e6;
+        std::cout << "Imported " << hands << " hands (" << malformed << " malformed hands skipped) from "
+                  << megabytes << " MB in " << seconds << " s: "
+                  << (seconds > 0 ? megabytes / seconds : 0) << " MB/s, "
+                  << static_cast<std::uint64_t>(seconds > 0 ? hands / seconds : 0) << " hands/s" << std::endl;
+    }
+};
+
+// Parses PokerStars style text hand histories into hand records.
+// Every field is a std::string_view into the mapped file, so tokenizing allocates nothing.
+class Text_Hand_Parser {
+private:
+    Hand_Record& record;
+    bool amounts_in_cents{false};
+    int street{0};
+    std::array<std::int32_t, Game::History::max_seats> street_bets{};
+    std::array<int, Game::History::max_seats> last_chip_action{};   // -1 until the seat puts chips in
+    std::array<std::string_view, Game::History::max_seats> names{};
+
+    static bool starts_with(std::string_view text, std::string_view prefix) {
+        return text.substr(0, prefix.size()) == prefix;
+    }
+
+    static std::string_view trim(std::string_view text) {
+        while (!text.empty() && (text.back() == '\r' || text.back() == ' ')) {
+            text.remove_suffix(1);
+        }
+        while (!text.empty() && text.front() == ' ') {
+            text.remove_prefix(1);
+        }
+        return text;
+    }
+
+    // "Ah" to a compact card index
+    static bool parse_card(std::string_view token, std::uint8_t& card) {
+        if (token.size() != 2) {
+            return false;
+        }
+        static const std::string_view rank_letters = "23456789TJQKA";
+        static const std::string_view suit_letters = "hdcs";  // same order as Cards::suit_symbols
+        std::size_t rank = rank_letters.find(token[0]);
+        std::size_t suit = suit_letters.find(token[1]);
+        if (rank == std::string_view::npos || suit == std::string_view::npos) {
+            return false;
+        }
+        card = static_cast<std::uint8_t>(rank * 4 + suit);
+        return true;
+    }
+
+    // Reads the cards of the last "[..]" group of a line
+    static int parse_card_group(std::string_view line, std::uint8_t* cards, int max_cards) {
+        std::size_t open = line.rfind('[');
+        std::size_t close = line.rfind(']');
+        if (open == std::string_view::npos || close == std::string_view::npos || close < open) {
+            return -1;
+        }
+        std::string_view group = line.substr(open + 1, close - open - 1);
+        int count{0};
+        while (!group.empty()) {
+            std::size_t space = group.find(' ');
+            std::string_view token = group.substr(0, space);
+            if (!token.empty()) {
+                if (count == max_cards || !parse_card(token, cards[count])) {
+                    return -1;
+                }
+                count++;
+            }
+            group = space == std::string_view::npos ? std::string_view{} : group.substr(space + 1);
+        }
+        return count;
+    }
+
+    // "$1,234.50" to 123450 for cash games, "1500" to 1500 for tournament chips
+    bool parse_amount(std::string_view token, std::int32_t& amount) const {
+        std::int64_t whole{0};
+        std::int64_t fraction{0};
+        int fraction_digits{-1};
+        bool digits{false};
+        for (char c : token) {
+            if (c >= '0' && c <= '9') {
+                digits = true;
+                if (fraction_digits < 0) {
+                    whole = whole * 10 + (c - '0');
+                } else if (fraction_digits < 2) {
+                    fraction = fraction * 10 + (c - '0');
+                    fraction_digits++;
+                }
+            } else if (c == '.') {
+                fraction_digits = 0;
+            } else if (c != ',' && c != '$' && static_cast<unsigned char>(c) < 0x80) {
+                break;
+            }
+        }
+        if (!digits) {
+            return false;
+        }
+        if (amounts_in_cents) {
+            while (fraction_digits < 2) {
+                fraction *= 10;
+                fraction_digits = fraction_digits < 0 ? 1 : fraction_digits + 1;
+            }
+            whole = whole * 100 + fraction;
+        }
+        if (whole > std::numeric_limits<std::int32_t>::max()) {
+            return false;
+        }
+        amount = static_cast<std::int32_t>(whole);
+        return true;
+    }
+
+    // Amount that follows a keyword, e.g. the 4 in "raises $2 to $4" after "to "
+    bool amount_after(std::string_view text, std::string_view keyword, std::int32_t& amount) const {
+        std::size_t at = text.find(keyword);
+        return at != std::string_view::npos && parse_amount(text.substr(at + keyword.size()), amount);
+    }
+
+    int seat_of_line(std::string_view line, std::string_view& rest) const {
+        for (int i{0}; i < record.header.nr_of_seats; i++) {
+            if (line.size() > names[i].size() + 1 && starts_with(line, names[i]) && line[names[i].size()] == ':') {
+                rest = trim(line.substr(names[i].size() + 1));
+                return i;
+            }
+        }
+        return -1;
+    }
+
+    int seat_named(std::string_view name) const {
+        for (int i{0}; i < record.header.nr_of_seats; i++) {
+            if (names[i] == name) {
+                return i;
+            }
+        }
+        return -1;
+    }
+
+    // An ante is dead money: "raises to" amounts do not include it, so it stays out of the street bet
+    void add(int seat, Game::Action_Type type, std::int32_t amount, bool is_ante = false) {
+        if (amount > 0 && record.header.nr_of_actions < Game::History::max_actions) {
+            last_chip_action[seat] = record.header.nr_of_actions;
+        }
+        if (!is_ante) {
+            street_bets[seat] += amount;
+        }
+        record.add_action(seat, street, static_cast<std::uint8_t>(type), amount);
+    }
+
+    bool parse_seat_line(std::string_view line) {
+        // Seat 3: name ($1.50 in chips)
+        std::size_t colon = line.find(": ");
+        std::size_t open = line.rfind(" (");
+        if (colon == std::string_view::npos || open == std::string_view::npos || open < colon) {
+            return false;
+        }
+        std::int32_t chips{0};
+        if (!parse_amount(line.substr(open + 2), chips) || record.header.nr_of_seats == Game::History::max_seats) {
+            return false;
+        }
+        std::string_view name = line.substr(colon + 2, open - colon - 2);
+        names[record.header.nr_of_seats] = name;
+        record.add_seat(std::string(name.substr(0, 11)), chips, Cards::no_card, Cards::no_card, false);
+        return true;
+    }
+
+    bool parse_action_line(std::string_view line) {
+        std::string_view rest;
+        int seat = seat_of_line(line, rest);
+        if (seat < 0) {
+            // "Dealt to", "Uncalled bet", "x collected" and table chatter
+            if (starts_with(line, "Dealt to ")) {
+                std::size_t open = line.rfind(" [");
+                int hero = open == std::string_view::npos ? -1 : seat_named(line.substr(9, open - 9));
+                if (hero < 0 || parse_card_group(line, record.seats[hero].hole, 2) != 2) {
+                    return false;
+                }
+                record.seats[hero].flags |= Game::History::seat_is_human;
+            } else if (starts_with(line, "Uncalled bet (")) {
+                std::int32_t returned{0};
+                std::size_t to = line.find(" returned to ");
+                int player = to == std::string_view::npos ? -1 : seat_named(line.substr(to + 13));
+                if (player < 0 || !parse_amount(line.substr(14), returned)) {
+                    return false;
+                }
+                // only the called part of the last bet (or the blind, on a walk) was really at stake;
+                // the bet keeps its size and the refund follows it as its own entry
+                int action = last_chip_action[player];
+                if (action < 0 || record.actions[action].amount < returned) {
+                    return false;
+                }
+                add(player, Game::Action_Type::uncalled, -returned);
+            } else {
+                std::size_t collected = line.find(" collected ");
+                if (collected != std::string_view::npos) {
+                    int player = seat_named(line.substr(0, collected));
+                    std::int32_t amount{0};
+                    if (player < 0 || !parse_amount(line.substr(collected + 11), amount)) {
+                        return false;
+                    }
+                    record.seats[player].won += amount;
+                }
+            }
+            return true;
+        }
+
+        std::int32_t amount{0};
+        if (starts_with(rest, "folds")) {
+            add(seat, Game::Action_Type::fold, 0);
+            record.seats[seat].flags |= Game::History::seat_folded;
+        } else if (starts_with(rest, "checks")) {
+            add(seat, Game::Action_Type::check, 0);
+        } else if (starts_with(rest, "calls ")) {
+            if (!parse_amount(rest.substr(6), amount)) {
+                return false;
+            }
+            add(seat, Game::Action_Type::call, amount);
+        } else if (starts_with(rest, "bets ")) {
+            if (!parse_amount(rest.substr(5), amount)) {
+                return false;
+            }
+            add(seat, Game::Action_Type::raise, amount);
+        } else if (starts_with(rest, "raises ")) {
+            // "raises $2 to $4": the street bet becomes 4
+            if (!amount_after(rest, " to ", amount)) {
+                return false;
+            }
+            add(seat, Game::Action_Type::raise, amount - street_bets[seat]);
+        } else if (starts_with(rest, "posts ")) {
+            std::size_t space = rest.rfind(' ');
+            if (!parse_amount(rest.substr(space + 1), amount)) {
+                return false;
+            }
+            add(seat, Game::Action_Type::blind, amount, starts_with(rest, "posts the ante"));
+        } else if (starts_with(rest, "shows ")) {
+            if (parse_card_group(rest, record.seats[seat].hole, 2) != 2) {
+                return false;
+            }
+            record.seats[seat].flags |= Game::History::seat_at_showdown;
+        }
+        return true;
+    }
+
+public:
+    explicit Text_Hand_Parser(Hand_Record& i_record) : record(i_record) {}
+
+    // Parses one hand, from its "PokerStars Hand #" line up to the next hand; false for a malformed hand
+    bool parse(std::string_view text) {
+        street = 0;
+        street_bets.fill(0);
+        last_chip_action.fill(-1);
+
+        std::size_t end_of_line = text.find('\n');
+        std::string_view title = trim(text.substr(0, end_of_line));
+        std::size_t hash = title.find('#');
+        if (hash == std::string_view::npos) {
+            return false;
+        }
+        std::uint64_t hand_id{0};
+        for (std::size_t i = hash + 1; i < title.size() && title[i] >= '0' && title[i] <= '9'; i++) {
+            hand_id = hand_id * 10 + (title[i] - '0');
+        }
+        amounts_in_cents = title.find('$') != std::string_view::npos || title.find("\xE2\x82\xAC") != std::string_view::npos
+                           || title.find("\xC2\xA3") != std::string_view::npos;
+        record.begin(hand_id);
+
+        bool in_summary{false};
+        while (end_of_line != std::string_view::npos) {
+            text.remove_prefix(end_of_line + 1);
+            end_of_line = text.find('\n');
+            std::string_view line = trim(text.substr(0, end_of_line));
+            if (line.empty()) {
+                continue;
+            }
+            if (starts_with(line, "*** ")) {
+                std::uint8_t board[5];
+                int nr_of_cards{-1};
+                int previous_street = street;
+                if (starts_with(line, "*** FLOP ***")) {
+                    street = 1;
+                    nr_of_cards = parse_card_group(line, board, 3);
+                    if (nr_of_cards != 3) {
+                        return false;
+                    }
+                    record.set_board(board, 3);
+                } else if (starts_with(line, "*** TURN ***") || starts_with(line, "*** RIVER ***")) {
+                    street = starts_with(line, "*** TURN ***") ? 2 : 3;
+                    if (parse_card_group(line, board, 1) != 1) {
+                        return false;
+                    }
+                    record.header.board[street + 1] = board[0];
+                } else if (starts_with(line, "*** SUMMARY ***")) {
+                    in_summary = true;
+                }
+                // the blinds posted before "*** HOLE CARDS ***" still count towards the preflop bet
+                if (street != previous_street) {
+                    street_bets.fill(0);
+                }
+                continue;
+            }
+            if (in_summary) {
+                continue;
+            }
+            if (starts_with(line, "Seat ") && line.find(" in chips") != std::string_view::npos) {
+                if (!parse_seat_line(line)) {
+                    return false;
+                }
+            } else if (starts_with(line, "Table ")) {
+                continue;
+            } else if (!parse_action_line(line)) {
+                return false;
+            }
+        }
+        return record.header.nr_of_seats >= 2;
+    }
+};
+
+// Streams text hand history files into a binary hand history.
+// The files are mapped read only and the pages behind the parser are released as it goes,
+// so memory stays bounded however large the archive is.
+Import_Report import_text_histories(const std::vector<std::string>& paths, Game::History::Hand_History_Writer& writer) {
+    Import_Report report;
+    auto start = std::chrono::steady_clock::now();
+    auto record = std::make_unique<Hand_Record>();
+    Text_Hand_Parser parser(*record);
+    const std::size_t release_interval = 64 << 20;
+    const std::size_t page_size = static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+
+    for (const auto& path : paths) {
+        int descriptor = ::open(path.c_str(), O_RDONLY);
+        if (descriptor < 0) {
+            throw std::runtime_error("Could not open " + path);
+        }
+        struct stat file_info;
+        if (fstat(descriptor, &file_info) != 0 || file_info.st_size == 0) {
+            ::close(descriptor);
+            continue;
+        }
+        std::size_t size = file_info.st_size;
+        void* mapped = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, descriptor, 0);
+        ::close(descriptor);
+        if (mapped == MAP_FAILED) {
+            throw std::runtime_error("Could not map " + path);
+        }
+        madvise(mapped, size, MADV_SEQUENTIAL);
+        const char* data = static_cast<const char*>(mapped);
+        std::string_view file(data, size);
+        report.bytes += size;
+
+        const std::string_view hand_start = "PokerStars ";
+        std::size_t released{0};
+        std::size_t position = file.find(hand_start);
+        while (position != std::string_view::npos) {
+            std::size_t next = file.find("\nPokerStars ", position);
+            std::string_view hand = file.substr(position, next == std::string_view::npos ? std::string_view::npos : next + 1 - position);
+            if (parser.parse(hand)) {
+                writer.append(*record);
+                report.hands += 1;
+            } else {
+                report.malformed += 1;
+            }
+            position = next == std::string_view::npos ? next : next + 1;
+
+            if (position != std::string_view::npos && position - released > release_interval) {
+                std::size_t release_end = position / page_size * page_size;
+                madvise(const_cast<char*>(data) + released, release_end - released, MADV_DONTNEED);
+                released = release_end;
+            }
+        }
+        munmap(mapped, size);
+    }
+    writer.flush();
+    report.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return report;
+}
+
+} // namespace Import end
+
+namespace Tournament {
+
+using Game::Action;
+using Game::Action_Type;
+using Game::Game_State;
+using Game::Variant;
+
+struct Blind_Level {
+    std::int32_t small_blind;
+    std::int32_t big_blind;
+};
+
+// Blinds start at 1/100 of a stack and grow by half every level
+inline std::vector<Blind_Level> make_blind_schedule(int starting_chips, int nr_of_levels) {
+    std::vector<Blind_Level> levels;
+    double big_blind = std::max(2, starting_chips / 100);
+    for (int i{0}; i < nr_of_levels; i++) {
+        std::int32_t rounded = static_cast<std::int32_t>(big_blind) / 2 * 2;
+        levels.push_back({ rounded / 2, rounded });
+        big_blind *= 1.5;
+    }
+    return levels;
+}
+
+struct Entrant {
+    std::string name;
+    std::int32_t chips{0};
+    std::int32_t chips_at_round_start{0};
+    int finish_place{0};  // 0 while the entrant is still playing
+};
+
+struct Table {
+    std::vector<int> seats;  // entrant ids in seating order
+    int button{0};
+    Cards::Session_Rng rng;
+    std::uint64_t hands_played{0};
+};
+
+struct Tournament_Settings {
+    int nr_of_entrants{1000};
+    int starting_chips{1500};
+    int max_players_per_table{9};
+    int hands_per_level{30};             // counted in balancing rounds
+    int hands_between_balancing{1};
+    unsigned nr_of_threads{std::max(1u, std::thread::hardware_concurrency())};
+    std::uint64_t seed{0x5EED};
+    Variant variant{Variant::holdem};
+};
+
+struct Tournament_Result {
+    std::vector<int> places;             // entrant ids, winner first
+    std::uint64_t hands_played{0};
+    int levels_reached{0};
+    int tables_broken{0};
+    int players_moved{0};
+    double seconds{0};
+};
+
+// Rough 0..1 strength of an Omaha hand: high cards, pairs, suits and ranks that work together
+inline double omaha_hand_strength(const Game_State& state, int seat) {
+    const std::uint8_t* hole = state.hole(seat);
+    int high{0};
+    for (int i{0}; i < 4; i++) {
+        high = std::max(high, hole[i] / 4);
+    }
+    if (state.street != Game_State::preflop) {
+        int nr_of_board_cards = std::min<int>(state.street + 2, 5);
+        const double by_category[9] = { 0.05, 0.3, 0.5, 0.65, 0.75, 0.82, 0.9, 0.97, 1.0 };
+        return by_category[Eval::category(Eval::evaluate_omaha(hole, state.board.data(), nr_of_board_cards))] + high / 120.0;
+    }
+    int suit_counts[4] = {};
+    unsigned rank_mask{0};
+    double strength{0};
+    for (int i{0}; i < 4; i++) {
+        strength += hole[i] / 4 / 80.0;
+        suit_counts[hole[i] % 4] += 1;
+        if (rank_mask >> (hole[i] / 4) & 1u) {
+            strength += 0.05 + hole[i] / 4 / 120.0;  // a pair
+        }
+        rank_mask |= 1u << (hole[i] / 4);
+    }
+    for (int count : suit_counts) {
+        strength += count >= 2 ? 0.06 : 0;
+    }
+    for (int rank{0}; rank + 3 < 13; rank++) {
+        if (__builtin_popcount(rank_mask >> rank & 0xF) >= 3) {
+            strength += 0.08;  // three ranks within a straight's reach
+            break;
+        }
+    }
+    return strength;
+}
+
+// Rough 0..1 strength of the hand from the cards the player can see
+inline double hand_strength(const Game_State& state, int seat) {
+    if (state.variant == Variant::omaha) {
+        return omaha_hand_strength(state, seat);
+    }
+    std::uint8_t cards[7] = { state.hole_cards[2 * seat], state.hole_cards[2 * seat + 1] };
+    int high = std::max(cards[0], cards[1]) / 4;
+    int low = std::min(cards[0], cards[1]) / 4;
+    if (state.street == Game_State::preflop) {
+        // a short deck has no cards below six, so its ranks are spread over the same scale
+        int lowest = Cards::lowest_rank(state.deck_type());
+        double high_rank = (high - lowest) * 12.0 / (12 - lowest);
+        double low_rank = (low - lowest) * 12.0 / (12 - lowest);
+        if (high == low) {
+            return 0.5 + high_rank / 24.0;
+        }
+        return (high_rank + low_rank) / 26.0 + (cards[0] % 4 == cards[1] % 4 ? 0.05 : 0) - (high - low > 4 ? 0.1 : 0);
+    }
+    int nr_of_board_cards = std::min<int>(state.street + 2, 5);
+    for (int i{0}; i < nr_of_board_cards; i++) {
+        cards[2 + i] = state.board[i];
+    }
+    const double by_category[9] = { 0.15, 0.45, 0.7, 0.8, 0.85, 0.88, 0.92, 0.97, 1.0 };
+    Eval::Strength strength = Eval::evaluate(cards, 2 + nr_of_board_cards, state.deck_type());
+    return by_category[Eval::category(strength, state.deck_type())] + high / 120.0;
+}
+
+// Simple tight-aggressive bot: raises strong hands, calls playable ones and folds the rest to bets
+inline Action choose_action(const Game_State& state, Cards::Session_Rng& rng) {
+    Action actions[Game_State::max_actions]{};
+    int nr_of_actions = state.legal_actions(actions);
+    int seat = state.to_act;
+    std::uniform_real_distribution<double> noise(0.0, 0.15);
+    double strength = hand_strength(state, seat) + noise(rng);
+
+    Action passive = actions[0].type == Action_Type::fold ? actions[1] : actions[0];
+    const Action* raise = nullptr;
+    for (int i{0}; i < nr_of_actions; i++) {
+        if (actions[i].type == Action_Type::raise) {
+            raise = &actions[i];
+            if (i + 1 < nr_of_actions) {
+                raise = &actions[i + 1];  // prefer the pot sized raise over the min raise
+            }
+            break;
+        }
+    }
+    bool facing_bet = actions[0].type == Action_Type::fold;
+    double price = facing_bet ? static_cast<double>(state.amount_to_call(seat)) / (state.pot + state.amount_to_call(seat)) : 0;
+
+    if (raise != nullptr && strength > (facing_bet ? 0.85 : 0.7)) {
+        return *raise;
+    }
+    if (facing_bet && strength < 0.35 + price) {
+        return actions[0];
+    }
+    return passive;
+}
+
+// Plays one hand at a table with the blinds of the current level and pays out the pot.
+// Players who busted earlier in the round keep their seat until the round ends but are dealt out.
+inline void play_hand(Table& table, std::vector<Entrant>& entrants, const Blind_Level& blinds, Variant variant) {
+    std::array<int, Game_State::max_seats> players{};
+    int nr_of_seats{0};
+    int dealer{0};  // players are listed from the button on
+    for (int i{0}; i < static_cast<int>(table.seats.size()); i++) {
+        int position = (table.button + i) % table.seats.size();
+        if (entrants[table.seats[position]].chips > 0) {
+            players[nr_of_seats++] = table.seats[position];
+        }
+    }
+    std::array<std::uint8_t, 52> deck;
+    int deck_size = variant == Variant::short_deck ? 36 : 52;
+    for (int i{0}; i < deck_size; i++) {
+        deck[i] = static_cast<std::uint8_t>(52 - deck_size + i);
+    }
+    int cards_per_player = variant == Variant::omaha ? 4 : 2;
+    int cards_needed = cards_per_player * nr_of_seats + 5;
+    for (int i{0}; i < cards_needed; i++) {
+        std::uniform_int_distribution<int> pick(i, deck_size - 1);
+        std::swap(deck[i], deck[pick(table.rng)]);
+    }
+
+    std::array<std::int32_t, Game_State::max_seats> stacks{};
+    for (int i{0}; i < nr_of_seats; i++) {
+        stacks[i] = entrants[players[i]].chips;
+    }
+    Game_State state;
+    state.variant = variant;
+    state.start_hand(nr_of_seats, stacks.data(), deck.data(), deck.data() + cards_per_player * nr_of_seats, dealer,
+                     blinds.small_blind, blinds.big_blind);
+    while (!state.hand_is_over()) {
+        state.apply(choose_action(state, table.rng));
+    }
+
+    std::array<std::int32_t, Game_State::max_seats> won{};
+    state.settle([&state](int seat) { return state.showdown_strength(seat); }, won);
+    for (int i{0}; i < nr_of_seats; i++) {
+        entrants[players[i]].chips = state.chips[i] + won[i];
+    }
+    table.button = (table.button + 1) % table.seats.size();
+    table.hands_played += 1;
+}
+
+// Runs a freezeout with many tables. Tables play in parallel between balancing rounds; after each round
+// busted players are placed, tables are broken when the rest fit on fewer tables and the others are balanced.
+class Tournament_Director {
+private:
+    Tournament_Settings settings;
+    std::vector<Entrant> entrants;
+    std::vector<Table> tables;
+    std::vector<Blind_Level> schedule;
+    Tournament_Result result;
+    int players_left{0};
+
+    void seat_entrants(Cards::Session_Rng& rng) {
+        std::vector<int> order(entrants.size());
+        for (std::size_t i{0}; i < order.size(); i++) {
+            order[i] = i;
+        }
+        std::shuffle(order.begin(), order.end(), rng);
+        int nr_of_tables = (order.size() + settings.max_players_per_table - 1) / settings.max_players_per_table;
+        tables.resize(nr_of_tables);
+        for (std::size_t i{0}; i < order.size(); i++) {
+            tables[i % nr_of_tables].seats.push_back(order[i]);
+        }
+        for (auto& table : tables) {
+            table.rng = Cards::Session_Rng(rng());
+        }
+    }
+
+    void play_round(const Blind_Level& blinds) {
+        std::atomic<std::size_t> next_table{0};
+        auto work = [&]() {
+            for (std::size_t t = next_table++; t < tables.size(); t = next_table++) {
+                Table& table = tables[t];
+                for (int hand{0}; hand < settings.hands_between_balancing; hand++) {
+                    // a table only touches its own entrants, so the tables need no locking
+                    int seated_with_chips{0};
+                    for (int id : table.seats) {
+                        seated_with_chips += entrants[id].chips > 0 ? 1 : 0;
+                    }
+                    if (seated_with_chips < 2) {
+                        break;
+                    }
+                    play_hand(table, entrants, blinds, settings.variant);
+                }
+            }
+        };
+        unsigned nr_of_threads = std::max(1u, std::min<unsigned>(settings.nr_of_threads, tables.size()));
+        std::vector<std::thread> workers;
+        for (unsigned t{1}; t < nr_of_threads; t++) {
+            workers.emplace_back(work);
+        }
+        work();
+        for (auto& worker : workers) {
+            worker.join();
+        }
+    }
+
+    void remove_busted(Table& table) {
+        for (std::size_t i{0}; i < table.seats.size();) {
+            if (entrants[table.seats[i]].chips == 0) {
+                table.seats.erase(table.seats.begin() + i);
+                if (static_cast<int>(i) < table.button) {
+                    table.button -= 1;
+                }
+            } else {
+                i++;
+            }
+        }
+        table.button = table.seats.empty() ? 0 : table.button % table.seats.size();
+    }
+
+    // Busted players finish in reverse order of the stacks they started the round with
+    void place_busted_players() {
+        std::vector<int> busted;
+        for (auto& table : tables) {
+            for (int id : table.seats) {
+                if (entrants[id].chips == 0) {
+                    busted.push_back(id);
+                }
+            }
+            remove_busted(table);
+        }
+        std::sort(busted.begin(), busted.end(), [this](int a, int b) {
+            return entrants[a].chips_at_round_start < entrants[b].chips_at_round_start;
+        });
+        for (int id : busted) {
+            entrants[id].finish_place = players_left--;
+            result.places.push_back(id);
+        }
+    }
+
+    // Moves the player who would post the next big blind, as a tournament director would
+    void move_player(Table& from, Table& to) {
+        int seat = (from.button + 2) % from.seats.size();
+        int id = from.seats[seat];
+        from.seats.erase(from.seats.begin() + seat);
+        if (seat < from.button) {
+            from.button -= 1;
+        }
+        from.button = from.seats.empty() ? 0 : from.button % from.seats.size();
+        // the new player sits down just before the button and posts when the blinds reach them
+        to.seats.insert(to.seats.begin() + to.button, id);
+        to.button = (to.button + 1) % to.seats.size();
+        result.players_moved += 1;
+    }
+
+    void break_and_balance() {
+        tables.erase(std::remove_if(tables.begin(), tables.end(), [](const Table& table) { return table.seats.empty(); }), tables.end());
+        auto by_size = [](const Table& a, const Table& b) { return a.seats.size() < b.seats.size(); };
+
+        std::size_t tables_needed = (players_left + settings.max_players_per_table - 1) / settings.max_players_per_table;
+        while (tables.size() > std::max<std::size_t>(tables_needed, 1)) {
+            auto smallest = std::min_element(tables.begin(), tables.end(), by_size);
+            Table broken = std::move(*smallest);
+            tables.erase(smallest);
+            while (!broken.seats.empty()) {
+                move_player(broken, *std::min_element(tables.begin(), tables.end(), by_size));
+            }
+            result.tables_broken += 1;
+        }
+        while (true) {
+            auto [smallest, largest] = std::minmax_element(tables.begin(), tables.end(), by_size);
+            if (largest->seats.size() - smallest->seats.size() <= 1) {
+                break;
+            }
+            move_player(*largest, *smallest);
+        }
+    }
+
+public:
+    explicit Tournament_Director(const Tournament_Settings& i_settings) : settings(i_settings) {
+        if (settings.nr_of_entrants < 2) {
+            throw std::invalid_argument("A tournament needs at least 2 entrants.");
+        }
+        if (settings.max_players_per_table < 2 || settings.max_players_per_table > Game_State::max_seats) {
+            throw std::invalid_argument("Tables seat 2 to 21 players.");
+        }
+        const std::vector<std::string> names = Players::Bot().names;
+        for (int i{0}; i < settings.nr_of_entrants; i++) {
+            Entrant entrant;
+            entrant.name = names[i % names.size()] + " " + std::to_string(i / names.size() + 1);
+            entrant.chips = settings.starting_chips;
+            entrants.push_back(entrant);
+        }
+        schedule = make_blind_schedule(settings.starting_chips, 40);
+    }
+
+    const std::vector<Entrant>& get_entrants() const { return entrants; }
+
+    Tournament_Result run() {
+        auto start = std::chrono::steady_clock::now();
+        Cards::Session_Rng rng(settings.seed);
+        seat_entrants(rng);
+        players_left = entrants.size();
+        for (int round{0}; players_left > 1; round++) {
+            int level = std::min<int>(round / settings.hands_per_level, schedule.size() - 1);
+            result.levels_reached = level + 1;
+            for (auto& entrant : entrants) {
+                entrant.chips_at_round_start = entrant.chips;
+            }
+            play_round(schedule[level]);
+            for (auto& table : tables) {
+                result.hands_played += table.hands_played;
+                table.hands_played = 0;
+            }
+            place_busted_players();
+            break_and_balance();
+        }
+        for (const auto& table : tables) {
+            for (int id : table.seats) {
+                entrants[id].finish_place = 1;
+                result.places.push_back(id);
+            }
+        }
+        std::reverse(result.places.begin(), result.places.end());
+        result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        return result;
+    }
+};
+
+} // namespace Tournament end
+
+
+// Vectorized environment for training agents: N independent tables stepped with one call.
+// Each table seats one agent (seat 0 of its Game_State) against the tournament bots. An episode is one
+// hand with fresh stacks; the button moves every hand, so the agent plays every position. Per table
+// values live in one array per field, and observations and rewards go straight into caller buffers,
+// so stepping never allocates.
+namespace Env {
+
+using Game::Action;
+using Game::Action_Type;
+using Game::Game_State;
+
+// Discrete agent actions. Actions that are not legal at the moment fall back to check/call.
+constexpr int action_fold = 0;
+constexpr int action_check_call = 1;
+constexpr int action_min_raise = 2;
+constexpr int action_pot_raise = 3;
+constexpr int action_all_in = 4;
+constexpr int nr_of_actions = 5;
+
+// The action of the given kind for the player to act
+inline Action agent_action(const Game_State& state, int kind) {
+    bool facing_bet = state.committed[state.to_act] < state.level;
+    Action passive{facing_bet ? Action_Type::call : Action_Type::check, 0};
+    bool can_raise = state.chips[state.to_act] > state.level - state.committed[state.to_act];
+    switch (kind) {
+        case action_fold:
+            return facing_bet ? Action{Action_Type::fold, 0} : passive;
+        case action_min_raise:
+            return can_raise ? Action{Action_Type::raise, state.min_raise_to()} : passive;
+        case action_pot_raise: {
+            int pot_to = state.level - state.street_start_level + state.pot + state.amount_to_call(state.to_act);
+            return can_raise ? Action{Action_Type::raise, std::clamp(pot_to, state.min_raise_to(), state.max_raise_to())} : passive;
+        }
+        case action_all_in:
+            return can_raise ? Action{Action_Type::raise, state.max_raise_to()} : passive;
+        default:
+            return passive;
+    }
+}
+
+// Bit per action kind that does what it says for the player to act, check/call always does
+inline std::uint8_t legal_action_mask(const Game_State& state) {
+    int seat = state.to_act;
+    std::uint8_t mask = 1u << action_check_call;
+    if (state.committed[seat] < state.level) {
+        mask |= 1u << action_fold;
+    }
+    if (state.chips[seat] > state.level - state.committed[seat]) {
+        mask |= 1u << action_min_raise | 1u << action_pot_raise | 1u << action_all_in;
+    }
+    return mask;
+}
+
+struct Env_Settings {
+    int nr_of_tables{1};
+    int nr_of_seats{6};
+    int starting_chips{200};
+    int big_blind{2};
+};
+
+// Tables are stored as a struct of arrays: each field of every table sits in one contiguous array, so
+// observe() streams through memory. A step loads one table into a scratch Game_State, plays it and stores
+// it back, which keeps a single undo log per environment instead of one per table.
+class Vector_Env {
+private:
+    Env_Settings settings;
+    int observation_size;
+    Game_State scratch;
+    // nr_of_tables * nr_of_seats entries, seats of a table next to each other
+    std::vector<std::int32_t> chips;
+    std::vector<std::int32_t> committed;
+    std::vector<std::uint8_t> hole_cards;  // two per seat
+    // one entry per table
+    std::vector<std::uint8_t> boards;      // five per table
+    std::vector<std::uint32_t> folded_masks;
+    std::vector<std::uint32_t> acted_masks;
+    std::vector<std::int32_t> pots;
+    std::vector<std::int32_t> levels;
+    std::vector<std::int32_t> street_start_levels;
+    std::vector<std::int32_t> last_raises;
+    std::vector<std::uint8_t> to_act;
+    std::vector<std::uint8_t> streets;
+    std::vector<std::uint8_t> buttons;
+    std::vector<Cards::Session_Rng> rngs;
+    std::vector<std::uint64_t> hands_played;
+
+    void load(int table) {
+        int seats = settings.nr_of_seats;
+        std::size_t first = static_cast<std::size_t>(table) * seats;
+        scratch.forget_undo_log();
+        scratch.nr_of_seats = static_cast<std::uint8_t>(seats);
+        scratch.big_blind = settings.big_blind;
+        std::copy_n(&chips[first], seats, scratch.chips.begin());
+        std::copy_n(&committed[first], seats, scratch.committed.begin());
+        std::copy_n(&hole_cards[2 * first], 2 * seats, scratch.hole_cards.begin());
+        std::copy_n(&boards[5 * static_cast<std::size_t>(table)], 5, scratch.board.begin());
+        scratch.folded_mask = folded_masks[table];
+        scratch.acted_mask = acted_masks[table];
+        scratch.pot = pots[table];
+        scratch.level = levels[table];
+        scratch.street_start_level = street_start_levels[table];
+        scratch.last_raise = last_raises[table];
+        scratch.to_act = to_act[table];
+        scratch.street = streets[table];
+        scratch.button = buttons[table];
+    }
+
+    void store(int table) {
+        int seats = settings.nr_of_seats;
+        std::size_t first = static_cast<std::size_t>(table) * seats;
+        std::copy_n(scratch.chips.begin(), seats, &chips[first]);
+        std::copy_n(scratch.committed.begin(), seats, &committed[first]);
+        std::copy_n(scratch.hole_cards.begin(), 2 * seats, &hole_cards[2 * first]);
+        std::copy_n(scratch.board.begin(), 5, &boards[5 * static_cast<std::size_t>(table)]);
+        folded_masks[table] = scratch.folded_mask;
+        acted_masks[table] = scratch.acted_mask;
+        pots[table] = scratch.pot;
+        levels[table] = scratch.level;
+        street_start_levels[table] = scratch.street_start_level;
+        last_raises[table] = scratch.last_raise;
+        to_act[table] = scratch.to_act;
+        streets[table] = scratch.street;
+        buttons[table] = scratch.button;
+    }
+
+    // Deals hands in the scratch state until the agent has a decision, then stores the table.
+    // Hands the agent never gets to act in are dealt again.
+    void start_hand(int table) {
+        Cards::Session_Rng& rng = rngs[table];
+        std::array<std::int32_t, Game_State::max_seats> stacks;
+        stacks.fill(settings.starting_chips);
+        do {
+            std::array<std::uint8_t, 52> deck;
+            for (int i{0}; i < 52; i++) {
+                deck[i] = static_cast<std::uint8_t>(i);
+            }
+            int cards_needed = 2 * settings.nr_of_seats + 5;
+            for (int i{0}; i < cards_needed; i++) {
+                int j = i + static_cast<int>(rng() % static_cast<std::uint64_t>(52 - i));
+                std::swap(deck[i], deck[j]);
+            }
+            buttons[table] = static_cast<std::uint8_t>((buttons[table] + 1) % settings.nr_of_seats);
+            scratch.start_hand(settings.nr_of_seats, stacks.data(), deck.data(), deck.data() + 2 * settings.nr_of_seats,
+                               buttons[table], settings.big_blind / 2, settings.big_blind);
+            play_bots(table);
+            hands_played[table] += 1;
+        } while (scratch.hand_is_over());
+        store(table);
+    }
+
+    void play_bots(int table) {
+        while (!scratch.hand_is_over() && scratch.to_act != 0) {
+            scratch.apply(Tournament::choose_action(scratch, rngs[table]));
+        }
+    }
+
+    // legal_action_mask straight from the arrays
+    std::uint8_t legal_mask(int table) const {
+        std::size_t seat = static_cast<std::size_t>(table) * settings.nr_of_seats + to_act[table];
+        std::uint8_t mask = 1u << action_check_call;
+        if (committed[seat] < levels[table]) {
+            mask |= 1u << action_fold;
+        }
+        if (chips[seat] > levels[table] - committed[seat]) {
+            mask |= 1u << action_min_raise | 1u << action_pot_raise | 1u << action_all_in;
+        }
+        return mask;
+    }
+
+public:
+    explicit Vector_Env(const Env_Settings& i_settings) : settings(i_settings) {
+        if (settings.nr_of_tables < 1) {
+            throw std::invalid_argument("The environment needs at least one table.");
+        }
+        if (settings.nr_of_seats < 2 || settings.nr_of_seats > Game_State::max_seats) {
+            throw std::invalid_argument("Tables seat 2 to 21 players.");
+        }
+        if (settings.big_blind < 2 || settings.starting_chips <= settings.big_blind) {
+            throw std::invalid_argument("The stacks have to cover more than a big blind of at least 2 chips.");
+        }
+        // hole cards, board, street, pot, to call, stack, position, then stack, bet and folded per opponent, legal actions
+        observation_size = 52 + 52 + 4 + 4 + 3 * (settings.nr_of_seats - 1) + nr_of_actions;
+        std::size_t tables = settings.nr_of_tables;
+        std::size_t seats = tables * settings.nr_of_seats;
+        chips.assign(seats, 0);
+        committed.assign(seats, 0);
+        hole_cards.assign(2 * seats, 0);
+        boards.assign(5 * tables, 0);
+        folded_masks.assign(tables, 0);
+        acted_masks.assign(tables, 0);
+        pots.assign(tables, 0);
+        levels.assign(tables, 0);
+        street_start_levels.assign(tables, 0);
+        last_raises.assign(tables, 0);
+        to_act.assign(tables, 0);
+        streets.assign(tables, 0);
+        buttons.assign(tables, 0);
+        rngs.resize(tables);
+        hands_played.assign(tables, 0);
+    }
+
+    int get_observation_size() const { return observation_size; }
+    int get_nr_of_tables() const { return settings.nr_of_tables; }
+    std::uint64_t get_hands_played(int table) const { return hands_played[table]; }
+
+    // Seeds every table with seeds[table] and deals its first hand
+    void reset(const std::uint64_t* seeds) {
+        for (int table{0}; table < settings.nr_of_tables; table++) {
+            rngs[table] = Cards::Session_Rng(seeds[table]);
+            buttons[table] = 0;
+            hands_played[table] = 0;
+            start_hand(table);
+        }
+    }
+
+    // Applies actions[table] for the agent of every table and plays the bots up to the agent's next decision.
+    // When a hand ends, rewards[table] is the agent's result in big blinds, dones[table] is 1 and the
+    // table has already dealt its next hand.
+    void step(const std::int32_t* actions, float* rewards, std::uint8_t* dones) {
+        for (int table{0}; table < settings.nr_of_tables; table++) {
+            load(table);
+            scratch.apply(agent_action(scratch, actions[table]));
+            play_bots(table);
+            rewards[table] = 0;
+            dones[table] = 0;
+            if (scratch.hand_is_over()) {
+                std::array<std::int32_t, Game_State::max_seats> won{};
+                scratch.settle([this](int seat) { return scratch.showdown_strength(seat); }, won);
+                rewards[table] = static_cast<float>(scratch.chips[0] + won[0] - settings.starting_chips) / settings.big_blind;
+                dones[table] = 1;
+                start_hand(table);
+            } else {
+                store(table);
+            }
+        }
+    }
+
+    // Writes get_observation_size() floats per table, seen from the agent's seat
+    void observe(float* observations) const {
+        float big_blind = static_cast<float>(settings.big_blind);
+        int seats = settings.nr_of_seats;
+        for (int table{0}; table < settings.nr_of_tables; table++) {
+            std::size_t first = static_cast<std::size_t>(table) * seats;
+            const std::int32_t* table_chips = &chips[first];
+            const std::int32_t* table_committed = &committed[first];
+            const std::uint8_t* board = &boards[5 * static_cast<std::size_t>(table)];
+            int street = streets[table];
+            float* out = observations + static_cast<std::size_t>(table) * observation_size;
+            std::fill(out, out + observation_size, 0.0f);
+            out[hole_cards[2 * first]] = 1;
+            out[hole_cards[2 * first + 1]] = 1;
+            int nr_of_board_cards = street == Game_State::preflop ? 0 : std::min(street + 2, 5);
+            for (int i{0}; i < nr_of_board_cards; i++) {
+                out[52 + board[i]] = 1;
+            }
+            out[104 + std::min<int>(street, Game_State::river)] = 1;
+            out[108] = pots[table] / big_blind;
+            out[109] = std::min(std::max(levels[table] - table_committed[0], 0), table_chips[0]) / big_blind;
+            out[110] = table_chips[0] / big_blind;
+            // seats from the button to the agent, 0 on the button
+            out[111] = static_cast<float>((seats - buttons[table]) % seats) / (seats - 1);
+            float* opponents = out + 112;
+            for (int seat{1}; seat < seats; seat++) {
+                opponents[3 * (seat - 1)] = table_chips[seat] / big_blind;
+                opponents[3 * (seat - 1) + 1] = table_committed[seat] / big_blind;
+                opponents[3 * (seat - 1) + 2] = static_cast<float>((folded_masks[table] >> seat) & 1u);
+            }
+            float* legal = out + observation_size - nr_of_actions;
+            std::uint8_t legal_mask_bits = legal_mask(table);
+            for (int kind{0}; kind < nr_of_actions; kind++) {
+                legal[kind] = static_cast<float>((legal_mask_bits >> kind) & 1u);
+            }
+        }
+    }
+};
+
+} // namespace Env end
+
+
+// C interface to the environment, for training code in other languages.
+// Build it as a library with: g++ -std=c++20 -O2 -pthread -shared -fPIC -DPOKER_NO_MAIN poker_final.cpp -o libpoker.so
+// Calls on one environment must not overlap; run one environment per training thread.
+// No exception crosses the interface: calls that can fail return 0 on success and -1 on an error.
+struct Poker_Env {
+    Env::Vector_Env env;
+};
+
+extern "C" {
+
+// Returns nullptr when the settings are invalid
+Poker_Env* poker_env_create(int nr_of_tables, int nr_of_seats, int starting_chips, int big_blind) {
+    try {
+        return new Poker_Env{ Env::Vector_Env({ nr_of_tables, nr_of_seats, starting_chips, big_blind }) };
+    } catch (...) {
+        return nullptr;
+    }
+}
+
+void poker_env_destroy(Poker_Env* handle) {
+    delete handle;
+}
+
+int poker_env_observation_size(const Poker_Env* handle) {
+    return handle ? handle->env.get_observation_size() : -1;
+}
+
+int poker_env_nr_of_actions() {
+    return Env::nr_of_actions;
+}
+
+// seeds holds one value per table
+int poker_env_reset(Poker_Env* handle, const std::uint64_t* seeds) {
+    if (!handle || !seeds) {
+        return -1;
+    }
+    try {
+        handle->env.reset(seeds);
+        return 0;
+    } catch (...) {
+        return -1;
+    }
+}
+
+// actions, rewards and dones hold one value per table
+int poker_env_step(Poker_Env* handle, const std::int32_t* actions, float* rewards, std::uint8_t* dones) {
+    if (!handle || !actions || !rewards || !dones) {
+        return -1;
+    }
+    try {
+        handle->env.step(actions, rewards, dones);
+        return 0;
+    } catch (...) {
+        return -1;
+    }
+}
+
+// observations holds poker_env_observation_size() floats per table
+int poker_env_observe(const Poker_Env* handle, float* observations) {
+    if (!handle || !observations) {
+        return -1;
+    }
+    try {
+        handle->env.observe(observations);
+        return 0;
+    } catch (...) {
+        return -1;
+    }
+}
+
+} // extern "C" end
+
+
+// Local game server: one epoll loop owns every socket, each client plays a cash game seat against bots at
+// its own table, and bot decisions run on a worker pool so a slow bot never stalls the loop.
+// Messages are a 4 byte payload length followed by the payload, whose first byte is the message type.
+namespace Server {
+
+using Game::Game_State;
+
+constexpr std::uint8_t message_join = 1;         // client: Join_Message
+constexpr std::uint8_t message_action = 2;       // client: Action_Message
+constexpr std::uint8_t message_decision = 10;    // server: Decision_Message, the client's seat has to act
+constexpr std::uint8_t message_hand_result = 11; // server: Hand_Result_Message
+constexpr std::uint8_t message_error = 12;       // server: type byte and text, the connection is closed after it
+constexpr std::uint32_t max_message_size = 64;
+
+struct Join_Message {
+    std::uint8_t type{message_join};
+    std::uint8_t nr_of_bots{5};
+    std::uint8_t reserved[2]{};
+    std::int32_t starting_chips{200};
+};
+
+struct Action_Message {
+    std::uint8_t type{message_action};
+    std::uint8_t action{Env::action_check_call};  // Env action kind
+};
+
+struct Decision_Message {
+    std::uint8_t type{message_decision};
+    std::uint8_t street;
+    std::uint8_t hole[2];
+    std::uint8_t board[5];                         // Cards::no_card for cards that are not dealt yet
+    std::uint8_t legal_actions;                    // bit per Env action kind
+    std::uint8_t reserved[2];
+    std::uint32_t hand_id;
+    std::int32_t pot;
+    std::int32_t to_call;
+    std::int32_t stack;
+};
+
+struct Hand_Result_Message {
+    std::uint8_t type{message_hand_result};
+    std::uint8_t reserved[3]{};
+    std::uint32_t hand_id;
+    std::int32_t net;                              // chips won or lost in the hand
+    std::int32_t stack;                            // after a rebuy when the client busted
+};
+
+static_assert(sizeof(Join_Message) == 8 && sizeof(Action_Message) == 2 && sizeof(Decision_Message) == 28
+              && sizeof(Hand_Result_Message) == 16, "messages are copied to and from the wire as they are");
+
+// Unix domain socket path, or host:port for a TCP socket on a loopback address
+struct Address {
+    bool is_tcp{false};
+    std::string path;
+    sockaddr_in tcp{};
+};
+
+inline Address parse_address(const std::string& text) {
+    Address address;
+    std::size_t colon = text.rfind(':');
+    if (colon == std::string::npos) {
+        if (text.empty() || text.size() >= sizeof(sockaddr_un::sun_path)) {
+            throw std::invalid_argument("Invalid socket path: " + text);
+        }
+        address.path = text;
+        return address;
+    }
+    address.is_tcp = true;
+    address.tcp.sin_family = AF_INET;
+    std::string host = text.substr(0, colon);
+    int port = std::stoi(text.substr(colon + 1));
+    if (port <= 0 || port > 65535 || inet_pton(AF_INET, host.empty() ? "127.0.0.1" : host.c_str(), &address.tcp.sin_addr) != 1) {
+        throw std::invalid_argument("Invalid address: " + text);
+    }
+    address.tcp.sin_port = htons(static_cast<std::uint16_t>(port));
+    return address;
+}
+
+inline int open_socket(const Address& address) {
+    int fd = socket(address.is_tcp ? AF_INET : AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        throw std::runtime_error("Could not create a socket.");
+    }
+    if (address.is_tcp) {
+        int enable{1};
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &enable, sizeof(enable));
+        setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &enable, sizeof(enable));
+    }
+    return fd;
+}
+
+// Calls connect or bind with the address
+template <typename Socket_Call>
+int with_sockaddr(const Address& address, Socket_Call call) {
+    if (address.is_tcp) {
+        return call(reinterpret_cast<const sockaddr*>(&address.tcp), static_cast<socklen_t>(sizeof(address.tcp)));
+    }
+    sockaddr_un unix_address{};
+    unix_address.sun_family = AF_UNIX;
+    address.path.copy(unix_address.sun_path, sizeof(unix_address.sun_path) - 1);
+    return call(reinterpret_cast<const sockaddr*>(&unix_address), static_cast<socklen_t>(sizeof(unix_address)));
+}
+
+// Thousands of connections need more descriptors than the usual default of 1024
+inline void raise_descriptor_limit() {
+    rlimit limit{};
+    if (getrlimit(RLIMIT_NOFILE, &limit) == 0 && limit.rlim_cur < limit.rlim_max) {
+        limit.rlim_cur = limit.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &limit);
+    }
+}
+
+// Appends a framed message to a send buffer
+template <typename Message>
+void append_message(std::vector<char>& buffer, const Message& message) {
+    std::uint32_t size = sizeof(Message);
+    const char* size_bytes = reinterpret_cast<const char*>(&size);
+    const char* bytes = reinterpret_cast<const char*>(&message);
+    buffer.insert(buffer.end(), size_bytes, size_bytes + sizeof(size));
+    buffer.insert(buffer.end(), bytes, bytes + sizeof(Message));
+}
+
+// Decision for the seat to act, seen from that seat
+inline Decision_Message decision_message(const Game_State& state, std::uint32_t hand_id) {
+    int seat = state.to_act;
+    Decision_Message decision{};
+    decision.type = message_decision;
+    decision.street = state.street;
+    decision.hole[0] = state.hole(seat)[0];
+    decision.hole[1] = state.hole(seat)[1];
+    int nr_of_board_cards = state.street == Game_State::preflop ? 0 : std::min(state.street + 2, 5);
+    for (int i{0}; i < 5; i++) {
+        decision.board[i] = i < nr_of_board_cards ? state.board[i] : Cards::no_card;
+    }
+    decision.legal_actions = Env::legal_action_mask(state);
+    decision.hand_id = hand_id;
+    decision.pot = state.pot;
+    decision.to_call = state.amount_to_call(seat);
+    decision.stack = state.chips[seat];
+    return decision;
+}
+
+// One client's table. While a job for the table is queued or running only the worker touches it,
+// otherwise only the event loop does.
+struct Server_Table {
+    Game_State state;
+    Cards::Session_Rng rng;
+    std::array<std::int32_t, Game_State::max_seats> stacks{};
+    int nr_of_seats{0};
+    int starting_chips{0};
+    int big_blind{0};
+    int button{0};
+    std::uint32_t hand_id{0};
+    bool in_hand{false};
+    int pending_action{-1};                        // client action the worker applies first
+    std::array<char, 128> outbox{};                // framed messages the worker produced for the client
+    int outbox_size{0};
+
+    template <typename Message>
+    void post(const Message& message) {
+        std::uint32_t size = sizeof(Message);
+        std::memcpy(&outbox[outbox_size], &size, sizeof(size));
+        std::memcpy(&outbox[outbox_size + sizeof(size)], &message, sizeof(Message));
+        outbox_size += sizeof(size) + sizeof(Message);
+    }
+
+    void start_hand() {
+        for (int seat{0}; seat < nr_of_seats; seat++) {
+            if (stacks[seat] < big_blind) {
+                stacks[seat] = starting_chips;  // cash game: busted players buy in again
+            }
+        }
+        std::array<std::uint8_t, 52> deck;
+        for (int i{0}; i < 52; i++) {
+            deck[i] = static_cast<std::uint8_t>(i);
+        }
+        for (int i{0}; i < 2 * nr_of_seats + 5; i++) {
+            int j = i + static_cast<int>(rng() % static_cast<std::uint64_t>(52 - i));
+            std::swap(deck[i], deck[j]);
+        }
+        button = (button + 1) % nr_of_seats;
+        hand_id += 1;
+        state.start_hand(nr_of_seats, stacks.data(), deck.data(), deck.data() + 2 * nr_of_seats, button, big_blind / 2, big_blind);
+        in_hand = true;
+    }
+
+    // Applies the client's action and plays on until the client has to decide again
+    void advance() {
+        outbox_size = 0;
+        if (pending_action >= 0 && in_hand && !state.hand_is_over() && state.to_act == 0) {
+            state.apply(Env::agent_action(state, pending_action));
+        }
+        pending_action = -1;
+        while (true) {
+            if (!in_hand) {
+                start_hand();
+            }
+            while (!state.hand_is_over() && state.to_act != 0) {
+                state.apply(Tournament::choose_action(state, rng));
+            }
+            if (!state.hand_is_over()) {
+                break;
+            }
+            std::array<std::int32_t, Game_State::max_seats> won{};
+            state.settle([this](int seat) { return state.showdown_strength(seat); }, won);
+            std::int32_t before = stacks[0];
+            for (int seat{0}; seat < nr_of_seats; seat++) {
+                stacks[seat] = state.chips[seat] + won[seat];
+            }
+            in_hand = false;
+            if (outbox_size + 4 + static_cast<int>(sizeof(Hand_Result_Message)) + 4 + static_cast<int>(sizeof(Decision_Message))
+                > static_cast<int>(outbox.size())) {
+                return;  // the client acts on the results first, the next hand follows with its next job
+            }
+            Hand_Result_Message result;
+            result.hand_id = hand_id;
+            result.net = stacks[0] - before;
+            result.stack = stacks[0] < big_blind ? starting_chips : stacks[0];
+            post(result);
+        }
+        post(decision_message(state, hand_id));
+    }
+};
+
+// Runs table jobs on worker threads and hands finished tables back to the event loop through an eventfd.
+// A job carries the table itself, so workers never index the server's table list while it grows.
+class Worker_Pool {
+private:
+    std::mutex mutex;
+    std::condition_variable has_jobs;
+    std::deque<std::pair<int, Server_Table*>> jobs;
+    std::vector<int> finished;
+    bool stopping{false};
+    std::vector<std::thread> threads;
+
+public:
+    const int wake_fd;
+
+    explicit Worker_Pool(unsigned nr_of_threads)
+        : wake_fd(eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)) {
+        if (wake_fd < 0) {
+            throw std::runtime_error("Could not create an eventfd.");
+        }
+        for (unsigned t{0}; t < std::max(1u, nr_of_threads); t++) {
+            threads.emplace_back([this]() { work(); });
+        }
+    }
+
+    ~Worker_Pool() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        has_jobs.notify_all();
+        for (auto& thread : threads) {
+            thread.join();
+        }
+        close(wake_fd);
+    }
+
+    void submit(int table, Server_Table* server_table) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            jobs.emplace_back(table, server_table);
+        }
+        has_jobs.notify_one();
+    }
+
+    // Moves the tables whose jobs are done into out
+    void take_finished(std::vector<int>& out) {
+        std::uint64_t count;
+        while (read(wake_fd, &count, sizeof(count)) > 0) {
+        }
+        std::lock_guard<std::mutex> lock(mutex);
+        out.swap(finished);
+        finished.clear();
+    }
+
+private:
+    void work() {
+        while (true) {
+            std::pair<int, Server_Table*> job;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                has_jobs.wait(lock, [this]() { return stopping || !jobs.empty(); });
+                if (stopping) {
+                    return;
+                }
+                job = jobs.front();
+                jobs.pop_front();
+            }
+            auto [table, server_table] = job;
+            server_table->advance();
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                finished.push_back(table);
+            }
+            std::uint64_t one{1};
+            ssize_t written = write(wake_fd, &one, sizeof(one));
+            (void)written;
+        }
+    }
+};
+
+struct Connection {
+    int fd{-1};
+    std::uint32_t generation{0};                   // tells a reused descriptor from the client that had it before
+    int table{-1};
+    bool waiting_for_action{false};
+    bool writing{false};                           // EPOLLOUT is registered
+    bool closing{false};                           // close once the output is sent
+    std::vector<char> input;
+    std::size_t input_start{0};
+    std::vector<char> output;
+};
+
+inline std::atomic<bool> stop_requested{false};
+
+class Game_Server {
+private:
+    int listen_fd{-1};
+    int epoll_fd{-1};
+    Address address;
+    std::vector<Connection> connections;                    // indexed by descriptor
+    std::vector<std::unique_ptr<Server_Table>> tables;
+    std::vector<std::pair<int, std::uint32_t>> table_owner;  // connection descriptor and generation
+    std::vector<bool> table_busy;                           // a worker job is queued or running
+    std::vector<int> free_tables;
+    std::uint32_t next_generation{1};
+    Worker_Pool pool;
+    std::uint64_t messages_received{0};
+
+public:
+    Game_Server(const std::string& address_text, unsigned nr_of_workers)
+        : address(parse_address(address_text)), pool(nr_of_workers) {
+        raise_descriptor_limit();
+        listen_fd = open_socket(address);
+        if (!address.is_tcp) {
+            unlink(address.path.c_str());
+        }
+        if (with_sockaddr(address, [this](const sockaddr* a, socklen_t size) { return bind(listen_fd, a, size); }) != 0
+            || listen(listen_fd, SOMAXCONN) != 0) {
+            close(listen_fd);
+            throw std::runtime_error("Could not listen on " + address_text);
+        }
+        epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+        watch(listen_fd, EPOLLIN);
+        watch(pool.wake_fd, EPOLLIN);
+    }
+
+    ~Game_Server() {
+        for (auto& connection : connections) {
+            if (connection.fd >= 0) {
+                close(connection.fd);
+            }
+        }
+        close(listen_fd);
+        close(epoll_fd);
+        if (!address.is_tcp) {
+            unlink(address.path.c_str());
+        }
+    }
+
+    // Serves until stop_requested is set
+    void run() {
+        std::array<epoll_event, 256> events;
+        std::vector<int> finished;
+        while (!stop_requested.load()) {
+            int count = epoll_wait(epoll_fd, events.data(), events.size(), 100);
+            for (int i{0}; i < count; i++) {
+                int fd = events[i].data.fd;
+                if (fd == listen_fd) {
+                    accept_clients();
+                } else if (fd == pool.wake_fd) {
+                    pool.take_finished(finished);
+                    for (int table : finished) {
+                        table_done(table);
+                    }
+                } else {
+                    if (events[i].events & (EPOLLERR | EPOLLHUP)) {
+                        drop(fd);
+                        continue;
+                    }
+                    if (events[i].events & EPOLLIN) {
+                        receive(fd);
+                    }
+                    if (connections[fd].fd >= 0 && (events[i].events & EPOLLOUT)) {
+                        flush(fd);
+                    }
+                }
+            }
+        }
+    }
+
+    std::uint64_t get_messages_received() const { return messages_received; }
+
+private:
+    void watch(int fd, std::uint32_t events) {
+        epoll_event event{};
+        event.events = events;
+        event.data.fd = fd;
+        epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &event);
+    }
+
+    void accept_clients() {
+        while (true) {
+            int fd = accept4(listen_fd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+            if (fd < 0) {
+                return;
+            }
+            if (address.is_tcp) {
+                int enable{1};
+                setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &enable, sizeof(enable));
+            }
+            if (static_cast<std::size_t>(fd) >= connections.size()) {
+                connections.resize(fd + 1);
+            }
+            Connection& connection = connections[fd];
+            connection = Connection{};
+            connection.fd = fd;
+            connection.generation = next_generation++;
+            connection.input.reserve(4096);
+            connection.output.reserve(4096);
+            watch(fd, EPOLLIN);
+        }
+    }
+
+    void receive(int fd) {
+        Connection& connection = connections[fd];
+        char buffer[16384];
+        while (true) {
+            ssize_t received = recv(fd, buffer, sizeof(buffer), 0);
+            if (received == 0 || (received < 0 && errno != EAGAIN && errno != EWOULDBLOCK)) {
+                drop(fd);
+                return;
+            }
+            if (received < 0) {
+                break;
+            }
+            connection.input.insert(connection.input.end(), buffer, buffer + received);
+        }
+        while (connection.fd >= 0 && !connection.closing && connection.input.size() - connection.input_start >= 4) {
+            std::uint32_t size;
+            std::memcpy(&size, &connection.input[connection.input_start], sizeof(size));
+            if (size == 0 || size > max_message_size) {
+                fail(fd, "Invalid message size.");
+                break;
+            }
+            if (connection.input.size() - connection.input_start < 4 + size) {
+                break;
+            }
+            const char* payload = &connection.input[connection.input_start + 4];
+            connection.input_start += 4 + size;
+            messages_received += 1;
+            handle(fd, payload, size);
+        }
+        if (connections[fd].fd >= 0) {
+            Connection& still_open = connections[fd];
+            still_open.input.erase(still_open.input.begin(), still_open.input.begin() + still_open.input_start);
+            still_open.input_start = 0;
+        }
+    }
+
+    void handle(int fd, const char* payload, std::uint32_t size) {
+        Connection& connection = connections[fd];
+        std::uint8_t type = static_cast<std::uint8_t>(payload[0]);
+        if (type == message_join && size == sizeof(Join_Message) && connection.table < 0) {
+            Join_Message join;
+            std::memcpy(&join, payload, sizeof(join));
+            if (join.nr_of_bots < 1 || join.nr_of_bots >= Game_State::max_seats || join.starting_chips < 20) {
+                fail(fd, "Invalid table settings.");
+                return;
+            }
+            int table = new_table();
+            Server_Table& server_table = *tables[table];
+            server_table.nr_of_seats = join.nr_of_bots + 1;
+            server_table.starting_chips = join.starting_chips;
+            server_table.big_blind = std::max(2, join.starting_chips / 100 * 2);
+            server_table.stacks.fill(join.starting_chips);
+            server_table.rng = Cards::Session_Rng(connection.generation * 0x9E3779B97F4A7C15ull);
+            connection.table = table;
+            table_owner[table] = { fd, connection.generation };
+            submit(table);
+        } else if (type == message_action && size == sizeof(Action_Message) && connection.table >= 0 && connection.waiting_for_action) {
+            Action_Message action;
+            std::memcpy(&action, payload, sizeof(action));
+            if (action.action >= Env::nr_of_actions) {
+                fail(fd, "Invalid action.");
+                return;
+            }
+            connection.waiting_for_action = false;
+            tables[connection.table]->pending_action = action.action;
+            submit(connection.table);
+        } else {
+            fail(fd, "Unexpected message.");
+        }
+    }
+
+    int new_table() {
+        if (!free_tables.empty()) {
+            int table = free_tables.back();
+            free_tables.pop_back();
+            tables[table] = std::make_unique<Server_Table>();
+            return table;
+        }
+        tables.push_back(std::make_unique<Server_Table>());
+        table_owner.emplace_back(-1, 0);
+        table_busy.push_back(false);
+        return tables.size() - 1;
+    }
+
+    void submit(int table) {
+        table_busy[table] = true;
+        pool.submit(table, tables[table].get());
+    }
+
+    void table_done(int table) {
+        table_busy[table] = false;
+        auto [fd, generation] = table_owner[table];
+        if (fd < 0 || connections[fd].fd < 0 || connections[fd].generation != generation) {
+            release_table(table);  // the client left while the bots were playing
+            return;
+        }
+        Connection& connection = connections[fd];
+        Server_Table& server_table = *tables[table];
+        connection.output.insert(connection.output.end(), server_table.outbox.begin(), server_table.outbox.begin() + server_table.outbox_size);
+        if (!server_table.in_hand) {
+            submit(table);  // results filled the outbox, deal the next hand
+        } else {
+            connection.waiting_for_action = true;
+        }
+        flush(fd);
+    }
+
+    void release_table(int table) {
+        table_owner[table] = { -1, 0 };
+        free_tables.push_back(table);
+    }
+
+    void flush(int fd) {
+        Connection& connection = connections[fd];
+        std::size_t sent_total{0};
+        while (sent_total < connection.output.size()) {
+            ssize_t sent = send(fd, connection.output.data() + sent_total, connection.output.size() - sent_total, MSG_NOSIGNAL);
+            if (sent < 0) {
+                if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                    break;
+                }
+                drop(fd);
+                return;
+            }
+            sent_total += sent;
+        }
+        connection.output.erase(connection.output.begin(), connection.output.begin() + sent_total);
+        bool pending = !connection.output.empty();
+        if (pending != connection.writing) {
+            epoll_event event{};
+            event.events = EPOLLIN | (pending ? EPOLLOUT : 0u);
+            event.data.fd = fd;
+            epoll_ctl(epoll_fd, EPOLL_CTL_MOD, fd, &event);
+            connection.writing = pending;
+        }
+        if (!pending && connection.closing) {
+            drop(fd);
+        }
+    }
+
+    void fail(int fd, const std::string& reason) {
+        Connection& connection = connections[fd];
+        std::uint32_t size = 1 + reason.size();
+        const char* size_bytes = reinterpret_cast<const char*>(&size);
+        connection.output.insert(connection.output.end(), size_bytes, size_bytes + sizeof(size));
+        connection.output.push_back(static_cast<char>(message_error));
+        connection.output.insert(connection.output.end(), reason.begin(), reason.end());
+        connection.closing = true;
+        flush(fd);
+    }
+
+    void drop(int fd) {
+        Connection& connection = connections[fd];
+        if (connection.fd < 0) {
+            return;
+        }
+        epoll_ctl(epoll_fd, EPOLL_CTL_DEL, fd, nullptr);
+        close(fd);
+        if (connection.table >= 0) {
+            if (table_busy[connection.table]) {
+                table_owner[connection.table] = { -1, 0 };  // released when its job comes back
+            } else {
+                release_table(connection.table);
+            }
+        }
+        connection.fd = -1;
+        connection.table = -1;
+        connection.input = std::vector<char>();
+        connection.output = std::vector<char>();
+    }
+};
+
+struct Benchmark_Report {
+    std::uint64_t actions{0};
+    std::uint64_t hands{0};
+    double seconds{0};
+    double p50_us{0};
+    double p99_us{0};
+    double p999_us{0};
+    double max_us{0};
+};
+
+// Test client: opens many connections, joins a table on each and answers every decision at once, measuring
+// the time from sending an action to receiving the next decision
+inline Benchmark_Report run_benchmark_client(const std::string& address_text, int nr_of_clients, int actions_per_client) {
+    raise_descriptor_limit();
+    Address address = parse_address(address_text);
+    int epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    struct Client {
+        int fd{-1};
+        std::vector<char> input;
+        std::chrono::steady_clock::time_point action_sent;
+        bool action_pending{false};
+        int actions_left{0};
+    };
+    std::vector<Client> clients(nr_of_clients);
+    std::vector<std::uint32_t> latencies_ns;
+    latencies_ns.reserve(static_cast<std::size_t>(nr_of_clients) * actions_per_client);
+    Cards::Session_Rng rng(7);
+    Benchmark_Report report;
+
+    auto send_message = [](int fd, const char* bytes, std::size_t size) {
+        // messages are tiny, a full socket buffer here means the server stopped reading
+        if (send(fd, bytes, size, MSG_NOSIGNAL) != static_cast<ssize_t>(size)) {
+            throw std::runtime_error("Could not send to the server.");
+        }
+    };
+
+    for (int i{0}; i < nr_of_clients; i++) {
+        Client& client = clients[i];
+        client.fd = open_socket(address);
+        int result = with_sockaddr(address, [&client](const sockaddr* a, socklen_t size) { return connect(client.fd, a, size); });
+        if (result != 0 && errno != EINPROGRESS) {
+            throw std::runtime_error("Could not connect to " + address_text);
+        }
+        client.actions_left = actions_per_client;
+        client.input.reserve(1024);
+        epoll_event event{};
+        event.events = EPOLLIN;
+        event.data.u32 = i;
+        epoll_ctl(epoll_fd, EPOLL_CTL_ADD, client.fd, &event);
+    }
+    // connections to a Unix socket or to loopback complete at once, so the joins can go out right away
+    for (auto& client : clients) {
+        std::vector<char> bytes;
+        append_message(bytes, Join_Message{});
+        pollfd writable{ client.fd, POLLOUT, 0 };
+        poll(&writable, 1, 1000);
+        send_message(client.fd, bytes.data(), bytes.size());
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    int clients_left = nr_of_clients;
+    std::array<epoll_event, 256> events;
+    char buffer[16384];
+    while (clients_left > 0) {
+        int count = epoll_wait(epoll_fd, events.data(), events.size(), 5000);
+        if (count == 0) {
+            throw std::runtime_error("The server stopped answering.");
+        }
+        for (int e{0}; e < count; e++) {
+            Client& client = clients[events[e].data.u32];
+            ssize_t received = recv(client.fd, buffer, sizeof(buffer), 0);
+            if (received <= 0) {
+                if (received < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+                    continue;
+                }
+                throw std::runtime_error("The server closed a connection.");
+            }
+            client.input.insert(client.input.end(), buffer, buffer + received);
+            std::size_t offset{0};
+            while (client.input.size() - offset >= 4) {
+                std::uint32_t size;
+                std::memcpy(&size, &client.input[offset], sizeof(size));
+                if (client.input.size() - offset < 4 + size) {
+                    break;
+                }
+                std::uint8_t type = static_cast<std::uint8_t>(client.input[offset + 4]);
+                offset += 4 + size;
+                if (type == message_error) {
+                    throw std::runtime_error("The server reported an error.");
+                }
+                if (type == message_hand_result) {
+                    report.hands += 1;
+                    continue;
+                }
+                if (type != message_decision) {
+                    continue;
+                }
+                auto now = std::chrono::steady_clock::now();
+                if (client.action_pending) {
+                    latencies_ns.push_back(static_cast<std::uint32_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(now - client.action_sent).count()));
+                    client.action_pending = false;
+                }
+                if (client.actions_left == 0) {
+                    epoll_ctl(epoll_fd, EPOLL_CTL_DEL, client.fd, nullptr);
+                    close(client.fd);
+                    clients_left -= 1;
+                    offset = client.input.size();
+                    break;
+                }
+                Action_Message action;
+                action.action = static_cast<std::uint8_t>(rng() % 4 == 0 ? Env::action_min_raise : Env::action_check_call);
+                std::vector<char> bytes;
+                bytes.reserve(8);
+                append_message(bytes, action);
+                client.action_sent = std::chrono::steady_clock::now();
+                client.action_pending = true;
+                client.actions_left -= 1;
+                report.actions += 1;
+                send_message(client.fd, bytes.data(), bytes.size());
+            }
+            client.input.erase(client.input.begin(), client.input.begin() + std::min(offset, client.input.size()));
+        }
+    }
+    report.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    close(epoll_fd);
+
+    std::sort(latencies_ns.begin(), latencies_ns.end());
+    auto percentile = [&latencies_ns](double p) {
+        return latencies_ns.empty() ? 0.0 : latencies_ns[std::min(latencies_ns.size() - 1, static_cast<std::size_t>(p * latencies_ns.size()))] / 1000.0;
+    };
+    report.p50_us = percentile(0.5);
+    report.p99_us = percentile(0.99);
+    report.p999_us = percentile(0.999);
+    report.max_us = latencies_ns.empty() ? 0.0 : latencies_ns.back() / 1000.0;
+    return report;
+}
+
+} // namespace Server end
+
+// Coroutine table driver: every table is a coroutine that suspends when a seat with an input source has to
+// act and resumes when the source delivers the action, so one thread runs any number of tables whose
+// players are thinking. Seats without a source are played by the tournament bots.
+namespace Driver {
+
+struct Table_Settings {
+    int nr_of_seats{6};
+    int starting_chips{200};
+    int big_blind{2};
+    int nr_of_hands{100};
+};
+
+class Table_Scheduler {
+private:
+    std::vector<std::unique_ptr<Table>> tables;
+    std::vector<Input_Source*> sources;
+    std::deque<int> ready;
+    std::uint64_t nr_of_suspensions{0};
+    std::uint64_t nr_of_hands{0};
+    int nr_of_waiting{0};
+    int most_waiting{0};
+
+public:
+    // Adds a table whose seats with a source get their actions from it, and gives its index
+    int add_table(const Table_Settings& settings, const std::vector<Input_Source*>& seat_sources, std::uint64_t seed) {
+        if (settings.nr_of_seats < 2 || settings.nr_of_seats > Game_State::max_seats || seat_sources.size() > static_cast<std::size_t>(settings.nr_of_seats)) {
+            throw std::invalid_argument("Tables seat 2 to 21 players.");
+        }
+        if (settings.big_blind < 2 || settings.starting_chips <= settings.big_blind) {
+            throw std::invalid_argument("The stacks have to cover more than a big blind of at least 2 chips.");
+        }
+        int index = tables.size();
+        tables.push_back(std::make_unique<Table>());
+        Table& table = *tables.back();
+        table.rng = Cards::Session_Rng(seed);
+        std::copy(seat_sources.begin(), seat_sources.end(), table.sources.begin());
+        for (Input_Source* source : seat_sources) {
+            if (source != nullptr && std::find(sources.begin(), sources.end(), source) == sources.end()) {
+                sources.push_back(source);
+            }
+        }
+        table.task = play_table(index, settings);
+        ready.push_back(index);
+        return index;
+    }
+
+    // Adds a table that runs a coroutine of the interactive game, whose human decides through source
+    int add_game(Game::Game& game, Input_Source* source, Table_Task task) {
+        int index = tables.size();
+        tables.push_back(std::make_unique<Table>());
+        Table& table = *tables.back();
+        table.sources[Game::Game::human_seat] = source;
+        if (std::find(sources.begin(), sources.end(), source) == sources.end()) {
+            sources.push_back(source);
+        }
+        game.attach_input(table);
+        table.task = std::move(task);
+        ready.push_back(index);
+        return index;
+    }
+
+    // Hands the action of the given Env kind to a waiting table; the table runs on the next scheduling round
+    void deliver(int table, int action_kind) {
+        deliver(table, Env::agent_action(tables.at(table)->state, action_kind));
+    }
+
+    // Hands an exact action to a waiting table, for sources that size their own raises.
+    // The table checks it against its rules.
+    void deliver(int table, const Action& action) {
+        Table& waiting_table = *tables.at(table);
+        if (!waiting_table.waiting || waiting_table.has_answer) {
+            throw std::logic_error("The table is not waiting for an action.");
+        }
+        waiting_table.answer = action;
+        waiting_table.has_answer = true;
+        nr_of_waiting -= 1;
+        ready.push_back(table);
+    }
+
+    // Runs until every table played its hands
+    void run() {
+        std::size_t tables_left = tables.size();
+        while (tables_left > 0) {
+            while (!ready.empty()) {
+                int index = ready.front();
+                Table& table = *tables[index];
+                ready.pop_front();
+                std::coroutine_handle<> handle = table.waiting ? std::exchange(table.waiting, {}) : table.task.get_handle();
+                handle.resume();
+                if (table.task.is_done()) {
+                    table.task.check();
+                    tables_left -= 1;
+                } else if (table.waiting) {
+                    // parked at an Input_Awaiter: ask the source of the seat to act
+                    nr_of_suspensions += 1;
+                    nr_of_waiting += 1;
+                    most_waiting = std::max(most_waiting, nr_of_waiting);
+                    table.sources[table.state.to_act]->request(*this, index, table.state);
+                }
+            }
+            if (tables_left == 0) {
+                break;
+            }
+            // poll every source without blocking, then wait on the first one so a lone source does not spin
+            for (std::size_t i{1}; i < sources.size(); i++) {
+                sources[i]->poll(*this, 0);
+            }
+            if (ready.empty()) {
+                if (sources.empty()) {
+                    throw std::logic_error("Tables are waiting without an input source.");
+                }
+                sources[0]->poll(*this, 1);
+            }
+        }
+    }
+
+    const Table& get_table(int table) const { return *tables[table]; }
+    int get_nr_of_tables() const { return tables.size(); }
+    std::uint64_t get_nr_of_suspensions() const { return nr_of_suspensions; }
+    std::uint64_t get_nr_of_hands() const { return nr_of_hands; }
+    int get_most_waiting() const { return most_waiting; }
+
+private:
+    Table_Task play_table(int index, Table_Settings settings) {
+        Table& table = *tables[index];
+        Game_State& state = table.state;
+        int seats = settings.nr_of_seats;
+        table.stacks.fill(settings.starting_chips);
+        int button{0};
+        for (int hand{0}; hand < settings.nr_of_hands; hand++) {
+            for (int seat{0}; seat < seats; seat++) {
+                if (table.stacks[seat] < settings.big_blind) {
+                    table.stacks[seat] = settings.starting_chips;  // cash game: busted players buy in again
+                    table.results[seat] -= settings.starting_chips;
+                }
+            }
+            std::array<std::uint8_t, 52> deck;
+            for (int i{0}; i < 52; i++) {
+                deck[i] = static_cast<std::uint8_t>(i);
+            }
+            for (int i{0}; i < 2 * seats + 5; i++) {
+                int j = i + static_cast<int>(table.rng() % static_cast<std::uint64_t>(52 - i));
+                std::swap(deck[i], deck[j]);
+            }
+            button = (button + 1) % seats;
+            table.hand_id += 1;
+            state.start_hand(seats, table.stacks.data(), deck.data(), deck.data() + 2 * seats, button, settings.big_blind / 2, settings.big_blind);
+            while (!state.hand_is_over()) {
+                if (table.sources[state.to_act] != nullptr) {
+                    Action action = co_await Input_Awaiter{table};
+                    state.apply(state.is_legal(action) ? action : Env::agent_action(state, Env::action_check_call));
+                } else {
+                    state.apply(Tournament::choose_action(state, table.rng));
+                }
+            }
+            std::array<std::int32_t, Game_State::max_seats> won{};
+            state.settle([&state](int seat) { return state.showdown_strength(seat); }, won);
+            for (int seat{0}; seat < seats; seat++) {
+                std::int32_t stack = state.chips[seat] + won[seat];
+                table.results[seat] += stack - table.stacks[seat];
+                table.stacks[seat] = stack;
+            }
+            nr_of_hands += 1;
+        }
+    }
+};
+
+// Table coroutine of an interactive session of nr_of_games games
+inline Table_Task play_session(Game::Game& game, int nr_of_games) {
+    co_await game.play_multiple_games(nr_of_games);
+}
+
+// Table coroutine of one headless game; played tells whether there were bots left to play it
+inline Table_Task play_unattended_game(Game::Game& game, bool& played) {
+    played = co_await game.play_unattended_game();
+}
+
+inline int parse_action_word(const std::string& word) {
+    if (word == "fold") {
+        return Env::action_fold;
+    } else if (word == "check" || word == "call") {
+        return Env::action_check_call;
+    } else if (word == "raise") {
+        return Env::action_min_raise;
+    } else if (word == "pot") {
+        return Env::action_pot_raise;
+    } else if (word == "allin") {
+        return Env::action_all_in;
+    }
+    return -1;
+}
+
+// Asks a person at the console; reading blocks, so this is for one table at a time
+class Console_Input : public Input_Source {
+public:
+    void request(Table_Scheduler& scheduler, int table, const Game_State& state) override {
+        const std::uint8_t* hole = state.hole(state.to_act);
+        std::cout << "Table " << table << ": you hold " << Cards::card_from_index(hole[0]) << ' '
+                  << Cards::card_from_index(hole[1]) << ", board";
+        int nr_of_board_cards = state.street == Game_State::preflop ? 0 : std::min(state.street + 2, 5);
+        for (int i{0}; i < nr_of_board_cards; i++) {
+            std::cout << ' ' << Cards::card_from_index(state.board[i]);
+        }
+        std::cout << ", pot " << state.pot << ", to call " << state.amount_to_call(state.to_act) << ", stack "
+                  << state.chips[state.to_act] << std::endl;
+        int kind{-1};
+        while (kind < 0) {
+            std::cout << "fold, check, call, raise, pot, allin" << std::endl;
+            std::string word;
+            if (!(std::cin >> word)) {
+                throw std::runtime_error("The console input ended.");
+            }
+            kind = parse_action_word(word);
+        }
+        scheduler.deliver(table, kind);
+    }
+};
+
+// The interactive game's console, asking the way the game always has: an action word and, after raise,
+// the chips to bet or to add on top of the call. Whether the action fits the spot is the game's call.
+class Game_Console_Input : public Input_Source {
+public:
+    void request(Table_Scheduler& scheduler, int table, const Game_State& state) override {
+        int seat = state.to_act;
+        std::string word;
+        while (word != "fold" && word != "check" && word != "call" && word != "raise") {
+            if (!(std::cin >> word)) {
+                throw std::runtime_error("The console input ended.");
+            }
+            if (word != "fold" && word != "check" && word != "call" && word != "raise") {
+                std::cerr << "Invalid action. " << '\n';
+            }
+        }
+        if (word != "raise") {
+            Action_Type type = word == "fold" ? Action_Type::fold : word == "check" ? Action_Type::check : Action_Type::call;
+            scheduler.deliver(table, Action{ type, 0 });
+            return;
+        }
+
+        int to_call = state.level - state.committed[seat];
+        int chips{0};
+        if (state.chips[seat] > to_call) {
+            int max_chips{0};
+            for (int i{0}; i < state.nr_of_seats; i++) {
+                if (i != seat && !state.is_folded(i)) {
+                    max_chips = std::max(max_chips, state.chips[i]);
+                }
+            }
+            if (to_call == 0) {
+                std::cout << "You have " << state.chips[seat] << " chips" << std::endl << "max opponent chips are: " << max_chips
+                          << std::endl << "How much are you betting?" << std::endl;
+            } else {
+                std::cout << "How many extra chips are you adding?\n" << " You currently have " << state.chips[seat] - to_call
+                          << " chips. Max opponent chips: " << max_chips << std::endl;
+            }
+            if (state.variant == Game::Variant::omaha) {
+                std::cout << "The pot limit allows up to " << state.max_raise_to() - (state.level - state.street_start_level)
+                          << " chips." << std::endl;
+            }
+            if (!(std::cin >> chips)) {
+                if (std::cin.eof()) {
+                    throw std::runtime_error("The console input ended.");
+                }
+                // not a number: the game turns the empty raise down and asks again
+                std::cin.clear();
+                std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+                chips = 0;
+            }
+        }
+        scheduler.deliver(table, Action{ Action_Type::raise, state.level - state.street_start_level + chips });
+    }
+};
+
+// Plays an interactive session as the only table of a driver, the human answering at the console
+inline void run_console_session(Game::Game& game, int nr_of_games) {
+    Table_Scheduler driver;
+    Game_Console_Input console;
+    driver.add_game(game, &console, play_session(game, nr_of_games));
+    driver.run();
+}
+
+// Replays a fixed list of action words, starting over when it runs out
+class Script_Input : public Input_Source {
+private:
+    std::vector<int> actions;
+    std::size_t next{0};
+
+public:
+    explicit Script_Input(const std::string& script) {
+        std::istringstream words(script);
+        std::string word;
+        while (words >> word) {
+            int kind = parse_action_word(word);
+            if (kind < 0) {
+                throw std::invalid_argument("Unknown action in the script: " + word);
+            }
+            actions.push_back(kind);
+        }
+        if (actions.empty()) {
+            throw std::invalid_argument("The script has no actions.");
+        }
+    }
+
+    void request(Table_Scheduler& scheduler, int table, const Game_State&) override {
+        scheduler.deliver(table, actions[next]);
+        next = (next + 1) % actions.size();
+    }
+};
+
+// Random agent that answers after a random think time, standing in for remote players
+class Thinking_Agent_Input : public Input_Source {
+private:
+    using Clock = std::chrono::steady_clock;
+    struct Pending {
+        Clock::time_point due;
+        int table;
+        int action;
+        bool operator>(const Pending& other) const { return due > other.due; }
+    };
+    std::priority_queue<Pending, std::vector<Pending>, std::greater<>> pending;
+    Cards::Session_Rng rng;
+    int max_think_us;
+
+public:
+    Thinking_Agent_Input(int i_max_think_us, std::uint64_t seed) : rng(seed), max_think_us(i_max_think_us) {}
+
+    void request(Table_Scheduler&, int table, const Game_State&) override {
+        auto think = std::chrono::microseconds(max_think_us > 0 ? rng() % static_cast<std::uint64_t>(max_think_us) : 0);
+        int action = rng() % 4 == 0 ? Env::action_min_raise : Env::action_check_call;
+        pending.push({ Clock::now() + think, table, action });
+    }
+
+    void poll(Table_Scheduler& scheduler, int timeout_ms) override {
+        if (pending.empty()) {
+            return;
+        }
+        auto now = Clock::now();
+        if (pending.top().due > now && timeout_ms > 0) {
+            std::this_thread::sleep_until(std::min(pending.top().due, now + std::chrono::milliseconds(timeout_ms)));
+            now = Clock::now();
+        }
+        while (!pending.empty() && pending.top().due <= now) {
+            scheduler.deliver(pending.top().table, pending.top().action);
+            pending.pop();
+        }
+    }
+};
+
+// Seats played over stream sockets with the server protocol: each table's seat sends a decision message
+// and reads back an action message on the table's socket
+class Socket_Input : public Input_Source {
+private:
+    struct Peer {
+        int fd{-1};
+        int table{-1};
+        std::vector<char> input;
+    };
+    int epoll_fd;
+    std::vector<Peer> peers;          // indexed by descriptor
+    std::vector<int> table_fds;       // indexed by table
+
+public:
+    Socket_Input() : epoll_fd(epoll_create1(EPOLL_CLOEXEC)) {
+        if (epoll_fd < 0) {
+            throw std::runtime_error("Could not create an epoll instance.");
+        }
+    }
+    ~Socket_Input() override { close(epoll_fd); }
+    Socket_Input(const Socket_Input&) = delete;
+    Socket_Input& operator=(const Socket_Input&) = delete;
+
+    // The table's seat is played over fd, which stays owned by the caller
+    void attach(int table, int fd) {
+        if (static_cast<std::size_t>(fd) >= peers.size()) {
+            peers.resize(fd + 1);
+        }
+        if (static_cast<std::size_t>(table) >= table_fds.size()) {
+            table_fds.resize(table + 1, -1);
+        }
+        peers[fd] = Peer{ fd, table, {} };
+        table_fds[table] = fd;
+        epoll_event event{};
+        event.events = EPOLLIN;
+        event.data.fd = fd;
+        epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &event);
+    }
+
+    void request(Table_Scheduler& scheduler, int table, const Game_State& state) override {
+        std::vector<char> bytes;
+        Server::append_message(bytes, Server::decision_message(state, scheduler.get_table(table).hand_id));
+        std::size_t sent_total{0};
+        while (sent_total < bytes.size()) {
+            ssize_t sent = send(table_fds.at(table), bytes.data() + sent_total, bytes.size() - sent_total, MSG_NOSIGNAL);
+            if (sent < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+                throw std::runtime_error("Could not send a decision to table " + std::to_string(table));
+            }
+            if (sent < 0) {
+                pollfd writable{ table_fds[table], POLLOUT, 0 };
+                ::poll(&writable, 1, 100);
+                continue;
+            }
+            sent_total += sent;
+        }
+    }
+
+    void poll(Table_Scheduler& scheduler, int timeout_ms) override {
+        std::array<epoll_event, 64> events;
+        int count = epoll_wait(epoll_fd, events.data(), events.size(), timeout_ms);
+        char buffer[4096];
+        for (int e{0}; e < count; e++) {
+            Peer& peer = peers[events[e].data.fd];
+            ssize_t received = recv(peer.fd, buffer, sizeof(buffer), MSG_DONTWAIT);
+            if (received == 0 || (received < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)) {
+                throw std::runtime_error("The player of table " + std::to_string(peer.table) + " disconnected.");
+            }
+            if (received < 0) {
+                continue;
+            }
+            peer.input.insert(peer.input.end(), buffer, buffer + received);
+            std::size_t offset{0};
+            while (peer.input.size() - offset >= 4 + sizeof(Server::Action_Message)) {
+                std::uint32_t size;
+                std::memcpy(&size, &peer.input[offset], sizeof(size));
+                Server::Action_Message action;
+                std::memcpy(&action, &peer.input[offset + 4], sizeof(action));
+                if (size != sizeof(action) || action.type != Server::message_action || action.action >= Env::nr_of_actions) {
+                    throw std::runtime_error("Invalid message from the player of table " + std::to_string(peer.table));
+                }
+                offset += 4 + size;
+                scheduler.deliver(peer.table, action.action);
+            }
+            peer.input.erase(peer.input.begin(), peer.input.begin() + offset);
+        }
+    }
+};
+
+} // namespace Driver end
+
+// Earliest-deadline-first scheduling of bot decisions from many tables on a worker pool. Policies are
+// anytime: they get a time budget out of their slack, return their best answer when it runs out, and
+// stop early when a more urgent decision needs the worker.
+namespace Scheduling {
+
+using Game::Game_State;
+using Clock = std::chrono::steady_clock;
+
+// What a policy sees of its time: answer by the deadline, or as soon as it is preempted
+struct Time_Budget {
+    Clock::time_point deadline;
+    const std::atomic<bool>* preempted;
+
+    bool should_stop() const { return preempted->load(std::memory_order_relaxed) || Clock::now() >= deadline; }
+};
+
+// Gives an Env action kind for the seat to act
+using Policy = std::function<int(const Game_State&, const Time_Budget&)>;
+
+struct Policy_Stats {
+    std::string name;
+    std::uint64_t decisions{0};
+    std::uint64_t deadline_misses{0};
+    std::uint64_t preemptions{0};
+    double cpu_seconds{0};
+    double worst_lateness_ms{0};  // latest finish after the deadline
+};
+
+struct Scheduler_Stats {
+    int queue_depth{0};
+    int max_queue_depth{0};
+    std::vector<Policy_Stats> policies;
+};
+
+inline double thread_cpu_seconds() {
+    timespec now{};
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &now);
+    return now.tv_sec + now.tv_nsec * 1e-9;
+}
+
+class Decision_Scheduler {
+public:
+    enum class Order { earliest_deadline, arrival };  // arrival is first come first served, for comparison
+
+private:
+    struct Request {
+        Clock::time_point deadline;
+        std::uint64_t sequence;
+        int policy;
+        const Game_State* state;            // left alone by its table until done is called
+        std::function<void(int)> done;
+    };
+
+    // one per worker: what it runs, so a more urgent arrival can preempt it
+    struct Worker_Slot {
+        bool busy{false};
+        Clock::time_point budget_end;
+        std::atomic<bool> preempted{false};
+    };
+
+    Order order;
+    Clock::duration margin;                 // kept free before a deadline to hand the answer back
+    std::vector<std::pair<std::string, Policy>> policies;
+    std::vector<Policy_Stats> policy_stats;
+    std::vector<Request> queue;             // a heap ordered by later()
+    std::uint64_t next_sequence{0};
+    int max_queue_depth{0};
+    unsigned nr_of_slots;
+    std::unique_ptr<Worker_Slot[]> slots;
+    mutable std::mutex mutex;
+    std::condition_variable has_requests;
+    bool stopping{false};
+    std::vector<std::thread> threads;
+
+    // heap comparison: true when a should run after b
+    bool later(const Request& a, const Request& b) const {
+        if (order == Order::earliest_deadline && a.deadline != b.deadline) {
+            return a.deadline > b.deadline;
+        }
+        return a.sequence > b.sequence;
+    }
+
+public:
+    Decision_Scheduler(unsigned nr_of_workers, Order i_order = Order::earliest_deadline,
+                       Clock::duration i_margin = std::chrono::microseconds(200))
+        : order(i_order), margin(i_margin), nr_of_slots(std::max(1u, nr_of_workers)),
+          slots(std::make_unique<Worker_Slot[]>(nr_of_slots)) {
+        for (unsigned w{0}; w < nr_of_slots; w++) {
+            threads.emplace_back([this, w]() { work(w); });
+        }
+    }
+
+    ~Decision_Scheduler() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        has_requests.notify_all();
+        for (auto& thread : threads) {
+            thread.join();
+        }
+    }
+
+    Decision_Scheduler(const Decision_Scheduler&) = delete;
+    Decision_Scheduler& operator=(const Decision_Scheduler&) = delete;
+
+    // Registers a policy before the first request and gives its id
+    int add_policy(const std::string& name, Policy policy) {
+        std::lock_guard<std::mutex> lock(mutex);
+        policies.emplace_back(name, std::move(policy));
+        policy_stats.push_back(Policy_Stats{ name });
+        return policies.size() - 1;
+    }
+
+    // Queues a decision; done gets the action kind on a worker thread
+    void submit(int policy, const Game_State& state, Clock::time_point deadline, std::function<void(int)> done) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            queue.push_back(Request{ deadline, next_sequence++, policy, &state, std::move(done) });
+            std::push_heap(queue.begin(), queue.end(), [this](const Request& a, const Request& b) { return later(a, b); });
+            max_queue_depth = std::max<int>(max_queue_depth, queue.size());
+            if (order == Order::earliest_deadline) {
+                preempt_for(deadline);
+            }
+        }
+        has_requests.notify_one();
+    }
+
+    Scheduler_Stats stats() const {
+        std::lock_guard<std::mutex> lock(mutex);
+        return Scheduler_Stats{ static_cast<int>(queue.size()), max_queue_depth, policy_stats };
+    }
+
+private:
+    // When every worker is busy, the one that would run longest past the new deadline wraps up
+    void preempt_for(Clock::time_point deadline) {
+        Worker_Slot* latest{nullptr};
+        for (unsigned w{0}; w < nr_of_slots; w++) {
+            Worker_Slot& slot = slots[w];
+            if (!slot.busy) {
+                return;
+            }
+            if (!slot.preempted.load(std::memory_order_relaxed) && (latest == nullptr || slot.budget_end > latest->budget_end)) {
+                latest = &slot;
+            }
+        }
+        if (latest != nullptr && latest->budget_end > deadline - margin) {
+            latest->preempted.store(true, std::memory_order_relaxed);
+        }
+    }
+
+    void work(unsigned worker) {
+        Worker_Slot& slot = slots[worker];
+        auto heap_order = [this](const Request& a, const Request& b) { return later(a, b); };
+        while (true) {
+            Request request;
+            Time_Budget budget;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                has_requests.wait(lock, [this]() { return stopping || !queue.empty(); });
+                if (stopping) {
+                    return;
+                }
+                std::pop_heap(queue.begin(), queue.end(), heap_order);
+                request = std::move(queue.back());
+                queue.pop_back();
+                // the policy may use its slack, but not time the next queued decision needs once the other
+                // workers are busy too; an idle one picks that decision up itself
+                Clock::time_point budget_end = request.deadline - margin;
+                bool others_busy{true};
+                for (unsigned w{0}; w < nr_of_slots; w++) {
+                    if (w != worker && !slots[w].busy) {
+                        others_busy = false;
+                    }
+                }
+                if (!queue.empty() && others_busy && order == Order::earliest_deadline) {
+                    budget_end = std::min(budget_end, queue.front().deadline - margin);
+                }
+                slot.busy = true;
+                slot.budget_end = budget_end;
+                slot.preempted.store(false, std::memory_order_relaxed);
+                budget = Time_Budget{ budget_end, &slot.preempted };
+            }
+            double cpu_start = thread_cpu_seconds();
+            int kind = policies[request.policy].second(*request.state, budget);
+            double cpu = thread_cpu_seconds() - cpu_start;
+            Clock::time_point finished = Clock::now();
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                Policy_Stats& stats = policy_stats[request.policy];
+                stats.decisions += 1;
+                stats.cpu_seconds += cpu;
+                stats.preemptions += slot.preempted.load(std::memory_order_relaxed) ? 1 : 0;
+                if (finished > request.deadline) {
+                    stats.deadline_misses += 1;
+                    stats.worst_lateness_ms = std::max(stats.worst_lateness_ms,
+                                                       std::chrono::duration<double, std::milli>(finished - request.deadline).count());
+                }
+                slot.busy = false;
+            }
+            request.done(kind);
+        }
+    }
+};
+
+// Anytime policy: samples the equity against the players still in the hand until the budget runs out or
+// the estimate is precise, then folds below the pot odds, raises with a clear edge and calls otherwise
+inline Policy equity_policy(double tolerance = 0.01) {
+    return [tolerance](const Game_State& state, const Time_Budget& budget) {
+        int seat = state.to_act;
+        int nr_of_board_cards = state.street == Game_State::preflop ? 0 : std::min(state.street + 2, 5);
+        Eval::Sampling_Options options;
+        options.tolerance = tolerance;
+        options.min_samples = 0;
+        options.deadline = budget.deadline;
+        options.stop = budget.preempted;
+        std::uint64_t seed = 0x9E3779B97F4A7C15ull * (state.pot + 131 * seat + 7919 * state.hole(seat)[0]);
+        Eval::Equity_Result equity = Eval::sample_equity(state.hole(seat), state.board.data(), nr_of_board_cards,
+                                                         state.nr_of_players_in_hand() - 1, options, seed);
+        int to_call = state.amount_to_call(seat);
+        double pot_odds = to_call > 0 ? static_cast<double>(to_call) / (state.pot + to_call) : 0;
+        if (to_call > 0 && equity.equity < pot_odds) {
+            return Env::action_fold;
+        }
+        if (equity.equity > 0.5 + 0.5 * pot_odds) {
+            return equity.equity > 0.8 ? Env::action_pot_raise : Env::action_min_raise;
+        }
+        return Env::action_check_call;
+    };
+}
+
+// Seats of coroutine driver tables whose decisions run on the scheduler, each due think_time after it
+// was asked for
+class Scheduled_Bot_Input : public Driver::Input_Source {
+private:
+    Decision_Scheduler& scheduler;
+    int policy;
+    Clock::duration think_time;
+    std::mutex mutex;
+    std::condition_variable has_answers;
+    std::vector<std::pair<int, int>> answers;  // table and action kind, delivered on the driver's thread
+    std::vector<std::pair<int, int>> delivering;
+
+public:
+    Scheduled_Bot_Input(Decision_Scheduler& i_scheduler, int i_policy, Clock::duration i_think_time)
+        : scheduler(i_scheduler), policy(i_policy), think_time(i_think_time) {}
+
+    void request(Driver::Table_Scheduler& tables, int table, const Game_State& state) override {
+        (void)tables;
+        scheduler.submit(policy, state, Clock::now() + think_time, [this, table](int kind) {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                answers.emplace_back(table, kind);
+            }
+            has_answers.notify_one();
+        });
+    }
+
+    void poll(Driver::Table_Scheduler& tables, int timeout_ms) override {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            if (answers.empty() && timeout_ms > 0) {
+                has_answers.wait_for(lock, std::chrono::milliseconds(timeout_ms));
+            }
+            delivering.swap(answers);
+        }
+        for (auto [table, kind] : delivering) {
+            tables.deliver(table, kind);
+        }
+        delivering.clear();
+    }
+};
+
+} // namespace Scheduling end
+
+// Stress runs of the full Game::run hand loop without a person: the human's answers come from a looping
+// script, the console output is discarded, and every hand is timed and its heap use measured.
+// Build with -DPOKER_COUNT_ALLOCATIONS to count every allocation as well.
+namespace Stress {
+
+// Heap bytes in use as the allocator sees them, so the shipped binary keeps the default operator new
+inline long heap_in_use() {
+    struct mallinfo2 info = mallinfo2();
+    return static_cast<long>(info.uordblks + info.hblkhd);
+}
+
+#ifdef POKER_COUNT_ALLOCATIONS
+// Allocations of the calling thread, counted by the operator new of the counting build below main
+inline thread_local std::uint64_t allocations{0};
+inline thread_local std::uint64_t allocated_bytes{0};
+#endif
+
+// Endless input: the script starts over whenever it has been read
+class Looping_Input : public std::streambuf {
+private:
+    std::string script;
+
+protected:
+    int_type underflow() override {
+        setg(script.data(), script.data(), script.data() + script.size());
+        return traits_type::to_int_type(script[0]);
+    }
+
+public:
+    explicit Looping_Input(std::string i_script) : script(std::move(i_script)) {
+        if (script.empty()) {
+            throw std::invalid_argument("The input script is empty.");
+        }
+    }
+};
+
+class Discarding_Output : public std::streambuf {
+protected:
+    int_type overflow(int_type c) override { return traits_type::not_eof(c); }
+    std::streamsize xsputn(const char*, std::streamsize count) override { return count; }
+};
+
+// Points cin at a script and cout and cerr at nothing until it goes out of scope
+class Console_Redirect {
+private:
+    Looping_Input input;
+    Discarding_Output output;
+    std::streambuf* saved_in;
+    std::streambuf* saved_out;
+    std::streambuf* saved_err;
+
+public:
+    explicit Console_Redirect(const std::string& script)
+        : input(script), saved_in(std::cin.rdbuf(&input)), saved_out(std::cout.rdbuf(&output)), saved_err(std::cerr.rdbuf(&output)) {}
+
+    ~Console_Redirect() {
+        std::cin.rdbuf(saved_in);
+        std::cout.rdbuf(saved_out);
+        std::cerr.rdbuf(saved_err);
+        std::cin.clear();
+    }
+
+    Console_Redirect(const Console_Redirect&) = delete;
+    Console_Redirect& operator=(const Console_Redirect&) = delete;
+};
+
+struct Scenario {
+    std::string name;
+    int difficulty{2};
+    int starting_chips{1000};
+    std::string script;      // the human's answers, numbers only right after raise
+    bool split_board{false}; // a royal flush on every board, so every showdown is split
+    double river_deadline_ms{20.0};
+};
+
+inline std::vector<Scenario> scenarios() {
+    return {
+        { "baseline", 3, 1000, "check call ", false, 20.0 },
+        // shoves: the biggest raise the game accepts, so most hands go all in before the flop
+        { "all-in", 3, 1000, "raise 1000000 raise 100000 raise 10000 raise 1000 raise 100 raise 10 call check ", false, 20.0 },
+        { "split-pots", 3, 1000, "check call ", true, 20.0 },
+        { "tiny-stacks", 1, 20, "call check ", false, 20.0 },
+        // deep bot stacks keep one game going, so the pot's bet history grows for the whole run;
+        // a short river solver deadline keeps thousands of hands quick
+        { "long-session", 4, 1000, "check call ", false, 1.0 },
+    };
+}
+
+struct Stress_Report {
+    std::string scenario;
+    int nr_of_seats{0};
+    int hands{0};
+    int restarts{0};                 // games started again after every bot was out
+    double seconds{0};
+    double p50_us{0};
+    double p99_us{0};
+    double p999_us{0};
+    double max_us{0};
+    double first_tenth_us{0};        // mean hand time over the first and the last tenth of the run
+    double last_tenth_us{0};
+    double allocations_per_hand{-1};  // -1 unless the build counts allocations
+    double bytes_per_hand{-1};
+    long heap_growth_kb{0};
+    std::size_t bet_history{0};      // bets the pot keeps at the end of the run
+    long peak_rss_kb{0};
+    long rss_growth_kb{0};
+};
+
+inline long current_rss_kb() {
+    long pages_total{0};
+    long pages_resident{0};
+    if (FILE* file = std::fopen("/proc/self/statm", "r")) {
+        if (std::fscanf(file, "%ld %ld", &pages_total, &pages_resident) != 2) {
+            pages_resident = 0;
+        }
+        std::fclose(file);
+    }
+    return pages_resident * (sysconf(_SC_PAGESIZE) / 1024);
+}
+
+inline long peak_rss_kb() {
+    rusage usage{};
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss;
+}
+
+// Plays hands of the scenario with the human and nr_of_bots bots, a new game whenever every bot is out
+inline Stress_Report run_scenario(const Scenario& scenario, int nr_of_bots, int nr_of_hands, std::uint64_t seed) {
+    Stress_Report report;
+    report.scenario = scenario.name;
+    report.nr_of_seats = nr_of_bots + 1;
+    std::vector<double> hand_us;
+    hand_us.reserve(nr_of_hands);
+    long rss_before = current_rss_kb();
+    long heap_before = heap_in_use();
+#ifdef POKER_COUNT_ALLOCATIONS
+    std::uint64_t allocations_before = allocations;
+    std::uint64_t bytes_before = allocated_bytes;
+#endif
+    {
+        Console_Redirect redirect(scenario.script);
+        Driver::Game_Console_Input console;
+        std::unique_ptr<Game::Game> game;
+        auto new_game = [&]() {
+            game = std::make_unique<Game::Game>(scenario.difficulty, nr_of_bots, scenario.starting_chips);
+            game->reseed(seed + report.restarts);
+            game->river_deadline_ms = scenario.river_deadline_ms;
+            if (scenario.split_board) {
+                game->fix_board({ Cards::Card("♠", "10"), Cards::Card("♠", "J"), Cards::Card("♠", "Q"),
+                                  Cards::Card("♠", "K"), Cards::Card("♠", "A") });
+            }
+        };
+        new_game();
+        auto start = std::chrono::steady_clock::now();
+        while (static_cast<int>(hand_us.size()) < nr_of_hands) {
+            auto hand_start = std::chrono::steady_clock::now();
+            // every game is a table of its own driver, the human answering from the scripted console
+            bool played{false};
+            Driver::Table_Scheduler driver;
+            driver.add_game(*game, &console, Driver::play_unattended_game(*game, played));
+            driver.run();
+            if (!played) {
+                report.restarts += 1;
+                new_game();
+                continue;
+            }
+            hand_us.push_back(std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - hand_start).count());
+        }
+        report.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        report.bet_history = game->get_bet_history_size();
+        report.heap_growth_kb = (heap_in_use() - heap_before) / 1024;
+    }
+    report.hands = hand_us.size();
+#ifdef POKER_COUNT_ALLOCATIONS
+    report.allocations_per_hand = static_cast<double>(allocations - allocations_before) / std::max(report.hands, 1);
+    report.bytes_per_hand = static_cast<double>(allocated_bytes - bytes_before) / std::max(report.hands, 1);
+#endif
+    report.peak_rss_kb = peak_rss_kb();
+    report.rss_growth_kb = current_rss_kb() - rss_before;
+
+    int tenth = std::max(1, report.hands / 10);
+    if (report.hands > 0) {
+        report.first_tenth_us = std::accumulate(hand_us.begin(), hand_us.begin() + std::min(tenth, report.hands), 0.0) / std::min(tenth, report.hands);
+        report.last_tenth_us = std::accumulate(hand_us.end() - std::min(tenth, report.hands), hand_us.end(), 0.0) / std::min(tenth, report.hands);
+    }
+    std::sort(hand_us.begin(), hand_us.end());
+    auto percentile = [&hand_us](double p) {
+        return hand_us.empty() ? 0.0 : hand_us[std::min(hand_us.size() - 1, static_cast<std::size_t>(p * hand_us.size()))];
+    };
+    report.p50_us = percentile(0.5);
+    report.p99_us = percentile(0.99);
+    report.p999_us = percentile(0.999);
+    report.max_us = hand_us.empty() ? 0.0 : hand_us.back();
+    return report;
+}
+
+inline void print_report(const Stress_Report& report) {
+    std::cout << report.scenario << ", " << report.nr_of_seats << " seats: " << report.hands / std::max(report.seconds, 1e-9)
+              << " hands/s, hand us p50 " << report.p50_us << " p99 " << report.p99_us << " p999 " << report.p999_us
+              << " max " << report.max_us << ", first/last tenth " << report.first_tenth_us << "/" << report.last_tenth_us << " us, ";
+    if (report.allocations_per_hand >= 0) {
+        std::cout << report.allocations_per_hand << " allocations (" << report.bytes_per_hand / 1024 << " KiB) per hand, ";
+    }
+    std::cout << "heap grew " << report.heap_growth_kb << " KiB, " << report.bet_history << " bets kept, RSS peak " << report.peak_rss_kb
+              << " KiB grew " << report.rss_growth_kb << " KiB, " << report.restarts << " restarts" << std::endl;
+}
+
+} // namespace Stress end
+
+#if defined(POKER_COUNT_ALLOCATIONS) && !defined(POKER_NO_MAIN)
+// Counts allocations for the stress reports of a counting build; kept out of line so the
+// compiler does not pair the malloc and free inside with new and delete expressions
+__attribute__((noinline)) void* operator new(std::size_t size) {
+    Stress::allocations += 1;
+    Stress::allocated_bytes += size;
+    if (void* memory = std::malloc(size == 0 ? 1 : size)) {
+        return memory;
+    }
+    throw std::bad_alloc();
+}
+
+__attribute__((noinline)) void* operator new[](std::size_t size) {
+    return operator new(size);
+}
+
+__attribute__((noinline)) void operator delete(void* memory) noexcept {
+    std::free(memory);
+}
+
+__attribute__((noinline)) void operator delete[](void* memory) noexcept {
+    std::free(memory);
+}
+
+__attribute__((noinline)) void operator delete(void* memory, std::size_t) noexcept {
+    std::free(memory);
+}
+
+__attribute__((noinline)) void operator delete[](void* memory, std::size_t) noexcept {
+    std::free(memory);
+}
+#endif // POKER_COUNT_ALLOCATIONS
+
+
+bool Game::Ranking::has_run=false;
+
+
+#ifndef POKER_NO_MAIN
+int main(int argc, char* argv[]) {
+    //replay mode re-scores logged hand history files instead of starting a game
+    if (argc > 2 && std::string(argv[1]) == "--replay") {
+        std::vector<std::string> shards(argv + 2, argv + argc);
+        try {
+            Replay::replay_shards(shards, std::thread::hardware_concurrency()).print();
+        } catch (const std::exception& e) {
+            std::cout << e.what() << '\n';
+            return 1;
+        }
+        return 0;
+    }
+    //export mode writes the hands of history files as per-hand and per-decision tables, --csv for text output
+    if (argc > 3 && std::string(argv[1]) == "--export") {
+        bool csv = std::string(argv[3]) == "--csv";
+        std::vector<std::string> shards(argv + (csv ? 4 : 3), argv + argc);
+        try {
+            auto start = std::chrono::steady_clock::now();
+            Game::Export::Exporter exporter(argv[2], csv ? Game::Export::Format::csv : Game::Export::Format::columnar);
+            std::uint64_t hands = Game::Export::export_shards(shards, exporter, std::thread::hardware_concurrency());
+            exporter.close();
+            double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            std::cout << "Exported " << hands << " hands (" << exporter.hands.rows_written() << " seat rows, "
+                      << exporter.decisions.rows_written() << " decision rows) in " << seconds << " s" << std::endl;
+        } catch (const std::exception& e) {
+            std::cout << e.what() << '\n';
+            return 1;
+        }
+        return 0;
+    }
+    //tournament mode plays a freezeout between bots on many tables: --tournament <entrants> [seed] [--omaha | --short-deck]
+    if (argc > 2 && std::string(argv[1]) == "--tournament") {
+        try {
+            Tournament::Tournament_Settings settings;
+            settings.nr_of_entrants = std::stoi(argv[2]);
+            for (int i{3}; i < argc; i++) {
+                if (std::string(argv[i]) == "--omaha") {
+                    settings.variant = Game::Variant::omaha;  // pot-limit Omaha
+                } else if (std::string(argv[i]) == "--short-deck") {
+                    settings.variant = Game::Variant::short_deck;
+                } else {
+                    settings.seed = std::stoull(argv[i]);
+                }
+            }
+            Tournament::Tournament_Director director(settings);
+            Tournament::Tournament_Result result = director.run();
+            const std::vector<Tournament::Entrant>& entrants = director.get_entrants();
+            std::cout << "Tournament of " << settings.nr_of_entrants << " players finished after " << result.hands_played << " hands and "
+                      << result.levels_reached << " blind levels in " << result.seconds << " s" << std::endl;
+            std::cout << "tables broken: " << result.tables_broken << ", players moved: " << result.players_moved << std::endl;
+            for (std::size_t i{0}; i < result.places.size() && i < 10; i++) {
+                std::cout << "  " << i + 1 << ". " << entrants[result.places[i]].name << std::endl;
+            }
+        } catch (const std::exception& e) {
+            std::cout << e.what() << '\n';
+            return 1;
+        }
+        return 0;
+    }
+    //measures the training environment with random agent actions: --env-benchmark <tables> [steps]
+    if (argc > 2 && std::string(argv[1]) == "--env-benchmark") {
+        try {
+            int nr_of_tables = std::stoi(argv[2]);
+            int nr_of_steps = argc > 3 ? std::stoi(argv[3]) : 1000;
+            Env::Vector_Env env({ nr_of_tables, 6, 200, 2 });
+            std::vector<std::uint64_t> seeds(nr_of_tables);
+            for (int i{0}; i < nr_of_tables; i++) {
+                seeds[i] = 0x5EED + i;
+            }
+            std::vector<std::int32_t> actions(nr_of_tables);
+            std::vector<float> rewards(nr_of_tables);
+            std::vector<std::uint8_t> dones(nr_of_tables);
+            std::vector<float> observations(static_cast<std::size_t>(nr_of_tables) * env.get_observation_size());
+            Cards::Session_Rng rng(1);
+            env.reset(seeds.data());
+            std::uint64_t episodes{0};
+            double total_reward{0};
+            auto start = std::chrono::steady_clock::now();
+            for (int step{0}; step < nr_of_steps; step++) {
+                env.observe(observations.data());
+                for (auto& action : actions) {
+                    action = static_cast<std::int32_t>(rng() % Env::nr_of_actions);
+                }
+                env.step(actions.data(), rewards.data(), dones.data());
+                for (int i{0}; i < nr_of_tables; i++) {
+                    episodes += dones[i];
+                    total_reward += rewards[i];
+                }
+            }
+            double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            std::cout << static_cast<double>(nr_of_tables) * nr_of_steps / seconds << " table steps/s, " << episodes / seconds
+                      << " hands/s, random agent result " << total_reward / std::max<std::uint64_t>(episodes, 1) << " bb/hand" << std::endl;
+        } catch (const std::exception& e) {
+            std::cout << e.what() << '\n';
+            return 1;
+        }
+        return 0;
+    }
+    //serves tables to many clients over a Unix socket path or host:port: --server <address> [workers]
+    if (argc > 2 && std::string(argv[1]) == "--server") {
+        try {
+            unsigned nr_of_workers = argc > 3 ? std::stoi(argv[3]) : std::max(1u, std::thread::hardware_concurrency());
+            Server::Game_Server server(argv[2], nr_of_workers);
+            auto request_stop = [](int) { Server::stop_requested.store(true); };
+            std::signal(SIGINT, request_stop);
+            std::signal(SIGTERM, request_stop);
+            std::cout << "Serving on " << argv[2] << " with " << nr_of_workers << " workers." << std::endl;
+            server.run();
+            std::cout << "Stopped after " << server.get_messages_received() << " messages." << std::endl;
+        } catch (const std::exception& e) {
+            std::cout << e.what() << '\n';
+            return 1;
+        }
+        return 0;
+    }
+    //measures a running server with many clients: --server-bench <address> <clients> [actions per client]
+    if (argc > 3 && std::string(argv[1]) == "--server-bench") {
+        try {
+            int nr_of_clients = std::stoi(argv[3]);
+            int nr_of_actions = argc > 4 ? std::stoi(argv[4]) : 100;
+            Server::Benchmark_Report report = Server::run_benchmark_client(argv[2], nr_of_clients, nr_of_actions);
+            std::cout << nr_of_clients << " clients, " << report.actions / report.seconds << " actions/s, "
+                      << report.hands / report.seconds << " hands/s\n";
+            std::cout << "action latency us: p50 " << report.p50_us << ", p99 " << report.p99_us << ", p999 " << report.p999_us
+                      << ", max " << report.max_us << std::endl;
+        } catch (const std::exception& e) {
+            std::cout << e.what() << '\n';
+            return 1;
+        }
+        return 0;
+    }
+    //runs many tables on one thread, seat 0 of each played by a thinking agent, the console or a script:
+    //--coroutine-tables <tables> [hands] [max think us] [--console | --script "<actions>"]
+    if (argc > 2 && std::string(argv[1]) == "--coroutine-tables") {
+        try {
+            int nr_of_tables = std::stoi(argv[2]);
+            int nr_of_hands = argc > 3 ? std::stoi(argv[3]) : 100;
+            int max_think_us = argc > 4 && argv[4][0] != '-' ? std::stoi(argv[4]) : 1000;
+            Driver::Thinking_Agent_Input agents(max_think_us, 11);
+            Driver::Console_Input console;
+            std::unique_ptr<Driver::Script_Input> script;
+            Driver::Input_Source* source = &agents;
+            for (int i{3}; i < argc; i++) {
+                if (std::string(argv[i]) == "--console") {
+                    source = &console;
+                } else if (std::string(argv[i]) == "--script" && i + 1 < argc) {
+                    script = std::make_unique<Driver::Script_Input>(argv[i + 1]);
+                    source = script.get();
+                }
+            }
+            Driver::Table_Scheduler scheduler;
+            Driver::Table_Settings settings;
+            settings.nr_of_hands = nr_of_hands;
+            for (int table{0}; table < nr_of_tables; table++) {
+                scheduler.add_table(settings, { source }, 0x7AB1E + table);
             }
-
-            
-            
-            
-            int highest_chips{0};
-            for (auto &object : bots_in_the_game ){
-                highest_chips = std::max(highest_chips, object.get_chips());
+            auto start = std::chrono::steady_clock::now();
+            scheduler.run();
+            double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            std::int64_t result{0};
+            for (int table{0}; table < nr_of_tables; table++) {
+                result += scheduler.get_table(table).results[0];
             }
-            if (highest_chips == 0){
-                deck.take_flop();
-                deck.take_turn();
-                deck.take_river();
-                break;
+            std::cout << nr_of_tables << " tables, " << scheduler.get_nr_of_hands() / seconds << " hands/s, "
+                      << scheduler.get_nr_of_suspensions() << " waits for input, at most " << scheduler.get_most_waiting()
+                      << " tables waiting at once, seat 0 result " << result << " chips" << std::endl;
+        } catch (const std::exception& e) {
+            std::cout << e.what() << '\n';
+            return 1;
+        }
+        return 0;
+    }
+    //bot decisions of many tables on a deadline scheduler, two seats per table due fast and four with more slack:
+    //--edf-bench <tables> [hands] [workers] [--fifo]
+    if (argc > 2 && std::string(argv[1]) == "--edf-bench") {
+        try {
+            int nr_of_tables = std::stoi(argv[2]);
+            int nr_of_hands = argc > 3 && argv[3][0] != '-' ? std::stoi(argv[3]) : 20;
+            unsigned nr_of_workers = argc > 4 && argv[4][0] != '-' ? std::stoi(argv[4]) : std::max(1u, std::thread::hardware_concurrency());
+            bool fifo = std::string(argv[argc - 1]) == "--fifo";
+            Scheduling::Decision_Scheduler scheduler(nr_of_workers, fifo ? Scheduling::Decision_Scheduler::Order::arrival
+                                                                         : Scheduling::Decision_Scheduler::Order::earliest_deadline);
+            int fast = scheduler.add_policy("equity, due in 5 ms", Scheduling::equity_policy());
+            int slow = scheduler.add_policy("equity, due in 50 ms", Scheduling::equity_policy());
+            Scheduling::Scheduled_Bot_Input fast_seats(scheduler, fast, std::chrono::milliseconds(5));
+            Scheduling::Scheduled_Bot_Input slow_seats(scheduler, slow, std::chrono::milliseconds(50));
+            Driver::Table_Scheduler tables;
+            Driver::Table_Settings settings;
+            settings.nr_of_hands = nr_of_hands;
+            for (int table{0}; table < nr_of_tables; table++) {
+                tables.add_table(settings, { &fast_seats, &fast_seats, &slow_seats, &slow_seats, &slow_seats, &slow_seats }, 0xEDF + table);
             }
-            
-            if (human_in_the_game == true && human.get_chips()>0 && round !=1){
-                bots_responded = human_turn();
-            } if (bots_in_the_game.size()>0 && bots_responded == false && round !=1){
-                bot_turn();
-            } else if ((bots_in_the_game.size() == 0 && human_in_the_game == true) || (bots_in_the_game.size()==1 && human_in_the_game == false)){
-                //ends the main game round loop if there is only a single player remaining in the game
-                deck.take_flop();
-                deck.take_turn();
-                deck.take_river();
-                break;
+            auto start = std::chrono::steady_clock::now();
+            tables.run();
+            double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            Scheduling::Scheduler_Stats stats = scheduler.stats();
+            std::cout << nr_of_tables << " tables, " << nr_of_workers << (fifo ? " workers, first come first served: " : " workers, earliest deadline first: ")
+                      << tables.get_nr_of_hands() / seconds << " hands/s, most queued decisions " << stats.max_queue_depth << std::endl;
+            for (const auto& policy : stats.policies) {
+                std::cout << " " << policy.name << ": " << policy.decisions << " decisions, " << policy.deadline_misses << " missed ("
+                          << 100.0 * policy.deadline_misses / std::max<std::uint64_t>(policy.decisions, 1) << "%, worst "
+                          << policy.worst_lateness_ms << " ms late), " << policy.preemptions << " preempted, "
+                          << 1000 * policy.cpu_seconds / std::max<std::uint64_t>(policy.decisions, 1) << " ms CPU per decision" << std::endl;
             }
-            
-        
-        }//game round loop ends
-        
-        
-        std::vector<Player> remaining_players;
-        std::cout<<"the number of bots left was: "<< bots_in_the_game.size()<<std::endl;
-        if (human_in_the_game == true){
-            remaining_players.push_back(human);
+        } catch (const std::exception& e) {
+            std::cout << e.what() << '\n';
+            return 1;
         }
-        
-        std::cout<<"final community pot: "<<pot.get_final_pot()<<std::endl;
-        std::cout<<"final community cards: ";
-        deck.print_community_cards();
-
-        
-        if (bots_in_the_game.size()>0){
-            for (const auto& bot : bots_in_the_game) {
-            remaining_players.push_back(bot);
+        return 0;
+    }
+    //plays the full hand loop headless in adversarial scenarios and reports speed, tail latency and memory:
+    //--stress [hands per run] [scenario]
+    if (argc > 1 && std::string(argv[1]) == "--stress") {
+        try {
+            int nr_of_hands = argc > 2 ? std::stoi(argv[2]) : 200;
+            std::string only = argc > 3 ? argv[3] : "";
+            bool found{false};
+            for (const Stress::Scenario& scenario : Stress::scenarios()) {
+                if (!only.empty() && scenario.name != only) {
+                    continue;
+                }
+                found = true;
+                for (int nr_of_bots : { 1, 5, 10, 20 }) {
+                    Stress::print_report(Stress::run_scenario(scenario, nr_of_bots, nr_of_hands, 0x57E55 + nr_of_bots));
+                }
             }
+            if (!found) {
+                throw std::invalid_argument("Unknown scenario " + only);
+            }
+        } catch (const std::exception& e) {
+            std::cout << e.what() << '\n';
+            return 1;
         }
-    
-        
-        // Determine the winner
-        std::vector<std::string> winner_names;
-        Ranking ranking;
-        
-        winner_names = ranking.determine_winner(remaining_players, deck);
-        
-       
-        // distribute the pot among winners
-        distribute_pot(winner_names, remaining_players, pot.get_final_pot());
-        
-        
-        //introduce game analytics for human player
-        
-        game_analytics(winner_names, remaining_players, ranking);
-        
-        
-        
-        //delete bots that are out of the game
-        bot.delete_defeated_bots();
-        
-       
-        //reset pot
-        pot.reset();
-        
-        //reset game cards
-        
-        deck.reset();
-        
-        Ranking::reset();   
-        
-        
-        it_is_the_first_game = false;
-        
-        
-   
-    }//run function ending
-    
-   
-    
-    void play_multiple_games(int nr_of_games) {
-        for (int game = 1; game <= nr_of_games; ++game) {
-            
-            if(human.get_chips() > 0) {
-                if(bot.get_bots_number() > 0 || it_is_the_first_game == true){
-                    //if all conditions are met, the game continues
-                    std::cout << "\n \n \n The Poker Game number " << game << " begins!\n";
-                    run();
+        return 0;
+    }
+    //solves every push/fold chart ahead of time so bots never wait for a solve: --solve-push-fold [file]
+    if (argc > 1 && std::string(argv[1]) == "--solve-push-fold") {
+        try {
+            auto start = std::chrono::steady_clock::now();
+            Push_Fold::Chart_Cache charts(argc > 2 ? argv[2] : "poker_pushfold.bin");
+            charts.solve_all(std::max(1u, std::thread::hardware_concurrency()));
+            const Push_Fold::Chart& heads_up = charts.chart(2, 10);
+            double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            std::cout << "Push/fold charts for 2-" << Push_Fold::max_players << " players and 1-" << Push_Fold::max_stack_bb
+                      << " big blinds solved in " << seconds << " s" << std::endl;
+            std::cout << "heads up at 10 big blinds the small blind pushes " << heads_up.push_percentage(0) << "% of hands" << std::endl;
+        } catch (const std::exception& e) {
+            std::cout << e.what() << '\n';
+            return 1;
+        }
+        return 0;
+    }
+    //trains the heads-up blueprint of the impossible bots: --train-cfr <iterations> [checkpoint] [--buckets file]
+    if (argc > 2 && std::string(argv[1]) == "--train-cfr") {
+        try {
+            std::uint64_t nr_of_iterations = std::stoull(argv[2]);
+            std::string checkpoint_path = "poker_cfr.ckpt";
+            std::unique_ptr<Game::Buckets::Bucket_Table> card_buckets;
+            for (int i{3}; i < argc; i++) {
+                if (std::string(argv[i]) == "--buckets" && i + 1 < argc) {
+                    card_buckets = std::make_unique<Game::Buckets::Bucket_Table>(argv[++i]);
+                } else {
+                    checkpoint_path = argv[i];
                 }
-                if (bot.get_bots_number() == 0 && it_is_the_first_game == false) {
-                    std::cout << "\nCONGRATULATIONS! You have successfully defeated all of the bot players! Throughout these poker games you increased your chips up to: " << human.get_chips() << std::endl;
-                    break;
+            }
+            unsigned nr_of_threads = std::max(1u, std::thread::hardware_concurrency());
+            Game::Cfr::Abstraction abstraction;
+            abstraction.card_buckets = card_buckets.get();
+            Game::Cfr::Trainer trainer(abstraction, 21, 0xCF5);
+            if (trainer.load_checkpoint(checkpoint_path)) {
+                std::cout << "Resuming from " << checkpoint_path << " after " << trainer.iterations() << " iterations" << std::endl;
+            }
+            std::uint64_t chunk = std::max<std::uint64_t>(1, nr_of_iterations / 10);
+            for (std::uint64_t done{0}; done < nr_of_iterations; done += chunk) {
+                auto start = std::chrono::steady_clock::now();
+                trainer.train(std::min(chunk, nr_of_iterations - done), nr_of_threads);
+                double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+                double exploitability = trainer.estimate_exploitability(100000, 20000, 20, nr_of_threads);
+                trainer.save_checkpoint(checkpoint_path);
+                std::cout << trainer.iterations() << " iterations, " << static_cast<std::uint64_t>(std::min(chunk, nr_of_iterations - done) / seconds)
+                          << " iterations/s, " << trainer.strategy_table().size() << " info sets, exploitability at least "
+                          << exploitability << " mbb/hand" << std::endl;
+            }
+            trainer.blueprint().save("poker_blueprint.bin");
+            std::cout << "Blueprint saved to poker_blueprint.bin" << std::endl;
+        } catch (const std::exception& e) {
+            std::cout << e.what() << '\n';
+            return 1;
+        }
+        return 0;
+    }
+    //bucket mode builds the EHS card abstraction for the bots: --build-buckets [file] [buckets per street]
+    if (argc > 1 && std::string(argv[1]) == "--build-buckets") {
+        try {
+            std::string path = argc > 2 ? argv[2] : "poker_buckets.bin";
+            int nr_of_buckets = argc > 3 ? std::stoi(argv[3]) : 64;
+            Game::Buckets::Builder builder(path, nr_of_buckets, std::max(1u, std::thread::hardware_concurrency()));
+            builder.build();
+            std::cout << "Bucket table saved to " << path << std::endl;
+        } catch (const std::exception& e) {
+            std::cout << e.what() << '\n';
+            return 1;
+        }
+        return 0;
+    }
+    //icm mode prints the prize equity of chip stacks: --icm <payout,payout,...> <stacks...>
+    if (argc > 3 && std::string(argv[1]) == "--icm") {
+        try {
+            std::vector<double> payouts;
+            std::string payout_list = argv[2];
+            for (std::size_t start{0}, end; start <= payout_list.size(); start = end + 1) {
+                end = std::min(payout_list.find(',', start), payout_list.size());
+                payouts.push_back(std::stod(payout_list.substr(start, end - start)));
+            }
+            std::vector<double> stacks;
+            for (int i{3}; i < argc; i++) {
+                stacks.push_back(std::stod(argv[i]));
+            }
+            std::vector<double> equity = Icm::equity(stacks, payouts);
+            for (std::size_t i{0}; i < stacks.size(); i++) {
+                std::cout << "stack " << stacks[i] << ": " << equity[i] << std::endl;
+            }
+        } catch (const std::exception& e) {
+            std::cout << e.what() << '\n';
+            return 1;
+        }
+        return 0;
+    }
+    //equity of two hole cards against random hands, sampled until precise enough or out of time:
+    //--equity <hole> [--board <cards>] [--opponents n] [--tolerance t] [--deadline-ms ms]
+    if (argc > 2 && std::string(argv[1]) == "--equity") {
+        try {
+            std::uint8_t hole[2];
+            std::uint8_t board[5];
+            int nr_of_board_cards{0};
+            int nr_of_opponents{1};
+            Eval::Sampling_Options options;
+            if (Game::Ranges::parse_cards(argv[2], hole, 2) != 2) {
+                throw std::invalid_argument("Give two hole cards, like AhKd.");
+            }
+            for (int i{3}; i + 1 < argc; i += 2) {
+                std::string option = argv[i];
+                if (option == "--board") {
+                    nr_of_board_cards = Game::Ranges::parse_cards(argv[i + 1], board, 5);
+                } else if (option == "--opponents") {
+                    nr_of_opponents = std::stoi(argv[i + 1]);
+                } else if (option == "--tolerance") {
+                    options.tolerance = std::stod(argv[i + 1]);
+                } else if (option == "--deadline-ms") {
+                    options.deadline = std::chrono::steady_clock::now() + std::chrono::microseconds(static_cast<long long>(1000 * std::stod(argv[i + 1])));
+                } else {
+                    throw std::invalid_argument("Unknown option " + option);
                 }
-            } else if (human.get_chips() == 0) {
-                // when the user lost the game
-                while (true) {
-                    try {
-                        std::cout << "\nYou have lost the game... It appears that you do not have any chips left. Now you can choose one out of two options:\n"
-                                  << "buyback - get free chips and continue playing\n"
-                                  << "quit - quits the program\n";
-                        std::string human_input;
-                        std::getline(std::cin, human_input); // Use getline to handle spaces in the input
-                        if (human_input == "buyback"){
-                            human.receive_pot_share(starting_chips);
-                            game -= 1;
-                            break;
-                        } else if (human_input == "quit"){
-                            while (true) {
-                                try {
-                                    std::cout << "Before you quit, would you like to see the previous games betting history [yes/no]? ";
-                                    std::string user_response;
-                                    std::getline(std::cin, user_response); // Use getline to handle spaces in the input
-                                    if (user_response == "yes"){
-                                        const std::vector<std::shared_ptr<Bet>>& bet_history = pot.get_bets();
-                                        for (const auto& bet : bet_history) {
-                                            std::cout << "Player " << bet->get_player_name() << " bet "
-                                                      << bet->get_amount() << " chips." << std::endl;
-                                        }
-                                        return;
-                                    } else if (user_response == "no"){
-                                        return;
-                                    } else {
-                                        throw std::invalid_argument("Invalid response. Please answer 'yes' or 'no'.");
-                                    }
-                                } catch (const std::exception& e) {
-                                    std::cout << e.what() << '\n';
-                                    throw; // Re-throw the exception to be caught by the outer loop
-                                }
-                            }
-                        } else {
-                            throw std::invalid_argument("Invalid response. Please choose 'buyback' or 'quit'.");
-                            }
-                    } catch (const std::exception& e) {
-                        std::cout << e.what() << '\n';
-                        continue;
-                        }
+            }
+            for (int i{0}; i < nr_of_board_cards; i++) {
+                if (board[i] == hole[0] || board[i] == hole[1]) {
+                    throw std::invalid_argument("The board repeats a hole card.");
                 }
-    
-            }   
+            }
+            auto start = std::chrono::steady_clock::now();
+            Eval::Equity_Result result = Eval::sample_equity(hole, board, nr_of_board_cards, nr_of_opponents, options, 1);
+            double milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+            std::cout << "equity " << result.equity * 100 << "% +- " << result.error * 100 << "% (win " << result.win * 100
+                      << "%, tie " << result.tie * 100 << "%) from " << result.samples << " samples in " << milliseconds << " ms" << std::endl;
+        } catch (const std::exception& e) {
+            std::cout << e.what() << '\n';
+            return 1;
         }
-            // after the games have passed
-            std::string user_response;
-            while (true) {
-                try {
-                    std::cout<<  "The game has finished. Restart the program if you would like to play again \n Would you like to see betting history? [yes/no] \n";
-                    std::cin >> user_response;
-            
-                    if (user_response == "yes") {
-                        const std::vector<std::shared_ptr<Bet>>& bet_history = pot.get_bets();
-                        for (const auto& bet : bet_history) {
-                            std::cout << "Player " << bet->get_player_name() << " bet "
-                                    << bet->get_amount() << " chips." << std::endl;
-                        }
-                        break;
-                    } else if (user_response != "no") {
-                        throw std::invalid_argument("Invalid response. Please answer 'yes' or 'no'.");
-                    } else {
-                        break;
-                    }
-                } catch (const std::invalid_argument& e) {
-                    std::cout << e.what() << '\n';
-                }
+        return 0;
+    }
+    //range equity mode prints the equity of weighted ranges: --range-equity [--board AsKd7c] "22+, A2s+" "QQ+, AK:0.5" ...
+    if (argc > 3 && std::string(argv[1]) == "--range-equity") {
+        try {
+            int first_range{2};
+            std::uint8_t board[5];
+            int nr_of_board_cards{0};
+            if (std::string(argv[2]) == "--board") {
+                nr_of_board_cards = Game::Ranges::parse_cards(argv[3], board, 5);
+                first_range = 4;
             }
-     
+            std::vector<Game::Ranges::Range> ranges;
+            for (int i{first_range}; i < argc; i++) {
+                ranges.push_back(Game::Ranges::parse_range(argv[i]));
+            }
+            Game::Ranges::Range_Equity result = Game::Ranges::range_equity(ranges, board, nr_of_board_cards, 5000, 200, 1,
+                                                                           std::max(1u, std::thread::hardware_concurrency()));
+            for (std::size_t i{0}; i < ranges.size(); i++) {
+                std::cout << argv[first_range + i] << ": " << result.equity[i] * 100 << "%" << std::endl;
+            }
+            std::cout << result.nr_of_boards << (result.exact ? " runouts, exact" : " runouts, sampled") << std::endl;
+        } catch (const std::exception& e) {
+            std::cout << e.what() << '\n';
+            return 1;
+        }
+        return 0;
     }
-
-};
-
-} //namespace Game end
-
-bool Game::Ranking::has_run=false;
-
-
-int main() {
+    //import mode converts text hand histories from poker sites into a binary hand history
+    if (argc > 3 && std::string(argv[1]) == "--import") {
+        std::vector<std::string> text_files(argv + 3, argv + argc);
+        try {
+            Game::History::Hand_History_Writer writer(argv[2]);
+            Import::import_text_histories(text_files, writer).print();
+        } catch (const std::exception& e) {
+            std::cout << e.what() << '\n';
+            return 1;
+        }
+        return 0;
+    }
+    
     int bot_number;
     int nr_of_games;
     int starting_chips;
     int difficulty;
+    const std::string session_path = "poker_session.bin";
+    const std::string history_path = "poker_history.bin";
+    const std::string push_fold_path = "poker_pushfold.bin";
+    const std::string blueprint_path = "poker_blueprint.bin";
+    const std::string buckets_path = "poker_buckets.bin";
+    //--short-deck plays the interactive game with the 36 card deck, --omaha plays it as pot-limit Omaha,
+    //--export-session <prefix> [--csv] also writes its hands as per-hand and per-decision tables
+    Game::Variant variant = Game::Variant::holdem;
+    std::string export_prefix;
+    bool export_csv{false};
+    for (int i{1}; i < argc; i++) {
+        std::string option = argv[i];
+        if (option == "--short-deck") {
+            variant = Game::Variant::short_deck;
+        } else if (option == "--omaha") {
+            variant = Game::Variant::omaha;
+        } else if (option == "--export-session" && i + 1 < argc) {
+            export_prefix = argv[++i];
+        } else if (option == "--csv") {
+            export_csv = true;
+        }
+    }
+    Game::Export::Format export_format = export_csv ? Game::Export::Format::csv : Game::Export::Format::columnar;
+    
+    //a session that was interrupted can be resumed from its last snapshot
+    Game::Session_Snapshot snapshot;
+    bool snapshot_found = false;
+    try {
+        snapshot = Game::Session_Snapshot::load(session_path);
+        snapshot_found = snapshot.games_played < snapshot.nr_of_games;
+    } catch (const std::runtime_error&) {
+        snapshot_found = false;
+    }
+    if (snapshot_found) {
+        std::string user_response;
+        while (user_response != "yes" && user_response != "no") {
+            std::cout << "An unfinished session was found (" << snapshot.games_played << " of " << snapshot.nr_of_games
+                      << " games played). Would you like to resume it? [yes/no] ";
+            // closed input counts as no, or the prompt would repeat forever
+            if (!(std::cin >> user_response)) {
+                user_response = "no";
+            }
+        }
+        if (user_response == "yes") {
+            Game::Game game(snapshot.difficulty, snapshot.nr_of_bots, snapshot.starting_chips, static_cast<Game::Variant>(snapshot.variant));
+            game.restore(snapshot);
+            game.enable_autosave(session_path);
+            game.enable_hand_history(history_path);
+            if (!export_prefix.empty()) {
+                game.enable_export(export_prefix, export_format);
+            }
+            game.enable_push_fold_charts(push_fold_path);
+            game.enable_card_buckets(buckets_path);
+            game.enable_blueprint(blueprint_path);
+            try {
+                Driver::run_console_session(game, snapshot.nr_of_games);
+            } catch (const std::exception& e) {
+                std::cout << e.what() << '\n';
+                return 1;
+            }
+            std::remove(session_path.c_str());
+            return 0;
+        }
+    }
     
-    //user enters the bot number and the input is checked
+    //user enters the bot number and the input is checked, smaller decks and four hole cards allow fewer bots
+    int max_bots = Game::Game::max_bots(variant);
     while (true) {
         try {
-            std::cout<<"Welcome to the poker game, enter the number of bots you will be playing against (5 recommended, 20 max): ";
+            std::cout<<"Welcome to the poker game, enter the number of bots you will be playing against (5 recommended, "<<max_bots<<" max): ";
             std::cin>>bot_number;
 
             if(std::cin.fail()){
+                if (std::cin.eof()) {
+                    return 0; // closed input: nobody is left to answer
+                }
                 std::cin.clear();
                 std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
                 throw std::runtime_error("Please enter a valid integer.");
             }
 
-            if (bot_number <= 0 || bot_number>20) {
-                throw std::runtime_error("The number of bots should be a positive integer, smaller than 20.");
+            if (bot_number <= 0 || bot_number>max_bots) {
+                throw std::runtime_error("The number of bots should be a positive integer, not more than " + std::to_string(max_bots) + ".");
             }
             break;
         } catch (const std::exception& e) {
@@ -1469,6 +11100,9 @@ int main() {
             std::cin>> nr_of_games;
 
             if(std::cin.fail()){
+                if (std::cin.eof()) {
+                    return 0; // closed input: nobody is left to answer
+                }
                 std::cin.clear();
                 std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
                 throw std::runtime_error("Please enter a valid integer.");
@@ -1489,6 +11123,9 @@ int main() {
             std::cin>>starting_chips;
 
             if(std::cin.fail()){
+                if (std::cin.eof()) {
+                    return 0; // closed input: nobody is left to answer
+                }
                 std::cin.clear();
                 std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
                 throw std::runtime_error("Please enter a valid integer.");
@@ -1509,6 +11146,9 @@ int main() {
             std::cin>>difficulty;
 
             if(std::cin.fail()){
+                if (std::cin.eof()) {
+                    return 0; // closed input: nobody is left to answer
+                }
                 std::cin.clear();
                 std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
                 throw std::runtime_error("Please enter a valid integer - 1, 2, 3 or 4.");
@@ -1524,9 +11164,26 @@ int main() {
     }
     
     //main class is initialized
-    Game::Game game(difficulty, bot_number, starting_chips);
-    //game is started
-    game.play_multiple_games(nr_of_games);
+    Game::Game game(difficulty, bot_number, starting_chips, variant);
+    game.enable_autosave(session_path);
+    game.enable_hand_history(history_path);
+    if (!export_prefix.empty()) {
+        game.enable_export(export_prefix, export_format);
+    }
+    game.enable_push_fold_charts(push_fold_path);
+    game.enable_card_buckets(buckets_path);
+    game.enable_blueprint(blueprint_path);
+    //game is started; if the input ends first the autosave is kept, so the session can be resumed
+    try {
+        Driver::run_console_session(game, nr_of_games);
+    } catch (const std::exception& e) {
+        std::cout << e.what() << '\n';
+        return 1;
+    }
+    //the session finished, so there is nothing left to resume
+    std::remove(session_path.c_str());
 
     return 0;
-}
\ No newline at end of file
+}
+
+#endif // POKER_NO_MAIN